@@ -0,0 +1,231 @@
+// Compares DECLARE_HASH_ARRAY against the single probe layout it replaced.
+// The array is churned to the target occupancy so freed and reused slots are
+// mixed in, then live ids, stale ids and use/free cycles are timed.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "platform/platform.cc"
+
+// The previous layout - id hashed to a bucket in a table twice the size of
+// the array with a single probe on lookup.
+#define LEGACY_DECLARE_HASH_ARRAY(type, max_count)                                \
+  constexpr u32 kMax##type = max_count;                                       \
+  constexpr u32 kMaxHash##type = (max_count * 2);                             \
+  static_assert(POWEROF2(kMaxHash##type), "kMaxHash must be a power of 2");   \
+                                                                              \
+  static u32 kAutoIncrementId##type = 1;                                      \
+  static u64 kUsed##type = 0;                                                 \
+                                                                              \
+  static type k##type[max_count];                                             \
+  static HashEntry kHashEntry##type[kMaxHash##type];                          \
+  static type kZero##type;                                                    \
+                                                                              \
+  b8 IsEmptyEntry##type(HashEntry entry)                                      \
+  {                                                                           \
+    return entry.id == kInvalidId || k##type[entry.array_idx].id != entry.id; \
+  }                                                                           \
+                                                                              \
+  u32 Hash##type(u32 id)                                                      \
+  {                                                                           \
+    return MOD_BUCKET(id, kMaxHash##type);                                    \
+  }                                                                           \
+                                                                              \
+  u32 GenerateFreeId##type()                                                  \
+  {                                                                           \
+    u32 id = kAutoIncrementId##type;                                          \
+    HashEntry* hash_entry = &kHashEntry##type[Hash##type(id)];                \
+    while (!IsEmptyEntry##type(*hash_entry)) {                                \
+      id += 1;                                                                \
+      hash_entry = &kHashEntry##type[Hash##type(id)];                         \
+    }                                                                         \
+    kAutoIncrementId##type = id;                                              \
+    return id;                                                                \
+  }                                                                           \
+                                                                              \
+  type* Use##type()                                                           \
+  {                                                                           \
+    assert(kUsed##type < max_count);                                          \
+    if (kUsed##type >= max_count) return nullptr;                             \
+    type* u = &k##type[kUsed##type++];                                        \
+    *u = {};                                                                  \
+    u->id = GenerateFreeId##type();                                           \
+    u32 hash = Hash##type(u->id);                                             \
+    HashEntry* hash_entry = &kHashEntry##type[hash];                          \
+    hash_entry->id = u->id;                                                   \
+    hash_entry->array_idx = kUsed##type - 1;                                  \
+    ++kAutoIncrementId##type;                                                 \
+    return u;                                                                 \
+  }                                                                           \
+                                                                              \
+  type* Find##type(u32 id)                                                    \
+  {                                                                           \
+    if (!id) return nullptr;                                                  \
+    u32 hash = Hash##type(id);                                                \
+    HashEntry* entry = &kHashEntry##type[hash];                               \
+    if (entry->id != id) return nullptr;                                      \
+    return &k##type[entry->array_idx];                                        \
+  }                                                                           \
+                                                                              \
+  void FreeHashEntry##type(u32 id)                                            \
+  {                                                                           \
+    u32 hash = Hash##type(id);                                                \
+    kHashEntry##type[hash] = {0, 0};                                          \
+  }                                                                           \
+                                                                              \
+  void Clear##type(u32 id)                                                    \
+  {                                                                           \
+    if (!id) return;                                                          \
+    u32 hash = Hash##type(id);                                                \
+    HashEntry* entry = &kHashEntry##type[hash];                               \
+    if (entry->id != id) return;                                              \
+    k##type[entry->array_idx] = {};                                           \
+    *entry = {0, 0};                                                          \
+    --kUsed##type;                                                            \
+  }                                                                           \
+                                                                              \
+  void Swap##type(u32 id1, u32 id2)                                           \
+  {                                                                           \
+    if (id1 == id2) return;                                                   \
+    if (!id1) return;                                                         \
+    u32 hash1 = Hash##type(id1);                                              \
+    HashEntry* entry1 = &kHashEntry##type[hash1];                             \
+    if (!id2) return;                                                         \
+    u32 hash2 = Hash##type(id2);                                              \
+    HashEntry* entry2 = &kHashEntry##type[hash2];                             \
+    type t = k##type[entry1->array_idx];                                      \
+    k##type[entry1->array_idx] = k##type[entry2->array_idx];                  \
+    k##type[entry2->array_idx] = t;                                           \
+    u32 tarr = entry1->array_idx;                                             \
+    entry1->array_idx = entry2->array_idx;                                    \
+    entry2->array_idx = tarr;                                                 \
+  }                                                                           \
+                                                                              \
+  void SwapAndClear##type(u32 id)                                             \
+  {                                                                           \
+    Swap##type(id, k##type[kUsed##type - 1].id);                              \
+    Clear##type(id);                                                          \
+  }                                                                           \
+                                                                              \
+  void Reset##type()                                                          \
+  {                                                                           \
+    for (u32 i = 0; i < kMax##type; ++i) {                                    \
+      k##type[i] = {};                                                        \
+    }                                                                         \
+    for (u32 i = 0; i < kMaxHash##type; ++i) {                                \
+      kHashEntry##type[i] = {};                                               \
+    }                                                                         \
+    kUsed##type = 0;                                                          \
+    kAutoIncrementId##type = 1;                                               \
+  }
+
+#define COUNT 65536
+
+struct Unit {
+  u32 id = 0;
+  v2f pos;
+};
+
+struct LegacyUnit {
+  u32 id = 0;
+  v2f pos;
+};
+
+DECLARE_HASH_ARRAY(Unit, COUNT);
+LEGACY_DECLARE_HASH_ARRAY(LegacyUnit, COUNT);
+
+constexpr u32 kLookups = 1 << 22;
+
+struct Timing {
+  r64 hit_nsec;
+  r64 stale_nsec;
+  r64 churn_nsec;
+};
+
+// Fills to load, frees a random half and refills so the free slots aren't
+// all at the end.
+template <typename Use, typename Free>
+std::vector<u32>
+Churn(r32 load, std::mt19937* rng, Use use, Free free, std::vector<u32>* stale)
+{
+  u32 target = (u32)(COUNT * load);
+  std::vector<u32> ids;
+  for (u32 i = 0; i < target; ++i) ids.push_back(use());
+  std::shuffle(ids.begin(), ids.end(), *rng);
+  for (u32 i = 0; i < target / 2; ++i) {
+    free(ids.back());
+    stale->push_back(ids.back());
+    ids.pop_back();
+  }
+  while (ids.size() < target) ids.push_back(use());
+  return ids;
+}
+
+template <typename Use, typename Free, typename Find>
+Timing
+Run(r32 load, Use use, Free free, Find find)
+{
+  std::mt19937 rng(1337);
+  std::vector<u32> stale;
+  std::vector<u32> ids = Churn(load, &rng, use, free, &stale);
+  std::vector<u32> hit(kLookups), miss(kLookups);
+  for (u32 i = 0; i < kLookups; ++i) {
+    hit[i] = ids[rng() % ids.size()];
+    miss[i] = stale[rng() % stale.size()];
+  }
+
+  Timing t;
+  platform::Clock clock;
+  u64 sum = 0;
+  platform::ClockStart(&clock);
+  for (u32 id : hit) sum += find(id) != nullptr;
+  t.hit_nsec = platform::ClockEnd(&clock) * 1000.0 / kLookups;
+  assert(sum == kLookups);
+  sum = 0;
+  platform::ClockStart(&clock);
+  for (u32 id : miss) sum += find(id) != nullptr;
+  t.stale_nsec = platform::ClockEnd(&clock) * 1000.0 / kLookups;
+  // The single probe layout hands ids back out after a wrap so stale ids may
+  // resolve to something else. Report it rather than assert.
+  if (sum) printf("  %lu stale lookups resolved\n", sum);
+  platform::ClockStart(&clock);
+  for (u32 i = 0; i < kLookups / 16; ++i) {
+    u32 idx = rng() % ids.size();
+    free(ids[idx]);
+    ids[idx] = use();
+  }
+  t.churn_nsec = platform::ClockEnd(&clock) * 1000.0 / (kLookups / 16);
+  return t;
+}
+
+int
+main(int argc, char** argv)
+{
+  r32 loads[] = {.5f, .9f};
+  printf("%6s %8s %12s %12s %12s\n", "load", "layout", "hit(ns)", "stale(ns)",
+         "churn(ns)");
+  for (r32 load : loads) {
+    ResetUnit();
+    Timing now = Run(load,
+        []() { return UseUnit()->id; },
+        [](u32 id) { SwapAndClearUnit(id); },
+        [](u32 id) { return FindUnit(id); });
+    ResetLegacyUnit();
+    Timing old = Run(load,
+        []() { return UseLegacyUnit()->id; },
+        [](u32 id) { SwapAndClearLegacyUnit(id); },
+        [](u32 id) { return FindLegacyUnit(id); });
+    printf("%6.2f %8s %12.2f %12.2f %12.2f\n", load, "slot", now.hit_nsec,
+           now.stale_nsec, now.churn_nsec);
+    printf("%6.2f %8s %12.2f %12.2f %12.2f\n", load, "legacy", old.hit_nsec,
+           old.stale_nsec, old.churn_nsec);
+  }
+  return 0;
+}
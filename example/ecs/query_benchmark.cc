@@ -0,0 +1,193 @@
+// Compares ecs::Query against the varargs EntityItr it replaced. Each
+// iterator joins two and three storages where one storage is much smaller
+// than the others, which is the common shape of the live and mood systems.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "memory/memory.cc"
+#include "platform/platform.cc"
+
+enum TypeId : u64 {
+  kPosition = 0,
+  kVelocity = 1,
+  kTag = 2,
+};
+
+struct Position {
+  u32 entity_id = 0;
+  v2f pos;
+};
+
+struct Velocity {
+  u32 entity_id = 0;
+  v2f vel;
+};
+
+struct Tag {
+  u32 entity_id = 0;
+};
+
+#define ENTITY_COUNT 131072
+#include "ecs/ecs.cc"
+
+namespace ecs {
+
+ComponentStorage*
+GetComponents(u64 tid)
+{
+  switch (tid) {
+    case kPosition: {
+      static ecs::ComponentStorage f(ENTITY_COUNT, sizeof(Position), kPosition);
+      return &f;
+    } break;
+    case kVelocity: {
+      static ecs::ComponentStorage f(ENTITY_COUNT, sizeof(Velocity), kVelocity);
+      return &f;
+    } break;
+    case kTag: {
+      static ecs::ComponentStorage f(ENTITY_COUNT, sizeof(Tag), kTag);
+      return &f;
+    } break;
+    default: {
+      assert(!"Unknown component type");
+    } break;
+  }
+  return nullptr;
+}
+
+DECLARE_COMPONENT(Position, kPosition);
+DECLARE_COMPONENT(Velocity, kVelocity);
+DECLARE_COMPONENT(Tag, kTag);
+
+// The previous iterator - type ids passed through varargs and component
+// pointers written into Components by offset.
+struct Components {
+  Position* position = nullptr;
+  Velocity* velocity = nullptr;
+  Tag* tag = nullptr;
+};
+
+template <u32 N>
+struct LegacyItr {
+  LegacyItr(u32 n, ...) {
+    va_list args;
+    va_start(args, n);
+    for (u32 i = 0; i < N; ++i) {
+      u64 tid = va_arg(args, u64);
+      types[i] = tid;
+      comps[i] = GetComponents(tid);
+    }
+    va_end(args);
+    cursor = comps[0]->size();
+  }
+
+  b8 Next() {
+    while (1) {
+      if (cursor > comps[0]->size()) cursor = comps[0]->size();
+      if (cursor == 0) return false;
+      --cursor;
+      u8* ptrs[N];
+      ptrs[0] = comps[0]->Get(cursor);
+      u32 id = *((u32*)(ptrs[0]));
+      b8 match = true;
+      for (u32 i = 1; i < N; ++i) {
+        ptrs[i] = comps[i]->Find(id);
+        if (!ptrs[i]) {
+          match = false;
+          break;
+        }
+      }
+      if (!match) continue;
+      e = FindEntity(id);
+      for (u32 i = 0; i < N; ++i) {
+        u64* comp = (u64*)ptrs[i];
+        void* taddress = (u64*)(&c) + types[i];
+        memcpy(taddress, &comp, sizeof(u64*));
+      }
+      return true;
+    }
+    return false;
+  }
+
+  Entity* e = nullptr;
+  Components c;
+
+  ComponentStorage* comps[N];
+  u64 types[N];
+  u32 cursor = 0;
+};
+
+}
+
+constexpr u32 kEntities = 100000;
+constexpr u32 kRuns = 100;
+
+int
+main(int argc, char** argv)
+{
+  memory::Initialize(MiB(64));
+
+  std::mt19937 rng(1337);
+  std::vector<ecs::Entity*> ents;
+  for (u32 i = 0; i < kEntities; ++i) ents.push_back(ecs::UseEntity());
+  std::shuffle(ents.begin(), ents.end(), rng);
+  // Everything has a position, half have velocity and 1% are tagged.
+  for (u32 i = 0; i < kEntities; ++i) {
+    ecs::AssignPosition(ents[i]);
+    if (i % 2 == 0) ecs::AssignVelocity(ents[i])->vel = v2f(1.f, 1.f);
+    if (i % 100 == 0) ecs::AssignTag(ents[i]);
+  }
+
+  platform::Clock clock;
+  u64 legacy_usec = 0, query_usec = 0;
+
+  platform::ClockStart(&clock);
+  for (u32 r = 0; r < kRuns; ++r) {
+    ecs::LegacyItr<2> itr(2, kPosition, kVelocity);
+    while (itr.Next()) itr.c.position->pos += itr.c.velocity->vel;
+  }
+  legacy_usec = platform::ClockEnd(&clock);
+
+  platform::ClockStart(&clock);
+  for (u32 r = 0; r < kRuns; ++r) {
+    ecs::Query<Position, Velocity> itr;
+    while (itr.Next()) {
+      itr.Get<Position>()->pos += itr.Get<Velocity>()->vel;
+    }
+  }
+  query_usec = platform::ClockEnd(&clock);
+  printf("Position+Velocity      legacy: %8luus query: %8luus\n", legacy_usec,
+         query_usec);
+
+  // The legacy iterator always drives from the first storage - the query
+  // drives from the 1k tagged entities.
+  platform::ClockStart(&clock);
+  for (u32 r = 0; r < kRuns; ++r) {
+    ecs::LegacyItr<3> itr(3, kPosition, kVelocity, kTag);
+    while (itr.Next()) itr.c.position->pos += itr.c.velocity->vel;
+  }
+  legacy_usec = platform::ClockEnd(&clock);
+
+  platform::ClockStart(&clock);
+  for (u32 r = 0; r < kRuns; ++r) {
+    ecs::Query<Position, Velocity, Tag> itr;
+    while (itr.Next()) {
+      itr.Get<Position>()->pos += itr.Get<Velocity>()->vel;
+    }
+  }
+  query_usec = platform::ClockEnd(&clock);
+  printf("Position+Velocity+Tag  legacy: %8luus query: %8luus\n", legacy_usec,
+         query_usec);
+
+  return 0;
+}
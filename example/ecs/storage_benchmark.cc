@@ -0,0 +1,209 @@
+// Compares the sparse set ecs::ComponentStorage against the sorted layout it
+// replaced. Components are assigned, looked up and erased in random entity
+// order since that's what spawning and killing particles looks like.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "memory/memory.cc"
+#include "platform/platform.cc"
+
+enum TypeId : u64 {
+  kFoo = 0,
+};
+
+struct Foo {
+  u32 entity_id = 0;
+  v2f pos;
+  v2f vel;
+};
+
+namespace ecs {
+
+struct Components {
+  Foo* foo = nullptr;
+};
+
+}
+
+#define ENTITY_COUNT 131072
+#include "ecs/ecs.cc"
+
+namespace ecs {
+
+ComponentStorage*
+GetComponents(u64 tid)
+{
+  switch (tid) {
+    case kFoo: {
+      static ecs::ComponentStorage f(ENTITY_COUNT, sizeof(Foo), kFoo);
+      return &f;
+    } break;
+    default: {
+      assert(!"Unknown component type");
+    } break;
+  }
+  return nullptr;
+}
+
+DECLARE_COMPONENT(Foo, kFoo);
+
+}
+
+// The previous storage - components sorted by entity id.
+class SortedStorage {
+ public:
+  SortedStorage(u32 n, u32 sz)
+  {
+    bytes_ = memory::PushBytes(n * sz);
+    sizeof_element_ = sz;
+    max_size_ = n;
+  }
+
+  u8*
+  Get(u32 idx)
+  {
+    return &bytes_[idx * sizeof_element_];
+  }
+
+  u8*
+  Assign(u32 id)
+  {
+    assert(size_ < max_size_);
+    u8* ptr = Get(size_++);
+    *((u32*)ptr) = id;
+    s32 nelem = size_ - 2;
+    while (nelem >= 0) {
+      u8* nelem_ptr = Get(nelem);
+      if (id > *((u32*)nelem_ptr)) return ptr;
+      for (u32 i = 0; i < sizeof_element_; ++i) {
+        u8 b = *ptr;
+        *ptr = *nelem_ptr;
+        *nelem_ptr = b;
+        ++ptr; ++nelem_ptr;
+      }
+      ptr = Get(nelem);
+      --nelem;
+    }
+    return ptr;
+  }
+
+  u8*
+  Find(u32 id)
+  {
+    s32 l = 0;
+    s32 r = size_ - 1;
+    while (l <= r) {
+      s32 m = l + (r - l) / 2;
+      u8* bytes = Get(m);
+      u32 tid = *((u32*)bytes);
+      if (tid == id) return bytes;
+      if (tid < id) l = m + 1;
+      else r = m - 1;
+    }
+    return nullptr;
+  }
+
+  void
+  Erase(u32 id)
+  {
+    u8* elem = Find(id);
+    if (!elem) return;
+    u8* end = Get(size_);
+    memmove(elem, elem + sizeof_element_, end - (elem + sizeof_element_));
+    --size_;
+  }
+
+  void
+  Clear()
+  {
+    size_ = 0;
+  }
+
+ private:
+  u8* bytes_ = nullptr;
+  u32 sizeof_element_ = 0;
+  u32 size_ = 0;
+  u32 max_size_ = 0;
+};
+
+struct Timing {
+  r64 assign_usec;
+  r64 get_usec;
+  r64 erase_usec;
+};
+
+Timing
+RunSparse(const std::vector<ecs::Entity*>& ents)
+{
+  Timing t;
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) ecs::AssignFoo(e)->vel = v2f(1.f, 1.f);
+  t.assign_usec = platform::ClockEnd(&clock);
+  r32 sum = 0.f;
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) sum += ecs::GetFoo(e)->vel.x;
+  t.get_usec = platform::ClockEnd(&clock);
+  assert(sum == (r32)ents.size());
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) ecs::RemoveFoo(e);
+  t.erase_usec = platform::ClockEnd(&clock);
+  return t;
+}
+
+Timing
+RunSorted(SortedStorage* storage, const std::vector<ecs::Entity*>& ents)
+{
+  Timing t;
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) ((Foo*)storage->Assign(e->id))->vel = v2f(1.f, 1.f);
+  t.assign_usec = platform::ClockEnd(&clock);
+  r32 sum = 0.f;
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) sum += ((Foo*)storage->Find(e->id))->vel.x;
+  t.get_usec = platform::ClockEnd(&clock);
+  assert(sum == (r32)ents.size());
+  platform::ClockStart(&clock);
+  for (ecs::Entity* e : ents) storage->Erase(e->id);
+  t.erase_usec = platform::ClockEnd(&clock);
+  return t;
+}
+
+int
+main(int argc, char** argv)
+{
+  memory::Initialize(MiB(64));
+
+  SortedStorage sorted(ENTITY_COUNT, sizeof(Foo));
+  std::mt19937 rng(1337);
+  u32 counts[] = {1000, 10000, 100000};
+  printf("%8s %8s %12s %12s %12s\n", "n", "layout", "assign(us)", "get(us)",
+         "erase(us)");
+  for (u32 n : counts) {
+    ecs::ResetEntity();
+    std::vector<ecs::Entity*> ents;
+    ents.reserve(n);
+    for (u32 i = 0; i < n; ++i) ents.push_back(ecs::UseEntity());
+    std::shuffle(ents.begin(), ents.end(), rng);
+
+    Timing sparse = RunSparse(ents);
+    sorted.Clear();
+    Timing sort = RunSorted(&sorted, ents);
+
+    printf("%8u %8s %12.0f %12.0f %12.0f\n", n, "sparse", sparse.assign_usec,
+           sparse.get_usec, sparse.erase_usec);
+    printf("%8u %8s %12.0f %12.0f %12.0f\n", n, "sorted", sort.assign_usec,
+           sort.get_usec, sort.erase_usec);
+  }
+
+  return 0;
+}
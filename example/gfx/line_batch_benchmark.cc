@@ -0,0 +1,160 @@
+// Draws a tile grid and a field of wire cubes a line at a time with
+// rgg::RenderLine, then through rgg::RenderGrid and rgg::LineBatch, checks the
+// framebuffers match and compares draw calls and frame time.
+//
+// Runs without a window on a surfaceless EGL context, so it works headless on
+// Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./line_batch_benchmark
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+
+constexpr u32 kTargetSize = 512;
+constexpr r32 kCell = 8.f;
+constexpr u32 kFrames = 60;
+
+b8
+CreateHeadlessContext()
+{
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!get_display) return false;
+  EGLDisplay display = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (!eglInitialize(display, nullptr, nullptr)) return false;
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context =
+      eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+  if (context == EGL_NO_CONTEXT) return false;
+  return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+const v4f kGridColors[] = {
+  v4f(0.207f, 0.317f, 0.360f, 0.60f),
+  v4f(0.050f, 0.215f, 0.050f, 0.45f),
+};
+
+Cubef
+SceneCube(u32 i)
+{
+  return Cubef(v3f(32.f + (i % 15) * 32.f, 32.f + (i / 15) * 32.f, 0.f),
+               v3f(20.f, 20.f, 20.f));
+}
+
+// The grid lines the way RenderGrid used to draw them.
+void
+RenderImmediate()
+{
+  u32 lines = kTargetSize / kCell + 1;
+  for (u32 i = 0; i < lines; ++i) {
+    rgg::RenderLine(v3f(0.f, i * kCell, 0.f),
+                    v3f(kTargetSize, i * kCell, 0.f), kGridColors[i % 2]);
+  }
+  for (u32 i = 0; i < lines; ++i) {
+    rgg::RenderLine(v3f(i * kCell, 0.f, 0.f),
+                    v3f(i * kCell, kTargetSize, 0.f), kGridColors[i % 2]);
+  }
+  for (u32 i = 0; i < 225; ++i) {
+    rgg::LineBatch cube;
+    cube.AddCube(SceneCube(i), rgg::kWhite);
+    for (u32 j = 0; j < cube.lines.size(); j += 2) {
+      rgg::RenderLine(cube.lines[j].position, cube.lines[j + 1].position,
+                      rgg::kWhite);
+    }
+  }
+}
+
+void
+RenderBatched()
+{
+  static rgg::LineBatch batch;
+  rgg::RenderGrid(v2f(kCell, kCell), Rectf(0.f, 0.f, kTargetSize, kTargetSize),
+                  ARRAY_LENGTH(kGridColors), kGridColors);
+  batch.Clear();
+  for (u32 i = 0; i < 225; ++i) batch.AddCube(SceneCube(i), rgg::kWhite);
+  rgg::RenderLineBatch(batch);
+}
+
+struct Result {
+  rgg::LineStats stats;
+  u32 grid_uploads;
+  r64 frame_usec;
+  std::vector<u8> pixels;
+};
+
+Result
+Run(b8 batched, const rgg::Surface& surface)
+{
+  Result result = {};
+  platform::Clock clock;
+  for (u32 i = 0; i < kFrames; ++i) {
+    rgg::BeginRenderTo(surface);
+    glClear(GL_COLOR_BUFFER_BIT);
+    platform::ClockStart(&clock);
+    if (batched) RenderBatched();
+    else RenderImmediate();
+    glFinish();
+    result.frame_usec += platform::ClockEnd(&clock);
+    result.stats = rgg::kLineBatchState.stats;
+    result.grid_uploads += result.stats.grid_uploads;
+    rgg::kLineBatchState.stats = {};
+  }
+  result.frame_usec /= kFrames;
+  result.pixels.resize(kTargetSize * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE,
+               result.pixels.data());
+  return result;
+}
+
+int
+main(int argc, char** argv)
+{
+  if (!CreateHeadlessContext()) {
+    printf("Unable to create a surfaceless EGL context\n");
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  if (!rgg::Initialize()) return 1;
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  rgg::Surface surface = rgg::CreateSurface(GL_RGBA, kTargetSize, kTargetSize);
+  rgg::GetObserver()->projection =
+      math::Ortho2(kTargetSize, 0.f, kTargetSize, 0.f, 0.f, 0.f);
+  rgg::GetObserver()->view = math::Identity();
+
+  Result immediate = Run(false, surface);
+  Result batched = Run(true, surface);
+  printf("%-10s %12s\n", "mode", "frame(us)");
+  printf("%-10s %12.2f\n", "immediate", immediate.frame_usec);
+  printf("%-10s %12.2f\n", "batched", batched.frame_usec);
+  printf("%u lines in %u draws, grid uploaded %u times in %u frames\n",
+         batched.stats.lines, batched.stats.draw_calls,
+         batched.grid_uploads, kFrames);
+  if (immediate.pixels != batched.pixels) {
+    u32 differing = 0;
+    for (u32 i = 0; i < immediate.pixels.size(); ++i) {
+      differing += immediate.pixels[i] != batched.pixels[i];
+    }
+    printf("Batched output differs from immediate output in %u bytes\n",
+           differing);
+    return 1;
+  }
+  printf("Output matches\n");
+  return 0;
+}
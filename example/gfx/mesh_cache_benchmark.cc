@@ -0,0 +1,321 @@
+// Writes a large torus OBJ and times loading it the way rgg::LoadOBJ used to
+// parse it, with fscanf a token at a time, against the single read parser, a
+// cold LoadOBJ that parses and writes the mesh cache and warm LoadOBJs that
+// map the cache. Checks the parsed triangles match the fscanf parse, the
+// uploaded buffers match the parse and that changing the OBJ makes the cache
+// stale.
+//
+// Runs without a window on a surfaceless EGL context, so it works headless on
+// Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./mesh_cache_benchmark
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+
+constexpr const char* kObjFile = "mesh_cache_benchmark/torus.obj";
+constexpr const char* kMtlFile = "mesh_cache_benchmark/torus.mtl";
+constexpr u32 kRings = 384;
+constexpr u32 kSides = 192;
+constexpr u32 kRuns = 5;
+
+b8
+CreateHeadlessContext()
+{
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!get_display) return false;
+  EGLDisplay display = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (!eglInitialize(display, nullptr, nullptr)) return false;
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context =
+      eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+  if (context == EGL_NO_CONTEXT) return false;
+  return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+// A torus of quads in the layout exporters write, with texture coordinates
+// and the two halves in different materials.
+b8
+WriteTorus(u32 rings, u32 sides)
+{
+  FILE* mtl = fopen(kMtlFile, "wb");
+  if (!mtl) return false;
+  fprintf(mtl, "newmtl Inner\nNs 96.0\nKa 1.000 1.000 1.000\n"
+               "Kd 0.800 0.200 0.100\nKs 0.500 0.500 0.500\nNi 1.45\n"
+               "illum 2\n\nnewmtl Outer\nKa 1.000 1.000 1.000\n"
+               "Kd 0.100 0.300 0.800\nKs 0.250 0.250 0.250\nNi 1.45\n"
+               "illum 2\n");
+  fclose(mtl);
+  FILE* f = fopen(kObjFile, "wb");
+  if (!f) return false;
+  fprintf(f, "# torus %u x %u\nmtllib torus.mtl\no Torus\n", rings, sides);
+  const r32 kTau = 6.28318530718f;
+  for (u32 i = 0; i < rings; ++i) {
+    for (u32 j = 0; j < sides; ++j) {
+      r32 u = kTau * i / rings;
+      r32 v = kTau * j / sides;
+      r32 r = 2.f + .75f * cosf(v);
+      fprintf(f, "v %.6f %.6f %.6f\n", r * cosf(u), r * sinf(u),
+              .75f * sinf(v));
+    }
+  }
+  for (u32 i = 0; i <= rings; ++i) {
+    for (u32 j = 0; j <= sides; ++j) {
+      fprintf(f, "vt %.6f %.6f\n", (r32)i / rings, (r32)j / sides);
+    }
+  }
+  for (u32 i = 0; i < rings; ++i) {
+    for (u32 j = 0; j < sides; ++j) {
+      r32 u = kTau * i / rings;
+      r32 v = kTau * j / sides;
+      fprintf(f, "vn %.4f %.4f %.4f\n", cosf(v) * cosf(u), cosf(v) * sinf(u),
+              sinf(v));
+    }
+  }
+  fprintf(f, "s 1\n");
+  for (u32 half = 0; half < 2; ++half) {
+    fprintf(f, "usemtl %s\n", half ? "Outer" : "Inner");
+    for (u32 i = 0; i < rings; ++i) {
+      for (u32 j = half * sides / 2; j < (half + 1) * sides / 2; ++j) {
+        u32 a = i * sides + j + 1;
+        u32 b = ((i + 1) % rings) * sides + j + 1;
+        u32 c = ((i + 1) % rings) * sides + (j + 1) % sides + 1;
+        u32 d = i * sides + (j + 1) % sides + 1;
+        u32 ta = i * (sides + 1) + j + 1;
+        u32 tb = (i + 1) * (sides + 1) + j + 1;
+        fprintf(f, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, ta, a, b, tb,
+                b, c, tb + 1, c, d, ta + 1, d);
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Triangles as flat positions and normals, parsed the way LoadOBJ used to.
+struct Triangles {
+  std::vector<r32> positions;
+  std::vector<r32> normals;
+};
+
+b8
+ParseWithFscanf(const char* filename, Triangles* triangles)
+{
+  std::vector<v3f> v;
+  std::vector<v3f> vn;
+  FILE* f = fopen(filename, "rb");
+  if (!f) return false;
+  auto add = [&](const v3i& corner) {
+    const v3f& p = v[corner.x - 1];
+    const v3f& n = vn[corner.z - 1];
+    triangles->positions.insert(triangles->positions.end(), {p.x, p.y, p.z});
+    triangles->normals.insert(triangles->normals.end(), {n.x, n.y, n.z});
+  };
+  char line[1024];
+  while (fscanf(f, "%s", line) != EOF) {
+    if (strcmp(line, "v") == 0) {
+      v3f vert;
+      fscanf(f, "%f %f %f\n", &vert.x, &vert.y, &vert.z);
+      v.push_back(vert);
+    } else if (strcmp(line, "vn") == 0) {
+      v3f norm;
+      fscanf(f, "%f %f %f\n", &norm.x, &norm.y, &norm.z);
+      vn.push_back(norm);
+    } else if (strcmp(line, "f") == 0) {
+      v3i first, second, third;
+      fscanf(f, " %i/%i/%i", &first.x, &first.y, &first.z);
+      fscanf(f, " %i/%i/%i", &second.x, &second.y, &second.z);
+      fscanf(f, " %i/%i/%i", &third.x, &third.y, &third.z);
+      add(first);
+      add(second);
+      add(third);
+      second = third;
+      while (fgetc(f) != '\n') {
+        fscanf(f, " %i/%i/%i", &third.x, &third.y, &third.z);
+        add(first);
+        add(second);
+        add(third);
+        second = third;
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Largest difference between the indexed mesh and the flat triangles, or -1
+// if they have different counts.
+r32
+CompareTriangles(const rgg::MeshData& data, const Triangles& triangles)
+{
+  if (data.index_count * 3 != triangles.positions.size()) return -1.f;
+  r32 error = 0.f;
+  for (u32 i = 0; i < data.index_count; ++i) {
+    u32 index = data.indices[i];
+    for (u32 k = 0; k < 3; ++k) {
+      error = fmaxf(error, fabsf(data.positions[index * 3 + k] -
+                                 triangles.positions[i * 3 + k]));
+      error = fmaxf(error, fabsf(data.normals[index * 3 + k] -
+                                 triangles.normals[i * 3 + k]));
+    }
+  }
+  return error;
+}
+
+// Reads back the buffers LoadOBJ uploaded and compares them with data.
+b8
+BuffersMatch(const rgg::Mesh& mesh, const rgg::MeshData& data)
+{
+  if (mesh.vert_count != data.vertex_count ||
+      mesh.index_count != data.index_count) {
+    return false;
+  }
+  std::vector<r32> floats(data.vertex_count * 3);
+  std::vector<u32> indices(data.index_count);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vert_vbo);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, floats.size() * sizeof(r32),
+                     floats.data());
+  b8 match = !memcmp(floats.data(), data.positions,
+                     floats.size() * sizeof(r32));
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.norm_vbo);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, floats.size() * sizeof(r32),
+                     floats.data());
+  match &= !memcmp(floats.data(), data.normals, floats.size() * sizeof(r32));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_vbo);
+  glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(u32),
+                     indices.data());
+  match &= !memcmp(indices.data(), data.indices, indices.size() * sizeof(u32));
+  return match;
+}
+
+void
+DeleteMesh(rgg::Mesh* mesh)
+{
+  GLuint buffers[] = {mesh->vert_vbo, mesh->norm_vbo, mesh->index_vbo};
+  glDeleteBuffers(3, buffers);
+  glDeleteVertexArrays(1, &mesh->vao);
+  *mesh = {};
+}
+
+int
+main(int argc, char** argv)
+{
+  if (!CreateHeadlessContext()) {
+    printf("Unable to create a surfaceless EGL context\n");
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  if (!memory::Initialize(MiB(256))) return 1;
+  if (!rgg::Initialize()) return 1;
+  filesystem::MakeDirectory("mesh_cache_benchmark");
+  if (!WriteTorus(kRings, kSides)) {
+    printf("Unable to write %s\n", kObjFile);
+    return 1;
+  }
+  u64 obj_size, modified;
+  filesystem::GetFileInfo(kObjFile, &obj_size, &modified);
+  std::string cache = rgg::MeshCacheFilename(kObjFile);
+  remove(cache.c_str());
+
+  platform::Clock clock;
+  Triangles triangles;
+  r64 fscanf_usec = 0.0;
+  for (u32 i = 0; i < kRuns; ++i) {
+    triangles = {};
+    platform::ClockStart(&clock);
+    ParseWithFscanf(kObjFile, &triangles);
+    fscanf_usec += platform::ClockEnd(&clock);
+  }
+
+  r64 parse_usec = 0.0;
+  r32 parse_error = 0.f;
+  for (u32 i = 0; i < kRuns; ++i) {
+    memory::ScopedMarker marker;
+    rgg::Mesh mesh;
+    rgg::MeshData data;
+    char mtl_file[128];
+    platform::ClockStart(&clock);
+    if (!rgg::ParseOBJ(kObjFile, &mesh, &data, mtl_file, sizeof(mtl_file))) {
+      return 1;
+    }
+    parse_usec += platform::ClockEnd(&clock);
+    parse_error = CompareTriangles(data, triangles);
+  }
+
+  // Cold loads parse and write the cache, warm loads map it.
+  rgg::Mesh mesh;
+  r64 cold_usec = 0.0;
+  for (u32 i = 0; i < kRuns; ++i) {
+    remove(cache.c_str());
+    platform::ClockStart(&clock);
+    if (!rgg::LoadOBJ(kObjFile, &mesh)) return 1;
+    glFinish();
+    cold_usec += platform::ClockEnd(&clock);
+    DeleteMesh(&mesh);
+  }
+  u64 cache_size, cache_modified;
+  filesystem::GetFileInfo(cache.c_str(), &cache_size, &cache_modified);
+  rgg::kMeshLoadStats = {};
+  r64 warm_usec = 0.0;
+  for (u32 i = 0; i < kRuns; ++i) {
+    if (i) DeleteMesh(&mesh);
+    platform::ClockStart(&clock);
+    if (!rgg::LoadOBJ(kObjFile, &mesh)) return 1;
+    glFinish();
+    warm_usec += platform::ClockEnd(&clock);
+  }
+  u32 warm_cache_loads = rgg::kMeshLoadStats.cache_loads;
+
+  b8 buffers_match;
+  {
+    memory::ScopedMarker marker;
+    rgg::Mesh parsed;
+    rgg::MeshData data;
+    char mtl_file[128];
+    rgg::ParseOBJ(kObjFile, &parsed, &data, mtl_file, sizeof(mtl_file));
+    buffers_match = BuffersMatch(mesh, data) &&
+                    mesh.material_count == parsed.material_count &&
+                    !memcmp(mesh.material, parsed.material,
+                            sizeof(parsed.material));
+  }
+
+  // A different OBJ under the same name has to be parsed again.
+  WriteTorus(kRings / 2, kSides);
+  rgg::kMeshLoadStats = {};
+  rgg::Mesh changed;
+  rgg::LoadOBJ(kObjFile, &changed);
+  b8 stale_reparsed = rgg::kMeshLoadStats.obj_loads == 1 &&
+                      changed.vert_count != mesh.vert_count;
+
+  printf("%u triangles, %u vertices, %.1f MiB OBJ, %.1f MiB cache\n",
+         mesh.index_count / 3, mesh.vert_count, obj_size / 1048576.0,
+         cache_size / 1048576.0);
+  printf("%-24s %12s\n", "load", "time(ms)");
+  printf("%-24s %12.2f\n", "fscanf parse", fscanf_usec / kRuns / 1000.0);
+  printf("%-24s %12.2f\n", "single read parse", parse_usec / kRuns / 1000.0);
+  printf("%-24s %12.2f\n", "LoadOBJ cold", cold_usec / kRuns / 1000.0);
+  printf("%-24s %12.2f\n", "LoadOBJ from cache", warm_usec / kRuns / 1000.0);
+  printf("Parse differs from fscanf by at most %g\n", parse_error);
+  printf("Cache loads %u of %u, uploaded buffers %s, stale cache %s\n",
+         warm_cache_loads, kRuns, buffers_match ? "match" : "differ",
+         stale_reparsed ? "reparsed" : "used");
+  b8 passed = parse_error >= 0.f && parse_error < 1e-6f && buffers_match &&
+              warm_cache_loads == kRuns && stale_reparsed;
+  return passed ? 0 : 1;
+}
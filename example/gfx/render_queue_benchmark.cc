@@ -0,0 +1,237 @@
+// Draws the same scene through the immediate rgg draw functions and through
+// rgg::RenderQueue, checks the framebuffers match and compares draw calls and
+// frame time. The queue is recorded on a worker thread while the main thread
+// waits, the way a game would overlap it with simulation.
+//
+// Runs without a window on a surfaceless EGL context, so it works headless on
+// Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./render_queue_benchmark
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+#include "util/worker_pool.cc"
+
+constexpr u32 kTargetSize = 512;
+constexpr u32 kCell = 16;
+constexpr u32 kFrames = 60;
+
+b8
+CreateHeadlessContext()
+{
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!get_display) return false;
+  EGLDisplay display = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (!eglInitialize(display, nullptr, nullptr)) return false;
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context =
+      eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+  if (context == EGL_NO_CONTEXT) return false;
+  return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+rgg::Texture
+CreateSheet()
+{
+  std::vector<u8> pixels(16 * 16 * 4);
+  for (u32 i = 0; i < 16 * 16; ++i) {
+    pixels[i * 4] = i;
+    pixels[i * 4 + 1] = 255 - i;
+    pixels[i * 4 + 2] = (i * 7) & 0xFF;
+    pixels[i * 4 + 3] = 255;
+  }
+  rgg::TextureInfo info;
+  info.min_filter = GL_NEAREST;
+  info.mag_filter = GL_NEAREST;
+  return rgg::CreateTexture2D(GL_RGBA, 16, 16, info, pixels.data());
+}
+
+v4f
+CellColor(u32 x, u32 y)
+{
+  return v4f((x % 4) / 4.f, (y % 4) / 4.f, ((x + y) % 3) / 3.f, .75f);
+}
+
+// The scene a layer at a time. Nothing within a layer overlaps so the queue
+// may reorder it. The overlay is drawn under a second observer zoomed in on
+// the bottom left quarter.
+struct Scene {
+  const rgg::Texture* sheet;
+  rgg::Observer world;
+  rgg::Observer overlay;
+};
+
+void
+RenderImmediate(const Scene& scene)
+{
+  u32 n = kTargetSize / kCell;
+  *rgg::GetObserver() = scene.world;
+  for (u32 y = 0; y < n; ++y) {
+    for (u32 x = 0; x < n; ++x) {
+      Rectf cell(x * kCell, y * kCell, kCell, kCell);
+      if ((x + y) % 2) rgg::RenderRectangle(cell, CellColor(x, y));
+      else rgg::RenderTriangle(cell.Center(), kCell / 4.f, CellColor(y, x));
+    }
+  }
+  for (u32 y = 0; y < n; y += 2) {
+    for (u32 x = 0; x < n; x += 2) {
+      rgg::RenderLineRectangle(Rectf(x * kCell + 2, y * kCell + 2, 12, 12),
+                               v4f(1.f, 1.f, 1.f, .5f));
+    }
+  }
+  for (u32 y = 1; y < n; y += 2) {
+    for (u32 x = 1; x < n; x += 4) {
+      rgg::RenderCircle(v3f(x * kCell + 8.f, y * kCell + 8.f, 0.f), 6.f,
+                        v4f(.9f, .3f, .1f, 1.f));
+      rgg::RenderTexture(*scene.sheet, Rectf(4.f, 4.f, 8.f, 8.f),
+                         Rectf((x + 2) * kCell, y * kCell, 12.f, 12.f));
+      rgg::RenderSmoothRectangle(Rectf(x * kCell, (y - 1) * kCell, 32.f, 12.f),
+                                 4.f, v4f(.2f, .4f, .9f, .8f));
+    }
+  }
+  rgg::ModifyObserver overlay(scene.overlay.projection, scene.overlay.view);
+  for (u32 i = 0; i < 16; ++i) {
+    rgg::RenderLine(v3f(i * 16.f, 0.f, 0.f), v3f(i * 16.f, 256.f, 0.f),
+                    v4f(0.f, 1.f, 0.f, 1.f));
+  }
+}
+
+void
+RenderQueued(rgg::RenderQueue* queue, const Scene& scene)
+{
+  u32 n = kTargetSize / kCell;
+  rgg::SetRenderObserver(queue, scene.world);
+  for (u32 y = 0; y < n; ++y) {
+    for (u32 x = 0; x < n; ++x) {
+      Rectf cell(x * kCell, y * kCell, kCell, kCell);
+      if ((x + y) % 2) rgg::RenderRectangle(queue, cell, CellColor(x, y));
+      else {
+        rgg::RenderTriangle(queue, cell.Center(), kCell / 4.f,
+                            CellColor(y, x));
+      }
+    }
+  }
+  rgg::SetRenderLayer(queue, 1);
+  for (u32 y = 0; y < n; y += 2) {
+    for (u32 x = 0; x < n; x += 2) {
+      rgg::RenderLineRectangle(queue,
+                               Rectf(x * kCell + 2, y * kCell + 2, 12, 12),
+                               v4f(1.f, 1.f, 1.f, .5f));
+    }
+  }
+  rgg::SetRenderLayer(queue, 2);
+  for (u32 y = 1; y < n; y += 2) {
+    for (u32 x = 1; x < n; x += 4) {
+      rgg::RenderCircle(queue, v3f(x * kCell + 8.f, y * kCell + 8.f, 0.f),
+                        6.f, v4f(.9f, .3f, .1f, 1.f));
+      rgg::RenderTexture(queue, *scene.sheet, Rectf(4.f, 4.f, 8.f, 8.f),
+                         Rectf((x + 2) * kCell, y * kCell, 12.f, 12.f));
+      rgg::RenderSmoothRectangle(
+          queue, Rectf(x * kCell, (y - 1) * kCell, 32.f, 12.f), 4.f,
+          v4f(.2f, .4f, .9f, .8f));
+    }
+  }
+  rgg::SetRenderObserver(queue, scene.overlay);
+  for (u32 i = 0; i < 16; ++i) {
+    rgg::RenderLine(queue, v3f(i * 16.f, 0.f, 0.f),
+                    v3f(i * 16.f, 256.f, 0.f), v4f(0.f, 1.f, 0.f, 1.f));
+  }
+}
+
+struct Result {
+  rgg::RenderQueueStats stats;
+  r64 frame_usec;
+  std::vector<u8> pixels;
+};
+
+Result
+Run(b8 queued, const rgg::Surface& surface, const Scene& scene)
+{
+  static rgg::RenderQueue queue;
+  Result result = {};
+  platform::Clock clock;
+  for (u32 i = 0; i < kFrames; ++i) {
+    rgg::BeginRenderTo(surface);
+    glClear(GL_COLOR_BUFFER_BIT);
+    platform::ClockStart(&clock);
+    if (queued) {
+      util::WorkGroup group;
+      util::WorkerPoolPush([&scene]() { RenderQueued(&queue, scene); },
+                           &group);
+      util::WorkerPoolWait(&group);
+      rgg::SubmitRenderQueue(&queue);
+    } else {
+      RenderImmediate(scene);
+    }
+    rgg::FlushBatches();
+    glFinish();
+    result.frame_usec += platform::ClockEnd(&clock);
+    result.stats = rgg::kRenderQueueState.stats;
+    rgg::kRenderQueueState.stats = {};
+  }
+  result.frame_usec /= kFrames;
+  result.pixels.resize(kTargetSize * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE,
+               result.pixels.data());
+  return result;
+}
+
+int
+main(int argc, char** argv)
+{
+  if (!CreateHeadlessContext()) {
+    printf("Unable to create a surfaceless EGL context\n");
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  if (!rgg::Initialize()) return 1;
+  util::WorkerPoolInitialize(1);
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  rgg::Texture sheet = CreateSheet();
+  rgg::Surface surface = rgg::CreateSurface(GL_RGBA, kTargetSize, kTargetSize);
+  Scene scene;
+  scene.sheet = &sheet;
+  scene.world.projection =
+      math::Ortho2(kTargetSize, 0.f, kTargetSize, 0.f, 0.f, 0.f);
+  scene.world.view = math::Identity();
+  scene.overlay.projection = math::Ortho2(256.f, 0.f, 256.f, 0.f, 0.f, 0.f);
+  scene.overlay.view = math::Identity();
+
+  Result immediate = Run(false, surface, scene);
+  Result queued = Run(true, surface, scene);
+  printf("%-10s %12s\n", "mode", "frame(us)");
+  printf("%-10s %12.2f\n", "immediate", immediate.frame_usec);
+  printf("%-10s %12.2f\n", "queued", queued.frame_usec);
+  printf("%u commands in %u draws\n", queued.stats.commands,
+         queued.stats.draw_calls);
+  util::WorkerPoolShutdown();
+  if (immediate.pixels != queued.pixels) {
+    u32 differing = 0;
+    for (u32 i = 0; i < immediate.pixels.size(); ++i) {
+      differing += immediate.pixels[i] != queued.pixels[i];
+    }
+    printf("Queued output differs from immediate output in %u bytes\n",
+           differing);
+    return 1;
+  }
+  printf("Output matches\n");
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Renders a tile map's worth of sprites with and without rgg::SpriteBatch and
+// compares draw calls, frame time and output.
+//
+// Runs without a window on a surfaceless EGL context, so it works headless on
+// Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./sprite_batch_benchmark
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+
+constexpr u32 kTargetSize = 512;
+constexpr u32 kTile = 8;
+constexpr u32 kFrames = 60;
+
+b8
+CreateHeadlessContext()
+{
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!get_display) return false;
+  EGLDisplay display = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (!eglInitialize(display, nullptr, nullptr)) return false;
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context =
+      eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+  if (context == EGL_NO_CONTEXT) return false;
+  return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+// A 2x2 tile sheet with a distinct color per tile.
+rgg::Texture
+CreateSheet(u8 seed)
+{
+  std::vector<u8> pixels(16 * 16 * 4);
+  for (u32 y = 0; y < 16; ++y) {
+    for (u32 x = 0; x < 16; ++x) {
+      u8* p = &pixels[(y * 16 + x) * 4];
+      u32 tile = (y / 8) * 2 + x / 8;
+      p[0] = seed + tile * 50;
+      p[1] = 255 - seed - tile * 30;
+      p[2] = (x ^ y) * 16;
+      p[3] = 255;
+    }
+  }
+  rgg::TextureInfo info;
+  info.min_filter = GL_NEAREST;
+  info.mag_filter = GL_NEAREST;
+  return rgg::CreateTexture2D(GL_RGBA, 16, 16, info, pixels.data());
+}
+
+// Terrain under every tile, with trees and characters from other sheets over
+// some of them - the way live::Render draws a screen.
+void
+RenderScene(const rgg::Texture& terrain, const rgg::Texture& trees,
+            const rgg::Texture& characters)
+{
+  u32 n = kTargetSize / kTile;
+  {
+    rgg::ScopedSpriteLayer layer;
+    for (u32 y = 0; y < n; ++y) {
+      for (u32 x = 0; x < n; ++x) {
+        Rectf src((x % 2) * 8.f, (y % 2) * 8.f, 8.f, 8.f);
+        rgg::RenderTexture(terrain, src,
+                           Rectf(x * kTile, y * kTile, kTile, kTile));
+      }
+    }
+  }
+  for (u32 y = 0; y < n; y += 3) {
+    for (u32 x = 0; x < n; x += 5) {
+      rgg::RenderTexture(trees, Rectf(0.f, 0.f, 8.f, 16.f),
+                         Rectf(x * kTile, y * kTile, kTile, kTile * 2.f));
+    }
+  }
+  for (u32 i = 0; i < 200; ++i) {
+    Rectf dest((i * 37) % kTargetSize, (i * 91) % kTargetSize, kTile, kTile);
+    rgg::RenderTexture(characters, Rectf(8.f, 8.f, 8.f, 8.f), dest,
+                       v4f(1.f, .5f, .5f, 1.f), i % 2, i % 3 == 0);
+  }
+}
+
+struct Result {
+  rgg::SpriteStats stats;
+  r64 frame_usec;
+  std::vector<u8> pixels;
+};
+
+Result
+Run(b8 batched, const rgg::Surface& surface, const rgg::Texture& terrain,
+    const rgg::Texture& trees, const rgg::Texture& characters)
+{
+  rgg::kSpriteBatch.enabled = batched;
+  Result result = {};
+  platform::Clock clock;
+  for (u32 i = 0; i < kFrames; ++i) {
+    rgg::BeginRenderTo(surface);
+    glClear(GL_COLOR_BUFFER_BIT);
+    platform::ClockStart(&clock);
+    RenderScene(terrain, trees, characters);
+    rgg::FlushSprites();
+    glFinish();
+    result.frame_usec += platform::ClockEnd(&clock);
+    result.stats = rgg::kSpriteBatch.stats;
+    rgg::kSpriteBatch.stats = {};
+  }
+  result.frame_usec /= kFrames;
+  result.pixels.resize(kTargetSize * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE,
+               result.pixels.data());
+  return result;
+}
+
+int
+main(int argc, char** argv)
+{
+  if (!CreateHeadlessContext()) {
+    printf("Unable to create a surfaceless EGL context\n");
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  if (!rgg::SetupTexture() || !rgg::SetupSpriteBatch()) return 1;
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  rgg::Texture terrain = CreateSheet(20);
+  rgg::Texture trees = CreateSheet(90);
+  rgg::Texture characters = CreateSheet(160);
+  rgg::Surface surface = rgg::CreateSurface(GL_RGBA, kTargetSize, kTargetSize);
+  rgg::GetObserver()->projection =
+      math::Ortho2(kTargetSize, 0.f, kTargetSize, 0.f, 0.f, 0.f);
+  rgg::GetObserver()->view = math::Identity();
+
+  Result unbatched = Run(false, surface, terrain, trees, characters);
+  Result batched = Run(true, surface, terrain, trees, characters);
+  printf("%-10s %8s %8s %12s\n", "mode", "sprites", "draws", "frame(us)");
+  printf("%-10s %8u %8u %12.2f\n", "unbatched", unbatched.stats.sprites,
+         unbatched.stats.draw_calls, unbatched.frame_usec);
+  printf("%-10s %8u %8u %12.2f\n", "batched", batched.stats.sprites,
+         batched.stats.draw_calls, batched.frame_usec);
+  if (unbatched.pixels != batched.pixels) {
+    printf("Batched output differs from unbatched output\n");
+    return 1;
+  }
+  printf("Output matches\n");
+  return 0;
+}
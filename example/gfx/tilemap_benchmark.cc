@@ -0,0 +1,224 @@
+// Draws square grids of terrain as one sprite per visible cell, the way
+// live::Render used to, and as an rgg::Tilemap, and reports frame time against
+// grid size. The whole grid is in view, which is the worst case for both.
+//
+// Runs without a window on a surfaceless EGL context, so it works headless on
+// Mesa's llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 ./tilemap_benchmark
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+
+constexpr u32 kTargetSize = 512;
+constexpr u32 kFrames = 30;
+constexpr r32 kTile = 8.f;
+
+b8
+CreateHeadlessContext()
+{
+  auto get_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!get_display) return false;
+  EGLDisplay display = get_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  if (!eglInitialize(display, nullptr, nullptr)) return false;
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 4,
+    EGL_CONTEXT_MINOR_VERSION, 1,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context =
+      eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+  if (context == EGL_NO_CONTEXT) return false;
+  return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+// A 2x2 tile sheet with a distinct color per tile, in the texture cache so a
+// tilemap can refer to it.
+rgg::TextureId
+CreateSheet()
+{
+  std::vector<u8> pixels(16 * 16 * 4);
+  for (u32 y = 0; y < 16; ++y) {
+    for (u32 x = 0; x < 16; ++x) {
+      u8* p = &pixels[(y * 16 + x) * 4];
+      u32 tile = (y / 8) * 2 + x / 8;
+      p[0] = 20 + tile * 50;
+      p[1] = 235 - tile * 30;
+      p[2] = (x ^ y) * 16;
+      p[3] = 255;
+    }
+  }
+  rgg::TextureInfo info;
+  info.min_filter = GL_NEAREST;
+  info.mag_filter = GL_NEAREST;
+  rgg::TextureHandle* handle = rgg::UseTextureHandle();
+  handle->texture = rgg::CreateTexture2D(GL_RGBA, 16, 16, info, pixels.data());
+  return handle->id;
+}
+
+Rectf
+TileRect(u32 x, u32 y)
+{
+  // Same corner rules as the live terrain.
+  if (x == 0 && y == 0) return Rectf(0.f, 0.f, 8.f, 8.f);
+  if (y == 0) return Rectf(8.f, 0.f, 8.f, 8.f);
+  if (x == 0) return Rectf(0.f, 8.f, 8.f, 8.f);
+  return Rectf(8.f, 8.f, 8.f, 8.f);
+}
+
+struct Result {
+  r64 cpu_usec = 0.0;
+  r64 frame_usec = 0.0;
+  u32 draw_calls = 0;
+  u32 cells_uploaded = 0;
+  std::vector<u8> pixels;
+};
+
+// Views the whole n by n grid.
+void
+SetView(u32 n)
+{
+  r32 size = n * kTile;
+  rgg::GetObserver()->projection = math::Ortho2(size, 0.f, size, 0.f, 0.f, 0.f);
+  rgg::GetObserver()->view = math::Identity();
+}
+
+Result
+RunSprites(u32 n, const rgg::Surface& surface, rgg::TextureId sheet)
+{
+  SetView(n);
+  const rgg::Texture* texture = rgg::GetTexture(sheet);
+  Rectf view(0.f, 0.f, n * kTile, n * kTile);
+  Result result;
+  platform::Clock clock;
+  for (u32 i = 0; i < kFrames; ++i) {
+    rgg::BeginRenderTo(surface);
+    glClear(GL_COLOR_BUFFER_BIT);
+    platform::ClockStart(&clock);
+    {
+      rgg::ScopedSpriteLayer layer;
+      for (u32 y = 0; y < n; ++y) {
+        for (u32 x = 0; x < n; ++x) {
+          Rectf dest(x * kTile, y * kTile, kTile, kTile);
+          if (!math::IsContainedInRect(dest, view) &&
+              !math::IntersectRect(dest, view))
+            continue;
+          rgg::RenderTexture(*texture, TileRect(x, y), dest);
+        }
+      }
+    }
+    rgg::FlushSprites();
+    result.cpu_usec += platform::ClockEnd(&clock);
+    glFinish();
+    result.frame_usec += platform::ClockEnd(&clock);
+    result.draw_calls = rgg::kSpriteBatch.stats.draw_calls;
+    rgg::kSpriteBatch.stats = {};
+  }
+  result.cpu_usec /= kFrames;
+  result.frame_usec /= kFrames;
+  result.pixels.resize(kTargetSize * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE,
+               result.pixels.data());
+  return result;
+}
+
+// Changes a cell a frame, like a sim editing terrain, to show only changed
+// cells are uploaded.
+Result
+RunTilemap(u32 n, const rgg::Surface& surface, rgg::TextureId sheet)
+{
+  SetView(n);
+  rgg::Tilemap map = rgg::CreateTilemap(sheet, n, n, v2f(kTile, kTile));
+  u16 tiles[4];
+  for (u32 i = 0; i < 4; ++i) {
+    tiles[i] = rgg::AddTilemapTile(&map, TileRect(i % 2, i / 2));
+  }
+  u16 middle = tiles[3];
+  for (u32 y = 0; y < n; ++y) {
+    for (u32 x = 0; x < n; ++x) {
+      rgg::SetTile(&map, x, y, tiles[(y > 0) * 2 + (x > 0)]);
+    }
+  }
+  Rectf view(0.f, 0.f, n * kTile, n * kTile);
+  Result result;
+  platform::Clock clock;
+  for (u32 i = 0; i < kFrames; ++i) {
+    // The first frame uploads the whole grid.
+    if (i == 1) rgg::kTilemapState.stats = {};
+    if (i) {
+      u32 x = 1 + i % (n - 1);
+      rgg::SetTile(&map, x, n / 2, i % 2 ? tiles[0] : middle);
+      rgg::SetTile(&map, x, n / 2, middle);
+    }
+    rgg::BeginRenderTo(surface);
+    glClear(GL_COLOR_BUFFER_BIT);
+    platform::ClockStart(&clock);
+    rgg::RenderTilemap(&map, v2f(0.f, 0.f), view);
+    result.cpu_usec += platform::ClockEnd(&clock);
+    glFinish();
+    result.frame_usec += platform::ClockEnd(&clock);
+  }
+  result.draw_calls = rgg::kTilemapState.stats.draw_calls / (kFrames - 1);
+  result.cells_uploaded = rgg::kTilemapState.stats.cells_uploaded;
+  rgg::kTilemapState.stats = {};
+  result.cpu_usec /= kFrames;
+  result.frame_usec /= kFrames;
+  result.pixels.resize(kTargetSize * kTargetSize * 4);
+  glReadPixels(0, 0, kTargetSize, kTargetSize, GL_RGBA, GL_UNSIGNED_BYTE,
+               result.pixels.data());
+  rgg::DestroyTilemap(&map);
+  return result;
+}
+
+int
+main(int argc, char** argv)
+{
+  if (!CreateHeadlessContext()) {
+    printf("Unable to create a surfaceless EGL context\n");
+    return 1;
+  }
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  if (!rgg::SetupTexture() || !rgg::SetupSpriteBatch() ||
+      !rgg::SetupTilemap()) {
+    return 1;
+  }
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  rgg::TextureId sheet = CreateSheet();
+  rgg::Surface surface = rgg::CreateSurface(GL_RGBA, kTargetSize, kTargetSize);
+
+  printf("%-6s %-8s %8s %10s %12s %8s\n", "grid", "mode", "draws", "cpu(us)",
+         "frame(us)", "uploads");
+  b8 matches = true;
+  for (u32 n : {64, 128, 256, 512}) {
+    Result sprites = RunSprites(n, surface, sheet);
+    Result tilemap = RunTilemap(n, surface, sheet);
+    printf("%-6u %-8s %8u %10.1f %12.1f %8s\n", n, "sprites",
+           sprites.draw_calls, sprites.cpu_usec, sprites.frame_usec, "-");
+    printf("%-6u %-8s %8u %10.1f %12.1f %8u\n", n, "tilemap",
+           tilemap.draw_calls, tilemap.cpu_usec, tilemap.frame_usec,
+           tilemap.cells_uploaded);
+    // Past 64 cells a tile covers fewer pixels than texels and the two pick
+    // texels differently.
+    if (n == 64 && sprites.pixels != tilemap.pixels) {
+      printf("Tilemap output differs from sprite output\n");
+      matches = false;
+    }
+  }
+  if (!matches) return 1;
+  printf("Output matches\n");
+  return 0;
+}
@@ -0,0 +1,210 @@
+// Times the physics broadphase modes against each other.
+//
+//   broadphase_benchmark [asset/test.map ...]
+//
+// Scenes:
+//   scatter - small dynamic particles drifting over an open field.
+//   column  - debris falling through a narrow vertical column, which puts
+//             most particles in the same x range.
+//   map     - mood map geometry with characters moving over it. Maps passed
+//             on the command line are loaded, otherwise a generated tile map
+//             of floors and walls stands in.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "math/math.cc"
+#include "renderer/renderer.cc"
+#include "renderer/imui.cc"
+
+#define PHYSICS_PARTICLE_COUNT 10240
+#include "physics/physics.cc"
+
+constexpr u32 kSteps = 240;
+constexpr r32 kDelta = 1.f / 60.f;
+constexpr r32 kTile = 16.f;
+
+struct Geometry {
+  v2f pos;
+  v2f dims;
+};
+
+physics::Particle2d*
+Mover(v2f pos, v2f dims, v2f velocity)
+{
+  physics::Particle2d* p = physics::CreateParticle2d(pos, dims);
+  p->velocity = velocity;
+  p->damping = 1.f;
+  // Keep resolution from zeroing velocity so the scene keeps moving.
+  SBIT(p->flags, physics::kParticleIgnoreCollisionResolution);
+  return p;
+}
+
+void
+Scatter(std::mt19937* rng)
+{
+  std::uniform_real_distribution<r32> pos(0.f, 1200.f);
+  std::uniform_real_distribution<r32> vel(-60.f, 60.f);
+  for (u32 i = 0; i < 10000; ++i) {
+    Mover(v2f(pos(*rng), pos(*rng)), v2f(4.f, 4.f),
+          v2f(vel(*rng), vel(*rng)));
+  }
+}
+
+void
+Column(std::mt19937* rng)
+{
+  std::uniform_real_distribution<r32> x(0.f, 64.f);
+  std::uniform_real_distribution<r32> y(0.f, 8000.f);
+  std::uniform_real_distribution<r32> fall(-200.f, -20.f);
+  for (u32 i = 0; i < 10000; ++i) {
+    Mover(v2f(x(*rng), y(*rng)), v2f(3.f, 3.f), v2f(0.f, fall(*rng)));
+  }
+}
+
+// Reads the collision geometry ("g" lines) out of a mood map file.
+b8
+LoadMapGeometry(const char* filename, std::vector<Geometry>* geometry)
+{
+  FILE* f = fopen(filename, "rb");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    Geometry g;
+    if (sscanf(line, "g %f %f %f %f", &g.pos.x, &g.pos.y, &g.dims.x,
+               &g.dims.y) == 4) {
+      geometry->push_back(g);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Floors every eight tiles with walls and stair steps on them, tile by tile
+// the way the mood editor lays them down.
+void
+GenerateMapGeometry(std::vector<Geometry>* geometry)
+{
+  for (s32 floor = 0; floor < 24; ++floor) {
+    r32 y = floor * 8 * kTile;
+    for (s32 x = 0; x < 160; ++x) {
+      geometry->push_back({v2f(x * kTile, y), v2f(kTile, kTile)});
+      if (x % 20 == 0) {
+        for (s32 h = 1; h < 6; ++h) {
+          geometry->push_back(
+              {v2f(x * kTile, y + h * kTile), v2f(kTile, kTile)});
+        }
+      }
+      if (x % 20 == 10) {
+        geometry->push_back({v2f(x * kTile, y + kTile), v2f(kTile, kTile)});
+      }
+    }
+  }
+}
+
+void
+Map(const std::vector<Geometry>& geometry, std::mt19937* rng)
+{
+  v2f max(0.f, 0.f);
+  for (const Geometry& g : geometry) {
+    physics::CreateInfinteMassParticle2d(g.pos, g.dims);
+    max.x = fmax(max.x, g.pos.x);
+    max.y = fmax(max.y, g.pos.y);
+  }
+  std::uniform_real_distribution<r32> x(0.f, max.x);
+  std::uniform_real_distribution<r32> y(0.f, max.y);
+  std::uniform_real_distribution<r32> vel(-120.f, 120.f);
+  u32 movers = PHYSICS_PARTICLE_COUNT - geometry.size() > 2000
+                   ? 2000 : PHYSICS_PARTICLE_COUNT - geometry.size();
+  for (u32 i = 0; i < movers; ++i) {
+    Mover(v2f(x(*rng), y(*rng)), v2f(kTile, kTile * 1.5f),
+          v2f(vel(*rng), vel(*rng)));
+  }
+}
+
+struct Timing {
+  r64 broadphase_usec = 0.0;
+  u64 pairs = 0;
+};
+
+Timing
+Run(physics::BroadphaseMode mode)
+{
+  physics::kPhysics.broadphase = mode;
+  // Settles the sort and builds the static layer outside the timed steps.
+  physics::BPCalculateCollisions();
+  // Dynamic particles drift without integrating so only the broadphase is
+  // timed. The scene is restored after so each mode sees the same motion.
+  std::vector<v2f> start;
+  for (u32 i = 0; i < physics::kUsedParticle2d; ++i) {
+    start.push_back(physics::kParticle2d[i].position);
+  }
+  Timing t;
+  platform::Clock clock;
+  for (u32 step = 0; step < kSteps; ++step) {
+    for (u32 i = 0; i < physics::kUsedParticle2d; ++i) {
+      physics::Particle2d* p = &physics::kParticle2d[i];
+      p->position += p->velocity * kDelta;
+    }
+    platform::ClockStart(&clock);
+    physics::BPCalculateCollisions();
+    t.broadphase_usec += platform::ClockEnd(&clock);
+    t.pairs += physics::kUsedBP2dCollision;
+  }
+  for (u32 i = 0; i < physics::kUsedParticle2d; ++i) {
+    physics::kParticle2d[i].position = start[i];
+  }
+  t.broadphase_usec /= kSteps;
+  t.pairs /= kSteps;
+  return t;
+}
+
+void
+Compare(const char* scene)
+{
+  Timing sweep = Run(physics::kBroadphaseSweep);
+  Timing grid = Run(physics::kBroadphaseGrid);
+  printf("%-24s %8lu %12.2f %12.2f %10lu\n", scene, physics::kUsedParticle2d,
+         sweep.broadphase_usec, grid.broadphase_usec, sweep.pairs);
+  if (sweep.pairs != grid.pairs) {
+    printf("  pair count mismatch sweep %lu grid %lu\n", sweep.pairs,
+           grid.pairs);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  std::mt19937 rng(1337);
+  printf("%-24s %8s %12s %12s %10s\n", "scene", "count", "sweep(us)",
+         "grid(us)", "pairs");
+
+  physics::Reset();
+  physics::kPhysics.grid_cell_size = 8.f;
+  Scatter(&rng);
+  Compare("scatter");
+
+  physics::Reset();
+  physics::kPhysics.grid_cell_size = 8.f;
+  Column(&rng);
+  Compare("column");
+
+  std::vector<const char*> maps;
+  for (s32 i = 1; i < argc; ++i) maps.push_back(argv[i]);
+  if (maps.empty()) maps.push_back(nullptr);
+  for (const char* map : maps) {
+    std::vector<Geometry> geometry;
+    if (map && !LoadMapGeometry(map, &geometry)) {
+      printf("Unable to load map %s\n", map);
+      continue;
+    }
+    if (!map) GenerateMapGeometry(&geometry);
+    physics::Reset();
+    physics::kPhysics.grid_cell_size = kTile * 2.f;
+    Map(geometry, &rng);
+    Compare(map ? map : "generated map");
+  }
+  return 0;
+}
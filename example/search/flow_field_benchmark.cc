@@ -0,0 +1,124 @@
+// Times sending crowds of units to one destination with a path each from
+// search::FindPath against a shared search::FlowField, and repairing the field
+// as walls go up against rebuilding it.
+//
+// The map is 256x256 cells scattered with blocked cells. Units start on random
+// open cells and every one walks its whole way, so both modes produce the
+// same number of steps.
+//
+//   flow_field_benchmark
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "platform/platform.cc"
+#include "search/search.cc"
+
+constexpr s32 kMapSize = 256;
+constexpr r32 kScatter = .2f;
+constexpr u32 kWalls = 200;
+
+struct Result {
+  r64 usec = 0.0;
+  u64 steps = 0;
+};
+
+Result
+RunPaths(const search::PathGrid& grid, const std::vector<v2i>& units,
+         v2i goal)
+{
+  Result result;
+  std::vector<v2i> path;
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  for (v2i unit : units) {
+    if (!search::FindPath(grid, unit, goal, &path)) continue;
+    result.steps += path.size() - 1;
+  }
+  result.usec = platform::ClockEnd(&clock);
+  return result;
+}
+
+Result
+RunFlowField(const search::PathGrid& grid, const std::vector<v2i>& units,
+             v2i goal)
+{
+  Result result;
+  search::FlowField field;
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  search::FlowFieldBuild(grid, &goal, 1, &field);
+  for (v2i unit : units) {
+    v2i next;
+    while (search::FlowFieldStep(field, unit, &next)) {
+      unit = next;
+      ++result.steps;
+    }
+  }
+  result.usec = platform::ClockEnd(&clock);
+  return result;
+}
+
+int
+main(int argc, char** argv)
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<r32> chance(0.f, 1.f);
+  std::uniform_int_distribution<s32> cell(0, kMapSize - 1);
+  std::vector<u8> blocked(kMapSize * kMapSize);
+  for (u8& b : blocked) b = chance(rng) < kScatter;
+  v2i goal(kMapSize / 2, kMapSize / 2);
+  blocked[goal.y * kMapSize + goal.x] = 0;
+  search::PathGrid grid;
+  grid.width = kMapSize;
+  grid.height = kMapSize;
+  grid.blocked = blocked.data();
+
+  printf("%-6s %-6s %12s %12s\n", "units", "mode", "total(us)", "steps");
+  for (u32 count : {10, 100, 500, 1000}) {
+    std::vector<v2i> units;
+    while (units.size() < count) {
+      v2i unit(cell(rng), cell(rng));
+      if (!blocked[unit.y * kMapSize + unit.x]) units.push_back(unit);
+    }
+    Result paths = RunPaths(grid, units, goal);
+    Result flow = RunFlowField(grid, units, goal);
+    printf("%-6u %-6s %12.0f %12lu\n", count, "astar", paths.usec,
+           paths.steps);
+    printf("%-6u %-6s %12.0f %12lu\n", count, "flow", flow.usec, flow.steps);
+  }
+
+  // Walls go up one cell at a time. The repaired field must match one built
+  // from scratch.
+  search::FlowField field;
+  search::FlowField rebuilt;
+  search::FlowFieldBuild(grid, &goal, 1, &field);
+  r64 repair_usec = 0.0;
+  r64 rebuild_usec = 0.0;
+  u64 repair_cells = 0;
+  u64 rebuild_cells = 0;
+  platform::Clock clock;
+  for (u32 i = 0; i < kWalls; ++i) {
+    v2i wall(cell(rng), cell(rng));
+    if (wall == goal) continue;
+    blocked[wall.y * kMapSize + wall.x] = 1;
+    platform::ClockStart(&clock);
+    repair_cells += search::FlowFieldBlock(grid, wall, &field);
+    repair_usec += platform::ClockEnd(&clock);
+    platform::ClockStart(&clock);
+    rebuild_cells += search::FlowFieldBuild(grid, &goal, 1, &rebuilt);
+    rebuild_usec += platform::ClockEnd(&clock);
+    if (field.integration != rebuilt.integration) {
+      printf("Repaired field differs from rebuilt field after %u walls\n", i);
+      return 1;
+    }
+  }
+  printf("%u walls: repair %.1f us %lu cells/wall, rebuild %.1f us %lu "
+         "cells/wall\n", kWalls, repair_usec / kWalls, repair_cells / kWalls,
+         rebuild_usec / kWalls, rebuild_cells / kWalls);
+  return 0;
+}
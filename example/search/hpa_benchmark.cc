@@ -0,0 +1,118 @@
+// Times search::HpaFindPath against flat A* from search::FindPath on 1024x1024
+// maps of random obstacles, and the cost of keeping the cluster graph up to
+// date as cells change against building it again.
+//
+//   hpa_benchmark [queries]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "platform/platform.cc"
+#include "search/search.cc"
+
+constexpr s32 kMapSize = 1024;
+constexpr u32 kUpdates = 1000;
+
+struct Latency {
+  r64 mean_usec = 0.0;
+  r64 p99_usec = 0.0;
+};
+
+Latency
+Summarize(std::vector<r64>* usecs)
+{
+  Latency latency;
+  if (usecs->empty()) return latency;
+  for (r64 usec : *usecs) latency.mean_usec += usec;
+  latency.mean_usec /= usecs->size();
+  std::sort(usecs->begin(), usecs->end());
+  latency.p99_usec = (*usecs)[usecs->size() * 99 / 100];
+  return latency;
+}
+
+int
+main(int argc, char** argv)
+{
+  u32 query_count = argc > 1 ? atoi(argv[1]) : 200;
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<r32> chance(0.f, 1.f);
+  std::uniform_int_distribution<s32> cell(0, kMapSize - 1);
+  printf("%-8s %-6s %10s %10s %10s %8s\n", "density", "mode", "mean(us)",
+         "p99(us)", "cost", "found");
+  for (r32 density : {.1f, .25f}) {
+    std::vector<u8> blocked(kMapSize * kMapSize);
+    for (u8& b : blocked) b = chance(rng) < density;
+    search::PathGrid grid;
+    grid.width = kMapSize;
+    grid.height = kMapSize;
+    grid.blocked = blocked.data();
+
+    platform::Clock clock;
+    search::HpaGraph graph;
+    platform::ClockStart(&clock);
+    search::HpaBuild(grid, 16, &graph);
+    r64 build_usec = platform::ClockEnd(&clock);
+
+    std::vector<r64> astar_usec;
+    std::vector<r64> hpa_usec;
+    r64 astar_cost = 0.0;
+    r64 hpa_cost = 0.0;
+    u32 astar_found = 0;
+    u32 hpa_found = 0;
+    std::vector<v2i> path;
+    for (u32 i = 0; i < query_count; ++i) {
+      v2i start(cell(rng), cell(rng));
+      v2i goal(cell(rng), cell(rng));
+      blocked[start.y * kMapSize + start.x] = 0;
+      blocked[goal.y * kMapSize + goal.x] = 0;
+      search::HpaUpdateCell(grid, start, &graph);
+      search::HpaUpdateCell(grid, goal, &graph);
+      search::PathStats path_stats;
+      platform::ClockStart(&clock);
+      b8 astar = search::FindPath(grid, start, goal, &path, search::kPathAStar,
+                                  &path_stats);
+      astar_usec.push_back(platform::ClockEnd(&clock));
+      search::HpaStats hpa_stats;
+      platform::ClockStart(&clock);
+      b8 hpa = search::HpaFindPath(grid, graph, start, goal, &path,
+                                   &hpa_stats);
+      hpa_usec.push_back(platform::ClockEnd(&clock));
+      if (astar != hpa) {
+        printf("A* and HPA* disagree on whether %d,%d reaches %d,%d\n",
+               start.x, start.y, goal.x, goal.y);
+        return 1;
+      }
+      if (!astar) continue;
+      ++astar_found;
+      ++hpa_found;
+      astar_cost += path_stats.cost;
+      hpa_cost += hpa_stats.cost;
+    }
+    Latency astar_latency = Summarize(&astar_usec);
+    Latency hpa_latency = Summarize(&hpa_usec);
+    printf("%-8.2f %-6s %10.1f %10.1f %10.1f %8u\n", density, "astar",
+           astar_latency.mean_usec, astar_latency.p99_usec,
+           astar_found ? astar_cost / astar_found : 0.0, astar_found);
+    printf("%-8.2f %-6s %10.1f %10.1f %10.1f %8u\n", density, "hpa",
+           hpa_latency.mean_usec, hpa_latency.p99_usec,
+           hpa_found ? hpa_cost / hpa_found : 0.0, hpa_found);
+
+    r64 update_usec = 0.0;
+    u64 clusters = 0;
+    for (u32 i = 0; i < kUpdates; ++i) {
+      v2i changed(cell(rng), cell(rng));
+      blocked[changed.y * kMapSize + changed.x] ^= 1;
+      platform::ClockStart(&clock);
+      clusters += search::HpaUpdateCell(grid, changed, &graph);
+      update_usec += platform::ClockEnd(&clock);
+    }
+    printf("         build %.0f us, update %.1f us touching %.2f clusters\n",
+           build_usec, update_usec / kUpdates, (r64)clusters / kUpdates);
+  }
+  return 0;
+}
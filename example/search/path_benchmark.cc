@@ -0,0 +1,209 @@
+// Times search::FindPath with A* and jump point search, and the BFS it
+// replaced, on random maps. Each map is rooms walled off from each other with
+// doorways, scattered with blocked cells. Every mode answers the same queries
+// between random open cells, and jump point paths are checked against A*'s.
+//
+//   path_benchmark [queries]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "common/common.cc"
+#include "math/math.cc"
+#include "platform/platform.cc"
+#include "search/search.cc"
+
+constexpr s32 kRoomSize = 32;
+constexpr r32 kScatter = .15f;
+// BFS visits the whole map per query, so it only runs on maps this small.
+constexpr s32 kBfsMaxSize = 256;
+
+struct Map {
+  s32 size;
+  std::vector<u8> blocked;
+  std::vector<v2i> open;
+
+  search::PathGrid
+  Grid() const
+  {
+    search::PathGrid grid;
+    grid.width = size;
+    grid.height = size;
+    grid.blocked = blocked.data();
+    return grid;
+  }
+};
+
+struct Query {
+  v2i start;
+  v2i goal;
+};
+
+struct Result {
+  r64 usec = 0.0;
+  u32 found = 0;
+  u64 expanded = 0;
+  std::vector<r32> costs;
+};
+
+Map
+CreateMap(s32 size, std::mt19937* rng)
+{
+  Map map;
+  map.size = size;
+  map.blocked.resize(size * size);
+  std::uniform_real_distribution<r32> chance(0.f, 1.f);
+  std::uniform_int_distribution<s32> door(1, kRoomSize - 4);
+  for (s32 y = 0; y < size; ++y) {
+    for (s32 x = 0; x < size; ++x) {
+      b8 wall = x % kRoomSize == 0 || y % kRoomSize == 0;
+      map.blocked[y * size + x] = wall || chance(*rng) < kScatter;
+    }
+  }
+  // Three cell doorways in the left and bottom wall of each room.
+  for (s32 ry = 0; ry < size; ry += kRoomSize) {
+    for (s32 rx = 0; rx < size; rx += kRoomSize) {
+      s32 dx = door(*rng);
+      s32 dy = door(*rng);
+      for (s32 i = 0; i < 3; ++i) {
+        if (rx + dx + i < size) map.blocked[ry * size + rx + dx + i] = 0;
+        if (ry + dy + i < size) map.blocked[(ry + dy + i) * size + rx] = 0;
+      }
+    }
+  }
+  for (s32 i = 0; i < size * size; ++i) {
+    if (!map.blocked[i]) map.open.push_back(v2i(i % size, i / size));
+  }
+  return map;
+}
+
+std::vector<Query>
+CreateQueries(const Map& map, u32 count, std::mt19937* rng)
+{
+  std::uniform_int_distribution<u32> cell(0, map.open.size() - 1);
+  std::vector<Query> queries(count);
+  for (Query& query : queries) {
+    query.start = map.open[cell(*rng)];
+    query.goal = map.open[cell(*rng)];
+  }
+  return queries;
+}
+
+Result
+RunFindPath(const Map& map, const std::vector<Query>& queries,
+            search::PathAlgorithm algorithm)
+{
+  search::PathGrid grid = map.Grid();
+  std::vector<v2i> path;
+  search::PathStats stats;
+  Result result;
+  result.costs.reserve(queries.size());
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  for (const Query& query : queries) {
+    b8 found = search::FindPath(grid, query.start, query.goal, &path,
+                                algorithm, &stats);
+    result.found += found;
+    result.expanded += stats.expanded;
+    result.costs.push_back(found ? stats.cost : -1.f);
+  }
+  result.usec = platform::ClockEnd(&clock);
+  // Check the paths walk what the stats say they cost. Untimed.
+  for (u32 i = 0; i < queries.size(); ++i) {
+    if (result.costs[i] < 0.f) continue;
+    search::FindPath(grid, queries[i].start, queries[i].goal, &path,
+                     algorithm);
+    // Costs are fixed point underneath, so the same path costs exactly the
+    // same however its steps were summed.
+    if (search::PathCost(path) != result.costs[i] ||
+        path.front() != queries[i].start || path.back() != queries[i].goal) {
+      printf("Path %u doesn't cost what was reported\n", i);
+      exit(1);
+    }
+  }
+  return result;
+}
+
+static const Map* kBfsMap;
+
+b8
+BfsBlocked(const v2i& pos)
+{
+  return kBfsMap->blocked[pos.y * kBfsMap->size + pos.x];
+}
+
+v2i
+BfsNeighbor(const v2i& from, u32 i)
+{
+  static const v2i kNeighbor[8] = {
+      v2i(-1, 0), v2i(1, 0),  v2i(0, 1),  v2i(0, -1),
+      v2i(1, 1),  v2i(-1, 1), v2i(1, -1), v2i(-1, -1)};
+  return from + kNeighbor[i % 8];
+}
+
+Result
+RunBfs(const Map& map, const std::vector<Query>& queries)
+{
+  kBfsMap = &map;
+  Result result;
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  for (const Query& query : queries) {
+    search::BfsIterator itr = {};
+    itr.blocked_callback = BfsBlocked;
+    itr.neighbor_callback = BfsNeighbor;
+    itr.max_neighbor = 8;
+    itr.current = query.start;
+    itr.map_size = v2i(map.size, map.size);
+    SBIT(itr.flags, search::kAvoidBlockedDiagnol);
+    result.found += search::BfsPathTo(&itr, query.goal) != nullptr;
+    result.expanded += search::kSearch.queue_size;
+  }
+  result.usec = platform::ClockEnd(&clock);
+  return result;
+}
+
+void
+Print(s32 size, const char* mode, const Result& result, u32 queries)
+{
+  printf("%-6d %-6s %12.0f %12.1f %8u\n", size, mode,
+         queries / (result.usec / 1e6), (r64)result.expanded / queries,
+         result.found);
+}
+
+int
+main(int argc, char** argv)
+{
+  u32 query_count = argc > 1 ? atoi(argv[1]) : 200;
+  std::mt19937 rng(1234);
+  printf("%-6s %-6s %12s %12s %8s\n", "map", "mode", "queries/s",
+         "expanded/q", "found");
+  for (s32 size : {256, 1024}) {
+    Map map = CreateMap(size, &rng);
+    std::vector<Query> queries = CreateQueries(map, query_count, &rng);
+    Result astar = RunFindPath(map, queries, search::kPathAStar);
+    Result jps = RunFindPath(map, queries, search::kPathJumpPoint);
+    Print(size, "astar", astar, query_count);
+    Print(size, "jps", jps, query_count);
+    for (u32 i = 0; i < query_count; ++i) {
+      if (astar.costs[i] != jps.costs[i]) {
+        printf("Query %u: A* cost %.3f, jump point cost %.3f\n", i,
+               astar.costs[i], jps.costs[i]);
+        return 1;
+      }
+    }
+    if (size > kBfsMaxSize) continue;
+    // BFS paths are shortest in steps rather than cost, so only whether a
+    // path was found is compared.
+    Result bfs = RunBfs(map, queries);
+    Print(size, "bfs", bfs, query_count);
+    if (bfs.found != astar.found) {
+      printf("BFS found %u paths, A* %u\n", bfs.found, astar.found);
+      return 1;
+    }
+  }
+  printf("Jump point paths match A*\n");
+  return 0;
+}
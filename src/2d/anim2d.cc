@@ -67,14 +67,21 @@ AnimSequence2d AnimSequence2d::LoadFromProto(const proto::Animation2d& proto) {
   texture_info.mag_filter = GL_NEAREST;
   for (const proto::AnimationFrame2d& pframe : proto.frames()) {
     SequenceFrame sframe;
-    // TODO: Should this load textures? This will upload to GPU / cache texture.
-    sframe.frame.texture_id_ = rgg::LoadTexture(
-        filesystem::SanitizePath(pframe.asset_name()).c_str(), texture_info);
-    sframe.frame.src_rect_ = Rectf(
+    std::string asset = filesystem::SanitizePath(pframe.asset_name());
+    Rectf src(
         pframe.texture_x(),
         pframe.texture_y(),
         pframe.texture_width(),
         pframe.texture_height());
+    // Frames whose image was packed into the atlas are remapped onto its
+    // page. The rest decode off the main thread and draw a placeholder until
+    // they're done.
+    if (!rgg::FindAtlasRegion(asset.c_str(), src, &sframe.frame.texture_id_,
+                              &sframe.frame.src_rect_)) {
+      sframe.frame.texture_id_ =
+          rgg::LoadTextureAsync(asset.c_str(), texture_info);
+      sframe.frame.src_rect_ = src;
+    }
     sframe.duration_sec = pframe.duration_sec();
     anim_sequence.sequence_frames_.push_back(sframe);
   }
@@ -160,12 +167,17 @@ proto::Animation2d AnimSequence2d::ToProto() const {
   for (const SequenceFrame& sframe : sequence_frames_) {
     const rgg::Texture* atex = rgg::GetTexture(sframe.frame.texture_id_);
     assert(atex != nullptr);
+    // Atlas frames are written back in terms of their original image.
+    std::string file = atex->file;
+    Rectf src = sframe.frame.src_rect_;
+    rgg::FindAtlasSource(sframe.frame.texture_id_, sframe.frame.src_rect_,
+                         &file, &src);
     proto::AnimationFrame2d* aframe = proto.add_frames();
-    aframe->set_asset_name(atex->file);
-    aframe->set_texture_x(sframe.frame.src_rect_.x);
-    aframe->set_texture_y(sframe.frame.src_rect_.y);
-    aframe->set_texture_width(sframe.frame.src_rect_.width);
-    aframe->set_texture_height(sframe.frame.src_rect_.height);
+    aframe->set_asset_name(file);
+    aframe->set_texture_x(src.x);
+    aframe->set_texture_y(src.y);
+    aframe->set_texture_width(src.width);
+    aframe->set_texture_height(src.height);
     aframe->set_duration_sec(sframe.duration_sec);
   }
   return proto;
@@ -4,14 +4,20 @@
 
 // TODO: This is all copy pasta from editor_render_target, seems like maybe should generify it.
 struct Layer2dSurface {
-  bool IsValid() const { return render_target.IsValid(); }
-  r32 width() const { return render_target.width(); }
-  r32 height() const { return render_target.height(); }
+  bool IsValid() const { return surface().IsValid(); }
+  r32 width() const { return surface().width(); }
+  r32 height() const { return surface().height(); }
   v2f Dims() const { return v2f( width(), height() ); }
   Rectf rect() const { return Rectf(v2f(0.f, 0.f), Dims()); };
-  const rgg::Texture& texture() const { return render_target.texture; }
+  const rgg::Texture& texture() const { return surface().texture; }
+  const rgg::Surface& surface() const {
+    static const rgg::Surface kNoSurface = {};
+    const rgg::RenderTarget* render_target = rgg::GetRenderTarget(target);
+    return render_target ? render_target->surface : kNoSurface;
+  }
   rgg::Camera camera;
-  rgg::Surface render_target;
+  // Layers are only drawn into when edited, everything else composites them.
+  rgg::RenderTargetId target = 0;
 };
 
 Layer2dSurface CreateLayer2dWithTexture(v2f dims, const rgg::Texture& texture) {
@@ -20,7 +26,7 @@ Layer2dSurface CreateLayer2dWithTexture(v2f dims, const rgg::Texture& texture) {
   surface.camera.dir = v3f(0.f, 0.f, -1.f);
   surface.camera.up = v3f(0.f, 1.f, 0.f);
   surface.camera.viewport = dims;
-  surface.render_target = rgg::CreateSurfaceFromTexture(texture);
+  surface.target = rgg::CreateRenderTarget("layer", texture);
   return surface;
 }
 
@@ -30,31 +36,32 @@ Layer2dSurface CreateLayer2dSurface(v2f dims) {
   surface.camera.dir = v3f(0.f, 0.f, -1.f);
   surface.camera.up = v3f(0.f, 1.f, 0.f);
   surface.camera.viewport = dims;
-  surface.render_target = rgg::CreateSurface(GL_RGBA, (u64)dims.x, (u64)dims.y);
-  rgg::BeginRenderTo(surface.render_target);
+  surface.target = rgg::CreateRenderTarget("layer", (u64)dims.x, (u64)dims.y);
+  rgg::BeginRenderTarget(surface.target);
   // Without this we have no alpha.
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glClearColor(0.f, 0.f, 0.f, 0.f);
+  rgg::EndRenderTarget(surface.target);
   return surface;
 }
 
 void DestroyLayer2dSurface(Layer2dSurface* surface) {
-  if (surface->IsValid()) {
-    rgg::DestroySurface(&surface->render_target);
-  }
+  rgg::DestroyRenderTarget(surface->target);
   *surface = {};
 }
 
 class RenderToLayer2dSurface {
 public:
-  RenderToLayer2dSurface(const Layer2dSurface& surface) : mod_observer_(surface.camera) {
-    rgg::BeginRenderTo(surface.render_target);
+  RenderToLayer2dSurface(const Layer2dSurface& surface)
+      : mod_observer_(surface.camera), target_(surface.target) {
+    rgg::BeginRenderTarget(target_);
   }
   ~RenderToLayer2dSurface() {
-    rgg::EndRenderTo();
+    rgg::EndRenderTarget(target_);
   }
 
   rgg::ModifyObserver mod_observer_;
+  rgg::RenderTargetId target_;
 };
 
 class Layer2d {
@@ -64,6 +71,12 @@ public:
   // Construct surface.
   void Initialize(const Rectf& world_rect, v4f color = v4f(0.f, 0.f, 0.f, 0.f));
   void InitializeWithTexture(const rgg::Texture& texture);
+  // Loads image_file asynchronously. The layer draws a placeholder of dims
+  // until the image is ready.
+  void InitializeAsync(const char* image_file, v2f dims,
+                       const rgg::TextureInfo& texture_info);
+  // Creates the surface once an async load finishes. False while loading.
+  bool Resolve();
   void AddTexture(const rgg::Texture* texture, const Rectf& src_rect, const Rectf& dest_rect);
 
   void Render(r32 scale = 1.f);
@@ -79,6 +92,8 @@ public:
   Layer2dSurface surface_;
   v4f background_color_;
   Rectf world_rect_;
+  // Set while the layer's image is loading.
+  rgg::TextureId texture_id_ = 0;
 };
 
 class Map2d {
@@ -107,17 +122,32 @@ public:
   proto::Map2d ToProto(const char* map_name) const;
 
   bool HasLayers() const { return !layers_.empty(); }
+  // False while any layer's image is still loading.
+  bool IsLoaded();
   s32 GetLayerCount() const { return layers_.size(); }
 
   const std::vector<proto::Entity2d>& entities() const { return entities_; }
+  // Changes on every edit and when a layer finishes loading, so views drawing
+  // the map can skip redrawing it otherwise.
+  u32 version() const { return version_; }
+  void MarkEdited();
 
   std::vector<Layer2d> layers_;
   std::vector<Rectf> collision_rects_;
   std::vector<proto::Entity2d> entities_;
+
+private:
+  u32 version_ = 0;
 };
 
+// Versions are unique across maps so a newly loaded map never looks unchanged.
+static u32 kMap2dEdits = 0;
+
 void Layer2d::Clear() {
   if (surface_.IsValid()) DestroyLayer2dSurface(&surface_);
+  // A load still in flight stays in the texture cache, where reloading the
+  // map will find it.
+  texture_id_ = 0;
 }
 
 void Layer2d::Initialize(const Rectf& world_rect, v4f color) {
@@ -140,8 +170,25 @@ void Layer2d::InitializeWithTexture(const rgg::Texture& texture) {
   surface_ = CreateLayer2dWithTexture(world_rect_.Dims(), texture);
 }
 
+void Layer2d::InitializeAsync(const char* image_file, v2f dims,
+                              const rgg::TextureInfo& texture_info) {
+  world_rect_ = Rectf(dims / -2.f, dims);
+  texture_id_ = rgg::LoadTextureAsync(image_file, texture_info);
+}
+
+bool Layer2d::Resolve() {
+  if (IsSurfaceValid()) return true;
+  if (!texture_id_) return false;
+  rgg::Texture texture;
+  if (!rgg::CopyTexture(texture_id_, &texture)) return false;
+  texture_id_ = 0;
+  if (!texture.IsValid()) return false;
+  InitializeWithTexture(texture);
+  return true;
+}
+
 void Layer2d::AddTexture(const rgg::Texture* texture, const Rectf& src_rect, const Rectf& dest_rect) {
-  if (!IsSurfaceValid()) {
+  if (!Resolve()) {
     LOG(WARN, "Trying to render to a Layer2d that has not been intialized.");
   }
   RenderToLayer2dSurface render_to(surface_);
@@ -149,15 +196,22 @@ void Layer2d::AddTexture(const rgg::Texture* texture, const Rectf& src_rect, con
 }
 
 void Layer2d::Render(r32 scale) {
-  assert(IsSurfaceValid());
-  Rectf dest = Rectf(surface_.Dims() / -2.f, surface_.Dims());
+  bool resolved = Resolve();
+  if (!resolved && !texture_id_) return;
+  v2f dims = world_rect_.Dims();
+  Rectf dest = Rectf(dims / -2.f, dims);
   if (scale != 1.f) {
     dest.x *= scale;
     dest.y *= scale;
     dest.width *= scale;
     dest.height *= scale;
   }
-  rgg::RenderTexture(surface_.render_target.texture, surface_.rect(), dest);
+  if (!resolved) {
+    // The cache's placeholder until the image is uploaded.
+    rgg::RenderTexture(texture_id_, Rectf(v2f(0.f, 0.f), dims), dest);
+    return;
+  }
+  rgg::RenderTexture(surface_.texture(), surface_.rect(), dest);
 }
 
 v4f Layer2d::background_color() const {
@@ -171,7 +225,7 @@ v4f Layer2d::background_color() const {
 }
 
 const rgg::Surface& Layer2d::GetSurface() const {
-  return surface_.render_target;
+  return surface_.surface();
 }
 
 const rgg::Texture& Layer2d::GetTexture() const {
@@ -184,15 +238,11 @@ Map2d Map2d::LoadFromProto(const proto::Map2d& proto) {
   texture_info.min_filter = GL_NEAREST_MIPMAP_NEAREST;
   texture_info.mag_filter = GL_NEAREST;
   for (const proto::Layer2d proto_layer : proto.layers()) {
-    rgg::Texture texture;
-    if (!rgg::LoadFromFile(proto_layer.image_file().c_str(), texture_info, &texture)) {
-      LOG(ERR, "Cannot load texture file %s... This is probably bad. Check that it exists?",
-          proto_layer.image_file().c_str());
-      continue;
-    }
     Layer2d layer;
     // TODO: world_rect should be loaded from file.
-    layer.InitializeWithTexture(texture);
+    layer.InitializeAsync(proto_layer.image_file().c_str(),
+                          v2f(proto_layer.width(), proto_layer.height()),
+                          texture_info);
     map.layers_.push_back(std::move(layer));
   }
   for (const proto::MapGeometry2d& proto_geom : proto.geometry()) {
@@ -206,6 +256,7 @@ Map2d Map2d::LoadFromProto(const proto::Map2d& proto) {
   for (const proto::Entity2d& entity : proto.entities()) {
     map.entities_.push_back(entity);
   }
+  map.MarkEdited();
   return map;
 }
 
@@ -225,6 +276,20 @@ void Map2d::Clear() {
   }
   layers_.clear();
   collision_rects_.clear();
+  MarkEdited();
+}
+
+bool Map2d::IsLoaded() {
+  for (Layer2d& layer : layers_) {
+    if (!layer.texture_id_) continue;
+    if (!layer.Resolve()) return false;
+    MarkEdited();
+  }
+  return true;
+}
+
+void Map2d::MarkEdited() {
+  version_ = ++kMap2dEdits;
 }
 
 void Map2d::AddLayer(const Rectf& world_rect) {
@@ -232,26 +297,31 @@ void Map2d::AddLayer(const Rectf& world_rect) {
   // TODO: AddLayer should pass in bounds.
   layer.Initialize(world_rect);
   layers_.push_back(std::move(layer));
+  MarkEdited();
 }
 
 void Map2d::AddTexture(s32 layer_idx, const rgg::Texture* texture, const Rectf& src_rect, const Rectf& dest_rect) {
   assert(layer_idx < layers_.size());
   Layer2d* layer = &layers_[layer_idx];
   layer->AddTexture(texture, src_rect, dest_rect);
+  MarkEdited();
 }
 
 void Map2d::AddGeometry(const Rectf& world_rect) {
   collision_rects_.push_back(world_rect);
+  MarkEdited();
 }
 
 void Map2d::AddEntity(const proto::Entity2d& entity) {
   entities_.push_back(entity);
+  MarkEdited();
 }
 
 void Map2d::DeleteGeometryAtPoint(v2f point) {
   for (s32 i = 0; i < collision_rects_.size();) {
     if (math::PointInRect(point, collision_rects_[i])) {
       collision_rects_.erase(collision_rects_.begin() + i);
+      MarkEdited();
       continue;
     }
     ++i;
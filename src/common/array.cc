@@ -2,6 +2,12 @@
 
 #include <cstdint>
 
+// Static pools report their size to the memory tracker when it's compiled in.
+// See memory/tracker.cc.
+#ifndef TRACK_STATIC_POOL
+#define TRACK_STATIC_POOL(type, bytes)
+#endif
+
 // For the given type defines:
 //    kMax<type> - The upper bound count for the given type.
 //    k<type> - The storage for the type.
@@ -17,6 +23,7 @@
   static type kZero##type;                         \
                                                    \
   static u64 kUsed##type;                          \
+  TRACK_STATIC_POOL(type, sizeof(k##type))         \
                                                    \
   type* Use##type()                                \
   {                                                \
@@ -47,6 +54,35 @@
     --kUsed##type;                                 \
   }
 
+// Like DECLARE_ARRAY but doubles its storage instead of failing when full.
+// Pointers into k<type> are invalidated when that happens.
+#define DECLARE_GROWABLE_ARRAY(type, initial_count)         \
+  static type kStorage##type[initial_count];                \
+  static type* k##type = kStorage##type;                    \
+  static u64 kCapacity##type = initial_count;               \
+  static type kZero##type;                                  \
+                                                            \
+  static u64 kUsed##type;                                   \
+  TRACK_STATIC_POOL(type, sizeof(kStorage##type))           \
+                                                            \
+  type* Use##type()                                         \
+  {                                                         \
+    if (kUsed##type >= kCapacity##type) {                   \
+      u64 capacity = kCapacity##type * 2;                   \
+      type* storage = new type[capacity]();                 \
+      for (u64 i = 0; i < kUsed##type; ++i) {               \
+        storage[i] = k##type[i];                            \
+      }                                                     \
+      if (k##type != kStorage##type) delete[] k##type;      \
+      k##type = storage;                                    \
+      kCapacity##type = capacity;                           \
+    }                                                       \
+    type* t = &k##type[kUsed##type];                        \
+    kUsed##type += 1;                                       \
+    *t = {};                                                \
+    return t;                                               \
+  }
+
 #define DECLARE_ID_ARRAY(type, max_count)                                 \
   DECLARE_ARRAY(type, max_count)                                          \
   static u32 kAutoIncrementId##type = 1;                                  \
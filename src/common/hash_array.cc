@@ -3,95 +3,172 @@
 #include <cassert>
 #include <cstdint>
 
+#ifndef TRACK_STATIC_POOL
+#define TRACK_STATIC_POOL(type, bytes)
+#endif
+
+// Ids handed out by a hash array are a slot index tagged with the slot's
+// generation:
+//
+//   [31] always 0 | [30..20] generation | [19..0] slot
+//
+// A slot belongs to one live element at a time and keeps its index for the
+// element's lifetime so Hash<type>(id) is a unique, stable index below
+// kMaxHash<type> for every live id. Freeing a slot bumps its generation so
+// handles to the old element stop resolving. The top bit is left clear for
+// callers that want to tag ids.
+constexpr u32 kHashArraySlotBits = 20;
+constexpr u32 kHashArraySlotMask = (1u << kHashArraySlotBits) - 1;
+constexpr u32 kHashArrayGenerationMask = (1u << 11) - 1;
+// Marks the end of a free slot list.
+constexpr u32 kHashArrayNoSlot = 0xFFFFFFFF;
+
 struct HashEntry {
+  // Id of the element in this slot, kInvalidId if the slot is free.
   u32 id;
+  // Index of the element in the array. Next free slot when free.
   u32 array_idx;
+  // Generation the next id handed out from this slot will carry.
+  u32 generation;
 };
 
-#define DECLARE_HASH_ARRAY(type, max_count)                                   \
+// For the given type defines:
+//    kMax<type> - The compile time count of the given type.
+//    k<type> - Densely packed storage for the type.
+//    kUsed<type> - The in-use count of the given type.
+// Methods:
+//    Use<type>() - Allocates an element and gives it an id.
+//    Find<type>(u32 id) - The element for id, nullptr if id is stale.
+//    SwapAndClear<type>(u32 id) - Frees the element for id, moving the last
+//    element into its place.
+//
+// Lookup is a single slot read regardless of how full the array is. The
+// growable variant doubles its storage when full - pointers into k<type> are
+// invalidated when that happens.
+#define _DECLARE_HASH_ARRAY(type, max_count, growable)                        \
   constexpr u32 kMax##type = max_count;                                       \
-  constexpr u32 kMaxHash##type = (max_count * 2);                             \
-  static_assert(POWEROF2(kMaxHash##type), "kMaxHash must be a power of 2");   \
+  constexpr u32 kMaxHash##type = max_count;                                   \
+  static_assert(kMax##type <= kHashArraySlotMask, "Too many slots for ids");  \
                                                                               \
-  static u32 kAutoIncrementId##type = 1;                                      \
   static u64 kUsed##type = 0;                                                 \
                                                                               \
-  static type k##type[max_count];                                             \
-  static HashEntry kHashEntry##type[kMaxHash##type];                          \
+  static type kStorage##type[max_count];                                      \
+  static HashEntry kHashEntryStorage##type[max_count];                        \
+  static type* k##type = kStorage##type;                                      \
+  static HashEntry* kHashEntry##type = kHashEntryStorage##type;               \
+  static u32 kCapacity##type = max_count;                                     \
+  /* Slots at or above this have never been used. */                          \
+  static u32 kSlotHigh##type = 0;                                             \
+  static u32 kFreeSlot##type = kHashArrayNoSlot;                              \
   static type kZero##type;                                                    \
+  TRACK_STATIC_POOL(type, sizeof(kStorage##type) +                            \
+                          sizeof(kHashEntryStorage##type))                    \
                                                                               \
   b8 IsEmptyEntry##type(HashEntry entry)                                      \
   {                                                                           \
-    return entry.id == kInvalidId || k##type[entry.array_idx].id != entry.id; \
+    return entry.id == kInvalidId;                                            \
   }                                                                           \
                                                                               \
   u32 Hash##type(u32 id)                                                      \
   {                                                                           \
-    return MOD_BUCKET(id, kMaxHash##type);                                    \
+    return id & kHashArraySlotMask;                                           \
+  }                                                                           \
+                                                                              \
+  b8 Grow##type()                                                             \
+  {                                                                           \
+    if (!growable) return false;                                              \
+    u32 capacity = kCapacity##type * 2;                                       \
+    if (capacity > kHashArraySlotMask) return false;                          \
+    type* storage = new type[capacity]();                                     \
+    HashEntry* entries = new HashEntry[capacity]();                           \
+    for (u32 i = 0; i < kUsed##type; ++i) storage[i] = k##type[i];            \
+    for (u32 i = 0; i < kSlotHigh##type; ++i) entries[i] = kHashEntry##type[i];\
+    if (k##type != kStorage##type) delete[] k##type;                          \
+    if (kHashEntry##type != kHashEntryStorage##type) {                        \
+      delete[] kHashEntry##type;                                              \
+    }                                                                         \
+    k##type = storage;                                                        \
+    kHashEntry##type = entries;                                               \
+    kCapacity##type = capacity;                                               \
+    return true;                                                              \
   }                                                                           \
                                                                               \
   u32 GenerateFreeId##type()                                                  \
   {                                                                           \
-    u32 id = kAutoIncrementId##type;                                          \
-    HashEntry* hash_entry = &kHashEntry##type[Hash##type(id)];                \
-    while (!IsEmptyEntry##type(*hash_entry)) {                                \
-      id += 1;                                                                \
-      hash_entry = &kHashEntry##type[Hash##type(id)];                         \
+    u32 slot = kFreeSlot##type;                                               \
+    if (slot != kHashArrayNoSlot) {                                           \
+      kFreeSlot##type = kHashEntry##type[slot].array_idx;                     \
+    } else {                                                                  \
+      if (kSlotHigh##type >= kCapacity##type && !Grow##type()) {              \
+        return kInvalidId;                                                    \
+      }                                                                       \
+      slot = kSlotHigh##type++;                                               \
+      kHashEntry##type[slot] = {kInvalidId, 0, 1};                            \
     }                                                                         \
-    kAutoIncrementId##type = id;                                              \
-    return id;                                                                \
+    HashEntry* entry = &kHashEntry##type[slot];                               \
+    entry->id = (entry->generation << kHashArraySlotBits) | slot;             \
+    return entry->id;                                                         \
   }                                                                           \
                                                                               \
   type* Use##type()                                                           \
   {                                                                           \
-    assert(kUsed##type < max_count);                                          \
-    if (kUsed##type >= max_count) return nullptr;                             \
+    if (kUsed##type >= kCapacity##type && !Grow##type()) {                    \
+      assert(!"Hash array is full");                                          \
+      return nullptr;                                                         \
+    }                                                                         \
+    u32 id = GenerateFreeId##type();                                          \
+    if (id == kInvalidId) return nullptr;                                     \
     type* u = &k##type[kUsed##type++];                                        \
     *u = {};                                                                  \
-    u->id = GenerateFreeId##type();                                           \
-    u32 hash = Hash##type(u->id);                                             \
-    HashEntry* hash_entry = &kHashEntry##type[hash];                          \
-    hash_entry->id = u->id;                                                   \
-    hash_entry->array_idx = kUsed##type - 1;                                  \
-    ++kAutoIncrementId##type;                                                 \
+    u->id = id;                                                               \
+    kHashEntry##type[Hash##type(id)].array_idx = kUsed##type - 1;             \
     return u;                                                                 \
   }                                                                           \
                                                                               \
-  type* Find##type(u32 id)                                                    \
+  HashEntry* FindHashEntry##type(u32 id)                                      \
   {                                                                           \
     if (!id) return nullptr;                                                  \
-    u32 hash = Hash##type(id);                                                \
-    HashEntry* entry = &kHashEntry##type[hash];                               \
+    u32 slot = Hash##type(id);                                                \
+    if (slot >= kSlotHigh##type) return nullptr;                              \
+    HashEntry* entry = &kHashEntry##type[slot];                               \
     if (entry->id != id) return nullptr;                                      \
+    return entry;                                                             \
+  }                                                                           \
+                                                                              \
+  type* Find##type(u32 id)                                                    \
+  {                                                                           \
+    HashEntry* entry = FindHashEntry##type(id);                               \
+    if (!entry) return nullptr;                                               \
     return &k##type[entry->array_idx];                                        \
   }                                                                           \
                                                                               \
   void FreeHashEntry##type(u32 id)                                            \
   {                                                                           \
-    u32 hash = Hash##type(id);                                                \
-    kHashEntry##type[hash] = {0, 0};                                          \
+    HashEntry* entry = FindHashEntry##type(id);                               \
+    if (!entry) return;                                                       \
+    entry->id = kInvalidId;                                                   \
+    entry->generation = (entry->generation + 1) & kHashArrayGenerationMask;   \
+    /* Generation 0 would let slot 0 hand out the invalid id. */              \
+    if (!entry->generation) entry->generation = 1;                            \
+    entry->array_idx = kFreeSlot##type;                                       \
+    kFreeSlot##type = Hash##type(id);                                         \
   }                                                                           \
                                                                               \
   void Clear##type(u32 id)                                                    \
   {                                                                           \
-    if (!id) return;                                                          \
-    u32 hash = Hash##type(id);                                                \
-    HashEntry* entry = &kHashEntry##type[hash];                               \
-    if (entry->id != id) return;                                              \
+    HashEntry* entry = FindHashEntry##type(id);                               \
+    if (!entry) return;                                                       \
     k##type[entry->array_idx] = {};                                           \
-    *entry = {0, 0};                                                          \
+    FreeHashEntry##type(id);                                                  \
     --kUsed##type;                                                            \
   }                                                                           \
                                                                               \
   void Swap##type(u32 id1, u32 id2)                                           \
   {                                                                           \
     if (id1 == id2) return;                                                   \
-    if (!id1) return;                                                         \
-    u32 hash1 = Hash##type(id1);                                              \
-    HashEntry* entry1 = &kHashEntry##type[hash1];                             \
-    if (!id2) return;                                                         \
-    u32 hash2 = Hash##type(id2);                                              \
-    HashEntry* entry2 = &kHashEntry##type[hash2];                             \
+    HashEntry* entry1 = FindHashEntry##type(id1);                             \
+    HashEntry* entry2 = FindHashEntry##type(id2);                             \
+    if (!entry1 || !entry2) return;                                           \
     type t = k##type[entry1->array_idx];                                      \
     k##type[entry1->array_idx] = k##type[entry2->array_idx];                  \
     k##type[entry2->array_idx] = t;                                           \
@@ -106,14 +183,19 @@ struct HashEntry {
     Clear##type(id);                                                          \
   }                                                                           \
                                                                               \
+  /* Frees everything. Slots keep their generations so ids from before the */ \
+  /* reset stay stale. */                                                     \
   void Reset##type()                                                          \
   {                                                                           \
-    for (u32 i = 0; i < kMax##type; ++i) {                                    \
+    for (u32 i = 0; i < kUsed##type; ++i) {                                   \
+      FreeHashEntry##type(k##type[i].id);                                     \
       k##type[i] = {};                                                        \
     }                                                                         \
-    for (u32 i = 0; i < kMaxHash##type; ++i) {                                \
-      kHashEntry##type[i] = {};                                               \
-    }                                                                         \
     kUsed##type = 0;                                                          \
-    kAutoIncrementId##type = 1;                                               \
   }
+
+#define DECLARE_HASH_ARRAY(type, max_count) \
+  _DECLARE_HASH_ARRAY(type, max_count, false)
+
+#define DECLARE_GROWABLE_HASH_ARRAY(type, initial_count) \
+  _DECLARE_HASH_ARRAY(type, initial_count, true)
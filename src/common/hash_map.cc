@@ -2,122 +2,278 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <type_traits>
 
 constexpr u32 kMaxHashKeyLength = 128;
 
-struct HashMapStrEntry {
-  char str[kMaxHashKeyLength];
+constexpr u32 kHashSeed = 2166136261u;
+constexpr u32 kHashPrime = 16777619u;
+
+// FNV-1a. Pass a previous result as hash to continue hashing a key that is
+// built in pieces.
+constexpr u32
+GetHash(const char* str, u32 len, u32 hash = kHashSeed)
+{
+  for (u32 i = 0; i < len; ++i) {
+    hash ^= (u8)str[i];
+    hash *= kHashPrime;
+  }
+  return hash;
+}
+
+// A key and its hash. Use HASH_STR for literals so the hash is computed at
+// compile time:
+//
+//   imui::Begin(HASH_STR("Debug"), imui::kEveryoneTag, ...);
+struct HashStr {
+  constexpr HashStr(const char* str, u32 len, u32 hash)
+      : str(str), len(len), hash(hash) {}
+  HashStr(const char* str, u32 len) : HashStr(str, len, GetHash(str, len)) {}
+  const char* str;
+  u32 len;
+  u32 hash;
+};
+
+#define HASH_STR(literal)                                                 \
+  HashStr(literal, sizeof(literal) - 1,                                   \
+          std::integral_constant<u32, GetHash(literal,                    \
+                                              sizeof(literal) - 1)>::value)
+
+// Keys are copied into a shared table of reference counted strings. Equal
+// keys share one copy, and it's freed when the last map entry using it is
+// erased.
+constexpr u32 kMaxInternedStrings = 4096;
+
+struct InternedStr {
+  char* str = nullptr;
   u32 len = 0;
-  u32 array_index = 0;
+  u32 hash = 0;
+  u32 refs = 0;
+};
+
+struct InternTable {
+  u32 count = 0;
+  InternedStr strings[kMaxInternedStrings];
 };
 
-b8 CompareHashMapEntry(const char* str, u32 len, const HashMapStrEntry& entry) {
-  if (len != entry.len) return false;
-  return strncmp(str, entry.str, len) == 0;
+static InternTable kInternTable;
+
+const char*
+InternString(const HashStr& key)
+{
+  InternTable* table = &kInternTable;
+  u32 idx = key.hash % kMaxInternedStrings;
+  while (table->strings[idx].str) {
+    InternedStr* s = &table->strings[idx];
+    if (s->hash == key.hash && s->len == key.len &&
+        memcmp(s->str, key.str, key.len) == 0) {
+      ++s->refs;
+      return s->str;
+    }
+    idx = (idx + 1) % kMaxInternedStrings;
+  }
+  // Probing relies on at least one empty slot.
+  if (table->count >= kMaxInternedStrings - 1) {
+    fprintf(stderr, "InternString: more than %u live keys\n",
+            kMaxInternedStrings - 1);
+    abort();
+  }
+  char* str = (char*)malloc(key.len + 1);
+  memcpy(str, key.str, key.len);
+  str[key.len] = 0;
+  table->strings[idx] = {str, key.len, key.hash, 1};
+  ++table->count;
+  return str;
 }
 
-u32 GetHash(const char* str, u32 len) {
-  // djb2_hash_more collides a lot for some reason - using this instead.
-  // Call imui::DebugPane to see hash collisions on panes.
-  u32 hash = 7;
-  for (u32 i = 0; i < len; ++i) {
-    hash = hash * 31 + str[i];
+// Drops a reference taken by InternString.
+void
+ReleaseString(const char* str, u32 hash)
+{
+  InternTable* table = &kInternTable;
+  u32 hole = hash % kMaxInternedStrings;
+  while (table->strings[hole].str != str) {
+    assert(table->strings[hole].str);
+    hole = (hole + 1) % kMaxInternedStrings;
   }
-  return hash;
+  if (--table->strings[hole].refs) return;
+  free(table->strings[hole].str);
+  --table->count;
+  // Pull back entries whose probe run passes through the hole.
+  u32 idx = hole;
+  for (;;) {
+    idx = (idx + 1) % kMaxInternedStrings;
+    InternedStr* next = &table->strings[idx];
+    if (!next->str) break;
+    u32 home = next->hash % kMaxInternedStrings;
+    b8 stays = hole <= idx ? (hole < home && home <= idx)
+                           : (hole < home || home <= idx);
+    if (stays) continue;
+    table->strings[hole] = *next;
+    hole = idx;
+  }
+  table->strings[hole] = {};
+}
+
+struct HashMapStrEntry {
+  // Interned key, nullptr if the entry is empty.
+  const char* str = nullptr;
+  u32 len = 0;
+  u32 hash = 0;
+  u32 array_index = 0;
+};
+
+b8 CompareHashMapEntry(const HashStr& key, const HashMapStrEntry& entry) {
+  if (key.hash != entry.hash || key.len != entry.len) return false;
+  return key.str == entry.str || memcmp(key.str, entry.str, key.len) == 0;
 }
 
-#define DECLARE_HASH_MAP_STR(type, max_count)                       \
-  constexpr u32 kMax##type = max_count;                             \
-  constexpr u32 kMaxHash##type = (u32)(1.3f * max_count);           \
-                                                                    \
-  static u64 kUsed##type = 0;                                       \
-  static u32 kInvalid##type = 0;                                    \
-                                                                    \
-  static type k##type[max_count];                                   \
-  static HashMapStrEntry kHashEntry##type[kMaxHash##type];          \
-  static type kZero##type;                                          \
-  static u32 kFindCalls##type = 0;                                  \
-  static u32 kFindCollisions##type = 0;                             \
-                                                                    \
-  HashMapStrEntry*                                                  \
-  FindEmptyHashEntry##type(const char* key, u32 key_len)            \
-  {                                                                 \
-    u32 idx = GetHash(key, key_len) % kMaxHash##type;               \
-    while (kHashEntry##type[idx].len) {                             \
-      idx = (idx + 1) % kMaxHash##type;                             \
-    }                                                               \
-    return &kHashEntry##type[idx];                                  \
-  }                                                                 \
-                                                                    \
-  type*                                                             \
-  Use##type(const char* key, u32 key_len)                           \
-  {                                                                 \
-    assert(key_len <= kMaxHashKeyLength);                           \
-    if (kUsed##type >= kMax##type) return nullptr;                  \
-    type* u = &k##type[kUsed##type++];                              \
-    *u = {};                                                        \
-    HashMapStrEntry* entry = FindEmptyHashEntry##type(key, key_len);\
-    memcpy(entry->str, key, key_len);                               \
-    entry->len = key_len;                                           \
-    entry->array_index = kUsed##type - 1;                           \
-    return u;                                                       \
-  }                                                                 \
-                                                                    \
-  HashMapStrEntry*                                                  \
-  FindHashEntry##type(const char* key, u32 key_len)                 \
-  {                                                                 \
-    u32 idx = GetHash(key, key_len) % kMaxHash##type;               \
-    HashMapStrEntry* hash_entry = &kHashEntry##type[idx];           \
-    u32 n = 0;                                                      \
-    ++kFindCalls##type;                                             \
-    b8 collision = false;                                           \
-    while (!CompareHashMapEntry(key, key_len, *hash_entry) &&       \
-           n < kMaxHash##type) {                                    \
-      idx = (idx + 1) % kMaxHash##type;                             \
-      hash_entry = &kHashEntry##type[idx];                          \
-      ++n;                                                          \
-      collision = true;                                             \
-    }                                                               \
-    if (collision) {                                                \
-      ++kFindCollisions##type;                                      \
-    }                                                               \
-    if (n >= kMaxHash##type) return nullptr;                        \
-    return hash_entry;                                              \
-  }                                                                 \
-                                                                    \
-  type*                                                             \
-  Find##type(const char* key, u32 key_len)                          \
-  {                                                                 \
-    HashMapStrEntry* hash_entry = FindHashEntry##type(key, key_len);\
-    if (!hash_entry) return nullptr;                                \
-    return &k##type[hash_entry->array_index];                       \
-  }                                                                 \
-                                                                    \
-  type*                                                             \
-  FindOrUse##type(const char* key, u32 key_len)                     \
-  {                                                                 \
-    HashMapStrEntry* hash_entry = FindHashEntry##type(key, key_len);\
-    if (!hash_entry) return Use##type(key, key_len);                \
-    return &k##type[hash_entry->array_index];                       \
-  }                                                                 \
-                                                                    \
-  void                                                              \
-  Erase##type(const char* key, u32 key_len)                         \
-  {                                                                 \
-    HashMapStrEntry* hash_entry = FindHashEntry##type(key, key_len);\
-    if (!hash_entry) return;                                        \
-    u32 arr_idx = hash_entry->array_index;                          \
-    *hash_entry = {};                                               \
-    for (s32 i = arr_idx; i < kUsed##type; ++i) {                   \
-      k##type[i] = k##type[i + 1];                                  \
-    }                                                               \
-    k##type[kUsed##type - 1] = {};                                  \
-    --kUsed##type;                                                  \
-    for (s32 i = 0; i < kMaxHash##type; ++i) {                      \
-      HashMapStrEntry* hash_entry = &kHashEntry##type[i];           \
-      if (!hash_entry->len) continue;                               \
-      if (hash_entry->array_index > arr_idx)                        \
-        --hash_entry->array_index;                                  \
-    }                                                               \
+// For the given type defines:
+//    kMax<type> - The compile time count of the given type.
+//    k<type> - Densely packed storage for the type.
+//    kUsed<type> - The in-use count of the given type.
+// Methods:
+//    Use<type>(key) - Allocates an element for key.
+//    Find<type>(key) - The element for key, nullptr if there isn't one.
+//    FindOrUse<type>(key) - Find, falling back to Use.
+//    Erase<type>(key) - Frees the element for key, moving the last element
+//    into its place.
+//
+// Each method takes either a HashStr or a string and its length. Probing
+// compares stored hashes before touching key bytes. Erase shifts later
+// entries in the probe run back instead of leaving tombstones, so lookups
+// never walk over deleted entries.
+#define DECLARE_HASH_MAP_STR(type, max_count)                           \
+  constexpr u32 kMax##type = max_count;                                 \
+  constexpr u32 kMaxHash##type = (u32)(1.3f * max_count);               \
+                                                                        \
+  static u64 kUsed##type = 0;                                           \
+  static u32 kInvalid##type = 0;                                        \
+                                                                        \
+  static type k##type[max_count];                                       \
+  static HashMapStrEntry kHashEntry##type[kMaxHash##type];              \
+  /* Index into kHashEntry for each element of k<type>. */              \
+  static u32 kHashSlot##type[max_count];                                \
+  static type kZero##type;                                              \
+  static u32 kFindCalls##type = 0;                                      \
+  static u32 kFindCollisions##type = 0;                                 \
+                                                                        \
+  u32                                                                   \
+  FindEmptyHashSlot##type(u32 hash)                                     \
+  {                                                                     \
+    u32 idx = hash % kMaxHash##type;                                    \
+    while (kHashEntry##type[idx].str) {                                 \
+      idx = (idx + 1) % kMaxHash##type;                                 \
+    }                                                                   \
+    return idx;                                                         \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  Use##type(const HashStr& key)                                         \
+  {                                                                     \
+    assert(key.len <= kMaxHashKeyLength);                               \
+    if (kUsed##type >= kMax##type) return nullptr;                      \
+    type* u = &k##type[kUsed##type++];                                  \
+    *u = {};                                                            \
+    u32 slot = FindEmptyHashSlot##type(key.hash);                       \
+    HashMapStrEntry* entry = &kHashEntry##type[slot];                   \
+    entry->str = InternString(key);                                     \
+    entry->len = key.len;                                               \
+    entry->hash = key.hash;                                             \
+    entry->array_index = kUsed##type - 1;                               \
+    kHashSlot##type[entry->array_index] = slot;                         \
+    return u;                                                           \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  Use##type(const char* key, u32 key_len)                               \
+  {                                                                     \
+    return Use##type(HashStr(key, key_len));                            \
+  }                                                                     \
+                                                                        \
+  HashMapStrEntry*                                                      \
+  FindHashEntry##type(const HashStr& key)                               \
+  {                                                                     \
+    u32 idx = key.hash % kMaxHash##type;                                \
+    ++kFindCalls##type;                                                 \
+    for (u32 n = 0; n < kMaxHash##type; ++n) {                          \
+      HashMapStrEntry* hash_entry = &kHashEntry##type[idx];             \
+      if (!hash_entry->str) break;                                      \
+      if (CompareHashMapEntry(key, *hash_entry)) {                      \
+        if (n) ++kFindCollisions##type;                                 \
+        return hash_entry;                                              \
+      }                                                                 \
+      idx = (idx + 1) % kMaxHash##type;                                 \
+    }                                                                   \
+    return nullptr;                                                     \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  Find##type(const HashStr& key)                                        \
+  {                                                                     \
+    HashMapStrEntry* hash_entry = FindHashEntry##type(key);             \
+    if (!hash_entry) return nullptr;                                    \
+    return &k##type[hash_entry->array_index];                           \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  Find##type(const char* key, u32 key_len)                              \
+  {                                                                     \
+    return Find##type(HashStr(key, key_len));                           \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  FindOrUse##type(const HashStr& key)                                   \
+  {                                                                     \
+    HashMapStrEntry* hash_entry = FindHashEntry##type(key);             \
+    if (!hash_entry) return Use##type(key);                             \
+    return &k##type[hash_entry->array_index];                           \
+  }                                                                     \
+                                                                        \
+  type*                                                                 \
+  FindOrUse##type(const char* key, u32 key_len)                         \
+  {                                                                     \
+    return FindOrUse##type(HashStr(key, key_len));                      \
+  }                                                                     \
+                                                                        \
+  void                                                                  \
+  Erase##type(const HashStr& key)                                       \
+  {                                                                     \
+    HashMapStrEntry* hash_entry = FindHashEntry##type(key);             \
+    if (!hash_entry) return;                                            \
+    u32 arr_idx = hash_entry->array_index;                              \
+    u32 last = kUsed##type - 1;                                         \
+    if (arr_idx != last) {                                              \
+      k##type[arr_idx] = k##type[last];                                 \
+      kHashSlot##type[arr_idx] = kHashSlot##type[last];                 \
+      kHashEntry##type[kHashSlot##type[arr_idx]].array_index = arr_idx; \
+    }                                                                   \
+    k##type[last] = {};                                                 \
+    --kUsed##type;                                                      \
+    /* Pull back entries whose probe run passes through the hole. */    \
+    ReleaseString(hash_entry->str, hash_entry->hash);                   \
+    u32 hole = hash_entry - kHashEntry##type;                           \
+    u32 idx = hole;                                                     \
+    for (;;) {                                                          \
+      idx = (idx + 1) % kMaxHash##type;                                 \
+      HashMapStrEntry* next = &kHashEntry##type[idx];                   \
+      if (!next->str) break;                                            \
+      u32 home = next->hash % kMaxHash##type;                           \
+      b8 stays = hole <= idx ? (hole < home && home <= idx)             \
+                             : (hole < home || home <= idx);            \
+      if (stays) continue;                                              \
+      kHashEntry##type[hole] = *next;                                   \
+      kHashSlot##type[next->array_index] = hole;                        \
+      hole = idx;                                                       \
+    }                                                                   \
+    kHashEntry##type[hole] = {};                                        \
+  }                                                                     \
+                                                                        \
+  void                                                                  \
+  Erase##type(const char* key, u32 key_len)                             \
+  {                                                                     \
+    Erase##type(HashStr(key, key_len));                                 \
   }
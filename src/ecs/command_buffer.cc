@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace ecs {
+
+// Records structural changes - entity creation and deletion, component
+// assignment and removal - so they can be applied at a sync point instead of
+// while a storage is being iterated. Recording is safe from multiple threads.
+//
+//   ecs::kCommandBuffer.Assign<DeathComponent>(itr->e->id);
+//   ...
+//   ecs::kCommandBuffer.Execute();
+//
+// Create returns a placeholder id that can be passed to Assign before the
+// entity exists. Placeholders resolve to real entity ids during Execute.
+class CommandBuffer {
+ public:
+  CommandBuffer()
+  {
+    platform::MutexCreate(&mutex_);
+  }
+
+  u32
+  Create()
+  {
+    LockGuard lock(&mutex_);
+    Command cmd;
+    cmd.op = kCreate;
+    cmd.entity_id = kPlaceholderBit | create_count_++;
+    commands_.push_back(cmd);
+    return cmd.entity_id;
+  }
+
+  template <typename T>
+  void
+  Assign(u32 entity_id, const T& value = {})
+  {
+    LockGuard lock(&mutex_);
+    Command cmd;
+    cmd.op = kAssign;
+    cmd.tid = ComponentTypeId<T>::kValue;
+    cmd.entity_id = entity_id;
+    cmd.size = sizeof(T);
+    cmd.offset = AllocatePayload(sizeof(T), alignof(T));
+    cmd.destroy = [](void* t) { ((T*)t)->~T(); };
+    new (&payload_[cmd.offset]) T(value);
+    commands_.push_back(cmd);
+  }
+
+  template <typename T>
+  void
+  Remove(u32 entity_id)
+  {
+    LockGuard lock(&mutex_);
+    Command cmd;
+    cmd.op = kRemove;
+    cmd.tid = ComponentTypeId<T>::kValue;
+    cmd.entity_id = entity_id;
+    commands_.push_back(cmd);
+  }
+
+  void
+  Delete(u32 entity_id)
+  {
+    LockGuard lock(&mutex_);
+    Command cmd;
+    cmd.op = kDelete;
+    cmd.entity_id = entity_id;
+    commands_.push_back(cmd);
+  }
+
+  // Applies recorded commands. Creates run first, then commands are grouped
+  // by component type so each storage is looked up and written once, then
+  // deletes run last. Commands against the same storage keep the order they
+  // were recorded in. Must not be called while any storage is being iterated.
+  void
+  Execute()
+  {
+    LockGuard lock(&mutex_);
+    std::stable_sort(commands_.begin(), commands_.end(),
+                     [](const Command& a, const Command& b) {
+      if (a.op == kCreate || b.op == kCreate) return a.op == kCreate && b.op != kCreate;
+      if (a.op == kDelete || b.op == kDelete) return a.op != kDelete && b.op == kDelete;
+      return a.tid < b.tid;
+    });
+    u32 i = 0;
+    u32 n = commands_.size();
+    for (; i < n && commands_[i].op == kCreate; ++i) {
+      created_.push_back(UseEntity()->id);
+    }
+    while (i < n && commands_[i].op != kDelete) {
+      u64 tid = commands_[i].tid;
+      ComponentStorage* storage = GetComponents(tid);
+      for (; i < n && commands_[i].tid == tid && commands_[i].op != kDelete; ++i) {
+        Apply(storage, &commands_[i]);
+      }
+    }
+    for (; i < n; ++i) {
+      Entity* ent = FindEntity(Resolve(commands_[i].entity_id));
+      if (ent) DeleteEntity(ent);
+    }
+    commands_.clear();
+    payload_.clear();
+    created_.clear();
+    create_count_ = 0;
+  }
+
+  u32
+  size() const
+  {
+    return commands_.size();
+  }
+
+ private:
+  enum Op : u8 {
+    kCreate = 0,
+    kAssign = 1,
+    kRemove = 2,
+    kDelete = 3,
+  };
+
+  // Set on ids returned from Create. Hash array ids never set the top bit.
+  static constexpr u32 kPlaceholderBit = 1u << 31;
+
+  struct Command {
+    Op op;
+    u64 tid = 0;
+    u32 entity_id = 0;
+    // Location of the component bytes in payload_ for kAssign.
+    u32 offset = 0;
+    u32 size = 0;
+    // Runs the component destructor if the command is dropped.
+    void (*destroy)(void*) = nullptr;
+  };
+
+  u32
+  Resolve(u32 entity_id) const
+  {
+    if (!(entity_id & kPlaceholderBit)) return entity_id;
+    u32 idx = entity_id & ~kPlaceholderBit;
+    assert(idx < created_.size());
+    return created_[idx];
+  }
+
+  void
+  Apply(ComponentStorage* storage, Command* cmd)
+  {
+    Entity* ent = FindEntity(Resolve(cmd->entity_id));
+    switch (cmd->op) {
+      case kAssign: {
+        u8* src = &payload_[cmd->offset];
+        if (!ent) {
+          cmd->destroy(src);
+          break;
+        }
+        // The storage takes ownership of the recorded bytes. Assigning over
+        // an existing component replaces it.
+        u8* dst = storage->Assign(ent->id);
+        if (ent->Has(cmd->tid)) cmd->destroy(dst);
+        memcpy(dst, src, cmd->size);
+        *((u32*)dst) = ent->id;
+        SBIT(ent->components_mask, cmd->tid);
+        ComponentsChanged(ent);
+      } break;
+      case kRemove: {
+        if (!ent || !ent->Has(cmd->tid)) break;
+        storage->Erase(ent->id);
+        CBIT(ent->components_mask, cmd->tid);
+        ComponentsChanged(ent);
+      } break;
+      default: break;
+    }
+  }
+
+  u32
+  AllocatePayload(u32 size, u32 align)
+  {
+    assert(align <= alignof(std::max_align_t));
+    u32 offset = (payload_.size() + align - 1) & ~(align - 1);
+    payload_.resize(offset + size);
+    return offset;
+  }
+
+  std::vector<Command> commands_;
+  // Components are relocated as raw bytes when this grows, the same way
+  // ComponentStorage moves them.
+  std::vector<u8> payload_;
+  // Entity ids for each Create, indexed by placeholder.
+  std::vector<u32> created_;
+  u32 create_count_ = 0;
+  Mutex mutex_;
+};
+
+static CommandBuffer kCommandBuffer;
+
+}
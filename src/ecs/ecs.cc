@@ -2,11 +2,13 @@
 
 #include <cassert>
 #include <cstdio>
-#include <cstdarg>
+#include <tuple>
+#include <utility>
 
 #include "common/common.cc"
 #include "platform/platform.cc"
 #include "memory/memory.cc"
+#include "util/worker_pool.cc"
 
 namespace ecs {
 
@@ -23,25 +25,50 @@ struct Entity {
 
 DECLARE_HASH_ARRAY(Entity, ENTITY_COUNT);
 
+// Called after Assign or Remove changes which components an entity has, if
+// set. Lets users keep indexes keyed on components_mask current.
+void (*kComponentsChanged)(Entity* ent) = nullptr;
+
+void
+ComponentsChanged(Entity* ent)
+{
+  if (kComponentsChanged) kComponentsChanged(ent);
+}
+
+// Sparse set of components. Components are densely packed in bytes_ so
+// iteration is linear and sparse_ maps an entity to its slot in the dense
+// array. Every live entity id owns a distinct slot in the entity hash array
+// (see common/hash_array.cc) so HashEntity(id) doubles as the sparse index.
+//
+// Assign, Find and Erase are O(1). Erase swaps the last element into the
+// erased slot so order of the dense array is not stable.
 class ComponentStorage {
  public:
   ComponentStorage(u32 n, u32 sz, u64 tid)
   {
+    memory::ScopedTag tag(memory::kTagEcs);
     bytes_ = memory::PushBytes(n * sz);
     assert(bytes_ != nullptr);
+    sparse_ = (u32*)memory::PushBytes(kMaxHashEntity * sizeof(u32));
+    assert(sparse_ != nullptr);
     sizeof_element_ = sz;
     max_size_ = n;
     tid_ = tid;
   }
 
+  // Returns the slot for entity id. If the entity already has a slot in this
+  // storage it is returned rather than creating a duplicate.
   u8*
-  Assign()
+  Assign(u32 id)
   {
+    u8* existing = Find(id);
+    if (existing) return existing;
     assert(size_ < max_size_);
-    u32 idx = size_ * sizeof_element_;
+    u32 idx = size_;
     ++size_;
+    sparse_[HashEntity(id)] = idx;
     //printf("Assign tid:%llu size:%u\n", tid_, size_);
-    return &bytes_[idx];
+    return Get(idx);
   }
 
   u8*
@@ -51,76 +78,37 @@ class ComponentStorage {
     return &bytes_[idx * sizeof_element_];
   }
 
-  // Sorts last element in list returning the sorted element.
-  u8*
-  SortLastElement()
-  {
-    assert(size_ > 0);
-    if (size_ == 1) {
-      return Get(size_ - 1);
-    }
-    u8* ptr = Get(size_ - 1);
-    u32 tid = *((u32*)ptr);
-    s32 nelem = size_ - 2;
-    // TODO: This probably would be faster if I found the position of where
-    // this element should go, memoved everything up and put it there.
-    while (nelem >= 0) {
-      u8* nelem_ptr = Get(nelem);
-      u32 nelem_tid = *((u32*)nelem_ptr);
-      if (tid > nelem_tid) {
-        return ptr;
-      }
-      // Swap bytes between nelem_ptr and ptr.
-      // Creating the loop allows the compiler to vectorize the byte swapping
-      // which ends up being faster than 3 memcpys.
-      for (u32 i = 0; i < sizeof_element_; ++i) {
-        u8 b = *ptr;
-        *ptr = *nelem_ptr;
-        *nelem_ptr = b;
-        ++ptr; ++nelem_ptr;
-      }
-      ptr = Get(nelem);
-      --nelem;
-    }
-    return ptr;
-  }
-
   u8*
   Find(u32 id)
   {
-    s32 l = 0;
-    s32 r = size_ - 1;
-    while (l <= r) {
-      s32 m = l + (r - l) / 2;
-      u8* bytes = Get(m);
-      u32 tid = *((u32*)bytes);
-      if (tid == id) return bytes;
-      if (tid < id) l = m + 1;
-      else r = m - 1;
-    }
-    return nullptr;
+    if (!id) return nullptr;
+    u32 idx = sparse_[HashEntity(id)];
+    // Sparse entries are never cleared - validate the slot still belongs to
+    // this entity.
+    if (idx >= size_) return nullptr;
+    u8* bytes = Get(idx);
+    if (*((u32*)bytes) != id) return nullptr;
+    return bytes;
   }
 
   void
   Erase(u32 id)
   {
     if (size_ == 0) return;
-    if (size_ == 1) {
-      Clear();
-      //printf("ComponentStorage::Erase tid:%llu eid:%u size:%u\n", tid_, id, size_);
-      return;
-    }
     u8* elem = Find(id);
     if (!elem) {
       //printf("ComponentStorage::Erase.Find(%u) not found\n", id);
       assert(elem != nullptr);
       return;
     }
-    u8* nelem = elem + sizeof_element_;
-    u8* end = &bytes_[(size_ - 1) * sizeof_element_ + sizeof_element_];
-    memmove(elem, elem + sizeof_element_, end - nelem);
+    u8* last = Get(size_ - 1);
+    if (elem != last) {
+      memcpy(elem, last, sizeof_element_);
+      u32 moved_id = *((u32*)elem);
+      sparse_[HashEntity(moved_id)] = (elem - bytes_) / sizeof_element_;
+    }
     --size_;
-    memset(Get(size_), 0, sizeof_element_);
+    memset(last, 0, sizeof_element_);
     //printf("ComponentStorage::Erase tid:%llu eid:%u size:%u\n", tid_, id, size_);
   }
 
@@ -146,6 +134,8 @@ class ComponentStorage {
 
  private:
   u8* bytes_ = nullptr;
+  // Indexed by HashEntity(id), holds the slot of id in bytes_.
+  u32* sparse_ = nullptr;
   u32 sizeof_element_ = 0;
   u32 size_ = 0;
   u32 max_size_ = 0;
@@ -156,36 +146,39 @@ class ComponentStorage {
 ComponentStorage*
 GetComponents(u64 tid);
 
-// Users must define this struct. It should be a struct where each
-// member is a pointer to a component that matches the order of type
-// ids.
-struct Components;
+// Maps a component type to its type id. Specialized by DECLARE_COMPONENT.
+template <typename T>
+struct ComponentTypeId;
 
 void
 DeleteEntity(Entity* ent, u32 max_comps = 64)
 {
   // If the entity has any components left attached to it - delete them.
-  if (ent->components_mask) {
-    // TODO: Use find first set
-    for (s32 i = 0; i < max_comps; ++i) {
-      if (FLAGGED(ent->components_mask, i)) {
-        //printf("GetComponents(%u)->Erase(entity:%u)\n", i, ent->id);
-        GetComponents(i)->Erase(ent->id);
-      }
-    }
+  // Walk set bits of the mask directly - FLAG shifts an int so testing bits
+  // past 31 aliases the low components.
+  u64 mask = ent->components_mask;
+  for (u32 i = 0; mask && i < max_comps; ++i, mask >>= 1) {
+    if (!(mask & 1)) continue;
+    //printf("GetComponents(%u)->Erase(entity:%u)\n", i, ent->id);
+    GetComponents(i)->Erase(ent->id);
   }
   SwapAndClearEntity(ent->id);
 }
 
 #define DECLARE_COMPONENT(Type, tid)                      \
+  template <>                                             \
+  struct ComponentTypeId<Type> {                          \
+    static constexpr u64 kValue = tid;                    \
+  };                                                      \
+                                                          \
   Type* Assign##Type(ecs::Entity* ent) {                  \
     if (!ent) return nullptr;                             \
     ComponentStorage* storage = ecs::GetComponents(tid);  \
-    Type* t = (Type*)storage->Assign();                   \
+    Type* t = (Type*)storage->Assign(ent->id);            \
     *t = {};                                              \
     t->entity_id = ent->id;                               \
     SBIT(ent->components_mask, tid);                      \
-    t = (Type*)storage->SortLastElement();                \
+    ecs::ComponentsChanged(ent);                          \
     return t;                                             \
   }                                                       \
                                                           \
@@ -199,6 +192,7 @@ DeleteEntity(Entity* ent, u32 max_comps = 64)
     ComponentStorage* storage = ecs::GetComponents(tid);  \
     storage->Erase(ent->id);                              \
     CBIT(ent->components_mask, tid);                      \
+    ecs::ComponentsChanged(ent);                          \
   }                                                       \
                                                           \
   Type* Get##Type(ecs::Entity* ent) {                     \
@@ -208,97 +202,122 @@ DeleteEntity(Entity* ent, u32 max_comps = 64)
     return (Type*)storage->Find(ent->id);                 \
   }
 
-template <u32 N>
-struct EntityItr {
-  EntityItr(u32 n, ...) {
-    va_list args;
-    va_start(args, n);
-    u32 cnt = 0;
-    for (u32 i = 0; i < N; ++i) {
-      u64 tid = va_arg(args, u64);
-      types[i] = tid;
-      comps[i] = GetComponents(tid);
-      ++cnt;
-    }
-    assert(cnt == N);
-    va_end(args);
-  }
-
-  void IncreaseMin(u8** ptrs) {
-    u32 min = 0xFFFFFFFF;
-    u32 min_idx = 0xFFFFFFFF;
-    for (u32 i = 0; i < N; ++i) {
-      u32 id = *((u32*)(ptrs[i]));
-      if (id < min) {
-        min = id;
-        min_idx = i;
-      }
-    }
-    ++idx[min_idx];
+// Joins the storages of each component type in Ts. The smallest storage
+// drives iteration and the rest are probed by entity id. The driving storage
+// is walked back to front so erasing the current entity during iteration -
+// which swaps the last element into its slot - never skips an entity.
+//
+// Entities are visited in storage order, not by id, and erasing one moves
+// another within the storage. Callers that want a particular entity, like the
+// oldest, must pick it themselves rather than take the first visited.
+//
+//   ecs::Query<PhysicsComponent, CharacterComponent> itr;
+//   while (itr.Next()) {
+//     PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+//     ...
+//   }
+template <typename... Ts>
+struct Query {
+  static constexpr u32 N = sizeof...(Ts);
+
+  Query() : comps{GetComponents(ComponentTypeId<Ts>::kValue)...}
+  {
+    Reset();
   }
 
   b8 Next() {
-    b8 match = true;
-    u32 id;
-    while(1) {
-      match = true;
-      u8* ptrs[N];
-      for (u32 i = 0; i < N; ++i) {
-        if (idx[i] >= comps[i]->max_size()) return false;
-        if (idx[i] >= comps[i]->size()) return false;
-        ptrs[i] = comps[i]->Get(idx[i]);
-      }
+    ComponentStorage* driver = comps[driver_idx];
+    while (1) {
+      // Storage may have shrunk by more than one if the loop body deleted
+      // other entities.
+      if (cursor > driver->size()) cursor = driver->size();
+      if (cursor <= cursor_end) return false;
+      --cursor;
       // First element in component structs is an entity id... Hopefully!
-      id = *((u32*)(ptrs[0]));
-      for (u32 i = 1; i < N; ++i) {
-        u32 oid = *((u32*)(ptrs[i]));
-        if (id != oid) {
-          match = false;
-          break;
-        }
-      }
-      if (match) break;
-      IncreaseMin(ptrs);
-    }
-
-    if (match) {
-      e = FindEntity(id);
-      for (u32 i = 0; i < N; ++i) {
-        // TODO: Do I need to address 32-bit vs 64-bit here?
-        u64* comp = (u64*)comps[i]->Get(idx[i]);
-        void* taddress = (u64*)(&c) + types[i];
-        memcpy(taddress, &comp, sizeof(u64*));
-        ++idx[i];
+      u32 id = *((u32*)driver->Get(cursor));
+      if (Probe(id, std::index_sequence_for<Ts...>{})) {
+        e = FindEntity(id);
+        return true;
       }
-      return true;
     }
-
     return false;
   }
 
+  template <typename T>
+  T* Get() {
+    return std::get<T*>(c);
+  }
+
   void Reset() {
     e = nullptr;
     c = {};
-    idx = {};
+    driver_idx = 0;
+    for (u32 i = 1; i < N; ++i) {
+      if (comps[i]->size() < comps[driver_idx]->size()) driver_idx = i;
+    }
+    cursor = comps[driver_idx]->size();
+    cursor_end = 0;
+  }
+
+  // Limits iteration to slots [begin, end) of storage comps[driver].
+  void Restrict(u32 driver, u32 begin, u32 end) {
+    assert(driver < N);
+    driver_idx = driver;
+    cursor = end;
+    cursor_end = begin;
   }
 
   Entity* e = nullptr;
-  Components c;
+  std::tuple<Ts*...> c;
 
   ComponentStorage* comps[N];
-  u64 types[N];
-  u32 idx[N] = {};
-};
-
-// Just some helpers to avoid typing.
-
-#define ECS_ITR1(name, ...) \
-  ecs::EntityItr<1> name(1, __VA_ARGS__);
+  u32 driver_idx = 0;
+  u32 cursor = 0;
+  u32 cursor_end = 0;
 
-#define ECS_ITR2(name, ...) \
-  ecs::EntityItr<2> name(2, __VA_ARGS__);
+ private:
+  // Expands to one Find per storage, stopping at the first miss.
+  template <size_t... Is>
+  b8 Probe(u32 id, std::index_sequence<Is...>) {
+    return (((std::get<Is>(c) = (Ts*)comps[Is]->Find(id)) != nullptr) && ...);
+  }
+};
 
-#define ECS_ITR3(name, ...) \
-  ecs::EntityItr<3> name(3, __VA_ARGS__);
+// Runs func over the entities matching Ts split into chunks of chunk_size
+// across util::kWorkerPool. func is handed a Query restricted to one chunk:
+//
+//   ecs::ParallelFor<PhysicsComponent, ProjectileComponent>(64,
+//       [](ecs::Query<PhysicsComponent, ProjectileComponent>* itr) {
+//     while (itr->Next()) { ... }
+//   });
+//
+// func must only touch the components of the entity it is handed. Storages
+// must not change while workers run - record Assign / Remove / Delete in
+// kCommandBuffer and Execute it once ParallelFor returns.
+template <typename... Ts, typename F>
+void
+ParallelFor(u32 chunk_size, const F& func)
+{
+  assert(chunk_size > 0);
+  Query<Ts...> all;
+  u32 driver_idx = all.driver_idx;
+  u32 size = all.cursor;
+  if (size <= chunk_size) {
+    func(&all);
+    return;
+  }
+  util::WorkGroup group;
+  for (u32 begin = 0; begin < size; begin += chunk_size) {
+    u32 end = MIN(begin + chunk_size, size);
+    util::WorkerPoolPush([&func, driver_idx, begin, end]() {
+      Query<Ts...> itr;
+      itr.Restrict(driver_idx, begin, end);
+      func(&itr);
+    }, &group);
+  }
+  util::WorkerPoolWait(&group);
+}
 
 }
+
+#include "ecs/command_buffer.cc"
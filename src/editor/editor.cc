@@ -32,6 +32,8 @@ struct Editor {
   Rectf render_viewport;
   EditorRenderTarget* current = nullptr;
   EditorMode mode;
+  // Input seen so far. Editor views redraw when it changes.
+  u32 events = 0;
 };
 
 struct EditorGrid {
@@ -372,6 +374,7 @@ rgg::Camera* EditorViewportCurrentCamera() {
 }
 
 void EditorProcessEvent(const PlatformEvent& event) {
+  ++kEditor.events;
   switch (kEditor.mode) {
     case EDITOR_MODE_GAME: {
       EditorGameViewerProcessEvent(event);
@@ -512,6 +515,18 @@ void EditorDebugMenu() {
           ImGui::Text("  runtime    %04.02fs", (r64)kGameState.game_time_usec / 1e6);
           ImGui::Text("  frametime  %04.02fus [%02.02f%%]",
                       StatsMean(&kGameStats), 100.f * StatsUnbiasedRsDev(&kGameStats));
+          ImGui::NewLine();
+
+          const rgg::RenderTargetStats& rt_stats = rgg::kRenderTargets.last_frame;
+          ImGui::Text("Render Targets (%lu)", rgg::kUsedRenderTarget);
+          ImGui::Text("  frame      %u drawn %u skipped %04.02fms",
+                      rt_stats.renders, rt_stats.skips, (r64)rt_stats.render_usec / 1e3);
+          ImGui::Text("  pool       %lu surfaces", rgg::kRenderTargets.pool.size());
+          rgg::IterateRenderTargets([](const rgg::RenderTarget* target) {
+            ImGui::Text("  %-12s %4.0fx%-4.0f %04.02fms %u drawn %u skipped", target->name,
+                        target->surface.width(), target->surface.height(),
+                        (r64)target->last_render_usec / 1e3, target->renders, target->skips);
+          });
         } else if (i == 2) {
           ImGui::Text("Cached Textures (%lu/%u)", rgg::kUsedTextureHandle, RGG_TEXTURE_MAX);
           ImGui::NewLine();
@@ -22,28 +22,34 @@ void GetImGuiLastItemRect(Rectf* rect) {
 
 // TODO: This might be a decent low level renderer thing to have?
 struct EditorSurface {
-  bool IsValid() const { return render_target.IsValid(); }
-  r32 width() const { return render_target.width(); }
-  r32 height() const { return render_target.height(); }
+  bool IsValid() const { return surface().IsValid(); }
+  r32 width() const { return surface().width(); }
+  r32 height() const { return surface().height(); }
   v2f Dims() const { return v2f( width(), height() ); }
+  const rgg::Surface& surface() const {
+    static const rgg::Surface kNoSurface = {};
+    const rgg::RenderTarget* render_target = rgg::GetRenderTarget(target);
+    return render_target ? render_target->surface : kNoSurface;
+  }
   rgg::Camera camera;
-  rgg::Surface render_target;
+  // Keeps its contents between frames so views only redraw when what they
+  // show changes.
+  rgg::RenderTargetId target = 0;
 };
 
-EditorSurface CreateEditorSurface(r32 width, r32 height) {
+EditorSurface CreateEditorSurface(r32 width, r32 height, const char* name = "editor") {
   EditorSurface surface;
   surface.camera.position = v3f(0.f, 0.f, 0.f);
   surface.camera.dir = v3f(0.f, 0.f, -1.f);
   surface.camera.up = v3f(0.f, 1.f, 0.f);
   surface.camera.viewport = v2f(width, height);
-  surface.render_target = rgg::CreateSurface(GL_RGBA, (u64)width, (u64)height);
+  surface.target = rgg::CreateRenderTarget(name, (u64)width, (u64)height);
   return surface;
 }
 
 void DestroyEditorSurface(EditorSurface* surface) {
-  if (surface->IsValid()) {
-    rgg::DestroySurface(&surface->render_target);
-  }
+  // The surface goes back to the render target pool.
+  rgg::DestroyRenderTarget(surface->target);
   *surface = {};
 }
 
@@ -53,32 +59,39 @@ public:
   ~RenderToEditorSurface();
 
   rgg::ModifyObserver mod_observer_;
+  rgg::RenderTargetId target_;
 };
 
+// Only redraws the surface when texture, tex_rect or outline change.
 void RenderSurfaceToImGuiImage(
     const EditorSurface& surface, const rgg::Texture* texture, const Rectf& tex_rect, bool outline = false) {
   assert(surface.IsValid());
-  RenderToEditorSurface render_to(surface);
-  Rectf dest = Rectf(-surface.width() / 2.f, -surface.height() / 2.f, surface.width(), surface.height());
-
-  rgg::RenderTexture(*texture, tex_rect, dest);
+  u32 key = rgg::HashRenderKey(texture->reference);
+  key = rgg::HashRenderKey(tex_rect, key);
+  key = rgg::HashRenderKey(outline, key);
+  if (rgg::RenderTargetNeedsRender(surface.target, key)) {
+    RenderToEditorSurface render_to(surface);
+    Rectf dest = Rectf(-surface.width() / 2.f, -surface.height() / 2.f, surface.width(), surface.height());
+    rgg::RenderTexture(*texture, tex_rect, dest);
+    if (outline) {
+      rgg::RenderLineRectangle(
+          Rectf(dest.x + 1.f, dest.y + 1.f, dest.width - 1.f, dest.height - 2.f), rgg::kRed);
+    }
+  }
   ImGui::Image(
-    (void*)(intptr_t)surface.render_target.texture.reference,
+    (void*)(intptr_t)surface.surface().texture.reference,
     ImVec2(surface.width(), surface.height()), ImVec2(0, 1), ImVec2(1, 0));
-  if (outline) {
-    rgg::RenderLineRectangle(
-        Rectf(dest.x + 1.f, dest.y + 1.f, dest.width - 1.f, dest.height - 2.f), rgg::kRed);
-  }
 }
 
-RenderToEditorSurface::RenderToEditorSurface(const EditorSurface& surface) : mod_observer_(surface.camera) {
-  rgg::BeginRenderTo(surface.render_target);
+RenderToEditorSurface::RenderToEditorSurface(const EditorSurface& surface)
+    : mod_observer_(surface.camera), target_(surface.target) {
+  rgg::BeginRenderTarget(target_);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glClearColor(0.f, 0.f, 0.f, 0.f);
 }
 
 RenderToEditorSurface::~RenderToEditorSurface() {
-  rgg::EndRenderTo();
+  rgg::EndRenderTarget(target_);
 }
 
 class EditorRenderTarget {
@@ -95,8 +108,8 @@ public:
   bool IsMouseInsideEditorSurface() const;
   bool IsRenderTargetValid() const { return editor_surface_.IsValid(); }
 
-  r32 GetRenderTargetWidth() const { return editor_surface_.render_target.width(); }
-  r32 GetRenderTargetHeight() const { return editor_surface_.render_target.height(); }
+  r32 GetRenderTargetWidth() const { return editor_surface_.width(); }
+  r32 GetRenderTargetHeight() const { return editor_surface_.height(); }
   v2f GetRenderTargetDims() const { return v2f(GetRenderTargetWidth(), GetRenderTargetHeight()); }
   v2f GetRenderTargetBottomLeft() const { return -GetRenderTargetDims() / 2.f; }
 
@@ -112,7 +125,13 @@ public:
   // So don't mess with rendering surfaces here.
   virtual void OnInitialize() {}
   // During this call the render_target is bound and all OpenGL calls are issued against that target.
+  // Only called when RenderKey changed or IsAnimating, otherwise the surface keeps last frame's drawing.
   virtual void OnRender() {}
+  // Hash of what OnRender draws from. The base covers input, the camera, zoom, the grid and texture
+  // loads. Fold in anything else that can change without input.
+  virtual u32 RenderKey();
+  // True to redraw every frame, for things that move on their own like animations.
+  virtual bool IsAnimating() { return false; }
   // Do UI stuff in here so we can guarantee the render target is unbound.
   virtual void OnImGui() {}
   // Will be dispatched to the active EditorRenderTarget.
@@ -127,7 +146,7 @@ public:
   rgg::Camera* camera() { return &editor_surface_.camera; }
   Rectf imgui_panel_rect() const { return imgui_panel_rect_; }
   EditorGrid* grid() { return &grid_; }
-  const rgg::Surface& surface() { return editor_surface_.render_target; }
+  const rgg::Surface& surface() { return editor_surface_.surface(); }
 
   const EditorCursor& cursor() const { return cursor_; }
 
@@ -141,6 +160,7 @@ protected:
   Rectf imgui_editor_surface_rect_;
   // Grid used for rendering / cursor shenanigans.
   EditorGrid grid_;
+  rgg::LineGrid grid_lines_;
   // Cursor as relative to the surface in editor_surface
   EditorCursor cursor_;
 };
@@ -235,8 +255,8 @@ v2f EditorRenderTarget::Scale(const v2f& v2) const {
 
 void EditorRenderTarget::ImGuiImage() {
   ImGui::Image(
-      (void*)(intptr_t)editor_surface_.render_target.texture.reference,
-      ImVec2(editor_surface_.render_target.width(), editor_surface_.render_target.height()), 
+      (void*)(intptr_t)editor_surface_.surface().texture.reference,
+      ImVec2(editor_surface_.width(), editor_surface_.height()),
       ImVec2(0, 1), ImVec2(1, 0));
   GetImGuiLastItemRect(&imgui_editor_surface_rect_);
 }
@@ -248,34 +268,19 @@ void EditorRenderTarget::RenderGrid(v4f color, bool alternate_alpha) {
   s32 scaled_width = grid_.cell_width * scale_;
   s32 scaled_height = grid_.cell_height * scale_;
   assert(scaled_width != 0 && scaled_height != 0);
-  s32 alpha_1_width = scaled_width;
-  s32 alpha_2_width = alpha_1_width * 2;
-  s32 alpha_3_width = alpha_2_width * 2;
-  s32 alpha_1_height = scaled_height;
-  s32 alpha_2_height = alpha_1_height * 2;
-  s32 alpha_3_height = alpha_2_height * 2;
-  // Draw lines right
-  s32 alpha_num = 0;
-  rgg::LineBatch line_batch;
-  for (r32 start_x = start_scaled.x; start_x <= view_rect_scaled.Max().x; start_x += scaled_width) {
-    line_batch.AddLine(v2f(start_x, view_rect_scaled.Min().y), v2f(start_x, view_rect_scaled.Max().y));
-  }
-  // Draw lines left
-  alpha_num = alpha_1_width;
-  for (r32 start_x = start_scaled.x - scaled_width; start_x >= view_rect_scaled.Min().x; start_x -= scaled_width) {
-    line_batch.AddLine(v2f(start_x, view_rect_scaled.Min().y), v2f(start_x, view_rect_scaled.Max().y));
-  }
-  // Draw lines up
-  alpha_num = 0;
-  for (r32 start_y = start_scaled.y; start_y <= view_rect_scaled.Max().y; start_y += scaled_height) {
-    line_batch.AddLine(v2f(view_rect_scaled.Min().x, start_y), v2f(view_rect_scaled.Max().x, start_y));
-  }
-  // Draw lines down
-  alpha_num = alpha_1_height;
-  for (r32 start_y = start_scaled.y - scaled_height; start_y >= view_rect_scaled.Min().y; start_y -= scaled_height) {
-    line_batch.AddLine(v2f(view_rect_scaled.Min().x, start_y), v2f(view_rect_scaled.Max().x, start_y));
-  }
-  rgg::RenderLineBatch(line_batch, color);
+  // Start on the grid line at or below the view's min corner. The grid's size
+  // only depends on the view's size and the zoom, so panning moves the cached
+  // grid lines rather than rebuilding them.
+  v2f min(start_scaled.x + floorf((view_rect_scaled.x - start_scaled.x) /
+                                  scaled_width) * scaled_width,
+          start_scaled.y + floorf((view_rect_scaled.y - start_scaled.y) /
+                                  scaled_height) * scaled_height);
+  s32 columns = (s32)(view_rect_scaled.width / scaled_width) + 2;
+  s32 rows = (s32)(view_rect_scaled.height / scaled_height) + 2;
+  rgg::RenderLineGrid(&grid_lines_, v2f(scaled_width, scaled_height),
+                      Rectf(min.x, min.y, columns * scaled_width,
+                            rows * scaled_height),
+                      color);
 }
 
 void EditorRenderTarget::RenderCursorAsRect() {
@@ -298,10 +303,23 @@ void EditorRenderTarget::RenderAxis() {
                   v4f(0.f, 0.f, 1.f, 0.5f));
 }
 
+u32 EditorRenderTarget::RenderKey() {
+  // Nearly every change in the editor comes from input. Async texture loads
+  // finishing are the exception.
+  u32 key = rgg::HashRenderKey(kEditor.events);
+  key = rgg::HashRenderKey(rgg::kTextureLoads.stats.loaded, key);
+  key = rgg::HashRenderKey(editor_surface_.camera.position, key);
+  key = rgg::HashRenderKey(scale_, key);
+  return rgg::HashRenderKey(grid_, key);
+}
+
 void EditorRenderTarget::Render() {
   if (IsRenderTargetValid()) {
-    RenderToEditorSurface render_to(editor_surface_);
-    OnRender();
+    if (IsAnimating()) rgg::MarkRenderTargetDirty(editor_surface_.target);
+    if (rgg::RenderTargetNeedsRender(editor_surface_.target, RenderKey())) {
+      RenderToEditorSurface render_to(editor_surface_);
+      OnRender();
+    }
   }
   OnImGui();
 }
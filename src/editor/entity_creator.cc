@@ -9,6 +9,7 @@ public:
   void OnInitialize() override;
   void OnRender() override;
   void OnImGui() override;
+  bool IsAnimating() override;
   void ChangeScale(r32 delta);
 };
 
@@ -53,6 +54,10 @@ void EntityCreator::OnRender() {
   RenderAxis();
 }
 
+bool EntityCreator::IsAnimating() {
+  return !kEntityCreatorControl.anim()->IsEmpty();
+}
+
 void EntityCreator::OnImGui() {
   UpdateImguiPanelRect();
   ImGuiImage();
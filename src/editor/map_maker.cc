@@ -6,6 +6,8 @@ public:
   void OnRender() override;
   void OnImGui() override;
   void OnFileSelected(const std::string& filename) override;
+  u32 RenderKey() override;
+  bool IsAnimating() override;
 
   void ChangeScale(r32 delta);
 
@@ -21,6 +23,8 @@ public:
   std::vector<AnimSequence2d> anims_;
   // Things to highlight for a single frame
   std::vector<Rectf> frame_highlights_;
+  // Highlights were drawn last render and need drawing over once they stop.
+  bool drew_highlights_ = false;
   Map2d map_;
   s32 current_layer_ = 0;
 
@@ -179,9 +183,28 @@ void MapMaker::OnRender() {
     rgg::RenderLineRectangle(Scale(highlight), rgg::kBlue);
   }
 
+  drew_highlights_ = !frame_highlights_.empty();
   frame_highlights_.clear();
 }
 
+u32 MapMaker::RenderKey() {
+  u32 key = EditorRenderTarget::RenderKey();
+  key = rgg::HashRenderKey(map_.version(), key);
+  key = rgg::HashRenderKey(current_layer_, key);
+  key = rgg::HashRenderKey(render_grid_, key);
+  return rgg::HashRenderKey(render_bounds_, key);
+}
+
+bool MapMaker::IsAnimating() {
+  if (!map_.IsLoaded() || anims_.size() != map_.entities_.size()) return true;
+  if (!frame_highlights_.empty() || drew_highlights_) return true;
+  for (const AnimSequence2d& anim : anims_) {
+    if (!anim.IsEmpty()) return true;
+  }
+  return kMapMakerControl.mode() == MapMakerControl::kMapMakerModeEntity &&
+         !kMapMakerControl.anim()->IsEmpty();
+}
+
 void MapMaker::OnImGui() {
   UpdateImguiPanelRect();
   ImGuiImage();
@@ -347,7 +370,8 @@ void MapMakerControl::OnImGui() {
   ImGui::InputText("file", kPngFilename, 128); 
   snprintf(kFullPath, 256, "gamedata/maps/%s.map", kPngFilename);
   ImGui::Text("%s", kFullPath);
-  if (ImGui::Button("save")) {
+  // Layers still loading have no surface to save.
+  if (ImGui::Button("save") && kMapMaker.map_.IsLoaded()) {
     //rgg::SaveSurface(kMapMaker.map_.GetSurface(0), kFullPath);
     proto::Map2d proto = kMapMaker.map_.ToProto(kPngFilename);
     SaveToFile(proto, kFullPath);
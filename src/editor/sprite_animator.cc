@@ -11,6 +11,7 @@ public:
 
   void OnRender() override;
   void OnImGui() override;
+  bool IsAnimating() override { return !anim_sequence_.IsEmpty(); }
 
   bool IsMouseInside() const override;
 
@@ -415,7 +416,7 @@ bool SpriteAnimatorControl::IsMouseInside() const {
 void SpriteAnimatorControl::AddFrame(const AnimFrame2d& frame, v2f dims, r32 duration) {
   anim_sequence_.AddFrame(frame, duration);
   Frame asset_frame;
-  asset_frame.editor_surface = CreateEditorSurface(dims.x, dims.y);
+  asset_frame.editor_surface = CreateEditorSurface(dims.x, dims.y, "sprite frame");
   assert(asset_frame.editor_surface.IsValid());
   anim_frames_.push_back(asset_frame);
 }
@@ -1,5 +1,7 @@
 // Singleplayer game template.
 #define SINGLE_PLAYER
+// Track heap and arena allocations by subsystem. See the Mem debug pane.
+#define MEMORY_TRACKING 0
 
 #include <vector>
 #include <unordered_map>
@@ -13,6 +15,7 @@
 #include "renderer/camera.cc"
 #include "renderer/imui.cc"
 #include "animation/fsm.cc"
+#include "search/search.cc"
 
 #define WIN_ATTACH_DEBUGGER 0
 #define DEBUG_PHYSICS 0
@@ -76,6 +79,7 @@ enum DebugUIState {
   kDiagnosticsViewer,
   kEntityViewer,
   kDebugViewer,
+  kMemoryViewer,
 };
 
 void
@@ -123,6 +127,51 @@ DebugUIRenderDiagnostics()
   imui::NewLine();
   imui::SameLine();
   imui::Width(right_align);
+  imui::Text("Sprites");
+  snprintf(kUIBuffer, sizeof(kUIBuffer), "%u in %u draws ",
+           rgg::kSpriteBatch.last_frame.sprites,
+           rgg::kSpriteBatch.last_frame.draw_calls);
+  imui::Text(kUIBuffer);
+  if (imui::Text(rgg::kSpriteBatch.enabled ? "batched" : "unbatched",
+                 debug_options).clicked) {
+    rgg::kSpriteBatch.enabled = !rgg::kSpriteBatch.enabled;
+  }
+  imui::NewLine();
+  imui::SameLine();
+  imui::Width(right_align);
+  imui::Text("Text");
+  snprintf(kUIBuffer, sizeof(kUIBuffer), "%u glyphs in %u draws",
+           rgg::kUI.last_frame.glyphs, rgg::kUI.last_frame.draw_calls);
+  imui::Text(kUIBuffer);
+  imui::NewLine();
+  imui::SameLine();
+  imui::Width(right_align);
+  imui::Text("Textures");
+  const rgg::TextureLoadStats& loads = rgg::kTextureLoads.stats;
+  snprintf(kUIBuffer, sizeof(kUIBuffer),
+           "%u loading %u loaded decode %.1fms upload %.1fms",
+           loads.pending, loads.loaded, loads.decode_usec / 1000.f,
+           loads.upload_usec / 1000.f);
+  imui::Text(kUIBuffer);
+  imui::NewLine();
+  imui::SameLine();
+  imui::Width(right_align);
+  imui::Text("Lines");
+  snprintf(kUIBuffer, sizeof(kUIBuffer), "%u in %u draws",
+           rgg::kLineBatchState.last_frame.lines,
+           rgg::kLineBatchState.last_frame.draw_calls);
+  imui::Text(kUIBuffer);
+  imui::NewLine();
+  imui::SameLine();
+  imui::Width(right_align);
+  imui::Text("Tilemaps");
+  snprintf(kUIBuffer, sizeof(kUIBuffer), "%u draws %u cells uploaded",
+           rgg::kTilemapState.last_frame.draw_calls,
+           rgg::kTilemapState.last_frame.cells_uploaded);
+  imui::Text(kUIBuffer);
+  imui::NewLine();
+  imui::SameLine();
+  imui::Width(right_align);
   imui::Text("Camera Pos");
   v3f cpos = rgg::CameraPosition();
   snprintf(kUIBuffer, sizeof(kUIBuffer), "(%.0f, %.0f, %.0f)", cpos.x, cpos.y, cpos.z);
@@ -188,7 +237,7 @@ DebugUIRenderEntity()
     snprintf(kUIBuffer, sizeof(kUIBuffer), "(%i, %i)", gpos.x, gpos.y);
     imui::Text(kUIBuffer);
     imui::NewLine();
-    for (u32 entity_id : cell->entity_ids) {
+    for (u32 entity_id : grid->Entities(cell)) {
       ecs::Entity* entity = ecs::FindEntity(entity_id);
       assert(entity != nullptr);
       imui::SameLine();
@@ -282,6 +331,60 @@ DebugUIRenderDebug()
   imui::NewLine();
 }
 
+void
+DebugUIRenderMemory()
+{
+  static r32 right_align = 80.f;
+  imui::TextOptions debug_options;
+  debug_options.color = imui::kWhite;
+  debug_options.highlight_color = imui::kRed;
+#if !MEMORY_TRACKING
+  imui::Text("Build with MEMORY_TRACKING 1");
+#endif
+  imui::SameLine();
+  imui::Width(right_align);
+  imui::Text("Tag");
+  imui::Width(right_align);
+  imui::Text("Bytes");
+  imui::Width(right_align);
+  imui::Text("Peak");
+  imui::Text("Frame");
+  imui::NewLine();
+  for (u32 i = 0; i < memory::kTagCount; ++i) {
+    const memory::TagStats* stats = memory::TrackerGetTag((memory::Tag)i);
+    imui::SameLine();
+    imui::Width(right_align);
+    imui::Text(memory::kTagNames[i]);
+    imui::Width(right_align);
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%llu",
+             (unsigned long long)stats->bytes);
+    imui::Text(kUIBuffer);
+    imui::Width(right_align);
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%llu",
+             (unsigned long long)stats->peak_bytes);
+    imui::Text(kUIBuffer);
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%llu",
+             (unsigned long long)stats->last_frame_count);
+    imui::Text(kUIBuffer);
+    imui::NewLine();
+  }
+  for (u32 i = 0; i < memory::kArenaCount; ++i) {
+    const memory::Arena* arena = memory::GetArena((memory::ArenaId)i);
+    imui::SameLine();
+    imui::Width(right_align);
+    imui::Text(arena->name);
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%llu / %llu high %llu",
+             (unsigned long long)arena->storage_used,
+             (unsigned long long)arena->storage_size,
+             (unsigned long long)arena->high_water);
+    imui::Text(kUIBuffer);
+    imui::NewLine();
+  }
+  if (imui::Text("Dump memory.txt", debug_options).clicked) {
+    memory::TrackerDump("memory.txt");
+  }
+}
+
 void
 DebugUI()
 {
@@ -294,8 +397,8 @@ DebugUI()
     static v4f unused_color = v4f(.8f, .8f, .8f, 1.f);
     imui::PaneOptions options;
     options.max_width = 315.f;
-    imui::Begin("Debug", imui::kEveryoneTag, options, &diagnostics_pos,
-                &enable_debug);
+    imui::Begin(HASH_STR("Debug"), imui::kEveryoneTag, options,
+                &diagnostics_pos, &enable_debug);
     imui::TextOptions debug_options;
     debug_options.highlight_color = imui::kRed;
     imui::SameLine();
@@ -313,6 +416,10 @@ DebugUI()
     if (imui::Text("Debug", debug_options).clicked) {
       debug_ui_state = kDebugViewer;
     }
+    debug_options.color = debug_ui_state == kMemoryViewer ? imui::kRed :  unused_color;
+    if (imui::Text("Mem", debug_options).clicked) {
+      debug_ui_state = kMemoryViewer;
+    }
     imui::NewLine();
     imui::HorizontalLine(v4f(1.f, 1.f, 1.f, .4f));
     imui::Space(imui::kVertical, 5);
@@ -326,6 +433,9 @@ DebugUI()
       case kDebugViewer:
         DebugUIRenderDebug();
         break;
+      case kMemoryViewer:
+        DebugUIRenderMemory();
+        break;
     }
     imui::End();
   }
@@ -363,6 +473,7 @@ GameInitialize(const v2f& dims)
   //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
   live::AssetLoadAll();  
   live::SimInitialize();
+  live::AssetTerrainTilemapBuild(live::GridMax());
 }
 
 bool
@@ -389,7 +500,10 @@ GameRender(v2f dims)
   //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
 
 
-  DebugUI();
+  {
+    memory::ScopedTag tag(memory::kTagImui);
+    DebugUI();
+  }
   //live::InteractionRenderEntityViewer();
   live::InteractionRenderOrderOptions();
   live::InteractionRenderResourceCounts();
@@ -397,7 +511,7 @@ GameRender(v2f dims)
   live::Grid* grid = live::GridGet(1);
   if (kRenderGridFill) {
     for (live::Cell& cell : grid->storage) {
-      if (!cell.entity_ids.empty()) {
+      if (!grid->Entities(&cell).empty()) {
         rgg::RenderRectangle(cell.rect(), v4f(.2f, .2f, .2f, .8f));
       }
     }
@@ -407,36 +521,22 @@ GameRender(v2f dims)
   rgg::Texture* character_texture = rgg::GetTexture(live::kAssets.character_texture_id);
   Rectf sbounds = live::ScreenBounds();
 
-  {
-    assert(terrain_texture);
-    for (const live::Cell& cell : grid->storage) {
-      if (!math::IsContainedInRect(cell.rect(), sbounds) && !math::IntersectRect(cell.rect(), sbounds))
-        continue;
-      if (cell.pos == v2i(0, 0)) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtBottomLeft);
-      } else if (cell.pos.y == 0) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtBottomMiddle);
-      } else if (cell.pos.x == 0) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtMiddleLeft);
-      } else {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtMiddleMiddle);
-      }
-    }
-  }
+  assert(terrain_texture);
+  rgg::RenderTilemap(&live::kAssets.terrain_tilemap, live::GridPosFromXY(live::GridMin()), sbounds);
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kZoneComponent);
+    ecs::Query<PhysicsComponent, ZoneComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
       rgg::RenderRectangle(physics->rect(), v4f(0.1f, 0.1f, 0.4f, 0.8f));
     }
   }
   
   {
-    ECS_ITR3(itr, kPhysicsComponent, kHarvestComponent, kResourceComponent);
+    ecs::Query<PhysicsComponent, HarvestComponent, ResourceComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      ResourceComponent* resource = itr.c.resource;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      ResourceComponent* resource = itr.Get<ResourceComponent>();
       if (!math::IsContainedInRect(physics->rect(), sbounds) && !math::IntersectRect(physics->rect(), sbounds))
         continue;
 
@@ -455,13 +555,14 @@ GameRender(v2f dims)
     }
   }
 
+  rgg::FlushBatches();
   glDisable(GL_BLEND);
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kBuildComponent);
+    ecs::Query<PhysicsComponent, BuildComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      BuildComponent* build = itr.c.build;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      BuildComponent* build = itr.Get<BuildComponent>();
       switch (build->structure_type) {
         case kWall:
           rgg::RenderLineRectangle(physics->rect(), v4f(1.f, 1.f, 1.f, 1.f));
@@ -474,10 +575,10 @@ GameRender(v2f dims)
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kStructureComponent);
+    ecs::Query<PhysicsComponent, StructureComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      StructureComponent* structure = itr.c.structure;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      StructureComponent* structure = itr.Get<StructureComponent>();
       switch (structure->structure_type) {
         case kWall:
           rgg::RenderRectangle(physics->rect(), v4f(.64f, .45f, .28f, 1.f));
@@ -490,9 +591,9 @@ GameRender(v2f dims)
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kCharacterComponent);
+    ecs::Query<PhysicsComponent, CharacterComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* character = itr.c.physics;
+      PhysicsComponent* character = itr.Get<PhysicsComponent>();
       r32 half_width = character->rect().width / 2.f;
 
       /*
@@ -519,12 +620,12 @@ GameRender(v2f dims)
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kResourceComponent);
+    ecs::Query<PhysicsComponent, ResourceComponent> itr;
     while (itr.Next()) {
       // The resource should not be rendered if this is a tree for instance.
       if (GetHarvestComponent(itr.e)) continue;
-      PhysicsComponent* physics = itr.c.physics;
-      ResourceComponent* resource = itr.c.resource;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      ResourceComponent* resource = itr.Get<ResourceComponent>();
       Rectf rect = physics->rect();
       switch (resource->resource_type) {
         case kLumber:
@@ -540,6 +641,7 @@ GameRender(v2f dims)
     }
   }
 
+  rgg::FlushBatches();
   glEnable(GL_BLEND);
 
   if (kRenderGrid) {
@@ -572,6 +674,7 @@ GameRender(v2f dims)
   }
   imui::Render(imui::kEveryoneTag);
 
+  rgg::EndFrame();
   window::SwapBuffers();
 }
 
@@ -656,6 +759,8 @@ main(s32 argc, char** argv)
 
   while (1) {
     platform::ClockStart(&kGameState.game_clock);
+    memory::ResetArena(memory::kFrame);
+    memory::TrackerFrame();
 
     imui::ResetTag(imui::kEveryoneTag);
     rgg::DebugReset();
@@ -670,8 +775,14 @@ main(s32 argc, char** argv)
       ProcessPlatformEvent(event);
     }
 
-    GameUpdate();
-    GameRender(dims);  
+    {
+      memory::ScopedTag tag(memory::kTagLive);
+      GameUpdate();
+    }
+    {
+      memory::ScopedTag tag(memory::kTagRenderer);
+      GameRender(dims);  
+    }
 
     const u64 elapsed_usec = platform::ClockEnd(&kGameState.game_clock);
     StatsAdd(elapsed_usec, &kGameStats);
@@ -51,6 +51,7 @@ static Rectf kVillagerRect = Rectf(0.f, 16.f, kCW, kCH);
 struct AssetStorage {
   u32 terrain_texture_id;
   u32 character_texture_id;
+  rgg::Tilemap terrain_tilemap;
 };
 
 static AssetStorage kAssets;
@@ -70,73 +71,63 @@ AssetLoadAll()
   assert(kAssets.character_texture_id != 0);
 }
 
-void
-AssetTerrainRender(rgg::Texture* texture, v2f pos = v2f(0.f, 0.f), TerrainAsset asset = TerrainAsset::kAll)
+Rectf
+AssetTerrainRect(TerrainAsset asset)
 {
-  //printf("%.2f %.2f\n", texture->width, texture->height);
-  //exit(0);
   switch (asset) {
-    case TerrainAsset::kAll: {
-      Rectf rect(pos.x, pos.y, texture->width, texture->height);
-      rgg::RenderTexture(*texture, rect, rect);
-    } break;
-    case TerrainAsset::kTree: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kTreeRect, dest);
-    } break;
-    case TerrainAsset::kGrassBottomLeft: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassBottomLeftRect, dest);
-    } break;
-    case TerrainAsset::kGrassBottomMiddle: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassBottomMiddleRect, dest);
-    } break;
-    case TerrainAsset::kGrassBottomRight: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassBottomRightRect, dest);
-    } break;
-    case TerrainAsset::kGrassMiddleLeft: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassMiddleLeftRect, dest);
-    } break;
-    case TerrainAsset::kGrassMiddleMiddle: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassMiddleMiddleRect, dest);
-    } break;
-    case TerrainAsset::kGrassMiddleRight: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kGrassMiddleRightRect, dest);
-    } break;
-    case TerrainAsset::kDirtBottomLeft: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtBottomLeftRect, dest);
-    } break;
-    case TerrainAsset::kDirtBottomMiddle: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtBottomMiddleRect, dest);
-    } break;
-    case TerrainAsset::kDirtBottomRight: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtBottomRightRect, dest);
-    } break;
-    case TerrainAsset::kDirtMiddleLeft: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtMiddleLeftRect, dest);
-    } break;
-    case TerrainAsset::kDirtMiddleMiddle: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtMiddleMiddleRect, dest);
-    } break;
-    case TerrainAsset::kDirtMiddleRight: {
-      Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
-      rgg::RenderTexture(*texture, kDirtMiddleRightRect, dest);
-    } break;
-
-
+    case TerrainAsset::kTree: return kTreeRect;
+    case TerrainAsset::kGrassBottomLeft: return kGrassBottomLeftRect;
+    case TerrainAsset::kGrassBottomMiddle: return kGrassBottomMiddleRect;
+    case TerrainAsset::kGrassBottomRight: return kGrassBottomRightRect;
+    case TerrainAsset::kGrassMiddleLeft: return kGrassMiddleLeftRect;
+    case TerrainAsset::kGrassMiddleMiddle: return kGrassMiddleMiddleRect;
+    case TerrainAsset::kGrassMiddleRight: return kGrassMiddleRightRect;
+    case TerrainAsset::kDirtBottomLeft: return kDirtBottomLeftRect;
+    case TerrainAsset::kDirtBottomMiddle: return kDirtBottomMiddleRect;
+    case TerrainAsset::kDirtBottomRight: return kDirtBottomRightRect;
+    case TerrainAsset::kDirtMiddleLeft: return kDirtMiddleLeftRect;
+    case TerrainAsset::kDirtMiddleMiddle: return kDirtMiddleMiddleRect;
+    case TerrainAsset::kDirtMiddleRight: return kDirtMiddleRightRect;
+    case TerrainAsset::kAll:
     default:
       assert(!"Implement rendering for this asset.");
-      break;
+      return Rectf(0.f, 0.f, 0.f, 0.f);
+  }
+}
+
+void
+AssetTerrainRender(rgg::Texture* texture, v2f pos = v2f(0.f, 0.f), TerrainAsset asset = TerrainAsset::kAll)
+{
+  if (asset == TerrainAsset::kAll) {
+    Rectf rect(pos.x, pos.y, texture->width, texture->height);
+    rgg::RenderTexture(*texture, rect, rect);
+    return;
+  }
+  Rectf dest = Rectf(pos.x, pos.y, kTW, kTH);
+  rgg::RenderTexture(*texture, AssetTerrainRect(asset), dest);
+}
+
+// The ground under the grid. It's picked from each cell's position and never
+// changes, so it's built into a tilemap once and drawn in a single call
+// however large the grid is.
+void
+AssetTerrainTilemapBuild(v2i dims)
+{
+  rgg::Tilemap* map = &kAssets.terrain_tilemap;
+  rgg::DestroyTilemap(map);
+  *map = rgg::CreateTilemap(kAssets.terrain_texture_id, dims.x, dims.y, CellDims());
+  u16 bottom_left = rgg::AddTilemapTile(map, kDirtBottomLeftRect);
+  u16 bottom_middle = rgg::AddTilemapTile(map, kDirtBottomMiddleRect);
+  u16 middle_left = rgg::AddTilemapTile(map, kDirtMiddleLeftRect);
+  u16 middle_middle = rgg::AddTilemapTile(map, kDirtMiddleMiddleRect);
+  for (s32 y = 0; y < dims.y; ++y) {
+    for (s32 x = 0; x < dims.x; ++x) {
+      u16 tile = middle_middle;
+      if (x == 0 && y == 0) tile = bottom_left;
+      else if (y == 0) tile = bottom_middle;
+      else if (x == 0) tile = middle_left;
+      rgg::SetTile(map, x, y, tile);
+    }
   }
 }
 
@@ -91,6 +91,13 @@ struct CharacterComponent {
   u32 order_id;
   u32 carrying_id;
   u32 job_bitfield;
+  // Cells being walked through to reach path_goal, from search::FindPath.
+  // path_index is the next one to walk to.
+  std::vector<v2i> path;
+  u32 path_index = 0;
+  v2i path_goal = v2i(-1, -1);
+  // Cell being walked to along a flow field.
+  v2i flow_cell = v2i(-1, -1);
 
   b8
   HasJob(Job job) {
@@ -159,6 +166,9 @@ struct PickupData {
 struct CarryToData {
   //u32 target_entity_id;
   v2i grid_to;
+  // Zone or build site grid_to belongs to, walked to by its flow field.
+  // Shares space with PickupData::zone_entity_id - set it after reading that.
+  u32 flow_entity_id;
 };
 
 struct OrderComponent {
@@ -168,6 +178,8 @@ struct OrderComponent {
   u32 acquire_count = 0;
   u32 max_acquire_count = 0;
   u32 target_entity_id = 0;
+  // Lower for orders created earlier, see SimAssignOrder.
+  u32 sequence = 0;
   union {
     HarvestData harvest_data;
     BuildData build_data;
@@ -203,24 +215,6 @@ struct CarryComponent {
 
 }
 
-namespace ecs {
-
-struct Components {
-  PhysicsComponent* physics = nullptr;
-  ResourceComponent* resource = nullptr;
-  HarvestComponent* harvest = nullptr;
-  CharacterComponent* character = nullptr;
-  DeathComponent* death = nullptr;
-  BuildComponent* build = nullptr;
-  StructureComponent* structure = nullptr;
-  OrderComponent* order = nullptr;
-  PickupComponent* pickup = nullptr;
-  ZoneComponent* zone = nullptr;
-  CarryComponent* carry = nullptr;
-};
-
-}
-
 #define ENTITY_COUNT 2048
 #include "ecs/ecs.cc"
 
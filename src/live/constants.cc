@@ -23,6 +23,9 @@ GridMin()
 constexpr u32 kGridMaxX = 128;
 constexpr u32 kGridMaxY = 128;
 
+// Cells per side of the clusters grids plan paths over. See search/hpa.cc.
+constexpr s32 kGridClusterSize = 16;
+
 static v2i
 GridMax()
 {
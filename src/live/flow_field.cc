@@ -0,0 +1,96 @@
+// namespace live {
+
+// Flow fields toward destinations many characters walk to at once - stockpile
+// zones and build sites. A field is built the first time a character heads to
+// an entity and shared by everyone after, who each look up one step per cell
+// walked. Walls built later repair the fields they cut through rather than
+// rebuilding them.
+
+struct FlowFieldEntry {
+  u32 entity_id;
+  u32 grid_id;
+  search::FlowField field;
+  u64 last_used;
+};
+
+// Fields kept at once. The least recently used makes way for a new one.
+constexpr u32 kFlowFieldMax = 16;
+
+static std::vector<FlowFieldEntry> kFlowFields;
+static u64 kFlowFieldUses = 0;
+
+// Cells characters walking to entity head for - every cell of a zone, or the
+// cells under anything else.
+std::vector<v2i>
+FlowFieldGoals(Entity* entity, PhysicsComponent* phys)
+{
+  std::vector<v2i> goals;
+  ZoneComponent* zone = GetZoneComponent(entity);
+  if (zone) {
+    for (const ZoneCell& zcell : zone->zone_cells) {
+      goals.push_back(zcell.grid_pos);
+    }
+    return goals;
+  }
+  return GridGetIntersectingCellPos(phys);
+}
+
+// The field toward entity_id, built if there isn't one. Null if the entity is
+// gone or has no position.
+search::FlowField*
+FlowFieldGet(u32 entity_id)
+{
+  for (FlowFieldEntry& entry : kFlowFields) {
+    if (entry.entity_id != entity_id) continue;
+    entry.last_used = ++kFlowFieldUses;
+    return &entry.field;
+  }
+  Entity* entity = FindEntity(entity_id);
+  if (!entity) return nullptr;
+  PhysicsComponent* phys = GetPhysicsComponent(entity);
+  if (!phys) return nullptr;
+  std::vector<v2i> goals = FlowFieldGoals(entity, phys);
+  if (goals.empty()) return nullptr;
+  FlowFieldEntry* entry = nullptr;
+  if (kFlowFields.size() < kFlowFieldMax) {
+    kFlowFields.emplace_back();
+    entry = &kFlowFields.back();
+  } else {
+    entry = &kFlowFields[0];
+    for (FlowFieldEntry& e : kFlowFields) {
+      if (e.last_used < entry->last_used) entry = &e;
+    }
+  }
+  entry->entity_id = entity_id;
+  entry->grid_id = phys->grid_id;
+  entry->last_used = ++kFlowFieldUses;
+  search::FlowFieldBuild(GridGet(phys->grid_id)->PathGrid(), goals.data(),
+                         goals.size(), &entry->field);
+  return &entry->field;
+}
+
+// Drops every field on grid_id, for when cells open up. Fields are only
+// repaired for cells closing - they're rebuilt as characters next need them.
+void
+FlowFieldRelease(u32 grid_id)
+{
+  kFlowFields.erase(
+      std::remove_if(kFlowFields.begin(), kFlowFields.end(),
+                     [grid_id](const FlowFieldEntry& entry) {
+                       return entry.grid_id == grid_id;
+                     }),
+      kFlowFields.end());
+}
+
+// Repairs every field on grid_id after cell was blocked.
+void
+FlowFieldBlock(u32 grid_id, v2i cell)
+{
+  Grid* grid = GridGet(grid_id);
+  for (FlowFieldEntry& entry : kFlowFields) {
+    if (entry.grid_id != grid_id) continue;
+    search::FlowFieldBlock(grid->PathGrid(), cell, &entry.field);
+  }
+}
+
+// }
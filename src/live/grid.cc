@@ -1,9 +1,23 @@
 // namespace live {
 
+// One entity in one cell's list. Links live in a pool on the grid and are
+// reused as entities move, so keeping cells current doesn't allocate.
+struct CellLink {
+  u32 entity_id;
+  // The entity's components_mask, kept current by GridComponentsChanged().
+  u64 components_mask;
+  // Index + 1 of the next link in the list, 0 at the end.
+  u32 next;
+};
+
 struct Cell {
   // A cell can contain, and also share, entity ids across multiple grid cells.
-  // This happens when a structure takes up multiple grid cells.
-  std::vector<u32> entity_ids;
+  // This happens when a structure takes up multiple grid cells. Index + 1 of
+  // the first link, see Grid::Entities().
+  u32 first_link = 0;
+  // Every component of every entity in the cell, so queries can pass over
+  // cells without what they're looking for.
+  u64 components_mask = 0;
   v2i pos;
 
   Rectf
@@ -13,9 +27,75 @@ struct Cell {
   }
 };
 
+// The entity ids in a cell, for range-for. Adding or removing entities on the
+// grid invalidates it.
+struct CellEntities {
+  struct Iterator {
+    u32
+    operator*() const
+    {
+      return links[link - 1].entity_id;
+    }
+
+    Iterator&
+    operator++()
+    {
+      link = links[link - 1].next;
+      return *this;
+    }
+
+    b8
+    operator!=(const Iterator& rhs) const
+    {
+      return link != rhs.link;
+    }
+
+    const CellLink* links;
+    u32 link;
+  };
+
+  Iterator begin() const { return {links, first}; }
+  Iterator end() const { return {links, 0}; }
+  b8 empty() const { return first == 0; }
+
+  const CellLink* links;
+  u32 first;
+};
+
+// Cells from min to max inclusive. Empty when min is past max.
+struct GridRange {
+  v2i min = v2i(0, 0);
+  v2i max = v2i(-1, -1);
+
+  b8
+  empty() const
+  {
+    return min.x > max.x || min.y > max.y;
+  }
+
+  b8
+  Contains(v2i xy) const
+  {
+    return xy.x >= min.x && xy.x <= max.x && xy.y >= min.y && xy.y <= max.y;
+  }
+
+  b8
+  operator==(const GridRange& rhs) const
+  {
+    if (empty() || rhs.empty()) return empty() == rhs.empty();
+    return min == rhs.min && max == rhs.max;
+  }
+
+  b8
+  operator!=(const GridRange& rhs) const
+  {
+    return !(*this == rhs);
+  }
+};
+
 struct Grid {
   Grid(v2i xy) :
-    width(xy.x), height(xy.y), storage(xy.x * xy.y)
+    width(xy.x), height(xy.y), storage(xy.x * xy.y), blocked(xy.x * xy.y)
   {
     for (s32 x = 0; x < xy.x; ++x) {
       for (s32 y = 0; y < xy.y; ++y) {
@@ -43,10 +123,40 @@ struct Grid {
     return &storage[Index(xy)];
   }
 
-  std::vector<v2i>
+  b8
+  IsBlocked(v2i xy) const
+  {
+    if (xy.x < 0 || xy.x >= width) return true;
+    if (xy.y < 0 || xy.y >= height) return true;
+    return blocked[Index(xy)];
+  }
+
+  // Also updates the path clusters around xy.
+  void
+  SetBlocked(v2i xy, b8 is_blocked)
+  {
+    u8* cell = &blocked[Index(xy)];
+    if (*cell == is_blocked) return;
+    *cell = is_blocked;
+    search::HpaUpdateCell(PathGrid(), xy, &hpa);
+  }
+
+  // The blocked cells as search::FindPath takes them. Valid until the grid
+  // is destroyed.
+  search::PathGrid
+  PathGrid() const
+  {
+    search::PathGrid path_grid;
+    path_grid.width = width;
+    path_grid.height = height;
+    path_grid.blocked = blocked.data();
+    return path_grid;
+  }
+
+  memory::FrameVector<v2i>
   NeighborsPos(v2i xy)
   {
-    std::vector<v2i> cells;
+    memory::FrameVector<v2i> cells;
     cells.reserve(8);
     Cell* top_left = Get(xy + v2i(-1, 1));
     Cell* top = Get(xy + v2i(0, 1));
@@ -98,21 +208,123 @@ struct Grid {
     return Neighbors(cell->pos);
   }
 
+  CellEntities
+  Entities(const Cell* cell) const
+  {
+    return {links.data(), cell->first_link};
+  }
+
+  void
+  AddEntity(v2i xy, u32 entity_id, u64 components_mask)
+  {
+    Cell* cell = Get(xy);
+    assert(cell != nullptr);
+    u32 link = free_link;
+    if (link) {
+      free_link = links[link - 1].next;
+    } else {
+      links.emplace_back();
+      link = links.size();
+    }
+    links[link - 1].entity_id = entity_id;
+    links[link - 1].components_mask = components_mask;
+    links[link - 1].next = cell->first_link;
+    cell->first_link = link;
+    SetComponentsMask(cell, cell->components_mask | components_mask);
+  }
+
+  void
+  RemoveEntity(v2i xy, u32 entity_id)
+  {
+    Cell* cell = Get(xy);
+    assert(cell != nullptr);
+    u64 components_mask = 0;
+    u32* prev = &cell->first_link;
+    while (*prev) {
+      u32 link = *prev;
+      CellLink* l = &links[link - 1];
+      if (l->entity_id != entity_id) {
+        components_mask |= l->components_mask;
+        prev = &l->next;
+        continue;
+      }
+      *prev = l->next;
+      l->next = free_link;
+      free_link = link;
+    }
+    SetComponentsMask(cell, components_mask);
+  }
+
+  // Records that entity_id in xy now has components_mask. Does nothing if
+  // the entity isn't in xy.
+  void
+  UpdateEntity(v2i xy, u32 entity_id, u64 components_mask)
+  {
+    Cell* cell = Get(xy);
+    assert(cell != nullptr);
+    u64 cell_mask = 0;
+    for (u32 link = cell->first_link; link; link = links[link - 1].next) {
+      CellLink* l = &links[link - 1];
+      if (l->entity_id == entity_id) l->components_mask = components_mask;
+      cell_mask |= l->components_mask;
+    }
+    SetComponentsMask(cell, cell_mask);
+  }
+
+  void
+  SetComponentsMask(Cell* cell, u64 components_mask)
+  {
+    u64 changed = cell->components_mask ^ components_mask;
+    for (u32 i = 0; changed; ++i, changed >>= 1) {
+      if (!(changed & 1)) continue;
+      if (FLAGGED(components_mask, i)) ++type_cells[i];
+      else --type_cells[i];
+    }
+    cell->components_mask = components_mask;
+  }
+
   // Number of cells x
   u32 width;
   // Number of cells y
   u32 height;
 
-  std::vector<Cell> storage;
+  // Cells and blocked are sized once and live as long as the program, so they
+  // come from the permanent arena.
+  memory::PermanentVector<Cell> storage;
+  // Entity lists of every cell, and the index + 1 of the first unused link.
+  std::vector<CellLink> links;
+  u32 free_link = 0;
+  // Number of cells holding an entity with each component type.
+  u32 type_cells[kComponentCount] = {};
+  // Nonzero for cells characters can't walk through, laid out like storage.
+  memory::PermanentVector<u8> blocked;
+  // Clusters of blocked that paths are planned over.
+  search::HpaGraph hpa;
 };
 
 
 std::vector<Grid> kGrids;
+// Guards cell entity lists when GridSync runs on worker threads.
+static Mutex kGridMutex;
+
+void GridComponentsChanged(Entity* ent);
+
+void
+GridInitialize()
+{
+  platform::MutexCreate(&kGridMutex);
+  ecs::kComponentsChanged = &GridComponentsChanged;
+}
 
 u32
 GridCreate(v2i xy)
 {
   kGrids.push_back(Grid(xy));
+  Grid* grid = &kGrids.back();
+  // A link per cell is far more than a world uses, so the pool doesn't
+  // reallocate as entities come and go.
+  grid->links.reserve(grid->storage.size());
+  search::HpaBuild(grid->PathGrid(), kGridClusterSize, &grid->hpa);
   // Grid ids are defined as kGrids[id - 1] to maintain 0 being unassigned.
   return kGrids.size();
 }
@@ -126,31 +338,42 @@ GridGet(u32 grid_id)
   return &kGrids[idx];
 }
 
-std::vector<v2i>
-GridGetIntersectingCellPos(PhysicsComponent* phys)
+// The cells rect overlaps or touches from the inside, clamped to the grid.
+// Empty if rect is entirely off the grid.
+GridRange
+GridRangeFromRect(const Grid& grid, const Rectf& rect)
+{
+  GridRange range;
+  v2f max = rect.Max();
+  v2i min((s32)floorf(rect.x / kCellWidth), (s32)floorf(rect.y / kCellHeight));
+  // Cells are open on their far edges so a rect ending on a border doesn't
+  // reach into the next cell, but one with no width still sits in a cell.
+  range.max = v2i(MAX(min.x, (s32)ceilf(max.x / kCellWidth) - 1),
+                  MAX(min.y, (s32)ceilf(max.y / kCellHeight) - 1));
+  range.min = v2i(MAX(min.x, 0), MAX(min.y, 0));
+  range.max = v2i(MIN(range.max.x, (s32)grid.width - 1),
+                  MIN(range.max.y, (s32)grid.height - 1));
+  return range;
+}
+
+GridRange
+GridGetRange(PhysicsComponent* phys)
 {
   Grid* grid = GridGet(phys->grid_id);
   assert(grid != nullptr);
-  std::vector<v2i> nodes;
+  return GridRangeFromRect(*grid, phys->rect());
+}
 
-  v2i xy;
-  if (GridXYFromPos(phys->pos, &xy)) {
-    BfsSearchItr itr(xy,
-        [grid, phys](v2i node) -> bool {
-          Rectf grid_rect(GridPosFromXY(node), CellDims());
-          Rectf character_rect = phys->rect();
-          return math::IntersectRect(character_rect, grid_rect) ||
-                 math::IsContainedInRect(character_rect, grid_rect) ||
-                 math::IsContainedInRect(grid_rect, character_rect);
-        },
-        [grid](v2i node) -> std::vector<v2i> {
-          return grid->NeighborsPos(node);
-        }
-    );
-    while (itr.Next());
-    nodes = std::move(itr.nodes);
+std::vector<v2i>
+GridGetIntersectingCellPos(PhysicsComponent* phys)
+{
+  GridRange range = GridGetRange(phys);
+  std::vector<v2i> nodes;
+  for (s32 y = range.min.y; y <= range.max.y; ++y) {
+    for (s32 x = range.min.x; x <= range.max.x; ++x) {
+      nodes.push_back(v2i(x, y));
+    }
   }
-
   return nodes;
 }
 
@@ -166,11 +389,10 @@ GridSetEntity(PhysicsComponent* phys)
 
   Grid* grid = GridGet(phys->grid_id);
   cells = GridGetIntersectingCellPos(phys);
+  Entity* entity = FindEntity(phys->entity_id);
+  assert(entity != nullptr);
   for (v2i cell : cells) {
-    Cell* gcell = grid->Get(cell);
-    assert(gcell != nullptr);
-    gcell->entity_ids.push_back(phys->entity_id);
-    //printf("grid->Set(%u, %u)->AddEntity(%u)\n", cell.x, cell.y, phys->entity_id);
+    grid->AddEntity(cell, phys->entity_id, entity->components_mask);
   }
 
   return cells;
@@ -186,51 +408,66 @@ GridUnsetEntity(PhysicsComponent* phys)
   }
 
   Grid* grid = GridGet(phys->grid_id);
-  std::vector<v2i> cells = GridGetIntersectingCellPos(phys);
-  for (v2i cell : cells) {
-    Cell* gcell = grid->Get(cell);
-    assert(gcell != nullptr);
-    gcell->entity_ids.erase(std::remove(
-          gcell->entity_ids.begin(), gcell->entity_ids.end(), phys->entity_id),
-            gcell->entity_ids.end());
-    //printf("grid->Set(%u, %u)->AddEntity(%u)\n", cell.x, cell.y, phys->entity_id);
+  GridRange range = GridGetRange(phys);
+  for (s32 y = range.min.y; y <= range.max.y; ++y) {
+    for (s32 x = range.min.x; x <= range.max.x; ++x) {
+      grid->RemoveEntity(v2i(x, y), phys->entity_id);
+    }
   }
 }
 
+// Moves phys between cells for whatever changed its rect in scope. Only cells
+// it left or entered are touched.
 struct GridSync {
   GridSync(PhysicsComponent* phys) : phys(phys)
   {
     assert(phys != nullptr);
-    nodes = GridGetIntersectingCellPos(phys);
+    range = GridGetRange(phys);
   }
 
   ~GridSync()
   {
     assert(phys != nullptr);
+    GridRange new_range = GridGetRange(phys);
+    if (new_range == range) return;
     Grid* grid = GridGet(phys->grid_id);
     assert(grid != nullptr);
-    std::vector<v2i> new_nodes = GridGetIntersectingCellPos(phys);
-    if (nodes != new_nodes) {
-      // Unset all from original nodes.
-      for (v2i node : nodes) {
-        Cell* gcell = grid->Get(node);
-        assert(gcell != nullptr);
-        gcell->entity_ids.erase(std::remove(
-          gcell->entity_ids.begin(), gcell->entity_ids.end(), phys->entity_id),
-            gcell->entity_ids.end());
-        //printf("grid(%u, %u)->RemoveEntity(%u)\n", node.x, node.y, phys->entity_id);
+    Entity* entity = FindEntity(phys->entity_id);
+    assert(entity != nullptr);
+    LockGuard lock(&kGridMutex);
+    for (s32 y = range.min.y; y <= range.max.y; ++y) {
+      for (s32 x = range.min.x; x <= range.max.x; ++x) {
+        if (new_range.Contains(v2i(x, y))) continue;
+        grid->RemoveEntity(v2i(x, y), phys->entity_id);
       }
-      for (v2i node : new_nodes) {
-        Cell* gcell = grid->Get(node);
-        assert(gcell != nullptr);
-        gcell->entity_ids.push_back(phys->entity_id);
-        //printf("grid(%u, %u)->AddEntity(%u)\n", node.x, node.y, phys->entity_id);
+    }
+    for (s32 y = new_range.min.y; y <= new_range.max.y; ++y) {
+      for (s32 x = new_range.min.x; x <= new_range.max.x; ++x) {
+        if (range.Contains(v2i(x, y))) continue;
+        grid->AddEntity(v2i(x, y), phys->entity_id, entity->components_mask);
       }
     }
   }
 
-  std::vector<v2i> nodes;
+  GridRange range;
   PhysicsComponent* phys;
 };
 
+// Keeps the component masks of the cells under ent current. Installed as
+// ecs::kComponentsChanged.
+void
+GridComponentsChanged(Entity* ent)
+{
+  PhysicsComponent* phys = GetPhysicsComponent(ent);
+  // Physics is assigned before the entity is placed on a grid.
+  if (!phys || !phys->grid_id) return;
+  Grid* grid = GridGet(phys->grid_id);
+  GridRange range = GridGetRange(phys);
+  for (s32 y = range.min.y; y <= range.max.y; ++y) {
+    for (s32 x = range.min.x; x <= range.max.x; ++x) {
+      grid->UpdateEntity(v2i(x, y), ent->id, ent->components_mask);
+    }
+  }
+}
+
 // }
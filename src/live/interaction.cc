@@ -33,7 +33,8 @@ InteractionRenderOrderOptions()
   static b8 enable_ui = true;
   static v2f pos_ui(screen.x - 115.f, screen.y);
   imui::PaneOptions options;
-  imui::Begin("Selection", imui::kEveryoneTag, options, &pos_ui, &enable_ui);
+  imui::Begin(HASH_STR("Selection"), imui::kEveryoneTag, options,
+              &pos_ui, &enable_ui);
   imui::TextOptions toptions;
   toptions.highlight_color = imui::kRed;
   toptions.color = kInteraction.action == Interaction::kHarvest ? imui::kRed : imui::kWhite;
@@ -61,7 +62,8 @@ InteractionRenderEntityViewer()
   static b8 enable_ui = true;
   static v2f pos_ui(0.f, screen.y - 20.f);
   imui::PaneOptions options;
-  imui::Begin("Entities", imui::kEveryoneTag, options, &pos_ui, &enable_ui);
+  imui::Begin(HASH_STR("Entities"), imui::kEveryoneTag, options,
+              &pos_ui, &enable_ui);
   imui::Text("TEST");
   imui::End();
 }*/
@@ -76,7 +78,8 @@ InteractionRenderResourceCounts()
   static b8 enable_ui = true;
   static v2f pos_ui(screen.x - 125.f, 80.f);
   imui::PaneOptions options;
-  imui::Begin("Resources", imui::kEveryoneTag, options, &pos_ui, &enable_ui);
+  imui::Begin(HASH_STR("Resources"), imui::kEveryoneTag, options,
+              &pos_ui, &enable_ui);
   for (s32 i = 0; i < kResourceTypeCount; ++i) {
     snprintf(resource_buffer, sizeof(resource_buffer), "%s: %i",
              ResourceName((ResourceType)i), kSim.resources[i]);
@@ -145,9 +148,9 @@ InteractionRender()
 {
   if (kInteraction.left_mouse_down && kInteraction.action == Interaction::kHarvest) {
     Rectf srect = math::OrientToAabb(kInteraction.selection_rect());
-    ECS_ITR2(itr, kPhysicsComponent, kHarvestComponent);
+    ecs::Query<PhysicsComponent, HarvestComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* tree = itr.c.physics;
+      PhysicsComponent* tree = itr.Get<PhysicsComponent>();
       Rectf trect = tree->rect();
       b8 irect = math::IntersectRect(trect, srect);
       b8 crect = math::IsContainedInRect(trect, srect);
@@ -176,7 +179,7 @@ InteractionRender()
                    math::IsContainedInRect(srect, grid_rect) ||
                    math::IsContainedInRect(grid_rect, srect);
           },
-          [grid](v2i node) -> std::vector<v2i> {
+          [grid](v2i node) -> memory::FrameVector<v2i> {
             return grid->NeighborsPos(node);
           }
       );
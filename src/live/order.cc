@@ -11,18 +11,91 @@ _GetOrder(CharacterComponent* character)
   return GetOrderComponent(order_entity);
 }
 
+// Plans a path from the character's cell to goal around blocked cells. Leaves
+// the path empty if there is none.
+void
+OrderPlanPath(CharacterComponent* character, PhysicsComponent* phys, v2i goal)
+{
+  character->path_goal = goal;
+  character->path_index = 1;
+  Grid* grid = GridGet(phys->grid_id);
+  v2i start;
+  if (!GridXYFromPos(phys->pos, &start) ||
+      !search::HpaFindPath(grid->PathGrid(), grid->hpa, start, goal,
+                           &character->path)) {
+    character->path.clear();
+  }
+}
+
+// Walks the character a step toward target, following a path around blocked
+// cells when one exists and straight at target otherwise. Returns true once
+// there.
 b8
 OrderExecuteMove(CharacterComponent* character, PhysicsComponent* phys, v2f target)
 {
   v2f diff = target - phys->pos;
   r32 diff_lsq = math::LengthSquared(diff);
-  if (diff_lsq > 1.f) {
-    GridSync grid_sync(phys);
-    v2f dir = math::Normalize(diff);
-    phys->pos += (dir * kCharacterDefaultSpeed);
-    return false;
+  if (diff_lsq <= 1.f) {
+    character->path.clear();
+    character->path_goal = v2i(-1, -1);
+    return true;
+  }
+  v2i goal;
+  if (GridXYFromPos(target, &goal)) {
+    Grid* grid = GridGet(phys->grid_id);
+    // Replan when the target moves to another cell or something was built
+    // in the way.
+    if (goal != character->path_goal ||
+        (character->path_index < character->path.size() &&
+         grid->IsBlocked(character->path[character->path_index]))) {
+      OrderPlanPath(character, phys, goal);
+    }
+    while (character->path_index < character->path.size() &&
+           math::LengthSquared(
+               GridPosFromXY(character->path[character->path_index]) -
+               phys->pos) <= 1.f) {
+      ++character->path_index;
+    }
+    if (character->path_index < character->path.size()) {
+      diff = GridPosFromXY(character->path[character->path_index]) -
+             phys->pos;
+    }
   }
-  return true;
+  GridSync grid_sync(phys);
+  v2f dir = math::Normalize(diff);
+  phys->pos += (dir * kCharacterDefaultSpeed);
+  return false;
+}
+
+// Walks the character a step toward target along the flow field toward
+// flow_entity_id, shared by every character headed there. Once the field runs
+// out, at the destination or where it can't reach, finishes with
+// OrderExecuteMove.
+b8
+OrderExecuteFlow(CharacterComponent* character, PhysicsComponent* phys, v2f target, u32 flow_entity_id)
+{
+  Grid* grid = GridGet(phys->grid_id);
+  v2i cell;
+  // Step cell to cell so characters keep to the field's steps rather than
+  // cutting the corners between them.
+  if (character->flow_cell == v2i(-1, -1) ||
+      grid->IsBlocked(character->flow_cell) ||
+      math::LengthSquared(GridPosFromXY(character->flow_cell) - phys->pos) <= 1.f) {
+    v2i from = character->flow_cell;
+    if (from == v2i(-1, -1) || grid->IsBlocked(from)) {
+      if (!GridXYFromPos(phys->pos, &from)) from = v2i(-1, -1);
+    }
+    search::FlowField* field = FlowFieldGet(flow_entity_id);
+    if (!field || !search::FlowFieldStep(*field, from, &cell)) {
+      character->flow_cell = v2i(-1, -1);
+      return OrderExecuteMove(character, phys, target);
+    }
+    character->flow_cell = cell;
+  }
+  GridSync grid_sync(phys);
+  v2f dir = math::Normalize(GridPosFromXY(character->flow_cell) - phys->pos);
+  phys->pos += (dir * kCharacterDefaultSpeed);
+  return false;
 }
 
 b8
@@ -82,7 +155,7 @@ OrderExecuteBuild(CharacterComponent* character, PhysicsComponent* physics, Orde
     } else {
       DispatchBuildCompleted(build->entity_id);
       for (u32 req_entity_id : build->requesite_entity_ids) {
-        AssignDeathComponent(req_entity_id);
+        kCommandBuffer.Assign<DeathComponent>(req_entity_id);
       }
       return true;
     }
@@ -94,21 +167,15 @@ OrderExecuteBuild(CharacterComponent* character, PhysicsComponent* physics, Orde
 void
 OrderMorphToCarryToZone(OrderComponent* order, PhysicsComponent* physics)
 {
-  // Find the zone to carry this thing to.
-  ECS_ITR2(itr, kZoneComponent, kPhysicsComponent);
-  ZoneComponent* zone = nullptr;
-  PhysicsComponent* zone_physics = nullptr;
-  while (itr.Next()) {
-    // TODO: Check that zone can hold this resource??
-    if (ZoneHasCapacity(itr.c.zone)) {
-      zone = itr.c.zone;
-      zone_physics = itr.c.physics;
-      break;
-    }
-  }
+  // Find the closest zone to carry this thing to.
+  u32 zone_id = SpatialNearest(physics->grid_id, physics->pos, kZoneComponent,
+      [](Entity* entity) {
+        // TODO: Check that zone can hold this resource??
+        return ZoneHasCapacity(GetZoneComponent(entity));
+      });
+  ZoneComponent* zone = GetZoneComponent(FindEntity(zone_id));
   assert(zone != nullptr);
-  assert(zone_physics != nullptr);
-  Grid* grid = GridGet(zone_physics->grid_id);
+  Grid* grid = GridGet(physics->grid_id);
   assert(grid != nullptr);
   ZoneCell* use_cell = nullptr;
   for (ZoneCell& zcell : zone->zone_cells) {
@@ -117,15 +184,8 @@ OrderMorphToCarryToZone(OrderComponent* order, PhysicsComponent* physics)
     Cell* gcell = grid->Get(zcell.grid_pos);
     assert(gcell != nullptr);
     // If the cell does not have a resource or building entity.
-    bool is_cell_valid = true;
-    for (u32 entity_id : gcell->entity_ids) {
-      Entity* entity = FindEntity(entity_id);
-      if (entity->Has(kResourceComponent) || entity->Has(kBuildComponent)) {
-        is_cell_valid = false;
-        break;
-      }
-    }
-    if (is_cell_valid) {
+    if (!(gcell->components_mask &
+          (FLAG(kResourceComponent) | FLAG(kBuildComponent)))) {
       use_cell = &zcell;
       break;
     }
@@ -134,6 +194,7 @@ OrderMorphToCarryToZone(OrderComponent* order, PhysicsComponent* physics)
   assert(use_cell != nullptr);
   if (use_cell) {
     order->carry_to_data.grid_to = use_cell->grid_pos;
+    order->carry_to_data.flow_entity_id = zone->entity_id;
     use_cell->reserved = true;
   }
 }
@@ -150,9 +211,10 @@ OrderExecutePickup(CharacterComponent* character, PhysicsComponent* physics, Ord
   assert(pickup_physics != nullptr);
 
   if (OrderExecuteMove(character, physics, pickup_physics->pos)) {
-    CarryComponent* carry = AssignCarryComponent(pickup_entity);
-    carry->carrier_entity_id = character->entity_id;
-    RemovePickupComponent(pickup_entity);
+    CarryComponent carry = {};
+    carry.carrier_entity_id = character->entity_id;
+    kCommandBuffer.Assign<CarryComponent>(pickup_entity->id, carry);
+    kCommandBuffer.Remove<PickupComponent>(pickup_entity->id);
     character->carrying_id = pickup_entity->id;
     order->order_type = kCarryTo;
     if (order->pickup_data.destination == PickupData::kFindZone) {
@@ -170,6 +232,7 @@ OrderExecutePickup(CharacterComponent* character, PhysicsComponent* physics, Ord
         ZoneCell* zone_cell = ZoneGetCell(GetZoneComponent(zone_entity), order->pickup_data.zone_grid_pos);
         if (zone_cell) zone_cell->reserved = false;
       }
+      order->carry_to_data.flow_entity_id = build_entity->id;
     }
   }
 
@@ -182,14 +245,14 @@ b8
 OrderExecuteCarryTo(CharacterComponent* character, PhysicsComponent* physics, OrderComponent* order)
 {
   v2f pos = GridPosFromXY(order->carry_to_data.grid_to);
-  if (OrderExecuteMove(character, physics, pos)) {
+  if (OrderExecuteFlow(character, physics, pos, order->carry_to_data.flow_entity_id)) {
     Entity* carried_entity = FindEntity(character->carrying_id);
     assert(carried_entity != nullptr);
     PhysicsComponent* carried_physics = GetPhysicsComponent(carried_entity);
     assert(carried_physics != nullptr);
     GridSync gsync(carried_physics);
     carried_physics->pos = pos;
-    RemoveCarryComponent(carried_entity);
+    kCommandBuffer.Remove<CarryComponent>(carried_entity->id);
     character->carrying_id = 0;
     // Assume a resource was carried to a stockpile???
     if (carried_entity->Has(kResourceComponent)) {
@@ -216,7 +279,7 @@ CanBuildProceed(Entity* ent, BuildComponent* build_comp, std::vector<u32>* entit
   for (v2i gcell : grid_cells) {
     Cell* cell = grid->Get(gcell);
     assert(cell != nullptr);
-    for (u32 entity_id : cell->entity_ids) {
+    for (u32 entity_id : grid->Entities(cell)) {
       Entity* cell_entity = FindEntity(entity_id);
       assert(cell_entity != nullptr);
       if (!cell_entity->Has(kResourceComponent)) continue;
@@ -237,29 +300,30 @@ CanBuildProceed(Entity* ent, BuildComponent* build_comp, std::vector<u32>* entit
 void
 OrderCreatePickupsFor(BuildComponent* build_comp)
 {
-  ECS_ITR2(itr, kZoneComponent, kPhysicsComponent);
+  Entity* build_entity = FindEntity(build_comp->entity_id);
+  assert(build_entity != nullptr);
+  PhysicsComponent* build_physics = GetPhysicsComponent(build_entity);
+  assert(build_physics != nullptr);
   ResourceComponent* resource_component = nullptr;
+  ZoneComponent* zone = nullptr;
   ZoneCell* zone_cell = nullptr;
-  u32 zone_entity_id = 0;
-  while (itr.Next()) {
-    if (ZoneHasResourceForPickup(itr.c.zone, &resource_component, &zone_cell, build_comp->required_resource_type)) {
-      // TODO: Investigate why itr.e.id doesn't work here. Seemed to be 0 when I tried it last.
-      zone_entity_id = itr.c.zone->entity_id;
-      break;
-    }
-  }
-  if (resource_component && zone_entity_id) {
+  // Take the stored resource closest to the build site.
+  if (ZoneFindResourceForPickup(build_physics->grid_id, build_physics->pos,
+                                build_comp->required_resource_type,
+                                &resource_component, &zone, &zone_cell)) {
     Entity* resource_entity = FindEntity(resource_component->entity_id);
     assert(resource_entity);
+    // Assigned immediately so the resource has an order before anyone else
+    // looks for one to pick up. OrderAcquire only visits the orders that
+    // existed when it started so the new order isn't visited.
     AssignPickupComponent(resource_entity);
-    // Consider abstracting order creation to a sim_create function perhaps.
-    OrderComponent* order = AssignOrderComponent(resource_entity);
+    OrderComponent* order = SimAssignOrder(resource_entity);
     order->order_type = kPickup;
     order->acquire_count = 0;
     order->max_acquire_count = 1;
     order->pickup_data.build_entity_id = build_comp->entity_id;
     order->pickup_data.destination = PickupData::kBuild;
-    order->pickup_data.zone_entity_id = zone_entity_id;
+    order->pickup_data.zone_entity_id = zone->entity_id;
     order->pickup_data.zone_grid_pos = zone_cell->grid_pos;
     build_comp->pickup_orders_issued += 1;
   }
@@ -276,14 +340,24 @@ OrderAcquire(CharacterComponent* character)
 
   {
     // Perhaps run some conditional logic on what types of orders a character is willing to acquire. 
-    ECS_ITR1(itr, kOrderComponent);
-    while (itr.Next()) {
-      OrderComponent* order = itr.c.order;
+    // Oldest orders first. Query visits in storage order, which shuffles as
+    // orders complete, and ids are reused so they don't give age either.
+    memory::FrameVector<std::pair<u32, u32>> orders;
+    ecs::Query<OrderComponent> order_itr;
+    while (order_itr.Next()) {
+      orders.push_back({order_itr.Get<OrderComponent>()->sequence,
+                        order_itr.e->id});
+    }
+    std::sort(orders.begin(), orders.end());
+    for (const std::pair<u32, u32>& sequence_id : orders) {
+      Entity* order_entity = FindEntity(sequence_id.second);
+      OrderComponent* order = GetOrderComponent(order_entity);
+      if (!order) continue;
       if (order->acquire_count >= order->max_acquire_count) {
         continue;
       }
       if (order->order_type == kBuild) {
-        BuildComponent* build_comp = GetBuildComponent(itr.e);
+        BuildComponent* build_comp = GetBuildComponent(order_entity);
         assert(build_comp != nullptr);
         // Don't have enough resources to build.
         if (kSim.resources[build_comp->required_resource_type] < build_comp->resource_count) {
@@ -302,7 +376,7 @@ OrderAcquire(CharacterComponent* character)
         //printf("Can anuyone build???\n");
 
         std::vector<u32> entity_ids;
-        b8 can_build_proceed = CanBuildProceed(itr.e, build_comp, &entity_ids);
+        b8 can_build_proceed = CanBuildProceed(order_entity, build_comp, &entity_ids);
         // Check if the build order can proceed.
         if (!can_build_proceed) {
           continue;
@@ -313,9 +387,9 @@ OrderAcquire(CharacterComponent* character)
           continue;
 
         // Look for a zone that this thing can be moved to.
-        ResourceComponent* resource = GetResourceComponent(itr.e);
+        ResourceComponent* resource = GetResourceComponent(order_entity);
         if (resource) {
-          ECS_ITR1(itr, kZoneComponent);
+          ecs::Query<ZoneComponent> itr;
           bool valid_zone = false;
           while (itr.Next()) {
             valid_zone = true; 
@@ -334,10 +408,10 @@ OrderAcquire(CharacterComponent* character)
 }
 
 void
-OrderExecute(EntityItr<2>* itr)
+OrderExecute(Query<CharacterComponent, PhysicsComponent>* itr)
 {
-  CharacterComponent* character = itr->c.character;
-  PhysicsComponent* physics = itr->c.physics;
+  CharacterComponent* character = itr->Get<CharacterComponent>();
+  PhysicsComponent* physics = itr->Get<PhysicsComponent>();
 
   OrderComponent* order = _GetOrder(character);
 
@@ -367,15 +441,12 @@ OrderExecute(EntityItr<2>* itr)
     default: break;
   }
 
-  // NOTE: The pointer to order might be different after Execute*...
-
   if (order_completed) {
     // If the order hasn't changed get rid of it since it's done. If it has  changed the completion
     // of one order likely mutated the existing component. Idk if that's bad but that's how this works.
     if (original_order_type == order->order_type) {
       //printf("Removing order component %u\n", itr->e->id);
-      Entity* order_entity = FindEntity(order->entity_id);
-      RemoveOrderComponent(order_entity);
+      kCommandBuffer.Remove<OrderComponent>(order->entity_id);
     }
     character->order_id = 0;
   }
@@ -6,7 +6,7 @@ Render()
   live::Grid* grid = live::GridGet(1);
   if (kRenderGridFill) {
     for (live::Cell& cell : grid->storage) {
-      if (!cell.entity_ids.empty()) {
+      if (!grid->Entities(&cell).empty()) {
         rgg::RenderRectangle(cell.rect(), v4f(.2f, .2f, .2f, .8f));
       }
     }
@@ -16,36 +16,22 @@ Render()
   rgg::Texture* character_texture = rgg::GetTexture(live::kAssets.character_texture_id);
   Rectf sbounds = live::ScreenBounds();
 
-  {
-    assert(terrain_texture);
-    for (const live::Cell& cell : grid->storage) {
-      if (!math::IsContainedInRect(cell.rect(), sbounds) && !math::IntersectRect(cell.rect(), sbounds))
-        continue;
-      if (cell.pos == v2i(0, 0)) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtBottomLeft);
-      } else if (cell.pos.y == 0) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtBottomMiddle);
-      } else if (cell.pos.x == 0) {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtMiddleLeft);
-      } else {
-        live::AssetTerrainRender(terrain_texture, live::GridPosFromXY(cell.pos), live::TerrainAsset::kDirtMiddleMiddle);
-      }
-    }
-  }
+  assert(terrain_texture);
+  rgg::RenderTilemap(&live::kAssets.terrain_tilemap, live::GridPosFromXY(live::GridMin()), sbounds);
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kZoneComponent);
+    ecs::Query<PhysicsComponent, ZoneComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
       rgg::RenderRectangle(physics->rect(), v4f(0.1f, 0.1f, 0.4f, 0.8f));
     }
   }
   
   {
-    ECS_ITR3(itr, kPhysicsComponent, kHarvestComponent, kResourceComponent);
+    ecs::Query<PhysicsComponent, HarvestComponent, ResourceComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      ResourceComponent* resource = itr.c.resource;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      ResourceComponent* resource = itr.Get<ResourceComponent>();
       if (!math::IsContainedInRect(physics->rect(), sbounds) && !math::IntersectRect(physics->rect(), sbounds))
         continue;
 
@@ -64,13 +50,14 @@ Render()
     }
   }
 
+  rgg::FlushBatches();
   glDisable(GL_BLEND);
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kBuildComponent);
+    ecs::Query<PhysicsComponent, BuildComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      BuildComponent* build = itr.c.build;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      BuildComponent* build = itr.Get<BuildComponent>();
       switch (build->structure_type) {
         case kWall:
           rgg::RenderLineRectangle(physics->rect(), v4f(1.f, 1.f, 1.f, 1.f));
@@ -83,10 +70,10 @@ Render()
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kStructureComponent);
+    ecs::Query<PhysicsComponent, StructureComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* physics = itr.c.physics;
-      StructureComponent* structure = itr.c.structure;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      StructureComponent* structure = itr.Get<StructureComponent>();
       switch (structure->structure_type) {
         case kWall:
           rgg::RenderRectangle(physics->rect(), v4f(.64f, .45f, .28f, 1.f));
@@ -99,9 +86,9 @@ Render()
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kCharacterComponent);
+    ecs::Query<PhysicsComponent, CharacterComponent> itr;
     while (itr.Next()) {
-      PhysicsComponent* character = itr.c.physics;
+      PhysicsComponent* character = itr.Get<PhysicsComponent>();
       r32 half_width = character->rect().width / 2.f;
 
       /*
@@ -128,12 +115,12 @@ Render()
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kResourceComponent);
+    ecs::Query<PhysicsComponent, ResourceComponent> itr;
     while (itr.Next()) {
       // The resource should not be rendered if this is a tree for instance.
       if (GetHarvestComponent(itr.e)) continue;
-      PhysicsComponent* physics = itr.c.physics;
-      ResourceComponent* resource = itr.c.resource;
+      PhysicsComponent* physics = itr.Get<PhysicsComponent>();
+      ResourceComponent* resource = itr.Get<ResourceComponent>();
       Rectf rect = physics->rect();
       switch (resource->resource_type) {
         case kLumber:
@@ -149,6 +136,7 @@ Render()
     }
   }
 
+  rgg::FlushBatches();
   glEnable(GL_BLEND);
 
   if (kRenderGrid) {
@@ -156,16 +144,9 @@ Render()
     live::Grid* grid = live::GridGet(1);
     r32 grid_width = grid->width * live::kCellWidth;
     r32 grid_height = grid->height * live::kCellHeight;
-    for (s32 x = 0; x < grid->width; ++x) {
-      v2f start(x * live::kCellWidth, 0);
-      v2f end(x * live::kCellWidth, grid_height);
-      rgg::RenderLine(start, end, v4f(1.f, 1.f, 1.f, .15f));
-    }
-    for (s32 y = 0; y < grid->height; ++y) {
-      v2f start(0, y * live::kCellHeight);
-      v2f end(grid_width, y * live::kCellHeight);
-      rgg::RenderLine(start, end, v4f(1.f, 1.f, 1.f, .15f));
-    }
+    rgg::RenderGrid(v2f(live::kCellWidth, live::kCellHeight),
+                    Rectf(0.f, 0.f, grid_width, grid_height),
+                    v4f(1.f, 1.f, 1.f, .15f));
   }
 
 }
@@ -1,6 +1,6 @@
 // namespace live {
 
-typedef std::function<std::vector<v2i>(v2i)> NeighborsFunc;
+typedef std::function<memory::FrameVector<v2i>(v2i)> NeighborsFunc;
 typedef std::function<bool(v2i)> ExpandFunc;
 
 struct BfsSearchItr {
@@ -19,10 +19,10 @@ struct BfsSearchItr {
   Next()
   {
     if (to_test.empty()) return false;
-    std::vector<v2i> new_to_test;
+    memory::FrameVector<v2i> new_to_test;
     for (v2i node : to_test) {
       nodes.push_back(node);
-      std::vector<v2i> neighbors = neighbors_func(node);
+      memory::FrameVector<v2i> neighbors = neighbors_func(node);
       for (v2i neighbor : neighbors) {
         if (explored.find(neighbor) != explored.end()) continue;
         if (expand_func(neighbor)) {
@@ -36,7 +36,8 @@ struct BfsSearchItr {
   }
 
   std::vector<v2i> nodes;
-  std::vector<v2i> to_test;
+  // Scratch space per expansion - comes from the frame arena.
+  memory::FrameVector<v2i> to_test;
   std::unordered_set<v2i> explored;
   ExpandFunc expand_func;
   NeighborsFunc neighbors_func;
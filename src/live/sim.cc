@@ -24,6 +24,9 @@ using SimCallbacks = std::vector<std::function<void(const T&)>>;
 
 struct Sim {
   s32 resources[kResourceTypeCount];
+  // Orders created so far. Each order is stamped with the count as its
+  // sequence so the oldest can be found - entity ids are reused.
+  u32 orders_created = 0;
 };
 
 static Sim kSim;
@@ -38,6 +41,8 @@ SecondsToTicks(r32 seconds)
 #include "live/search.cc"
 #include "live/asset.cc"
 #include "live/grid.cc"
+#include "live/spatial.cc"
+#include "live/flow_field.cc"
 #include "live/sim_create.cc"
 #include "live/zone.cc"
 #include "live/mgen.cc"
@@ -47,15 +52,11 @@ SecondsToTicks(r32 seconds)
 void
 SimHandleHarvestBoxSelect(const Rectf& selection)
 {
-  ECS_ITR2(itr, kPhysicsComponent, kHarvestComponent);
-  while (itr.Next()) {
-    PhysicsComponent* tree = itr.c.physics;
-    Rectf trect = tree->rect();
-    b8 irect = math::IntersectRect(trect, selection);
-    b8 crect = math::IsContainedInRect(trect, selection);
-    if (irect || crect) {
-      SimCreateHarvestOrder(itr.e);
-    }
+  for (u32 grid_id = 1; grid_id <= kGrids.size(); ++grid_id) {
+    SpatialQueryRect(grid_id, selection, kHarvestComponent,
+                     [](Entity* entity, PhysicsComponent*) {
+                       SimCreateHarvestOrder(entity);
+                     });
   }
 }
 
@@ -98,6 +99,9 @@ SimHandleBuildCompleted(u32 entity_id)
   switch (build->structure_type) {
     case kWall:
       SimCreateWall(physics->pos, physics->grid_id);
+      for (v2i cell : GridGetIntersectingCellPos(physics)) {
+        FlowFieldBlock(physics->grid_id, cell);
+      }
       break;
     default: printf("Error: SimHandleBuildCompleted - unabled to complete.");
   }
@@ -116,7 +120,7 @@ SimHandleBuildLeftClick(v2f pos)
   Cell* gcell = grid->Get(gpos);
   if (!gcell)
     return;
-  for (u32 entity_id : gcell->entity_ids) {
+  for (u32 entity_id : grid->Entities(gcell)) {
     Entity* entity = FindEntity(entity_id);
     assert(entity);
     if (entity->Has(kBuildComponent) || entity->Has(kStructureComponent))
@@ -129,6 +133,8 @@ SimHandleBuildLeftClick(v2f pos)
 void
 SimInitialize()
 {
+  util::WorkerPoolInitialize();
+  GridInitialize();
   u32 grid_id = GridCreate(GridMax());
 
   GenTrees(GridPosFromXY(GridMin()), GridPosFromXY(GridMax() - v2i(1, 1)), grid_id);
@@ -160,37 +166,47 @@ void
 SimUpdate()
 {
   {
-    ECS_ITR2(itr, kCharacterComponent, kPhysicsComponent);
+    ecs::Query<CharacterComponent, PhysicsComponent> itr;
     while (itr.Next()) {
-      OrderAcquire(itr.c.character);
+      OrderAcquire(itr.Get<CharacterComponent>());
       OrderExecute(&itr);
     }
+    // Apply order, pickup and carry changes before carried things follow.
+    kCommandBuffer.Execute();
   }
 
   {
-    ECS_ITR2(itr, kPhysicsComponent, kCarryComponent);
-    while (itr.Next()) {
-      PhysicsComponent* phys = GetPhysicsComponent(itr.e);
-      assert(phys != nullptr);
-      CarryComponent* carry = GetCarryComponent(itr.e);
-      assert(carry != nullptr);
-      Entity* carrying_entity = FindEntity(carry->carrier_entity_id);
-      assert(carrying_entity != nullptr);
-      PhysicsComponent* carrying_physics = GetPhysicsComponent(carrying_entity);
-      assert(carrying_physics != nullptr);
-      GridSync sync(phys);
-      phys->pos = carrying_physics->pos;
-    }
+    // Carried things only read the carrier and write their own physics.
+    ParallelFor<PhysicsComponent, CarryComponent>(64,
+        [](Query<PhysicsComponent, CarryComponent>* itr) {
+      while (itr->Next()) {
+        PhysicsComponent* phys = itr->Get<PhysicsComponent>();
+        CarryComponent* carry = itr->Get<CarryComponent>();
+        Entity* carrying_entity = FindEntity(carry->carrier_entity_id);
+        assert(carrying_entity != nullptr);
+        PhysicsComponent* carrying_physics = GetPhysicsComponent(carrying_entity);
+        assert(carrying_physics != nullptr);
+        GridSync sync(phys);
+        phys->pos = carrying_physics->pos;
+      }
+    });
   }
 
   {
-    ECS_ITR1(itr, kDeathComponent);
+    ecs::Query<DeathComponent> itr;
     while (itr.Next()) {
       if (!itr.e) continue;
       // Free the grid of the entity id.
       if (itr.e->Has(kPhysicsComponent)) {
         PhysicsComponent* phys = GetPhysicsComponent(itr.e);
         assert(phys != nullptr);
+        if (itr.e->Has(kStructureComponent)) {
+          Grid* grid = GridGet(phys->grid_id);
+          for (v2i cell : GridGetIntersectingCellPos(phys)) {
+            grid->SetBlocked(cell, false);
+          }
+          FlowFieldRelease(phys->grid_id);
+        }
         GridUnsetEntity(phys);
       }
       DeleteEntity(itr.e, kComponentCount);
@@ -64,19 +64,26 @@ SimCreateWall(v2f pos, u32 grid_id)
   StructureComponent* structure = AssignStructureComponent(wall);
   structure->structure_type = kWall; 
 
-  GridSetEntity(phys);
+  Grid* grid = GridGet(grid_id);
+  for (v2i cell : GridSetEntity(phys)) grid->SetBlocked(cell, true);
+}
+
+// Every order is created through here so it gets its sequence.
+OrderComponent*
+SimAssignOrder(Entity* entity)
+{
+  OrderComponent* order = AssignOrderComponent(entity);
+  order->sequence = kSim.orders_created++;
+  return order;
 }
 
 void
 SimCreateHarvestOrder(Entity* harvest_entity)
 {
-  ECS_ITR1(itr, kOrderComponent);
-  while (itr.Next()) {
-    if (itr.e->id == harvest_entity->id)
-      return;
-  }
+  if (harvest_entity->Has(kOrderComponent))
+    return;
 
-  OrderComponent* order = AssignOrderComponent(harvest_entity);
+  OrderComponent* order = SimAssignOrder(harvest_entity);
   order->order_type = kHarvest;
   order->acquire_count  = 0;
   order->max_acquire_count = 1;
@@ -113,7 +120,7 @@ SimCreateBuildOrder(StructureType structure_type, v2f pos, u32 grid_id, r32 seco
   build->resource_count = 1;
   build->pickup_orders_issued = 0;
 
-  OrderComponent* order = AssignOrderComponent(entity);
+  OrderComponent* order = SimAssignOrder(entity);
   order->order_type = kBuild;
   order->acquire_count  = 0;
   order->max_acquire_count = 1;
@@ -0,0 +1,245 @@
+// namespace live {
+
+// Finds entities by component type near a point, within a radius or inside a
+// rect. Queries walk grid cells outward from where they're asked and pass over
+// cells whose component mask doesn't have the type, so they cost what's nearby
+// rather than what's in the world.
+//
+//   u32 zone_id = SpatialNearest(grid_id, pos, kZoneComponent);
+
+// Distance from pos to the closest point of rect, 0 inside it.
+r32
+SpatialDistance(v2f pos, const Rectf& rect)
+{
+  v2f min = rect.Min();
+  v2f max = rect.Max();
+  r32 dx = fmaxf(fmaxf(min.x - pos.x, pos.x - max.x), 0.f);
+  r32 dy = fmaxf(fmaxf(min.y - pos.y, pos.y - max.y), 0.f);
+  return sqrtf(dx * dx + dy * dy);
+}
+
+// Closest any cell ring or more cells from center can be to pos - the
+// distance from pos out of the box of cells nearer than ring.
+r32
+SpatialRingDistance(v2f pos, v2i center, s32 ring)
+{
+  if (ring == 0) return 0.f;
+  Rectf inner(GridPosFromXY(center - v2i(ring - 1, ring - 1)),
+              v2f((2 * ring - 1) * kCellWidth, (2 * ring - 1) * kCellHeight));
+  v2f min = inner.Min();
+  v2f max = inner.Max();
+  if (pos.x < min.x || pos.x > max.x || pos.y < min.y || pos.y > max.y) {
+    return 0.f;
+  }
+  return fminf(fminf(pos.x - min.x, max.x - pos.x),
+               fminf(pos.y - min.y, max.y - pos.y));
+}
+
+// The cell under pos, clamped to the grid.
+v2i
+SpatialCenter(const Grid& grid, v2f pos)
+{
+  v2i xy((s32)floorf(pos.x / kCellWidth), (s32)floorf(pos.y / kCellHeight));
+  return v2i(CLAMP(xy.x, 0, (s32)grid.width - 1),
+             CLAMP(xy.y, 0, (s32)grid.height - 1));
+}
+
+// Calls visit(xy) for every cell of the grid exactly ring cells from center.
+template <typename F>
+void
+SpatialVisitRing(const Grid& grid, v2i center, s32 ring, F&& visit)
+{
+  if (ring == 0) {
+    visit(center);
+    return;
+  }
+  s32 width = grid.width;
+  s32 height = grid.height;
+  s32 min_x = MAX(center.x - ring, 0);
+  s32 max_x = MIN(center.x + ring, width - 1);
+  for (s32 y : {center.y - ring, center.y + ring}) {
+    if (y < 0 || y >= height) continue;
+    for (s32 x = min_x; x <= max_x; ++x) visit(v2i(x, y));
+  }
+  s32 min_y = MAX(center.y - ring + 1, 0);
+  s32 max_y = MIN(center.y + ring - 1, height - 1);
+  for (s32 x : {center.x - ring, center.x + ring}) {
+    if (x < 0 || x >= width) continue;
+    for (s32 y = min_y; y <= max_y; ++y) visit(v2i(x, y));
+  }
+}
+
+// Calls visit(entity, phys) for everything in xy with component type.
+template <typename F>
+void
+SpatialVisitCell(Grid* grid, v2i xy, u64 type, F&& visit)
+{
+  Cell* cell = grid->Get(xy);
+  if (!FLAGGED(cell->components_mask, type)) return;
+  for (u32 entity_id : grid->Entities(cell)) {
+    Entity* entity = FindEntity(entity_id);
+    assert(entity != nullptr);
+    if (!entity->Has(type)) continue;
+    PhysicsComponent* phys = GetPhysicsComponent(entity);
+    assert(phys != nullptr);
+    visit(entity, phys);
+  }
+}
+
+// Walks rings out from pos until none can be closer than farthest(). Ring
+// count is bounded by the grid so a query for something absent stops.
+template <typename F, typename G>
+void
+SpatialWalkRings(Grid* grid, v2f pos, F&& visit_cell, G&& farthest)
+{
+  v2i center = SpatialCenter(*grid, pos);
+  s32 rings = MAX(MAX(center.x, (s32)grid->width - 1 - center.x),
+                  MAX(center.y, (s32)grid->height - 1 - center.y));
+  for (s32 ring = 0; ring <= rings; ++ring) {
+    if (SpatialRingDistance(pos, center, ring) > farthest()) return;
+    SpatialVisitRing(*grid, center, ring, visit_cell);
+  }
+}
+
+// The id of the entity with component type closest to pos that accept(entity)
+// returns true for, or 0. Ties go to the lowest id. accept is only asked about
+// entities that would beat the best so far.
+template <typename F>
+u32
+SpatialNearest(u32 grid_id, v2f pos, u64 type, F&& accept)
+{
+  Grid* grid = GridGet(grid_id);
+  if (!grid->type_cells[type]) return 0;
+  u32 best = 0;
+  r32 best_distance = FLT_MAX;
+  SpatialWalkRings(grid, pos,
+      [&](v2i xy) {
+        SpatialVisitCell(grid, xy, type,
+            [&](Entity* entity, PhysicsComponent* phys) {
+              r32 distance = SpatialDistance(pos, phys->rect());
+              if (distance > best_distance) return;
+              if (distance == best_distance && entity->id >= best) return;
+              if (!accept(entity)) return;
+              best = entity->id;
+              best_distance = distance;
+            });
+      },
+      [&]() { return best_distance; });
+  return best;
+}
+
+u32
+SpatialNearest(u32 grid_id, v2f pos, u64 type)
+{
+  return SpatialNearest(grid_id, pos, type, [](Entity*) { return true; });
+}
+
+// The ids of the k entities with component type closest to pos that
+// accept(entity) returns true for, nearest first and ties by lowest id.
+template <typename F>
+void
+SpatialNearestK(u32 grid_id, v2f pos, u64 type, u32 k, std::vector<u32>* ids,
+                F&& accept)
+{
+  ids->clear();
+  Grid* grid = GridGet(grid_id);
+  if (!k || !grid->type_cells[type]) return;
+  std::vector<r32> distances;
+  distances.reserve(k + 1);
+  SpatialWalkRings(grid, pos,
+      [&](v2i xy) {
+        SpatialVisitCell(grid, xy, type,
+            [&](Entity* entity, PhysicsComponent* phys) {
+              r32 distance = SpatialDistance(pos, phys->rect());
+              if (ids->size() == k &&
+                  (distance > distances.back() ||
+                   (distance == distances.back() &&
+                    entity->id > ids->back()))) {
+                return;
+              }
+              // Entities covering several cells are seen once per cell.
+              if (std::find(ids->begin(), ids->end(), entity->id) !=
+                  ids->end()) {
+                return;
+              }
+              if (!accept(entity)) return;
+              u32 i = std::upper_bound(distances.begin(), distances.end(),
+                                       distance) - distances.begin();
+              while (i > 0 && distances[i - 1] == distance &&
+                     (*ids)[i - 1] > entity->id) {
+                --i;
+              }
+              distances.insert(distances.begin() + i, distance);
+              ids->insert(ids->begin() + i, entity->id);
+              if (ids->size() > k) {
+                distances.pop_back();
+                ids->pop_back();
+              }
+            });
+      },
+      [&]() { return ids->size() == k ? distances.back() : FLT_MAX; });
+}
+
+void
+SpatialNearestK(u32 grid_id, v2f pos, u64 type, u32 k, std::vector<u32>* ids)
+{
+  SpatialNearestK(grid_id, pos, type, k, ids, [](Entity*) { return true; });
+}
+
+// Calls visit(entity, phys) once for every entity with component type closer
+// than radius to pos.
+template <typename F>
+void
+SpatialQueryRadius(u32 grid_id, v2f pos, r32 radius, u64 type, F&& visit)
+{
+  Grid* grid = GridGet(grid_id);
+  if (!grid->type_cells[type]) return;
+  Rectf bounds(pos - v2f(radius, radius), v2f(2.f * radius, 2.f * radius));
+  GridRange range = GridRangeFromRect(*grid, bounds);
+  for (s32 y = range.min.y; y <= range.max.y; ++y) {
+    for (s32 x = range.min.x; x <= range.max.x; ++x) {
+      SpatialVisitCell(grid, v2i(x, y), type,
+          [&](Entity* entity, PhysicsComponent* phys) {
+            Rectf prect = phys->rect();
+            if (SpatialDistance(pos, prect) >= radius) return;
+            // Entities covering several cells are visited from the first
+            // of their cells inside bounds.
+            GridRange prange = GridRangeFromRect(*grid, prect);
+            v2i first(MAX(prange.min.x, range.min.x),
+                      MAX(prange.min.y, range.min.y));
+            if (first == v2i(x, y)) visit(entity, phys);
+          });
+    }
+  }
+}
+
+// Calls visit(entity, phys) once for every entity with component type that
+// overlaps rect.
+template <typename F>
+void
+SpatialQueryRect(u32 grid_id, const Rectf& rect, u64 type, F&& visit)
+{
+  Grid* grid = GridGet(grid_id);
+  if (!grid->type_cells[type]) return;
+  GridRange range = GridRangeFromRect(*grid, rect);
+  for (s32 y = range.min.y; y <= range.max.y; ++y) {
+    for (s32 x = range.min.x; x <= range.max.x; ++x) {
+      SpatialVisitCell(grid, v2i(x, y), type,
+          [&](Entity* entity, PhysicsComponent* phys) {
+            Rectf prect = phys->rect();
+            if (!math::IntersectRect(prect, rect) &&
+                !math::IsContainedInRect(prect, rect)) {
+              return;
+            }
+            // Entities covering several cells are visited from the first
+            // of their cells inside rect.
+            GridRange prange = GridRangeFromRect(*grid, prect);
+            v2i first(MAX(prange.min.x, range.min.x),
+                      MAX(prange.min.y, range.min.y));
+            if (first == v2i(x, y)) visit(entity, phys);
+          });
+    }
+  }
+}
+
+// }
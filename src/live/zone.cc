@@ -1,34 +1,5 @@
 // namespace live {
 
-b8
-ZoneHasResourceForPickup(ZoneComponent* zone, ResourceComponent** resource, ZoneCell** zone_cell, ResourceType resource_type)
-{
-  Entity* zone_entity = FindEntity(zone->entity_id);
-  assert(zone_entity);
-  PhysicsComponent* zone_physics = GetPhysicsComponent(zone_entity);
-  assert(zone_physics);
-  Grid* grid = GridGet(zone_physics->grid_id);
-  assert(grid);
-  for (ZoneCell& cell : zone->zone_cells) {
-    // printf("Looking at cell %i %i\n", cell.x, cell.y);
-    Cell* gcell = grid->Get(cell.grid_pos);
-    assert(gcell != nullptr);
-    // If the cell does not have a resource or building entity.
-    for (u32 entity_id : gcell->entity_ids) {
-      Entity* entity = FindEntity(entity_id);
-      if (entity->Has(kResourceComponent) && !entity->Has(kOrderComponent)) {
-        ResourceComponent* entity_resource = GetResourceComponent(entity);
-        if (entity_resource->resource_type == resource_type) {
-          *resource = entity_resource;
-          *zone_cell = &cell;
-          return true;
-        }
-      }
-    }
-  }
-  return false;
-}
-
 b8
 ZoneHasCapacity(ZoneComponent* zone)
 {
@@ -47,4 +18,38 @@ ZoneGetCell(ZoneComponent* zone, v2i pos)
   return nullptr;
 }
 
+// Finds the resource of resource_type closest to pos that's stored in a zone
+// and not already ordered somewhere.
+b8
+ZoneFindResourceForPickup(u32 grid_id, v2f pos, ResourceType resource_type,
+                          ResourceComponent** resource, ZoneComponent** zone,
+                          ZoneCell** zone_cell)
+{
+  Grid* grid = GridGet(grid_id);
+  assert(grid);
+  u32 resource_id = SpatialNearest(grid_id, pos, kResourceComponent,
+      [&](Entity* entity) {
+        if (entity->Has(kOrderComponent)) return false;
+        if (GetResourceComponent(entity)->resource_type != resource_type) {
+          return false;
+        }
+        v2i xy = GridGetRange(GetPhysicsComponent(entity)).min;
+        Cell* gcell = grid->Get(xy);
+        if (!FLAGGED(gcell->components_mask, kZoneComponent)) return false;
+        for (u32 entity_id : grid->Entities(gcell)) {
+          ZoneComponent* cell_zone = GetZoneComponent(FindEntity(entity_id));
+          if (!cell_zone) continue;
+          ZoneCell* cell = ZoneGetCell(cell_zone, xy);
+          if (!cell) continue;
+          *zone = cell_zone;
+          *zone_cell = cell;
+          return true;
+        }
+        return false;
+      });
+  if (!resource_id) return false;
+  *resource = GetResourceComponent(FindEntity(resource_id));
+  return true;
+}
+
 // }
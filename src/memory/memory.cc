@@ -1,56 +1,206 @@
 #pragma once
 
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <new>
+#include <vector>
+
+#include "memory/tracker.cc"
 
 namespace memory {
 
-struct Memory {
+// Bump allocated arenas. The permanent arena holds storage that lives for the
+// whole program and the frame arena is reset at the top of every frame.
+//
+// Arenas are thread_local and only exist on threads that call Initialize.
+enum ArenaId : u32 {
+  kPermanent = 0,
+  kFrame = 1,
+  kArenaCount = 2,
+};
+
+struct Arena {
+  const char* name = nullptr;
   u8* storage = nullptr;
   u64 storage_size = 0;
   u64 storage_used = 0;
+  // Most bytes ever in use at once.
+  u64 high_water = 0;
 };
 
-thread_local Memory kMemory;
+// Position in an arena that can be rolled back to.
+struct Marker {
+  ArenaId arena = kPermanent;
+  u64 used = 0;
+};
+
+thread_local Arena kArena[kArenaCount];
 
 b8 IsInitialized() {
-  return kMemory.storage != nullptr;
+  return kArena[kPermanent].storage != nullptr;
 }
 
-bool Initialize(u64 storage_bytes) {
-  assert(kMemory.storage == nullptr);
-  kMemory.storage_used = 0;
-  kMemory.storage_size = storage_bytes;
-  kMemory.storage = (u8*)calloc(storage_bytes, sizeof(u8));
+Arena* GetArena(ArenaId id) {
+  assert(id < kArenaCount);
+  return &kArena[id];
+}
+
+b8 _InitializeArena(ArenaId id, const char* name, u64 storage_bytes) {
+  Arena* arena = GetArena(id);
+  assert(arena->storage == nullptr);
+  arena->name = name;
+  arena->storage_used = 0;
+  arena->high_water = 0;
+  arena->storage_size = storage_bytes;
+  arena->storage = (u8*)calloc(storage_bytes, sizeof(u8));
+  return arena->storage != nullptr;
+}
+
+bool Initialize(u64 storage_bytes, u64 frame_bytes = MiB(4)) {
+  if (!_InitializeArena(kPermanent, "permanent", storage_bytes)) return false;
+  if (!_InitializeArena(kFrame, "frame", frame_bytes)) return false;
   return IsInitialized();
 }
 
-u8* PushBytes(u64 num) {
-  assert(kMemory.storage_used + num < kMemory.storage_size);
-  u8* mem = &kMemory.storage[kMemory.storage_used];
-  kMemory.storage_used += num;
+// Returns nullptr instead of asserting if the arena can't fit num bytes.
+u8* TryPushBytes(Arena* arena, u64 num, u64 align = 1) {
+  u64 offset = (arena->storage_used + align - 1) & ~(align - 1);
+  if (!arena->storage || offset + num >= arena->storage_size) return nullptr;
+  arena->storage_used = offset + num;
+  TrackArenaPush(num);
+  if (arena->storage_used > arena->high_water) {
+    arena->high_water = arena->storage_used;
+  }
+  return &arena->storage[offset];
+}
+
+u8* TryPushBytes(ArenaId id, u64 num, u64 align = 1) {
+  return TryPushBytes(GetArena(id), num, align);
+}
+
+u8* PushBytes(ArenaId id, u64 num, u64 align = 1) {
+  u8* mem = TryPushBytes(id, num, align);
+  assert(mem != nullptr);
   return mem;
 }
 
+u8* PushBytes(u64 num) {
+  return PushBytes(kPermanent, num);
+}
+
 void PopBytes(u64 num) {
-  assert(kMemory.storage_used >= num);
-  kMemory.storage_used -= num;
-  //LOG(INFO, "Storage at %llu", kMemory.storage_used);
-  memset(&kMemory.storage[kMemory.storage_used], 0, num);
+  Arena* arena = GetArena(kPermanent);
+  assert(arena->storage_used >= num);
+  arena->storage_used -= num;
+  //LOG(INFO, "Storage at %llu", arena->storage_used);
+  memset(&arena->storage[arena->storage_used], 0, num);
+}
+
+template <typename T> T* PushType(ArenaId id, u64 num) {
+  return (T*)PushBytes(id, num * sizeof(T), alignof(T));
 }
 
 template <typename T> T* PushType(u64 num) {
-  u64 sz = num * sizeof(T);
-  assert(kMemory.storage_used + sz < kMemory.storage_size);
-  T* mem = (T*)&kMemory.storage[kMemory.storage_used];
-  kMemory.storage_used += sz;
-  return mem;
+  return PushType<T>(kPermanent, num);
 }
 
+// Does not give back padding PushType added for alignment. Prefer markers.
 template <typename T> void PopType(u64 num) {
-  u64 sz = num * sizeof(T);
-  assert(kMemory.storage_used >= sz);
-  kMemory.storage_used -= sz;
-  memset(&kMemory.storage[kMemory.storage_used], 0, sz);
+  PopBytes(num * sizeof(T));
+}
+
+Marker GetMarker(ArenaId id = kPermanent) {
+  Marker marker;
+  marker.arena = id;
+  marker.used = GetArena(id)->storage_used;
+  return marker;
 }
 
+// O(1) - released memory is not zeroed.
+void Rollback(Marker marker) {
+  Arena* arena = GetArena(marker.arena);
+  assert(marker.used <= arena->storage_used);
+  arena->storage_used = marker.used;
+}
+
+void ResetArena(ArenaId id) {
+  GetArena(id)->storage_used = 0;
+}
+
+// Rolls an arena back to where it was when the marker was created.
+struct ScopedMarker {
+  ScopedMarker(ArenaId id = kPermanent) : marker(GetMarker(id)) {}
+  ~ScopedMarker() { Rollback(marker); }
+  Marker marker;
+};
+
+void LogArenas() {
+  for (u32 i = 0; i < kArenaCount; ++i) {
+    const Arena* arena = GetArena((ArenaId)i);
+    if (!arena->storage) continue;
+    printf("arena %-10s used %10llu high water %10llu size %10llu\n",
+           arena->name, (unsigned long long)arena->storage_used,
+           (unsigned long long)arena->high_water,
+           (unsigned long long)arena->storage_size);
+  }
+}
+
+// std allocator drawing from an arena of the thread that created it. Memory
+// is released when the arena resets so deallocate is free. Falls back to the
+// heap on threads without the arena or when the arena is full.
+template <typename T, ArenaId kId>
+struct ArenaAllocator {
+  typedef T value_type;
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U, kId> other;
+  };
+
+  ArenaAllocator() : arena(GetArena(kId)) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U, kId>& other) : arena(other.arena) {}
+
+  T* allocate(size_t n) {
+    u8* mem = TryPushBytes(arena, n * sizeof(T), alignof(T));
+    if (mem) return (T*)mem;
+    mem = (u8*)malloc(n * sizeof(T));
+    if (!mem) throw std::bad_alloc();
+    return (T*)mem;
+  }
+
+  void deallocate(T* p, size_t n) {
+    u8* mem = (u8*)p;
+    if (mem >= arena->storage && mem < arena->storage + arena->storage_size) {
+      return;
+    }
+    free(mem);
+  }
+
+  Arena* arena;
+};
+
+template <typename T, typename U, ArenaId kId>
+bool operator==(const ArenaAllocator<T, kId>& a,
+                const ArenaAllocator<U, kId>& b) {
+  return a.arena == b.arena;
+}
+
+template <typename T, typename U, ArenaId kId>
+bool operator!=(const ArenaAllocator<T, kId>& a,
+                const ArenaAllocator<U, kId>& b) {
+  return a.arena != b.arena;
+}
+
+template <typename T>
+using FrameAllocator = ArenaAllocator<T, kFrame>;
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// For storage sized once that lives for the whole program. Growing one strands
+// its old block in the arena, use std::vector for anything that grows.
+template <typename T>
+using PermanentVector = std::vector<T, ArenaAllocator<T, kPermanent>>;
+
 }  // namespace memory
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Opt-in allocation tracking. Define MEMORY_TRACKING to 1 before including
+// memory.cc to count heap allocations, arena pushes and static pools by
+// subsystem. With it off the API remains but records nothing.
+//
+//   {
+//     memory::ScopedTag tag(memory::kTagPhysics);
+//     physics::Integrate(kFrameDelta);
+//   }
+//   memory::TrackerFrame();  // Once per frame.
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING 0
+#endif
+
+namespace memory {
+
+enum Tag : u32 {
+  kTagUntagged = 0,
+  kTagEcs = 1,
+  kTagPhysics = 2,
+  kTagRenderer = 3,
+  kTagImui = 4,
+  kTagLive = 5,
+  kTagCount = 6,
+};
+
+static const char* kTagNames[kTagCount] = {
+  "untagged", "ecs", "physics", "renderer", "imui", "live",
+};
+
+struct TagStats {
+  // Live heap allocations and the bytes they hold.
+  std::atomic<u64> count{0};
+  std::atomic<u64> bytes{0};
+  std::atomic<u64> peak_bytes{0};
+  // Heap allocations made since tracking started.
+  std::atomic<u64> total_count{0};
+  // Heap allocations made this frame and in the previous frame.
+  std::atomic<u64> frame_count{0};
+  std::atomic<u64> last_frame_count{0};
+  // Bytes pushed onto arenas. Arenas roll back in bulk so these aren't
+  // subtracted.
+  std::atomic<u64> arena_bytes{0};
+};
+
+// A DECLARE_ARRAY or DECLARE_HASH_ARRAY pool.
+struct TrackedPool {
+  const char* name = nullptr;
+  u64 bytes = 0;
+};
+
+constexpr u32 kMaxTrackedPools = 64;
+
+struct Tracker {
+  TagStats tags[kTagCount];
+  TrackedPool pools[kMaxTrackedPools] = {};
+  u32 pool_count = 0;
+};
+
+// Constant initialized so static pools and the operator new hook can use it
+// during static initialization.
+static Tracker kTracker;
+thread_local Tag kCurrentTag = kTagUntagged;
+
+// Allocations on this thread are attributed to tag until destroyed.
+struct ScopedTag {
+  ScopedTag(Tag tag) : previous(kCurrentTag) { kCurrentTag = tag; }
+  ~ScopedTag() { kCurrentTag = previous; }
+  Tag previous;
+};
+
+const TagStats* TrackerGetTag(Tag tag) {
+  assert(tag < kTagCount);
+  return &kTracker.tags[tag];
+}
+
+void _TrackAlloc(Tag tag, u64 bytes) {
+  TagStats* stats = &kTracker.tags[tag];
+  ++stats->count;
+  ++stats->total_count;
+  ++stats->frame_count;
+  u64 now = (stats->bytes += bytes);
+  u64 peak = stats->peak_bytes;
+  while (now > peak && !stats->peak_bytes.compare_exchange_weak(peak, now));
+}
+
+void _TrackFree(Tag tag, u64 bytes) {
+  TagStats* stats = &kTracker.tags[tag];
+  --stats->count;
+  stats->bytes -= bytes;
+}
+
+void TrackArenaPush(u64 bytes) {
+#if MEMORY_TRACKING
+  kTracker.tags[kCurrentTag].arena_bytes += bytes;
+#endif
+}
+
+struct TrackPool {
+  TrackPool(const char* name, u64 bytes) {
+    if (kTracker.pool_count >= kMaxTrackedPools) return;
+    kTracker.pools[kTracker.pool_count++] = {name, bytes};
+  }
+};
+
+// Rolls per frame allocation counts. Call once at the top of each frame.
+void TrackerFrame() {
+  for (u32 i = 0; i < kTagCount; ++i) {
+    TagStats* stats = &kTracker.tags[i];
+    stats->last_frame_count = stats->frame_count.exchange(0);
+  }
+}
+
+u32 TrackerPoolCount() {
+  return kTracker.pool_count;
+}
+
+const TrackedPool* TrackerGetPool(u32 i) {
+  assert(i < kTracker.pool_count);
+  return &kTracker.pools[i];
+}
+
+// Writes a plain text snapshot meant to be diffed between runs.
+b8 TrackerDump(const char* filename) {
+  FILE* f = fopen(filename, "w");
+  if (!f) return false;
+  fprintf(f, "%-10s %10s %12s %12s %12s %10s %12s\n", "tag", "count",
+          "bytes", "peak", "total", "frame", "arena");
+  for (u32 i = 0; i < kTagCount; ++i) {
+    const TagStats* stats = &kTracker.tags[i];
+    fprintf(f, "%-10s %10llu %12llu %12llu %12llu %10llu %12llu\n",
+            kTagNames[i], (unsigned long long)stats->count,
+            (unsigned long long)stats->bytes,
+            (unsigned long long)stats->peak_bytes,
+            (unsigned long long)stats->total_count,
+            (unsigned long long)stats->last_frame_count,
+            (unsigned long long)stats->arena_bytes);
+  }
+  fprintf(f, "\n%-24s %12s\n", "pool", "bytes");
+  for (u32 i = 0; i < kTracker.pool_count; ++i) {
+    fprintf(f, "%-24s %12llu\n", kTracker.pools[i].name,
+            (unsigned long long)kTracker.pools[i].bytes);
+  }
+  fclose(f);
+  return true;
+}
+
+}  // namespace memory
+
+#if MEMORY_TRACKING
+
+// Registers a static pool with the tracker. Used by DECLARE_ARRAY and
+// DECLARE_HASH_ARRAY for pools declared after this file is included.
+#undef TRACK_STATIC_POOL
+#define TRACK_STATIC_POOL(type, bytes) \
+  static memory::TrackPool kTrackPool##type(#type, bytes);
+
+// Heap hook. Each block is prefixed with its size and tag so frees are
+// attributed to the tag that allocated them.
+struct AllocHeader {
+  u64 bytes;
+  memory::Tag tag;
+};
+
+constexpr size_t kAllocHeaderSize = 16;
+static_assert(sizeof(AllocHeader) <= kAllocHeaderSize, "AllocHeader too big");
+
+void*
+operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+  u8* mem = (u8*)malloc(bytes + kAllocHeaderSize);
+  if (!mem) return nullptr;
+  AllocHeader* header = (AllocHeader*)mem;
+  header->bytes = bytes;
+  header->tag = memory::kCurrentTag;
+  memory::_TrackAlloc(header->tag, bytes);
+  return mem + kAllocHeaderSize;
+}
+
+void*
+operator new(size_t bytes)
+{
+  void* mem = operator new(bytes, std::nothrow);
+  if (!mem) throw std::bad_alloc();
+  return mem;
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  if (!ptr) return;
+  u8* mem = (u8*)ptr - kAllocHeaderSize;
+  AllocHeader* header = (AllocHeader*)mem;
+  memory::_TrackFree(header->tag, header->bytes);
+  free(mem);
+}
+
+void
+operator delete(void* ptr, size_t bytes) noexcept
+{
+  operator delete(ptr);
+}
+
+void
+operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+  operator delete(ptr);
+}
+
+void*
+operator new[](size_t bytes)
+{
+  return operator new(bytes);
+}
+
+void*
+operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+  return operator new(bytes, std::nothrow);
+}
+
+void
+operator delete[](void* ptr) noexcept
+{
+  operator delete(ptr);
+}
+
+void
+operator delete[](void* ptr, size_t bytes) noexcept
+{
+  operator delete(ptr);
+}
+
+void
+operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+  operator delete(ptr);
+}
+
+#endif
@@ -60,8 +60,18 @@ AIInitialize()
 {
 }
 
+// Uniform in [0, 1) for entity_id. seed is drawn once per update so
+// behaviors on worker threads don't share rand() state and come out the same
+// however entities are split across them.
+r32
+AIRandom(u32 seed, u32 entity_id)
+{
+  u32 hash = GetHash((const char*)&entity_id, sizeof(entity_id), seed);
+  return (hash >> 8) / 16777216.f;
+}
+
 void
-AIBehaviorPatrol(AIComponent* ai)
+AIBehaviorPatrol(AIComponent* ai, u32 seed)
 {
   const Patrol* patrol;
   if (!BB_GET(ai->blackboard, kAIBbPatrol, patrol)) return;
@@ -69,7 +79,7 @@ AIBehaviorPatrol(AIComponent* ai)
   physics::Particle2d* ai_particle = physics::FindParticle2d(
       ecs::GetPhysicsComponent(entity)->particle_id); 
   if (fabs(ai_particle->velocity.x) <= FLT_EPSILON) {
-    r32 r = math::Random(0.f, 1.f);
+    r32 r = AIRandom(seed, ai->entity_id);
     if (r < 0.5f) {
       ai_particle->acceleration.x = -kEnemyAcceleration;
     } else {
@@ -86,9 +96,9 @@ AIBehaviorPatrol(AIComponent* ai)
 }
 
 void
-AIBehaviorSimple(AIComponent* ai)
+AIBehaviorSimple(AIComponent* ai, u32 seed)
 {
-  AIBehaviorPatrol(ai);
+  AIBehaviorPatrol(ai, seed);
   // Head towards the player I guess?
   //physics::Particle2d* player_particle = PlayerParticle();
   //physics::Particle2d* ai_particle = FindParticle(c);
@@ -124,20 +134,24 @@ void
 AIUpdate()
 {
   if (!kEnableEnemies) return;
-  ECS_ITR1(itr, kAIComponent);
-  while (itr.Next()) {
-    const u32* behavior;
-    if (!BB_GET(itr.c.ai->blackboard,  kAIBbType, behavior)) continue;
-    switch (*behavior) {
-      case kBehaviorSimple: {
-        AIBehaviorSimple(itr.c.ai);
-      } break;
-      case kBehaviorSimpleFlying: {
-        AIBehaviorFlying(itr.c.ai);
-      } break;
-      default: {
-        printf("Unknown behavior entity %u\n", itr.e->id);
-      } break;
+  // Behaviors only write to the particle and character of their own entity.
+  u32 seed = rand();
+  ecs::ParallelFor<AIComponent>(32, [seed](ecs::Query<AIComponent>* itr) {
+    while (itr->Next()) {
+      AIComponent* ai = itr->Get<AIComponent>();
+      const u32* behavior;
+      if (!BB_GET(ai->blackboard,  kAIBbType, behavior)) continue;
+      switch (*behavior) {
+        case kBehaviorSimple: {
+          AIBehaviorSimple(ai, seed);
+        } break;
+        case kBehaviorSimpleFlying: {
+          AIBehaviorFlying(ai);
+        } break;
+        default: {
+          printf("Unknown behavior entity %u\n", itr->e->id);
+        } break;
+      }
     }
-  }
+  });
 }
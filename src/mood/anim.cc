@@ -163,9 +163,9 @@ AnimInitFireSpiritFSM(animation::FSM* fsm)
 void
 AnimUpdate()
 {
-  ECS_ITR1(itr, kAnimComponent);
+  ecs::Query<AnimComponent> itr;
   while (itr.Next()) {
-    itr.c.anim->fsm.Update(itr.e->id);
+    itr.Get<AnimComponent>()->fsm.Update(itr.e->id);
   }
 }
 
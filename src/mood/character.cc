@@ -20,11 +20,11 @@ CharacterInitialize()
 bool
 CharacterUpdate()
 {
-  ECS_ITR2(itr, kPhysicsComponent, kCharacterComponent);
+  ecs::Query<PhysicsComponent, CharacterComponent> itr;
   while (itr.Next()) {
     physics::Particle2d* particle =
-        physics::FindParticle2d(itr.c.physics->particle_id);
-    CharacterComponent* c = itr.c.character;
+        physics::FindParticle2d(itr.Get<PhysicsComponent>()->particle_id);
+    CharacterComponent* c = itr.Get<CharacterComponent>();
     AnimComponent* anim = ecs::GetAnimComponent(itr.e);
     Rectf caabb = particle->aabb();
     // Move character.
@@ -10,7 +10,7 @@ __CharacterProjectileCollision(CharacterComponent* character,
   assert(projectile);
   // If the particle created the projectile - ignore the collision.
   if (projectile->from_entity == character->entity_id) return;
-  ecs::AssignDeathComponent(projectile->entity_id);
+  ecs::kCommandBuffer.Assign<DeathComponent>(projectile->entity_id);
   character->health -= projectile->damage;
 }
 
@@ -22,7 +22,7 @@ __ProjectileParticleCollision(ProjectileComponent* projectile,
   assert(projectile);
   assert(particle);
   ecs::Entity* projectile_ent = ecs::FindEntity(projectile->entity_id);
-  ecs::AssignDeathComponent(projectile_ent);
+  ecs::kCommandBuffer.Assign<DeathComponent>(projectile->entity_id);
   physics::Particle2d* projectile_particle = physics::FindParticle2d(
       ecs::GetPhysicsComponent(projectile_ent)->particle_id);
   // Spawn effect flying off in opposite direction.
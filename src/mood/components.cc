@@ -105,11 +105,15 @@ struct ProjectileComponent {
 struct ObstacleComponent {
   u32 entity_id = 0;
   ObstacleType obstacle_type = kObstacleNone;
+  // Lower for map entities created earlier, see Sim::map_entities_created.
+  u32 sequence = 0;
 };
 
 struct SpawnerComponent {
   u32 entity_id = 0;
   SpawnerType spawner_type = kSpawnerNone;
+  // Lower for map entities created earlier, see Sim::map_entities_created.
+  u32 sequence = 0;
   // How many times the spawner should spawn the given character.
   u32 spawn_to_count = 1;
   // How many times the spawner has spawned the given character.
@@ -158,24 +162,6 @@ struct DamageComponent {
 
 }
 
-namespace ecs {
-
-struct Components {
-  mood::PhysicsComponent*          physics           = nullptr;
-  mood::AIComponent*               ai                = nullptr;
-  mood::CharacterComponent*        character         = nullptr;
-  mood::DeathComponent*            death             = nullptr;
-  mood::ProjectileComponent*       projectile        = nullptr;
-  mood::ObstacleComponent*         obstacle          = nullptr;
-  mood::SpawnerComponent*          spawner           = nullptr;
-  mood::ProjectileWeaponComponent* projectile_weapon = nullptr;
-  mood::AnimComponent*             anim              = nullptr;
-  mood::MeleeWeaponComponent*      melee_weapon      = nullptr;
-  mood::DamageComponent*           damage            = nullptr;
-};
-
-}
-
 #define ENTITY_COUNT 2048
 #include "ecs/ecs.cc"
 
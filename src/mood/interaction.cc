@@ -127,7 +127,7 @@ ProcessPlatformEvent(const PlatformEvent& event, const v2f cursor)
             kInteraction.selection.last_particle->dims.x += kTileHeight / 2.f;
             kInteraction.selection.last_particle->position.x +=
                 kTileHeight / 4.f;
-            physics::BPUpdateP2d(kInteraction.selection.last_particle);
+            physics::BPGridStaticChanged();
           }
         } break;
         case '9': {
@@ -135,7 +135,7 @@ ProcessPlatformEvent(const PlatformEvent& event, const v2f cursor)
             kInteraction.selection.last_particle->dims.x -= kTileHeight / 2.f;
             kInteraction.selection.last_particle->position.x -=
                 kTileHeight / 4.f;
-            physics::BPUpdateP2d(kInteraction.selection.last_particle);
+            physics::BPGridStaticChanged();
           }
         } break;
         case 43 /* Plus */: {
@@ -143,7 +143,7 @@ ProcessPlatformEvent(const PlatformEvent& event, const v2f cursor)
             kInteraction.selection.last_particle->dims.y += kTileHeight / 2.f;
             kInteraction.selection.last_particle->position.y +=
                 kTileHeight / 4.f;
-            physics::BPUpdateP2d(kInteraction.selection.last_particle);
+            physics::BPGridStaticChanged();
           }
         } break;
         case 45 /* Minus */: {
@@ -151,7 +151,7 @@ ProcessPlatformEvent(const PlatformEvent& event, const v2f cursor)
             kInteraction.selection.last_particle->dims.y -= kTileHeight / 2.f;
             kInteraction.selection.last_particle->position.y -=
                 kTileHeight / 4.f;
-            physics::BPUpdateP2d(kInteraction.selection.last_particle);
+            physics::BPGridStaticChanged();
           }
         } break;
         case '1': {
@@ -398,7 +398,8 @@ EntityViewer(v2f screen)
   imui::PaneOptions options;
   options.width = options.max_width = 315.f;
   options.max_height = 800.f;
-  imui::Begin("Entity Viewer", imui::kEveryoneTag, options, &pos, &enable);
+  imui::Begin(HASH_STR("Entity Viewer"), imui::kEveryoneTag, options,
+              &pos, &enable);
   for (u32 i = 0; i < ecs::kUsedEntity; ++i) {
     ecs::Entity* e = &ecs::kEntity[i];
     snprintf(kUIBuffer, kUIBufferSize, "Entity %u", e->id);
@@ -455,7 +456,8 @@ MapEditor(v2f screen)
   static v2f pos(screen.x - 615, screen.y);
   imui::PaneOptions options;
   options.width = options.max_width = 315.f;
-  imui::Begin("Map Editor", imui::kEveryoneTag, options, &pos, &enable);
+  imui::Begin(HASH_STR("Map Editor"), imui::kEveryoneTag, options,
+              &pos, &enable);
   if (enable) {
     kRenderSpawner = true;
     kRenderAabb = true;
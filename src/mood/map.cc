@@ -35,17 +35,33 @@ MapSave(const char* name)
               p->inverse_mass, p->flags, p->user_flags);
     }
   }
-  ECS_ITR1(spawner_itr, kSpawnerComponent);
+  // Entities are written in the order they were created, which for a loaded
+  // map is the order they were read, so saving doesn't shuffle the file.
+  std::vector<std::pair<u32, u32>> ids;
+  ecs::Query<SpawnerComponent> spawner_itr;
   while (spawner_itr.Next()) {
-    SpawnerComponent* s = spawner_itr.c.spawner;
-    physics::Particle2d* p = ecs::GetParticle(spawner_itr.e);
+    ids.push_back({spawner_itr.Get<SpawnerComponent>()->sequence,
+                   spawner_itr.e->id});
+  }
+  std::sort(ids.begin(), ids.end());
+  for (const std::pair<u32, u32>& sequence_id : ids) {
+    ecs::Entity* e = ecs::FindEntity(sequence_id.second);
+    SpawnerComponent* s = ecs::GetSpawnerComponent(e);
+    physics::Particle2d* p = ecs::GetParticle(e);
     fprintf(f, "s %.2f %.2f %u\n", p->position.x, p->position.y,
             s->spawner_type);
   }
-  ECS_ITR1(obstacle_itr, kObstacleComponent);
+  ids.clear();
+  ecs::Query<ObstacleComponent> obstacle_itr;
   while (obstacle_itr.Next()) {
-    ObstacleComponent* o = obstacle_itr.c.obstacle;
-    physics::Particle2d* p = ecs::GetParticle(obstacle_itr.e);
+    ids.push_back({obstacle_itr.Get<ObstacleComponent>()->sequence,
+                   obstacle_itr.e->id});
+  }
+  std::sort(ids.begin(), ids.end());
+  for (const std::pair<u32, u32>& sequence_id : ids) {
+    ecs::Entity* e = ecs::FindEntity(sequence_id.second);
+    ObstacleComponent* o = ecs::GetObstacleComponent(e);
+    physics::Particle2d* p = ecs::GetParticle(e);
     fprintf(f, "o %.2f %.2f %.2f %.2f %u\n",
             p->position.x, p->position.y, p->dims.x, p->dims.y,
             o->obstacle_type);
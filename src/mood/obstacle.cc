@@ -15,6 +15,7 @@ ObstacleCreate(v2f pos, v2f dims, ObstacleType type)
       SBIT(p->collision_mask, kCollisionMaskAI);
       ecs::AssignPhysicsComponent(entity)->particle_id = p->id;
       obstacle->obstacle_type = type;
+      obstacle->sequence = kSim.map_entities_created++;
       SBIT(p->flags, physics::kParticleIgnoreGravity);
       SBIT(p->flags, physics::kParticleIgnoreCollisionResolution);
       SBIT(p->user_flags, kParticleBoost);
@@ -31,9 +32,9 @@ ObstacleCreate(v2f pos, v2f dims, ObstacleType type)
 void
 ObstacleUpdate()
 {
-  ECS_ITR1(itr, kObstacleComponent);
+  ecs::Query<ObstacleComponent> itr;
   while (itr.Next()) {
-    ObstacleComponent* o = itr.c.obstacle;
+    ObstacleComponent* o = itr.Get<ObstacleComponent>();
     physics::Particle2d* p = ecs::GetParticle(itr.e);
     switch (o->obstacle_type) {
       case kObstacleBoost: {
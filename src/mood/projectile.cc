@@ -64,34 +64,36 @@ ProjectileCreate(v2f start, v2f dir, u32 from_entity,
 void
 ProjectileUpdate()
 {
-  ECS_ITR2(itr, kPhysicsComponent, kProjectileComponent);
-  while (itr.Next()) {
-    physics::Particle2d* particle =
-        physics::FindParticle2d(itr.c.physics->particle_id);
-    ProjectileComponent* p = itr.c.projectile;
-    if (particle) {
-      switch (p->projectile_type) {
-        case kProjectileLaser: {
-        } break;
-        case kProjectilePellet:
-        case kProjectileBullet: {
-          v2f delta = p->dir * p->speed;
-          particle->velocity = delta;
-        } break;
-        case kProjectileGrenade: {
-          v2f delta = p->dir * p->speed;
-          particle->velocity = delta;
-          particle->velocity.y -= physics::kPhysics.gravity * kFrameDelta;
-        } break;
-        default: break;
+  ecs::ParallelFor<PhysicsComponent, ProjectileComponent>(64,
+      [](ecs::Query<PhysicsComponent, ProjectileComponent>* itr) {
+    while (itr->Next()) {
+      physics::Particle2d* particle =
+          physics::FindParticle2d(itr->Get<PhysicsComponent>()->particle_id);
+      ProjectileComponent* p = itr->Get<ProjectileComponent>();
+      if (particle) {
+        switch (p->projectile_type) {
+          case kProjectileLaser: {
+          } break;
+          case kProjectilePellet:
+          case kProjectileBullet: {
+            v2f delta = p->dir * p->speed;
+            particle->velocity = delta;
+          } break;
+          case kProjectileGrenade: {
+            v2f delta = p->dir * p->speed;
+            particle->velocity = delta;
+            particle->velocity.y -= physics::kPhysics.gravity * kFrameDelta;
+          } break;
+          default: break;
+        }
       }
-    }
 
-    --p->ttl;
-    if (!p->ttl) {
-      ecs::AssignDeathComponent(itr.e);
+      --p->ttl;
+      if (!p->ttl) {
+        ecs::kCommandBuffer.Assign<DeathComponent>(itr->e->id);
+      }
     }
-  }
+  });
 }
 
 }
@@ -186,11 +186,11 @@ Render()
   }
 
   //physics::DebugRender(); 
-  ECS_ITR2(itr, kPhysicsComponent, kCharacterComponent);
+  ecs::Query<PhysicsComponent, CharacterComponent> itr;
   while (itr.Next()) {
     physics::Particle2d* p =
-      physics::FindParticle2d(itr.c.physics->particle_id);
-    CharacterComponent* c = itr.c.character;
+      physics::FindParticle2d(itr.Get<PhysicsComponent>()->particle_id);
+    CharacterComponent* c = itr.Get<CharacterComponent>();
     ecs::Entity* player = Player();
     AnimComponent* anim = ecs::GetAnimComponent(itr.e);
     if (player && player->id == c->entity_id) {
@@ -14,6 +14,9 @@ void ObstacleUpdate();  // Defined in obstacle.cc
 struct Sim {
   // Frame - incremented when SimUpdate is called.
   u64 frame = 0;
+  // Spawners and obstacles created so far. Each is stamped with the count as
+  // its sequence so maps save in creation order - entity ids are reused.
+  u32 map_entities_created = 0;
 };
 
 static Sim kSim;
@@ -30,6 +33,7 @@ static b8 kEditMode = false;
 void
 SimInitialize()
 {
+  util::WorkerPoolInitialize();
   PlayerInitialize();
   CharacterInitialize();
   AIInitialize();
@@ -59,6 +63,8 @@ SimUpdate()
   SpawnerUpdate();
   ProjectileUpdate();
   AIUpdate();
+  // Sync point for structural changes recorded by parallel systems.
+  ecs::kCommandBuffer.Execute();
 
   ecs::Entity* player = Player();
   if (player) {
@@ -77,21 +83,24 @@ SimUpdate()
   AnimUpdate();
 
   {
-    ECS_ITR1(itr, kDamageComponent);
+    ecs::Query<DamageComponent> itr;
     while (itr.Next()) {
       if (!itr.e) continue;
-      if (itr.c.damage->ttl) --itr.c.damage->ttl; 
-      if (itr.c.damage->ttl == 0) {
-        ecs::AssignDeathComponent(itr.e);
+      DamageComponent* damage = itr.Get<DamageComponent>();
+      if (damage->ttl) --damage->ttl; 
+      if (damage->ttl == 0) {
+        ecs::kCommandBuffer.Assign<DeathComponent>(itr.e->id);
       }
     }
+    // Apply deaths recorded by collisions and damage.
+    ecs::kCommandBuffer.Execute();
   }
 
   {
     // Cleanup entities marked to die at the end of each simulation update
     // frame. Particle for physics system will be destroyed at the top of the
     // next integration step.
-    ECS_ITR1(itr, kDeathComponent);
+    ecs::Query<DeathComponent> itr;
     while (itr.Next()) {
       // Just in case an entity got multiple death components.
       if (!itr.e) continue;
@@ -103,11 +112,6 @@ SimUpdate()
     ecs::GetComponents(kDeathComponent)->Clear();
   }
 
-  // TODO: Not entirely sure why this is needed. Without this - sometimes
-  // physics geometry can get into an invalid state where things tunnel
-  // through. *shrug*
-  physics::BPUpdateAll();
-
   return false;
 }
 
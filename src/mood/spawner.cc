@@ -26,6 +26,7 @@ SpawnerCreate(v2f pos, SpawnerType type)
           pos, v2f(5.f, 5.f), entity->id);
       ecs::AssignPhysicsComponent(entity)->particle_id = p->id;
       spawner->spawner_type = type;
+      spawner->sequence = kSim.map_entities_created++;
       SBIT(p->flags, physics::kParticleIgnoreGravity);
       SBIT(p->flags, physics::kParticleIgnoreCollisionResolution);
       SBIT(p->user_flags, kParticleSpawner);
@@ -45,9 +46,9 @@ SpawnerCreate(v2f pos, SpawnerType type)
 void
 SpawnerUpdate()
 {
-  ECS_ITR1(itr, kSpawnerComponent);
+  ecs::Query<SpawnerComponent> itr;
   while (itr.Next()) {
-    SpawnerComponent* s = itr.c.spawner;
+    SpawnerComponent* s = itr.Get<SpawnerComponent>();
     physics::Particle2d* p = GetParticle(itr.e);
     if (!util::FrameCooldownReady(&s->cooldown)) continue;
     if (s->spawn_count < s->spawn_to_count) {
@@ -1,6 +1,14 @@
 #pragma once
 
 // Implement sweep and prune against 2d particles.
+//
+// Each step the bounds of every particle are cached into arrays kept sorted
+// on min x. The order is carried over from the previous step so the insertion
+// sort that restores it only moves particles that crossed a neighbor. The
+// sweep then reads nothing but those arrays until it finds an overlap.
+//
+// kPhysics.broadphase selects the uniform grid in broadphase_grid.cc instead.
+// Both produce the same kBP2dCollision pairs.
 
 enum CollisionType {
   kCollisionTypeRect = 0,
@@ -18,221 +26,181 @@ struct BP2dCollision {
   Particle2d* p1;
   Particle2d* p2;
   CollisionType type;
-  union { 
+  union {
     Rectf rect_intersection;
     PolygonIntersection polygon_intersection;
   };
 };
 
-// Particles like blood and sparks really blow up collision counts.
-// Consider actually addressing that issue instead of increasing this
-// count by so much.
-DECLARE_ARRAY(BP2dCollision, PHYSICS_PARTICLE_COUNT * 4);
+DECLARE_GROWABLE_ARRAY(BP2dCollision, PHYSICS_PARTICLE_COUNT);
+
+// Particle bounds sorted on min_x. index is the particle's position in
+// kParticle2d, which is stable from the start of the sweep until particles
+// are next deleted at the top of Integrate.
+struct Broadphase {
+  r32 min_x[PHYSICS_PARTICLE_COUNT];
+  r32 max_x[PHYSICS_PARTICLE_COUNT];
+  r32 min_y[PHYSICS_PARTICLE_COUNT];
+  r32 max_y[PHYSICS_PARTICLE_COUNT];
+  // Twice the particle count - while seating, the last step's seats and the
+  // particles new this step can both be full.
+  u32 index[PHYSICS_PARTICLE_COUNT * 2];
+  u32 count;
+};
 
-u32
-BPGetNextId(u32 id)
-{
-  if (!id) return kInvalidId;
-  Particle2d* p = FindParticle2d(id);
-  if (!p) return kInvalidId;
-  return p->next_p2d_x;
-}
+static Broadphase kBroadphase;
 
+// Rebuilds the sorted bounds from kParticle2d.
 void
-BPDeleteP2d(Particle2d* p)
+BPSort()
 {
-  // If we are deleting the head adjust the head pointer.
-  if (p->id == kPhysics.p2d_head_x) {
-    kPhysics.p2d_head_x = BPGetNextId(kPhysics.p2d_head_x);
-  }
-
-  // Get the particles next and prev pointers - update their next and prev.
-  Particle2d* nextx = FindParticle2d(p->next_p2d_x);
-  Particle2d* prevx = FindParticle2d(p->prev_p2d_x);
-
-  if (nextx) {
-    if (prevx) nextx->prev_p2d_x = prevx->id;
-    else nextx->prev_p2d_x = kInvalidId;
+  Broadphase* bp = &kBroadphase;
+  // Seat particles in the order they had last step. Seats left by deleted
+  // particles are squeezed out and new particles go on the end.
+  u32 seats = bp->count;
+  for (u32 i = 0; i < seats; ++i) bp->index[i] = kBPNoOrder;
+  u32 n = seats;
+  for (u32 i = 0; i < kUsedParticle2d; ++i) {
+    u32 order = kParticle2d[i].bp_order;
+    if (order < seats && bp->index[order] == kBPNoOrder) {
+      bp->index[order] = i;
+    } else {
+      // Appended past the seats then moved down below.
+      bp->index[n++] = i;
+    }
   }
-
-  if (prevx) {
-    if (nextx) prevx->next_p2d_x = nextx->id;
-    else prevx->next_p2d_x = kInvalidId;
+  u32 count = 0;
+  for (u32 i = 0; i < n; ++i) {
+    if (bp->index[i] == kBPNoOrder) continue;
+    u32 idx = bp->index[i];
+    Rectf aabb = kParticle2d[idx].aabb();
+    bp->index[count] = idx;
+    bp->min_x[count] = aabb.x;
+    bp->max_x[count] = aabb.x + aabb.width;
+    bp->min_y[count] = aabb.y;
+    bp->max_y[count] = aabb.y + aabb.height;
+    ++count;
   }
-
-  // Swap the last and and current particle of the used list.
-  SwapParticle2d(p->id, kParticle2d[kUsedParticle2d - 1].id);
-  ClearParticle2d(kParticle2d[kUsedParticle2d - 1].id);
-
-  if (!kUsedParticle2d) {
-    kPhysics.p2d_head_x = kInvalidId;
+  bp->count = count;
+  // Insertion sort - particles rarely pass more than a neighbor or two per
+  // step so this is close to linear.
+  for (u32 i = 1; i < count; ++i) {
+    r32 min_x = bp->min_x[i];
+    if (bp->min_x[i - 1] <= min_x) continue;
+    r32 max_x = bp->max_x[i];
+    r32 min_y = bp->min_y[i];
+    r32 max_y = bp->max_y[i];
+    u32 idx = bp->index[i];
+    u32 j = i;
+    for (; j > 0 && bp->min_x[j - 1] > min_x; --j) {
+      bp->min_x[j] = bp->min_x[j - 1];
+      bp->max_x[j] = bp->max_x[j - 1];
+      bp->min_y[j] = bp->min_y[j - 1];
+      bp->max_y[j] = bp->max_y[j - 1];
+      bp->index[j] = bp->index[j - 1];
+    }
+    bp->min_x[j] = min_x;
+    bp->max_x[j] = max_x;
+    bp->min_y[j] = min_y;
+    bp->max_y[j] = max_y;
+    bp->index[j] = idx;
   }
+  for (u32 i = 0; i < count; ++i) kParticle2d[bp->index[i]].bp_order = i;
 }
 
-// Moves particle to between prev and next pointers.
+// Narrowphase for two particles whose cached bounds overlap.
 void
-__MoveP2d(Particle2d* p, Particle2d* prev, Particle2d* next)
+BPCollide(Particle2d* p1, const Rectf& p1aabb, Particle2d* p2,
+          const Rectf& p2aabb)
 {
-  // Consider the case where head must be updated.
-  // If p was head it is being moved forward. Its next is now head.
-  if (p->id == kPhysics.p2d_head_x) {
-    kPhysics.p2d_head_x = BPGetNextId(p->id);
-  }
-  // If p has the smallest x in the list it will become the new head.
-  Particle2d* head = FindParticle2d(kPhysics.p2d_head_x);
-  if (!head) return;
-  if (p->aabb().Min().x < head->aabb().Min().x) {
-    kPhysics.p2d_head_x = p->id;
+  Rectf rect_intersection;
+  if (!math::IntersectRect(p1aabb, p2aabb, &rect_intersection)) return;
+  // If there is rotation turn the rect into a polygon and use polygon
+  // intersection.
+  // TODO: Maybe someday allow arbitrary polygons.
+  if (p1->rotation != 0.f || p2->rotation != 0.f) {
+    Rectf p1rect(p1->position - p1->dims / 2.f, p1->dims);
+    Rectf p2rect(p2->position - p2->dims / 2.f, p2->dims);
+    v2f collision_start;
+    v2f collision_end;
+    if (!math::IntersectPolygon(
+          p1rect.Rotate(p1->rotation), p2rect.Rotate(p2->rotation),
+          &collision_start, &collision_end)) {
+      return;
+    }
+    BP2dCollision* collision = UseBP2dCollision();
+    collision->p1 = p1;
+    collision->p2 = p2;
+    collision->type = kCollisionTypePolygon;
+    collision->polygon_intersection.start = collision_start;
+    collision->polygon_intersection.end = collision_end;
+    return;
   }
-  // Swap all node pointers
-  Particle2d* particle_prev = FindParticle2d(p->prev_p2d_x);
-  if (particle_prev) particle_prev->next_p2d_x = p->next_p2d_x;
-  Particle2d* particle_next = FindParticle2d(p->next_p2d_x);
-  if (particle_next) particle_next->prev_p2d_x = p->prev_p2d_x;
-  if (prev) prev->next_p2d_x = p->id;
-  if (next) next->prev_p2d_x = p->id;
-  if (next) p->next_p2d_x = next->id;
-  if (prev) p->prev_p2d_x = prev->id;
+  BP2dCollision* collision = UseBP2dCollision();
+  collision->p1 = p1;
+  collision->p2 = p2;
+  collision->type = kCollisionTypeRect;
+  collision->rect_intersection = rect_intersection;
 }
 
-// Updates the particle to be sorted.
+// Collides the sorted entries i and j.
 void
-BPUpdateP2d(Particle2d* p)
+BPSweepCollide(u32 i, u32 j)
 {
-  // TODO: There is a weird bug with this where if there are only two 
-  // particles the next and prev pointers do not properly update. It doesn't
-  // cause an issue in functionality that I can discern but leaving this
-  // comment for documentation if it ever does.
-
-  // Updates particle position in sorted list if its x is now out of order.
-  Particle2d* prev = FindParticle2d(p->prev_p2d_x);
-  Particle2d* next = FindParticle2d(p->next_p2d_x);
-  Rectf paabb = p->aabb();
-  // Move the particle forward if needed.
-  while (next && paabb.Min().x > next->aabb().Min().x) {
-    prev = next;
-    next = FindParticle2d(next->next_p2d_x);
-  }
-  if (next && next->id != p->next_p2d_x) {
-    __MoveP2d(p, prev, next);
-  }
-  prev = FindParticle2d(p->prev_p2d_x);
-  next = FindParticle2d(p->next_p2d_x);
-  // Move the particle backward if needed.
-  while (prev && paabb.Min().x < prev->aabb().Min().x) {
-    next = prev;
-    prev = FindParticle2d(prev->prev_p2d_x);
-  }
-  if (prev && prev->id != p->prev_p2d_x) {
-    __MoveP2d(p, prev, next);
-  }
+  Broadphase* bp = &kBroadphase;
+  Rectf p1aabb(bp->min_x[i], bp->min_y[i], bp->max_x[i] - bp->min_x[i],
+               bp->max_y[i] - bp->min_y[i]);
+  Rectf p2aabb(bp->min_x[j], bp->min_y[j], bp->max_x[j] - bp->min_x[j],
+               bp->max_y[j] - bp->min_y[j]);
+  BPCollide(&kParticle2d[bp->index[i]], p1aabb, &kParticle2d[bp->index[j]],
+            p2aabb);
 }
 
 void
-BPInitP2d(Particle2d* particle)
+BPSweepCollisions()
 {
-  if (!kPhysics.p2d_head_x) {
-    kPhysics.p2d_head_x = particle->id;
-    return;
-  }
-
-  Particle2d* head = FindParticle2d(kPhysics.p2d_head_x);
-  if (!head) return;
-  Rectf paabb = particle->aabb();
-  if (paabb.Min().x < head->aabb().Min().x) {
-    head->prev_p2d_x = particle->id;
-    particle->next_p2d_x = head->id;
-    kPhysics.p2d_head_x = particle->id;
-    return;
-  }
-
-  Particle2d* prev = head;
-  Particle2d* next = FindParticle2d(head->next_p2d_x);
-  while (prev) {
-    if (!next) {
-      particle->prev_p2d_x = prev->id;
-      prev->next_p2d_x = particle->id;
-      break;
+  BPSort();
+  Broadphase* bp = &kBroadphase;
+  u32 n = bp->count;
+  for (u32 i = 0; i < n; ++i) {
+    r32 max_x = bp->max_x[i];
+    r32 min_y = bp->min_y[i];
+    r32 max_y = bp->max_y[i];
+    u32 j = i + 1;
+#if PHYSICS_SSE
+    // Four candidates at a time. Entries are sorted on min_x so the run
+    // ends at the first lane that starts past max_x.
+    __m128 v_max_x = _mm_set1_ps(max_x);
+    __m128 v_min_y = _mm_set1_ps(min_y);
+    __m128 v_max_y = _mm_set1_ps(max_y);
+    for (; j + 4 <= n; j += 4) {
+      __m128 x = _mm_cmplt_ps(_mm_loadu_ps(&bp->min_x[j]), v_max_x);
+      __m128 y = _mm_and_ps(
+          _mm_cmplt_ps(_mm_loadu_ps(&bp->min_y[j]), v_max_y),
+          _mm_cmpgt_ps(_mm_loadu_ps(&bp->max_y[j]), v_min_y));
+      s32 overlap = _mm_movemask_ps(_mm_and_ps(x, y));
+      for (u32 k = 0; overlap; ++k, overlap >>= 1) {
+        if (overlap & 1) BPSweepCollide(i, j + k);
+      }
+      if (_mm_movemask_ps(x) != 0xF) break;
     }
-    if (paabb.Min().x >= prev->aabb().Min().x &&
-        paabb.Min().x <= next->aabb().Min().x) {
-      particle->prev_p2d_x = prev->id;
-      particle->next_p2d_x = next->id;
-      next->prev_p2d_x = particle->id;
-      prev->next_p2d_x = particle->id;
-      break;
+    if (j + 4 <= n) continue;
+#endif
+    for (; j < n && bp->min_x[j] < max_x; ++j) {
+      if (bp->min_y[j] < max_y && bp->max_y[j] > min_y) BPSweepCollide(i, j);
     }
-    prev = next;
-    next = FindParticle2d(next->next_p2d_x);
   }
 }
 
+#include "broadphase_grid.cc"
+
 void
 BPCalculateCollisions()
 {
-  if (!kPhysics.p2d_head_x) return;
   kUsedBP2dCollision = 0;
-  // Detect all colliding particles.
-  Particle2d* p1 = FindParticle2d(kPhysics.p2d_head_x);
-  Particle2d* p2 = FindParticle2d(p1->next_p2d_x);
-  while (p1->next_p2d_x) {
-    if (!p2) {
-      p1 = FindParticle2d(p1->next_p2d_x);
-      p2 = FindParticle2d(p1->next_p2d_x);
-      continue;
-    }
-    Rectf rect_intersection;
-    Rectf p1aabb = p1->aabb();
-    Rectf p2aabb = p2->aabb();
-    if (math::IntersectRect(p1aabb, p2aabb, &rect_intersection)) {
-      // If there is rotation turn the rect into a polygon and use polygon
-      // intersection.
-      // TODO: Maybe someday allow arbitrary polygons.
-      if (p1->rotation != 0.f || p2->rotation != 0.f) {
-        Rectf p1rect(p1->position - p1->dims / 2.f, p1->dims);
-        Rectf p2rect(p2->position - p2->dims / 2.f, p2->dims);
-        v2f collision_start;
-        v2f collision_end;
-#if 0
-        math::Polygon<4> t1 = p1rect.Rotate(-p1->rotation);
-        math::Polygon<4> t2 = p2rect.Rotate(-p2->rotation);
-        for (s32 i = 0; i < t1.size(); ++i) {
-          rgg::DebugPushPoint(t1.Vertex(i), .2f, rgg::kWhite);
-          rgg::DebugPushPoint(t2.Vertex(i), .2f, rgg::kWhite);
-        }
-#endif
-        if (!math::IntersectPolygon(
-              p1rect.Rotate(p1->rotation), p2rect.Rotate(p2->rotation),
-              &collision_start, &collision_end)) {
-          p2 = FindParticle2d(p2->next_p2d_x);
-          continue;
-        }
-
-        BP2dCollision* collision = UseBP2dCollision();
-        collision->p1 = p1;
-        collision->p2 = p2;
-        collision->type = kCollisionTypePolygon;
-        collision->polygon_intersection.start = collision_start;
-        collision->polygon_intersection.end = collision_end;
-        p2 = FindParticle2d(p2->next_p2d_x);
-        continue;
-      } else {
-        BP2dCollision* collision = UseBP2dCollision();
-        collision->p1 = p1;
-        collision->p2 = p2;
-        collision->type = kCollisionTypeRect;
-        collision->rect_intersection = rect_intersection;
-        p2 = FindParticle2d(p2->next_p2d_x);
-        continue;
-      }
-    }
-    // If x axis intersects move p2 forward only, this may be a non
-    // intersecting y.
-    if (p2aabb.Min().x < p1aabb.Max().x) {
-      p2 = FindParticle2d(p2->next_p2d_x);
-    } else {
-      p1 = FindParticle2d(p1->next_p2d_x);
-      p2 = FindParticle2d(p1->next_p2d_x);
-    }
+  switch (kPhysics.broadphase) {
+    case kBroadphaseSweep: BPSweepCollisions(); break;
+    case kBroadphaseGrid: BPGridCollisions(); break;
+    default: break;
   }
 }
@@ -0,0 +1,273 @@
+#pragma once
+
+// Uniform grid broadphase. Cells are hashed into a fixed bucket table and
+// particles are bucketed with a counting sort each step, so nothing is
+// allocated once the entry arrays reach their working size.
+//
+// Particles with inverse_mass == 0 live in a separate static layer that is
+// only rebuilt when one is created or deleted, when the number of static
+// particles changes, or when BPGridStaticChanged is called. Pairs between two
+// static particles are found once per rebuild.
+//
+// A pair that spans several cells is reported only from the cell holding the
+// min corner of the pair's overlap.
+
+constexpr u32 kGridBucketCount = 4096;
+static_assert(POWEROF2(kGridBucketCount),
+              "kGridBucketCount must be a power of 2");
+
+struct GridEntry {
+  // Index into the layer's aabb and particle arrays.
+  u32 idx;
+  s32 cx;
+  s32 cy;
+};
+
+struct GridCells {
+  s32 x0, y0;
+  s32 x1, y1;
+};
+
+struct GridLayer {
+  // Entries in bucket b are entries[start[b]] to entries[start[b + 1] - 1].
+  u32 start[kGridBucketCount + 1];
+  std::vector<GridEntry> entries;
+  std::vector<Rectf> aabb;
+  // Cells each aabb covers.
+  std::vector<GridCells> cells;
+  // Index into kParticle2d for the dynamic layer. Particle id for the static
+  // layer, since static particles are shuffled in kParticle2d by deletes.
+  std::vector<u32> particle;
+};
+
+struct Grid {
+  GridLayer dynamic;
+  GridLayer statics;
+  // Scratch write cursor per bucket while bucketing.
+  u32 cursor[kGridBucketCount];
+  // Pairs of static layer indices that overlapped at the last rebuild.
+  std::vector<u32> static_pairs;
+  u32 static_count = 0;
+  r32 static_cell_size = 0.f;
+  b8 static_dirty = true;
+};
+
+static Grid kGrid;
+
+// Call after moving or resizing an infinite mass particle.
+void
+BPGridStaticChanged()
+{
+  kGrid.static_dirty = true;
+}
+
+void
+BPGridReset()
+{
+  kGrid.dynamic.entries.clear();
+  kGrid.dynamic.aabb.clear();
+  kGrid.dynamic.particle.clear();
+  kGrid.dynamic.cells.clear();
+  kGrid.statics.entries.clear();
+  kGrid.statics.aabb.clear();
+  kGrid.statics.particle.clear();
+  kGrid.statics.cells.clear();
+  kGrid.static_pairs.clear();
+  kGrid.static_count = 0;
+  kGrid.static_dirty = true;
+}
+
+u32
+BPGridBucket(s32 cx, s32 cy)
+{
+  return ((u32)cx * 73856093u ^ (u32)cy * 19349663u) & (kGridBucketCount - 1);
+}
+
+// floorf is a library call on baseline x64 and shows up in profiles here.
+s32
+BPGridFloor(r32 v)
+{
+  s32 i = (s32)v;
+  return i - (v < (r32)i);
+}
+
+GridCells
+BPGridCells(const Rectf& aabb, r32 inv_cell_size)
+{
+  GridCells cells;
+  cells.x0 = BPGridFloor(aabb.x * inv_cell_size);
+  cells.y0 = BPGridFloor(aabb.y * inv_cell_size);
+  cells.x1 = BPGridFloor((aabb.x + aabb.width) * inv_cell_size);
+  cells.y1 = BPGridFloor((aabb.y + aabb.height) * inv_cell_size);
+  return cells;
+}
+
+// Same test as math::IntersectRect without computing the intersection.
+b8
+BPGridOverlap(const Rectf& a, const Rectf& b)
+{
+  return a.x < b.x + b.width && b.x < a.x + a.width &&
+         a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// True if cell (cx, cy) is the one that reports the overlapping pair a, b.
+b8
+BPGridOwnsPair(const Rectf& a, const Rectf& b, s32 cx, s32 cy,
+               r32 inv_cell_size)
+{
+  return BPGridFloor(math::Max(a.x, b.x) * inv_cell_size) == cx &&
+         BPGridFloor(math::Max(a.y, b.y) * inv_cell_size) == cy;
+}
+
+// Collides with p1 as the particle with the smaller min x - the order the
+// sweep reports pairs in.
+void
+BPGridCollide(Particle2d* p1, const Rectf& a1, Particle2d* p2,
+              const Rectf& a2)
+{
+  if (a2.x < a1.x) BPCollide(p2, a2, p1, a1);
+  else BPCollide(p1, a1, p2, a2);
+}
+
+// Counting sort of the layer's aabbs into buckets.
+void
+BPGridBucketLayer(GridLayer* layer, r32 inv_cell_size)
+{
+  memset(layer->start, 0, sizeof(layer->start));
+  u32 n = layer->aabb.size();
+  layer->cells.resize(n);
+  for (u32 i = 0; i < n; ++i) {
+    GridCells c = BPGridCells(layer->aabb[i], inv_cell_size);
+    layer->cells[i] = c;
+    for (s32 cy = c.y0; cy <= c.y1; ++cy) {
+      for (s32 cx = c.x0; cx <= c.x1; ++cx) {
+        ++layer->start[BPGridBucket(cx, cy) + 1];
+      }
+    }
+  }
+  for (u32 b = 0; b < kGridBucketCount; ++b) {
+    layer->start[b + 1] += layer->start[b];
+    kGrid.cursor[b] = layer->start[b];
+  }
+  layer->entries.resize(layer->start[kGridBucketCount]);
+  for (u32 i = 0; i < n; ++i) {
+    GridCells c = layer->cells[i];
+    for (s32 cy = c.y0; cy <= c.y1; ++cy) {
+      for (s32 cx = c.x0; cx <= c.x1; ++cx) {
+        layer->entries[kGrid.cursor[BPGridBucket(cx, cy)]++] = {i, cx, cy};
+      }
+    }
+  }
+}
+
+// Calls f(i, j) with layer indices for each overlapping pair in the layer.
+template <typename F>
+void
+BPGridLayerPairs(const GridLayer& layer, r32 inv_cell_size, F f)
+{
+  for (u32 b = 0; b < kGridBucketCount; ++b) {
+    u32 end = layer.start[b + 1];
+    for (u32 i = layer.start[b]; i < end; ++i) {
+      const GridEntry& e1 = layer.entries[i];
+      const Rectf& a1 = layer.aabb[e1.idx];
+      for (u32 j = i + 1; j < end; ++j) {
+        const GridEntry& e2 = layer.entries[j];
+        // Different cells can share a bucket.
+        if (e1.cx != e2.cx || e1.cy != e2.cy) continue;
+        const Rectf& a2 = layer.aabb[e2.idx];
+        if (!BPGridOverlap(a1, a2)) continue;
+        if (!BPGridOwnsPair(a1, a2, e1.cx, e1.cy, inv_cell_size)) continue;
+        f(e1.idx, e2.idx);
+      }
+    }
+  }
+}
+
+void
+BPGridRebuildStatic(r32 inv_cell_size)
+{
+  GridLayer* layer = &kGrid.statics;
+  layer->aabb.clear();
+  layer->particle.clear();
+  for (u32 i = 0; i < kUsedParticle2d; ++i) {
+    Particle2d* p = &kParticle2d[i];
+    if (p->inverse_mass > 0.f) continue;
+    layer->aabb.push_back(p->aabb());
+    layer->particle.push_back(p->id);
+  }
+  BPGridBucketLayer(layer, inv_cell_size);
+  kGrid.static_pairs.clear();
+  BPGridLayerPairs(*layer, inv_cell_size, [](u32 i, u32 j) {
+    kGrid.static_pairs.push_back(i);
+    kGrid.static_pairs.push_back(j);
+  });
+  kGrid.static_count = layer->aabb.size();
+  kGrid.static_cell_size = kPhysics.grid_cell_size;
+  kGrid.static_dirty = false;
+}
+
+void
+BPGridCollisions()
+{
+  assert(kPhysics.grid_cell_size > 0.f);
+  r32 inv_cell_size = 1.f / kPhysics.grid_cell_size;
+  GridLayer* dynamic = &kGrid.dynamic;
+  GridLayer* statics = &kGrid.statics;
+  dynamic->aabb.clear();
+  dynamic->particle.clear();
+  u32 static_count = 0;
+  for (u32 i = 0; i < kUsedParticle2d; ++i) {
+    Particle2d* p = &kParticle2d[i];
+    if (p->inverse_mass <= 0.f) {
+      ++static_count;
+      continue;
+    }
+    dynamic->aabb.push_back(p->aabb());
+    dynamic->particle.push_back(i);
+  }
+  if (kGrid.static_dirty || static_count != kGrid.static_count ||
+      kGrid.static_cell_size != kPhysics.grid_cell_size) {
+    BPGridRebuildStatic(inv_cell_size);
+  }
+  BPGridBucketLayer(dynamic, inv_cell_size);
+
+  // Dynamic against dynamic.
+  BPGridLayerPairs(*dynamic, inv_cell_size, [dynamic](u32 i, u32 j) {
+    BPGridCollide(&kParticle2d[dynamic->particle[i]], dynamic->aabb[i],
+                  &kParticle2d[dynamic->particle[j]], dynamic->aabb[j]);
+  });
+
+  // Dynamic against static. Only the static buckets the particle covers are
+  // read.
+  u32 n = statics->aabb.empty() ? 0 : dynamic->aabb.size();
+  for (u32 i = 0; i < n; ++i) {
+    const Rectf& a1 = dynamic->aabb[i];
+    GridCells c = dynamic->cells[i];
+    for (s32 cy = c.y0; cy <= c.y1; ++cy) {
+      for (s32 cx = c.x0; cx <= c.x1; ++cx) {
+        u32 b = BPGridBucket(cx, cy);
+        u32 end = statics->start[b + 1];
+        for (u32 j = statics->start[b]; j < end; ++j) {
+          const GridEntry& e = statics->entries[j];
+          if (e.cx != cx || e.cy != cy) continue;
+          const Rectf& a2 = statics->aabb[e.idx];
+          if (!BPGridOverlap(a1, a2)) continue;
+          if (!BPGridOwnsPair(a1, a2, cx, cy, inv_cell_size)) continue;
+          Particle2d* p2 = FindParticle2d(statics->particle[e.idx]);
+          if (!p2) continue;
+          BPGridCollide(&kParticle2d[dynamic->particle[i]], a1, p2, a2);
+        }
+      }
+    }
+  }
+
+  // Static against static.
+  for (u32 i = 0; i < kGrid.static_pairs.size(); i += 2) {
+    u32 s1 = kGrid.static_pairs[i];
+    u32 s2 = kGrid.static_pairs[i + 1];
+    Particle2d* p1 = FindParticle2d(statics->particle[s1]);
+    Particle2d* p2 = FindParticle2d(statics->particle[s2]);
+    if (!p1 || !p2) continue;
+    BPGridCollide(p1, statics->aabb[s1], p2, statics->aabb[s2]);
+  }
+}
@@ -3,12 +3,24 @@
 #include "common/common.cc"
 #include "math/vec.h"
 #include "math/rect.h"
+#include "memory/memory.cc"
 #include "renderer/imui.cc"
 
-#include "util/scoped_expression.cc"
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PHYSICS_SSE 1
+#else
+#define PHYSICS_SSE 0
+#endif
 
 namespace physics {
 
+// bp_order of a particle the broadphase hasn't sorted yet.
+constexpr u32 kBPNoOrder = UINT32_MAX;
+
 enum ParticleFlags {
   // Ignores the force of gravity if it's enabled.
   kParticleIgnoreGravity = 0,
@@ -48,10 +60,9 @@ struct Particle2d {
   b8 on_ground = false;
   b8 on_wall = false;
 
-  // Particles keep forward and backward pointers so they can quickly sort
-  // themselves after updating.
-  u32 next_p2d_x = kInvalidId;
-  u32 prev_p2d_x = kInvalidId;
+  // Position in the broadphase's sorted bounds as of the last step. Lets the
+  // broadphase start each sort from the previous order.
+  u32 bp_order = kBPNoOrder;
 
   // Id to entity that contains this particle. Zero if not owned by an entity.
   u32 entity_id = 0;
@@ -83,29 +94,15 @@ struct Particle2d {
   Rectf
   aabb() const
   {
-    Rectf r = Rect();
-    if (rotation != 0.f) {
-      v2f sides[4];
-      r32 angle = rotation * PI / 180.0f;
-      r32 cos_a = cos(angle);
-      r32 sin_a = sin(angle);
-      sides[0] = math::Rotate(r.Min() - position, cos_a, sin_a);
-      sides[1] = math::Rotate(
-          v2f(r.x, r.y + r.height) - position, cos_a, sin_a);
-      sides[2] = math::Rotate(r.Max() - position, cos_a, sin_a);
-      sides[3] = math::Rotate(
-          v2f(r.x + r.width, r.y) - position, cos_a, sin_a);
-      v2f min(FLT_MAX, FLT_MAX);
-      v2f max(FLT_MIN, FLT_MIN);
-      for (s32 i = 0; i < 4; ++i) {
-        if (sides[i].x < min.x) min.x = sides[i].x;
-        if (sides[i].x > max.x) max.x = sides[i].x;
-        if (sides[i].y < min.y) min.y = sides[i].y;
-        if (sides[i].y > max.y) max.y = sides[i].y;
-      }
-      return math::MakeRect(position + min, position + max);
-    }
-    return r;
+    if (rotation == 0.f) return Rect();
+    // Half extents of the rotated rect projected back onto the axes.
+    r32 angle = rotation * PI / 180.0f;
+    r32 cos_a = fabs(cos(angle));
+    r32 sin_a = fabs(sin(angle));
+    v2f half = dims / 2.f;
+    v2f extent(half.x * cos_a + half.y * sin_a,
+               half.x * sin_a + half.y * cos_a);
+    return math::MakeRect(position - extent, position + extent);
   }
 
   r32
@@ -115,11 +112,21 @@ struct Particle2d {
   }
 };
 
+enum BroadphaseMode {
+  // Sweep and prune on x. Best when particles are spread along x.
+  kBroadphaseSweep = 0,
+  // Uniform grid. Holds up when many particles share an x range, like
+  // stacked colliders or a falling column.
+  kBroadphaseGrid = 1,
+};
+
 struct Physics {
   // Acceleration of gravity.
   r32 gravity = 1550.f;
-  // Linked list in sorted order on x / y axis for collision checks.
-  u32 p2d_head_x = kInvalidId;
+  BroadphaseMode broadphase = kBroadphaseSweep;
+  // Side length of a kBroadphaseGrid cell. Roughly the size of the common
+  // particle works best.
+  r32 grid_cell_size = 32.f;
   // If using DebugUI will render rectangles where collisions occur.
   b8 debug_render_collision = true;
 };
@@ -138,6 +145,8 @@ Reset()
   ResetParticle2d();
   kPhysics = {};
   kUsedBP2dCollision = 0;
+  kBroadphase.count = 0;
+  BPGridReset();
 }
 
 Particle2d*
@@ -147,7 +156,6 @@ CreateParticle2d(v2f pos, v2f dims, u32 entity_id = 0)
   particle->position = pos;
   particle->dims = dims;
   particle->entity_id = entity_id;
-  BPInitP2d(particle);
   return particle;
 }
 
@@ -158,7 +166,7 @@ CreateInfinteMassParticle2d(v2f pos, v2f dims)
   particle->position = pos;
   particle->dims = dims;
   particle->inverse_mass = 0.f;
-  BPInitP2d(particle);
+  BPGridStaticChanged();
   return particle;
 }
 
@@ -216,7 +224,6 @@ __ResolvePositionAndVelocity(
     }
     p->velocity.y = 0.f;
   }
-  BPUpdateP2d(p);
 }
 
 void
@@ -240,13 +247,15 @@ __SetOnWall(Particle2d* p, const Rectf& intersection)
 void
 Integrate(r32 dt_sec)
 {
+  memory::ScopedTag tag(memory::kTagPhysics);
 
   assert(dt_sec > 0.f);
   // Delete any particles that must be deleted for this integration step.
   for (u32 i = 0; i < kUsedParticle2d;) {
     Particle2d* p = &kParticle2d[i];
     if (FLAGGED(p->flags, kParticleRemove) || p->ttl == 0) {
-      BPDeleteP2d(p);
+      if (p->inverse_mass <= 0.f) BPGridStaticChanged();
+      SwapAndClearParticle2d(p->id);
       continue;
     }
     if (p->ttl != UINT32_MAX) {
@@ -288,8 +297,6 @@ Integrate(r32 dt_sec)
     if (p->disable_gravity_ttl) {
       --p->disable_gravity_ttl;
     }
-
-    BPUpdateP2d(p);
   }
 
   BPCalculateCollisions();
@@ -298,11 +305,6 @@ Integrate(r32 dt_sec)
   for (u32 i = 0; i < kUsedBP2dCollision; ++i) {
     BP2dCollision* c = &kBP2dCollision[i];
 
-    util::ScopedExpression expr([c]() {
-      BPUpdateP2d(c->p1);
-      BPUpdateP2d(c->p2);
-    });
-
     // If either particle completely ignore collision continue.
     if (FLAGGED(c->p1->flags, kParticleIgnoreCollisionResolution)) continue;
     if (FLAGGED(c->p2->flags, kParticleIgnoreCollisionResolution)) continue;
@@ -358,7 +360,6 @@ void
 SetRotation(Particle2d* p, r32 rotation)
 {
   p->rotation = rotation;
-  BPUpdateP2d(p);
 }
 
 void
@@ -368,14 +369,6 @@ Rotate(Particle2d* p, r32 delta)
   SetRotation(p, p->rotation + delta);
 }
 
-void
-BPUpdateAll()
-{
-  for (u32 i = 0; i < kUsedParticle2d; ++i) {
-    BPUpdateP2d(&kParticle2d[i]);
-  }
-}
-
 void
 DebugUI(v2f screen, b8* enable)
 {
@@ -385,20 +378,22 @@ DebugUI(v2f screen, b8* enable)
   imui::PaneOptions options;
   options.width = options.max_width = 365.f;
   options.max_height = 500.f;
-  imui::Begin("Physics", imui::kEveryoneTag, options, &physics_pos, enable);
+  imui::Begin(HASH_STR("Physics"), imui::kEveryoneTag, options,
+              &physics_pos, enable);
   static const r32 kWidth = 130.f;
   imui::SameLine();
   imui::Text("Render Collision");
   imui::Checkbox(16.f, 16.f, &kPhysics.debug_render_collision);
   imui::NewLine();
+  imui::SameLine();
+  imui::Text("Grid Broadphase");
+  b8 grid = kPhysics.broadphase == kBroadphaseGrid;
+  imui::Checkbox(16.f, 16.f, &grid);
+  kPhysics.broadphase = grid ? kBroadphaseGrid : kBroadphaseSweep;
+  imui::NewLine();
   snprintf(kUIBuffer, kUIBufferSize, "%u", kUsedBP2dCollision);
   imui::Text(kUIBuffer);
   imui::NewLine();
-  imui::SameLine();
-  imui::Width(80);
-  imui::Text("X Head");
-  snprintf(kUIBuffer, kUIBufferSize, "%u", kPhysics.p2d_head_x);
-  imui::Text(kUIBuffer);
   imui::NewLine();
   imui::SameLine();
   imui::Width(80);
@@ -416,19 +411,27 @@ DebugUI(v2f screen, b8* enable)
   imui::NewLine();
   for (u32 i = 0; i < kUsedParticle2d; ++i) {
     Particle2d* p = &kParticle2d[i];
+    v2f dims = p->dims;
+    r32 inverse_mass = p->inverse_mass;
     imui::SameLine();
     imui::Width(80);
     imui::TextOptions o;
     o.highlight_color = rgg::kRed;
     if (imui::Text("Particle", o).highlighted) {
       rgg::DebugPushRect(p->aabb(), rgg::kGreen);
-      if (p->next_p2d_x) {
-        rgg::DebugPushRect(
-            FindParticle2d(p->next_p2d_x)->aabb(), rgg::kBlue);
+      // Neighbors in the broadphase sort.
+      u32 order = p->bp_order;
+      if (order != kBPNoOrder && order + 1 < kBroadphase.count) {
+        u32 next = kBroadphase.index[order + 1];
+        if (next < kUsedParticle2d) {
+          rgg::DebugPushRect(kParticle2d[next].aabb(), rgg::kBlue);
+        }
       }
-      if (p->prev_p2d_x) {
-        rgg::DebugPushRect(
-            FindParticle2d(p->prev_p2d_x)->aabb(), rgg::kPurple);
+      if (order != kBPNoOrder && order > 0 && order < kBroadphase.count) {
+        u32 prev = kBroadphase.index[order - 1];
+        if (prev < kUsedParticle2d) {
+          rgg::DebugPushRect(kParticle2d[prev].aabb(), rgg::kPurple);
+        }
       }
     }
     snprintf(kUIBuffer, kUIBufferSize, "%u", p->id);
@@ -440,14 +443,8 @@ DebugUI(v2f screen, b8* enable)
     }
     imui::SameLine();
     imui::Width(kWidth);
-    imui::Text("Next");
-    snprintf(kUIBuffer, kUIBufferSize, "%u", p->next_p2d_x);
-    imui::Text(kUIBuffer);
-    imui::NewLine();
-    imui::SameLine();
-    imui::Width(kWidth);
-    imui::Text("Prev");
-    snprintf(kUIBuffer, kUIBufferSize, "%u", p->prev_p2d_x);
+    imui::Text("Sort Order");
+    snprintf(kUIBuffer, kUIBufferSize, "%u", p->bp_order);
     imui::Text(kUIBuffer);
     imui::NewLine();
     imui::SameLine();
@@ -583,29 +580,42 @@ DebugUI(v2f screen, b8* enable)
     }
     imui::NewLine();
     imui::Indent(0);
-    BPUpdateP2d(p);
+    // Resizing a static particle, or making one static or dynamic, changes
+    // the static broadphase layer.
+    b8 was_static = inverse_mass <= 0.f;
+    b8 is_static = p->inverse_mass <= 0.f;
+    if ((was_static || is_static) &&
+        (p->dims != dims || p->inverse_mass != inverse_mass)) {
+      BPGridStaticChanged();
+    }
   }
   imui::End();
 }
 
+// Collision debug rendering can run to thousands of rects a frame.
+static rgg::RenderQueue kDebugRenderQueue;
+
 void
 DebugRender()
 {
   if (kPhysics.debug_render_collision) {
+    rgg::RenderQueue* queue = &kDebugRenderQueue;
+    rgg::SetRenderObserver(queue, *rgg::GetObserver());
     for (u32 i = 0; i < kUsedBP2dCollision; ++i) {
       BP2dCollision* c = &kBP2dCollision[i];
       switch (c->type) {
         case kCollisionTypeRect: {
-          rgg::RenderLineRectangle(c->rect_intersection, rgg::kWhite);
+          rgg::RenderLineRectangle(queue, c->rect_intersection, rgg::kWhite);
         } break;
         case kCollisionTypePolygon: {
           rgg::RenderLine(
-              c->polygon_intersection.start, c->polygon_intersection.end,
-              rgg::kWhite);
+              queue, c->polygon_intersection.start,
+              c->polygon_intersection.end, rgg::kWhite);
         } break;
         default: break;
       }
     }
+    rgg::SubmitRenderQueue(queue);
   }
 }
 
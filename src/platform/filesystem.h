@@ -77,6 +77,23 @@ void WalkDirectory(const std::string& dir, const std::function<void(const char*,
 void ChangeDirectory(const char* dir);
 const char* GetWorkingDirectory();
 
+// A read only view of a whole file mapped into memory.
+struct MappedFile {
+  const u8* data = nullptr;
+  u64 size = 0;
+#ifdef _WIN32
+  void* file = nullptr;
+  void* mapping = nullptr;
+#endif
+};
+
+b8 MapFile(const char* name, MappedFile* file);
+void UnmapFile(MappedFile* file);
+
+// Size and a last modified stamp for name. Stamps only compare for equality -
+// their units differ between platforms.
+b8 GetFileInfo(const char* name, u64* size, u64* modified);
+
 // Check if the current working directory contains a specific directory.
 inline b8 WorkingDirectoryContains(const char* dir) {
   b8 contains = false;
@@ -23,6 +23,18 @@ struct Mutex {
 #endif
 };
 
+// Counting semaphore. Unix uses a mutex / condition variable pair since
+// unnamed posix semaphores are unsupported on macos.
+struct Semaphore {
+#ifdef _WIN32
+  HANDLE handle = 0;
+#else
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  u32 count = 0;
+#endif
+};
+
 namespace platform
 {
 
@@ -37,6 +49,13 @@ void MutexLock(Mutex* m);
 void MutexUnlock(Mutex* m);
 void MutexFree(Mutex* m);
 
+b8 SemaphoreCreate(Semaphore* s, u32 initial_count = 0);
+// Blocks until the count is non-zero then decrements it.
+void SemaphoreWait(Semaphore* s);
+// Increments the count by n waking up to n waiters.
+void SemaphorePost(Semaphore* s, u32 n = 1);
+void SemaphoreFree(Semaphore* s);
+
 }  // namespace platform
 
 struct LockGuard {
@@ -2,6 +2,8 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -46,6 +48,42 @@ const char* GetWorkingDirectory() {
   return cwd;
 }
 
+b8 MapFile(const char* name, MappedFile* file) {
+  *file = {};
+  s32 fd = open(name, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file.
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  file->data = (const u8*)data;
+  file->size = st.st_size;
+  return true;
+}
+
+void UnmapFile(MappedFile* file) {
+  if (file->data) munmap((void*)file->data, file->size);
+  *file = {};
+}
+
+b8 GetFileInfo(const char* name, u64* size, u64* modified) {
+  struct stat st;
+  if (stat(name, &st) < 0) return false;
+  *size = st.st_size;
+#ifdef __APPLE__
+  const timespec& mtime = st.st_mtimespec;
+#else
+  const timespec& mtime = st.st_mtim;
+#endif
+  *modified = (u64)mtime.tv_sec * 1000000000ull + mtime.tv_nsec;
+  return true;
+}
+
 std::string Filename(const char* fullname) {
   s32 sz = strlen(fullname);
   s32 i = sz - 1;
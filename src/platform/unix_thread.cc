@@ -100,4 +100,53 @@ MutexFree(Mutex* m)
   pthread_mutex_destroy(&m->lock);
 }
 
+b8
+SemaphoreCreate(Semaphore* s, u32 initial_count)
+{
+  int res = pthread_mutex_init(&s->lock, nullptr);
+  if (res) {
+    printf("semaphore_create error: %d\n", res);
+    return false;
+  }
+  res = pthread_cond_init(&s->cond, nullptr);
+  if (res) {
+    printf("semaphore_create error: %d\n", res);
+    pthread_mutex_destroy(&s->lock);
+    return false;
+  }
+  s->count = initial_count;
+  return true;
+}
+
+void
+SemaphoreWait(Semaphore* s)
+{
+  pthread_mutex_lock(&s->lock);
+  while (!s->count) {
+    pthread_cond_wait(&s->cond, &s->lock);
+  }
+  --s->count;
+  pthread_mutex_unlock(&s->lock);
+}
+
+void
+SemaphorePost(Semaphore* s, u32 n)
+{
+  pthread_mutex_lock(&s->lock);
+  s->count += n;
+  pthread_mutex_unlock(&s->lock);
+  if (n == 1) {
+    pthread_cond_signal(&s->cond);
+  } else {
+    pthread_cond_broadcast(&s->cond);
+  }
+}
+
+void
+SemaphoreFree(Semaphore* s)
+{
+  pthread_cond_destroy(&s->cond);
+  pthread_mutex_destroy(&s->lock);
+}
+
 }  // namespace platform
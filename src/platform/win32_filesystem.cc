@@ -86,4 +86,49 @@ std::string SanitizePath(const std::string& path) {
   return copy;
 }
 
+b8 MapFile(const char* name, MappedFile* file) {
+  *file = {};
+  HANDLE handle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+    CloseHandle(handle);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(handle);
+    return false;
+  }
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    CloseHandle(handle);
+    return false;
+  }
+  file->data = (const u8*)data;
+  file->size = size.QuadPart;
+  file->file = handle;
+  file->mapping = mapping;
+  return true;
+}
+
+void UnmapFile(MappedFile* file) {
+  if (file->data) UnmapViewOfFile(file->data);
+  if (file->mapping) CloseHandle(file->mapping);
+  if (file->file) CloseHandle(file->file);
+  *file = {};
+}
+
+b8 GetFileInfo(const char* name, u64* size, u64* modified) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(name, GetFileExInfoStandard, &data)) return false;
+  *size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+  *modified = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) |
+              data.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
 }  // namespace filesystem
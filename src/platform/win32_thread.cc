@@ -75,4 +75,35 @@ void MutexFree(Mutex* m) {
   CloseHandle(m->handle);
 }
 
+b8 SemaphoreCreate(Semaphore* s, u32 initial_count) {
+  s->handle = CreateSemaphore(
+      nullptr,        // Default security attributes.
+      initial_count,  // Initial count.
+      LONG_MAX,       // Maximum count.
+      nullptr);       // Unnamed semaphore.
+
+  if (!s->handle) {
+    printf("semaphore_create error: %d\n", GetLastError());
+    return false;
+  }
+
+  return true;
+}
+
+void SemaphoreWait(Semaphore* s) {
+  if (WaitForSingleObject(s->handle, INFINITE) == WAIT_FAILED) {
+    printf("semaphore_wait error: %d\n", GetLastError());
+  }
+}
+
+void SemaphorePost(Semaphore* s, u32 n) {
+  if (!ReleaseSemaphore(s->handle, n, nullptr)) {
+    printf("semaphore_post error: %d\n", GetLastError());
+  }
+}
+
+void SemaphoreFree(Semaphore* s) {
+  CloseHandle(s->handle);
+}
+
 }  // namespace platform
@@ -68,8 +68,8 @@ DebugUI()
     static r32 right_align = 130.f;
     imui::PaneOptions options;
     options.max_width = 315.f;
-    imui::Begin("Diagnostics", imui::kEveryoneTag, options, &diagnostics_pos,
-                &enable_debug);
+    imui::Begin(HASH_STR("Diagnostics"), imui::kEveryoneTag, options,
+                &diagnostics_pos, &enable_debug);
     imui::TextOptions debug_options;
     debug_options.color = imui::kWhite;
     debug_options.highlight_color = imui::kRed;
@@ -103,6 +103,35 @@ DebugUI()
     imui::NewLine();
     imui::SameLine();
     imui::Width(right_align);
+    imui::Text("Sprites");
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%u in %u draws ",
+             rgg::kSpriteBatch.last_frame.sprites,
+             rgg::kSpriteBatch.last_frame.draw_calls);
+    imui::Text(kUIBuffer);
+    if (imui::Text(rgg::kSpriteBatch.enabled ? "batched" : "unbatched",
+                   debug_options).clicked) {
+      rgg::kSpriteBatch.enabled = !rgg::kSpriteBatch.enabled;
+    }
+    imui::NewLine();
+    imui::SameLine();
+    imui::Width(right_align);
+    imui::Text("Text");
+    snprintf(kUIBuffer, sizeof(kUIBuffer), "%u glyphs in %u draws",
+             rgg::kUI.last_frame.glyphs, rgg::kUI.last_frame.draw_calls);
+    imui::Text(kUIBuffer);
+    imui::NewLine();
+    imui::SameLine();
+    imui::Width(right_align);
+    imui::Text("Textures");
+    const rgg::TextureLoadStats& loads = rgg::kTextureLoads.stats;
+    snprintf(kUIBuffer, sizeof(kUIBuffer),
+             "%u loading %u loaded decode %.1fms upload %.1fms",
+             loads.pending, loads.loaded, loads.decode_usec / 1000.f,
+             loads.upload_usec / 1000.f);
+    imui::Text(kUIBuffer);
+    imui::NewLine();
+    imui::SameLine();
+    imui::Width(right_align);
     imui::Text("Game Speed");
     if (imui::Text("60 ", debug_options).clicked) {
       SetFramerate(60);
@@ -223,6 +252,7 @@ GameRender(v2f dims)
   rgg::DebugRenderUIPrimitives();
 
   imui::Render(imui::kEveryoneTag);
+  rgg::EndFrame();
   window::SwapBuffers();
 }
 
@@ -273,6 +303,7 @@ main(s32 argc, char** argv)
 
   while (1) {
     platform::ClockStart(&kGameState.game_clock);
+    memory::ResetArena(memory::kFrame);
 
     imui::ResetTag(imui::kEveryoneTag);
     rgg::DebugReset();
@@ -14,13 +14,28 @@ public:
 
 void Anim::Initialize(const proto::Entity2d& proto_entity) {
   if (proto_entity.animation_size() == 0)
-    return nullptr;
-  for (const proto::Entity2d::Animation& proto_anim : proto_entity.animation()) {
-    AnimSequence2d& anim_sequence = sequence_map_[(u32)proto_anim.type()];
-    if (!AnimSequence2d::LoadFromProtoFile(proto_anim.animation_file(), &anim_sequence)) {
+    return;
+  std::vector<proto::Animation2d> protos(proto_entity.animation_size());
+  std::vector<std::string> assets;
+  for (s32 i = 0; i < proto_entity.animation_size(); ++i) {
+    const proto::Entity2d::Animation& proto_anim = proto_entity.animation(i);
+    std::fstream inp(proto_anim.animation_file(), std::ios::in | std::ios::binary);
+    if (!protos[i].ParseFromIstream(&inp)) {
       LOG(ERR, "Error loading animation %s", proto_anim.animation_file().c_str());
       continue;
     }
+    for (const proto::AnimationFrame2d& pframe : protos[i].frames()) {
+      assets.push_back(filesystem::SanitizePath(pframe.asset_name()));
+    }
+  }
+  // Pack every frame's image so the entity's animations share a texture.
+  rgg::BuildTextureAtlas(assets);
+  for (s32 i = 0; i < proto_entity.animation_size(); ++i) {
+    const proto::Entity2d::Animation& proto_anim = proto_entity.animation(i);
+    if (!protos[i].frames_size()) continue;
+    AnimSequence2d& anim_sequence = sequence_map_[(u32)proto_anim.type()];
+    anim_sequence = AnimSequence2d::LoadFromProto(protos[i]);
+    anim_sequence.file_ = proto_anim.animation_file();
     anim_sequence.alignment_ = v2f(proto_anim.alignment_x(), proto_anim.alignment_y());
   }
   current_sequence_ = FindOrNull(sequence_map_, (u32)proto::Entity2d::Animation::kIdle);
@@ -57,6 +57,8 @@ public:
   void OnRender() override;
   void OnImGui() override;
   void OnFileSelected(const std::string& filename) override;
+  // Characters move every frame.
+  bool IsAnimating() override { return true; }
   void LoadMap(const std::string& filename);
   void ChangeScale(r32 delta);
   void Main();
@@ -30,7 +30,12 @@ static void ImGuiImplNewFrame() {
   ImGui_ImplOpenGL3_NewFrame();
 }
 
+namespace rgg {
+void FlushBatches();
+}
+
 static void ImGuiImplRenderDrawData() {
+  rgg::FlushBatches();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
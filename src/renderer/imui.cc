@@ -243,6 +243,8 @@ struct IMUI {
   u32 button_circle_exhaustion[kMaxTags];
   b8 debug_show_details[kMaxTags];
   b8 debug_enabled = false;
+  // Kept across frames so recording doesn't allocate.
+  rgg::RenderQueue render_queue;
 };
 
 static IMUI kIMUI;
@@ -341,6 +343,7 @@ MouseDelta()
 void
 SetScissorWithPane(const Pane& pane, const v2f& viewport, b8 ignore_scissor)
 {
+  rgg::FlushBatches();
   if (ignore_scissor) {
     glScissor(0, 0, viewport.x, viewport.y);
   } else {
@@ -367,6 +370,7 @@ IsRectHighlighted(Rectf rect)
 void
 Render(u32 tag)
 {
+  rgg::FlushBatches();
   glDisable(GL_DEPTH_TEST);
   auto dims = window::GetWindowSize();
   // printf("dims(%.2f, %.2f)\n", dims.x, dims.y);
@@ -390,37 +394,49 @@ Render(u32 tag)
   kIMUI.button_exhaustion[tag] = kUsedButton[tag];
   kIMUI.button_circle_exhaustion[tag] = kUsedButtonCircle[tag];
 
+  // Shapes are queued so each kind draws instanced. Textures and text are
+  // batched separately so the queue is submitted before them.
+  rgg::RenderQueue* queue = &kIMUI.render_queue;
+  rgg::SetRenderObserver(queue, *rgg::GetObserver());
+  // Panes overlap so each gets its own layers. The scroll bar draws over the
+  // pane's outline.
+  u8 layer = 0;
   for (int i = 0; i < kUsedPane; ++i) {
     Pane* pane = &kPane[i];
     if (pane->tag != tag) continue;
-    rgg::RenderRectangle(pane->rect, pane->options.color);
-    rgg::RenderRectangle(pane->header_rect, kPaneHeaderColor);
+    rgg::SetRenderLayer(queue, layer++);
+    rgg::RenderRectangle(queue, pane->rect, pane->options.color);
+    rgg::RenderRectangle(queue, pane->header_rect, kPaneHeaderColor);
     rgg::RenderLineRectangle(
-        pane->rect, v4f(0.2f, 0.2f, 0.2f, 0.7f));
+        queue, pane->rect, v4f(0.2f, 0.2f, 0.2f, 0.7f));
+    rgg::SetRenderLayer(queue, layer++);
     if (FLAGGED(pane->flags, kPaneHasScroll) &&
         !FLAGGED(pane->flags, kPaneHidden)) {
       if (FLAGGED(pane->flags, kPaneIsScrolling)) {
-        rgg::RenderRectangle(pane->scroll_rect, kScrollSelectedColor);
+        rgg::RenderRectangle(queue, pane->scroll_rect, kScrollSelectedColor);
       } else if (IsRectHighlighted(pane->scroll_rect)) {
-        rgg::RenderRectangle(pane->scroll_rect, kScrollHighlightedColor);
+        rgg::RenderRectangle(queue, pane->scroll_rect,
+                             kScrollHighlightedColor);
       } else {
-        rgg::RenderRectangle(pane->scroll_rect, kScrollColor);
+        rgg::RenderRectangle(queue, pane->scroll_rect, kScrollColor);
       }
     }
   }
 
+  rgg::SetRenderLayer(queue, layer++);
   for (int i = 0; i < kUsedButton[tag]; ++i) {
     Button* button = &kButton[tag][i];
     //SetScissorWithPane(*button->pane, dims, false);
-    rgg::RenderLineRectangle(button->rect, button->color);
+    rgg::RenderLineRectangle(queue, button->rect, button->color);
   }
 
   for (int i = 0; i < kUsedButtonCircle[tag]; ++i) {
     ButtonCircle* button = &kButtonCircle[tag][i];
     //SetScissorWithPane(*button->pane, dims,
     //                   button->options.ignore_scissor_test);
-    rgg::RenderCircle(button->position, button->radius, button->color);
+    rgg::RenderCircle(queue, button->position, button->radius, button->color);
   }
+  rgg::SubmitRenderQueue(queue);
 
   for (int i = 0; i < kUsedTexture[tag]; ++i) {
     Texture* texture = &kTexture[tag][i];
@@ -428,26 +444,28 @@ Render(u32 tag)
     rgg::RenderTexture(texture->texture_id, texture->subrect, texture->rect);
   }
 
+  rgg::SetRenderObserver(queue, *rgg::GetObserver());
   for (int i = 0; i < kUsedCheckbox[tag]; ++i) {
     Checkbox* cb = &kCheckbox[tag][i];
     //SetScissorWithPane(*cb->pane, dims, false);
-    rgg::RenderLineRectangle(cb->rect, kCheckboxColor);
+    rgg::RenderLineRectangle(queue, cb->rect, kCheckboxColor);
     if (cb->checked) {
       Rectf crect(cb->rect);
       crect.width /= 1.25f;
       crect.height /= 1.25f;
       crect.x  += (cb->rect.width - crect.width) / 2.f;
       crect.y  += (cb->rect.height - crect.height) / 2.f;
-      rgg::RenderRectangle(crect, kCheckboxCheckedColor);
+      rgg::RenderRectangle(queue, crect, kCheckboxCheckedColor);
     } else if (cb->is_highlighted) {
       Rectf crect(cb->rect);
       crect.width /= 1.25f;
       crect.height /= 1.25f;
       crect.x  += (cb->rect.width - crect.width) / 2.f;
       crect.y  += (cb->rect.height - crect.height) / 2.f;
-      rgg::RenderRectangle(crect, kCheckboxHighlightedColor);
+      rgg::RenderRectangle(queue, crect, kCheckboxHighlightedColor);
     }
   }
+  rgg::SubmitRenderQueue(queue);
 
   for (int i = 0; i < kUsedText[tag]; ++i) {
     Text* text = &kText[tag][i];
@@ -455,12 +473,13 @@ Render(u32 tag)
     rgg::RenderText(text->msg, text->pos, kTextScale, text->color);
   }
 
+  rgg::SetRenderObserver(queue, *rgg::GetObserver());
   for (int i = 0; i < kUsedLine[tag]; ++i) {
     Line* line = &kLine[tag][i];
     //SetScissorWithPane(*line->pane, dims, false);
     if (line->type == kHorizontal) {
       v2f end(line->start.x + line->pane->rect.width, line->start.y);
-      rgg::RenderLine(line->start, end, line->color);
+      rgg::RenderLine(queue, line->start, end, line->color);
     }
   }
 
@@ -468,10 +487,12 @@ Render(u32 tag)
     ProgressBar* pb = &kProgressBar[tag][i];
     //SetScissorWithPane(*pb->pane, dims, false);
     rgg::RenderProgressBar(
-        pb->rect, 0.f, pb->current_progress, pb->max_progress, pb->fill_color,
-        pb->outline_color);
+        queue, pb->rect, 0.f, pb->current_progress, pb->max_progress,
+        pb->fill_color, pb->outline_color);
   }
+  rgg::SubmitRenderQueue(queue);
   //glScissor(0, 0, dims.x, dims.y);
+  rgg::FlushBatches();
   glEnable(GL_DEPTH_TEST);
 }
 
@@ -918,19 +939,23 @@ NewLine()
   begin_mode->pos.x = begin_mode->start->x + begin_mode->indent * row->xadvance;
 }
 
+// The title's hash is continued with the tag so HASH_STR titles are never
+// hashed at runtime.
 void
-Begin(const char* title, u32 tag, const PaneOptions& pane_options, v2f* start,
-      b8* show = nullptr)
+Begin(const HashStr& title, u32 tag, const PaneOptions& pane_options,
+      v2f* start, b8* show = nullptr)
 {
   assert(tag < kMaxTags);
-  assert(title);
+  assert(title.str);
   if (pane_options.max_width)
     assert(pane_options.width <= pane_options.max_width);
   if (pane_options.max_height)
     assert(pane_options.height <= pane_options.max_height);
-  TITLE_WITH_TAG(title, tag);
+  TITLE_WITH_TAG(title.str, tag);
   u32 title_with_tag_len = strlen(title_with_tag);
   assert(title_with_tag_len < kMaxHashKeyLength);
+  HashStr key(title_with_tag, title_with_tag_len,
+              GetHash(tag_append, strlen(tag_append), title.hash));
   auto& begin_mode = kIMUI.begin_mode;
   // End must be called before Begin.
   assert(!begin_mode.set);
@@ -938,14 +963,14 @@ Begin(const char* title, u32 tag, const PaneOptions& pane_options, v2f* start,
   begin_mode.set = true;
   begin_mode.tag = tag;
   begin_mode.start = start;
-  begin_mode.pane = FindOrUsePane(title_with_tag, title_with_tag_len);
+  begin_mode.pane = FindOrUsePane(key);
   u32 title_len = strlen(begin_mode.pane->title);
-  strcpy(begin_mode.pane->title, title);
+  strcpy(begin_mode.pane->title, title.str);
   // Header. TODO(abrunasso): imui now relies on hashing header title for pane
   // persistence - but it is worth adding a pane option to hide it here.
   SameLine();
   begin_mode.pos.x += 5.f;
-  Rectf t = rgg::GetTextRect(title, title_len, *start, kTextScale);
+  Rectf t = rgg::GetTextRect(title.str, title_len, *start, kTextScale);
   begin_mode.pane->tag = tag;
   begin_mode.pane->rect.width =
       pane_options.width > 0.f ? pane_options.width : t.width;
@@ -973,13 +998,29 @@ Begin(const char* title, u32 tag, const PaneOptions& pane_options, v2f* start,
   begin_mode.pos.x += 5.f;
   TextOptions text_options; 
   text_options.ignore_scissor_test = true;
-  Rectf trect = Text(title, text_options).rect;
+  Rectf trect = Text(title.str, text_options).rect;
   begin_mode.ignore_vertical_scroll = false;
   begin_mode.pane->header_rect.height = trect.height;
   NewLine();
   if (show) begin_mode.show = show;
 }
 
+void
+Begin(const char* title, u32 tag, const PaneOptions& pane_options, v2f* start,
+      b8* show = nullptr)
+{
+  assert(title);
+  Begin(HashStr(title, strlen(title)), tag, pane_options, start, show);
+}
+
+void
+Begin(const HashStr& title, u32 tag, v2f* start, b8* show = nullptr)
+{
+  PaneOptions pane_options;
+  pane_options.color = v4f(0.f, 0.f, 0.f, 0.f);
+  Begin(title, tag, pane_options, start, show);
+}
+
 void
 Begin(const char* title, u32 tag, v2f* start, b8* show = nullptr)
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "platform/platform.cc"
+#include "util/worker_pool.cc"
 
 #include "constants.cc"
 #include "opengl3_imgui.cc"
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+// Lines with per-vertex color. However many lines a LineBatch holds it costs
+// one upload and a draw per primitive type, so fill it once a frame and render
+// it once:
+//
+//   rgg::LineBatch batch;
+//   for (...) batch.AddLine(start, end, color);
+//   rgg::RenderLineBatch(batch);
+//
+// Thin lines are GL_LINES and a pixel wide. Core profile doesn't allow
+// glLineWidth above 1 so lines with a thickness are widened into quads in the
+// xy plane, in world units. Keep lines in 3D views thin.
+//
+// Grids that look the same from frame to frame go in a LineGrid. It keeps its
+// vertices on the GPU and only rebuilds them when the grid's size, spacing or
+// colors change. Where the grid sits is a matrix uniform, so panning a view
+// over it costs no upload.
+
+struct LineBatch {
+  void AddLine(const v3f& start, const v3f& end, const v4f& color,
+               r32 thickness = 0.f) {
+    if (thickness <= 0.f) {
+      lines.push_back({start, color});
+      lines.push_back({end, color});
+      return;
+    }
+    v2f dir = math::SafeNormalize(end.xy() - start.xy());
+    v3f n(-dir.y * thickness / 2.f, dir.x * thickness / 2.f, 0.f);
+    triangles.insert(triangles.end(), {{start + n, color},
+                                       {start - n, color},
+                                       {end - n, color},
+                                       {start + n, color},
+                                       {end - n, color},
+                                       {end + n, color}});
+  }
+  void AddLine(const v2f& start, const v2f& end, const v4f& color,
+               r32 thickness = 0.f) {
+    AddLine(v3f(start.x, start.y, 0.f), v3f(end.x, end.y, 0.f), color,
+            thickness);
+  }
+  // The cube's twelve edges.
+  void AddCube(const Cubef& cube, const v4f& color) {
+    v3f pos =
+        cube.pos - v3f(cube.width / 2.f, cube.height / 2.f, cube.depth / 2.f);
+    v3f back_top_left = pos + v3f(0.f, cube.height, 0.f);
+    v3f back_top_right = pos + v3f(cube.width, cube.height, 0.f);
+    v3f back_bottom_left = pos;
+    v3f back_bottom_right = pos + v3f(cube.width, 0.f, 0.f);
+    v3f front_top_left = pos + v3f(0.f, cube.height, cube.depth);
+    v3f front_top_right = pos + v3f(cube.width, cube.height, cube.depth);
+    v3f front_bottom_left = pos + v3f(0.f, 0.f, cube.depth);
+    v3f front_bottom_right = pos + v3f(cube.width, 0.f, cube.depth);
+    // Back face.
+    AddLine(back_bottom_left, back_top_left, color);
+    AddLine(back_bottom_left, back_bottom_right, color);
+    AddLine(back_bottom_right, back_top_right, color);
+    AddLine(back_top_left, back_top_right, color);
+    // Connecting edges between back and front.
+    AddLine(back_bottom_left, front_bottom_left, color);
+    AddLine(back_bottom_right, front_bottom_right, color);
+    AddLine(back_top_left, front_top_left, color);
+    AddLine(back_top_right, front_top_right, color);
+    // Front face.
+    AddLine(front_bottom_left, front_top_left, color);
+    AddLine(front_bottom_left, front_bottom_right, color);
+    AddLine(front_bottom_right, front_top_right, color);
+    AddLine(front_top_left, front_top_right, color);
+  }
+  // Outline of a hexagon in the xy plane at center.z.
+  void AddHexagon(const v3f& center, r32 size, const v4f& color) {
+    v3f points[6];
+    for (s32 i = 1; i <= 6; ++i) {
+      points[i - 1] = v3f(math::HexCorner(center.xy(), size, i));
+      points[i - 1].z = center.z;
+    }
+    for (s32 i = 0; i < 6; ++i) {
+      AddLine(points[(i + 5) % 6], points[i], color);
+    }
+  }
+  void Clear() {
+    lines.clear();
+    triangles.clear();
+  }
+  b8 Empty() const { return lines.empty() && triangles.empty(); }
+  // Thin lines as pairs of vertices.
+  std::vector<ColorVertex> lines;
+  // Thick lines as two triangles each.
+  std::vector<ColorVertex> triangles;
+};
+
+// Grid lines kept in their own vertex buffer. Rebuilt by RenderLineGrid when
+// what it was built for changes.
+struct LineGrid {
+  GLuint vao = 0;
+  GLuint vbo = 0;
+  u32 vertex_count = 0;
+  v2f spacing;
+  v2f size;
+  std::vector<v4f> colors;
+  // For the cache behind the RenderGrid that takes no LineGrid.
+  u32 last_used = 0;
+};
+
+struct LineStats {
+  u32 lines = 0;
+  u32 draw_calls = 0;
+  // Times a LineGrid's vertices were rebuilt.
+  u32 grid_uploads = 0;
+};
+
+struct LineBatchState {
+  GLuint vao;
+  GLuint vbo;
+  // Vertices vbo has room for.
+  u32 capacity = 0;
+  // Scratch for grid rebuilds and the immediate outline functions.
+  LineBatch scratch;
+  std::vector<ColorVertex> grid_vertices;
+  // Grids drawn by RenderGrid, reused while their size, spacing and colors
+  // match.
+  LineGrid grid_cache[4];
+  u32 grid_cache_clock = 0;
+  LineStats stats;
+  LineStats last_frame;
+};
+
+static LineBatchState kLineBatchState;
+
+// Lines use RenderQueue's color program, so call after SetupRenderQueue.
+b8 SetupLineBatch() {
+  LineBatchState* state = &kLineBatchState;
+  glGenBuffers(1, &state->vbo);
+  state->vao = CreateColorVertexArray(state->vbo);
+  return true;
+}
+
+void UseLineProgram(const Mat4f& matrix) {
+  glUseProgram(kRenderQueueState.color_program);
+  glUniformMatrix4fv(kRenderQueueState.color_matrix_uniform, 1, GL_FALSE,
+                     &matrix.data_[0]);
+}
+
+// Thick lines draw before, so under, thin ones.
+void RenderLineBatch(const LineBatch& batch) {
+  if (batch.Empty()) return;
+  FlushBatches();
+  LineBatchState* state = &kLineBatchState;
+  u32 triangle_count = batch.triangles.size();
+  u32 line_count = batch.lines.size();
+  u32 count = triangle_count + line_count;
+  if (!state->capacity) state->capacity = 1024;
+  while (state->capacity < count) state->capacity *= 2;
+  glBindBuffer(GL_ARRAY_BUFFER, state->vbo);
+  // Orphan the old storage so the driver doesn't wait on draws still reading
+  // it.
+  glBufferData(GL_ARRAY_BUFFER, state->capacity * sizeof(ColorVertex),
+               nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, triangle_count * sizeof(ColorVertex),
+                  batch.triangles.data());
+  glBufferSubData(GL_ARRAY_BUFFER, triangle_count * sizeof(ColorVertex),
+                  line_count * sizeof(ColorVertex), batch.lines.data());
+  UseLineProgram(kObserver.projection * kObserver.view);
+  glBindVertexArray(state->vao);
+  if (triangle_count) {
+    glDrawArrays(GL_TRIANGLES, 0, triangle_count);
+    ++state->stats.draw_calls;
+  }
+  if (line_count) {
+    glDrawArrays(GL_LINES, triangle_count, line_count);
+    ++state->stats.draw_calls;
+  }
+  state->stats.lines += triangle_count / 6 + line_count / 2;
+}
+
+b8 LineGridMatches(const LineGrid& grid, const v2f& spacing, const v2f& size,
+                   u32 color_count, const v4f* colors) {
+  return grid.vertex_count && grid.spacing == spacing && grid.size == size &&
+         grid.colors.size() == color_count &&
+         !memcmp(grid.colors.data(), colors, color_count * sizeof(v4f));
+}
+
+// Horizontal lines from the bottom then vertical lines from the left, each
+// set cycling through colors. Lines are relative to the grid's bottom left.
+void BuildLineGrid(LineGrid* grid, const v2f& spacing, const v2f& size,
+                   u32 color_count, const v4f* colors) {
+  std::vector<ColorVertex>* vertices = &kLineBatchState.grid_vertices;
+  vertices->clear();
+  u32 rows = (u32)(size.y / spacing.y) + 1;
+  for (u32 i = 0; i < rows; ++i) {
+    const v4f& color = colors[i % color_count];
+    vertices->push_back({v3f(0.f, i * spacing.y, 0.f), color});
+    vertices->push_back({v3f(size.x, i * spacing.y, 0.f), color});
+  }
+  u32 columns = (u32)(size.x / spacing.x) + 1;
+  for (u32 i = 0; i < columns; ++i) {
+    const v4f& color = colors[i % color_count];
+    vertices->push_back({v3f(i * spacing.x, 0.f, 0.f), color});
+    vertices->push_back({v3f(i * spacing.x, size.y, 0.f), color});
+  }
+  if (!grid->vbo) {
+    glGenBuffers(1, &grid->vbo);
+    grid->vao = CreateColorVertexArray(grid->vbo);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, grid->vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices->size() * sizeof(ColorVertex),
+               vertices->data(), GL_STATIC_DRAW);
+  grid->vertex_count = vertices->size();
+  grid->spacing = spacing;
+  grid->size = size;
+  grid->colors.assign(colors, colors + color_count);
+  ++kLineBatchState.stats.grid_uploads;
+}
+
+// Draws grid lines spacing apart over bounds, starting from its bottom left,
+// in a single draw. The lines are only rebuilt when the spacing, the size of
+// bounds or the colors differ from the last call with this grid.
+void RenderLineGrid(LineGrid* grid, const v2f& spacing, const Rectf& bounds,
+                    u32 color_count, const v4f* colors) {
+  assert(spacing.x > 0.f && spacing.y > 0.f && color_count);
+  v2f size(bounds.width, bounds.height);
+  if (!LineGridMatches(*grid, spacing, size, color_count, colors)) {
+    BuildLineGrid(grid, spacing, size, color_count, colors);
+  }
+  FlushBatches();
+  UseLineProgram(kObserver.projection * kObserver.view *
+                 math::Translation(v3f(bounds.x, bounds.y, 0.f)));
+  glBindVertexArray(grid->vao);
+  glDrawArrays(GL_LINES, 0, grid->vertex_count);
+  ++kLineBatchState.stats.draw_calls;
+  kLineBatchState.stats.lines += grid->vertex_count / 2;
+}
+
+void RenderLineGrid(LineGrid* grid, const v2f& spacing, const Rectf& bounds,
+                    const v4f& color) {
+  RenderLineGrid(grid, spacing, bounds, 1, &color);
+}
+
+// RenderLineGrid for callers that don't keep a LineGrid. A few recently drawn
+// grids are cached, so grids redrawn every frame with the same size, spacing
+// and colors still aren't rebuilt.
+void RenderGrid(const v2f& spacing, const Rectf& bounds, u32 color_count,
+                const v4f* colors) {
+  LineBatchState* state = &kLineBatchState;
+  v2f size(bounds.width, bounds.height);
+  LineGrid* grid = &state->grid_cache[0];
+  for (LineGrid& cached : state->grid_cache) {
+    if (LineGridMatches(cached, spacing, size, color_count, colors)) {
+      grid = &cached;
+      break;
+    }
+    if (cached.last_used < grid->last_used) grid = &cached;
+  }
+  grid->last_used = ++state->grid_cache_clock;
+  RenderLineGrid(grid, spacing, bounds, color_count, colors);
+}
+
+void RenderGrid(const v2f& spacing, const Rectf& bounds, const v4f& color) {
+  RenderGrid(spacing, bounds, 1, &color);
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <string>
+
 namespace rgg {
 
 #define DEBUGOBJ 0
@@ -9,7 +12,7 @@ constexpr u32 kMaxVertPair = 32;
 
 struct MaterialVertPair {
   u64 first = u64(-1);
-  u64 count;
+  u64 count = 0;
 };
 
 struct Material {
@@ -29,14 +32,14 @@ struct Mesh {
   u32 norm_count = 0;
   GLuint vert_vbo = 0;
   GLuint norm_vbo = 0;
+  GLuint index_vbo = 0;
+  u32 index_count = 0;
   GLuint vao = 0;
   Material material[kMaxMaterial];
   u32 material_count = 0;
   bool IsValid() const { return vert_count > 0; }
 };
 
-constexpr s32 kMaxVertCount = 65538;
-
 bool LoadMTL(const char* filename, Material* material, u32* material_count) {
   *material = {};
   FILE* f = fopen(filename, "rb");
@@ -99,122 +102,418 @@ bool LoadMTL(const char* filename, Material* material, u32* material_count) {
   return true;
 }
 
+// Meshes are indexed. Each vertex is a distinct position and normal pair and
+// material vert pairs are ranges of indices.
 bool
-SetupMesh(Mesh* mesh, r32* verts, u32 verts_count, r32* norms, u32 norms_count)
+SetupMesh(Mesh* mesh, const r32* positions, const r32* normals,
+          u32 vertex_count, const u32* indices, u32 index_count)
 {
-  mesh->vert_count = verts_count / 3;
-  mesh->norm_count = norms_count / 3;
+  mesh->vert_count = vertex_count;
+  mesh->norm_count = vertex_count;
+  mesh->index_count = index_count;
 
-  GLuint points_vbo = 0;
-  glGenBuffers(1, &points_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-  glBufferData(GL_ARRAY_BUFFER, verts_count * sizeof(GLfloat),
-               &verts[0], GL_STATIC_DRAW);
+  glGenBuffers(1, &mesh->vert_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->vert_vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(GLfloat), positions,
+               GL_STATIC_DRAW);
 
-  if (!points_vbo) {
-    return false;
-  }
+  glGenBuffers(1, &mesh->norm_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->norm_vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(GLfloat), normals,
+               GL_STATIC_DRAW);
 
-  GLuint normals_vbo = 0;
-  glGenBuffers(1, &normals_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, normals_vbo);
-  glBufferData(GL_ARRAY_BUFFER, norms_count * sizeof(GLfloat),
-               &norms[0], GL_STATIC_DRAW);
-  
-  if (!normals_vbo) {
-    return false;
-  }
+  glGenVertexArrays(1, &mesh->vao);
+  glBindVertexArray(mesh->vao);
 
-  GLuint vao = 0;
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
-
-  if (!vao) {
+  if (!mesh->vert_vbo || !mesh->norm_vbo || !mesh->vao) {
     return false;
   }
 
   glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->vert_vbo);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 
   glEnableVertexAttribArray(1);
-  glBindBuffer(GL_ARRAY_BUFFER, normals_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->norm_vbo);
   glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 
-  mesh->vert_vbo = points_vbo;
-  mesh->norm_vbo = normals_vbo;
-  mesh->vao = vao;
+  // The element buffer binding is part of the vao.
+  glGenBuffers(1, &mesh->index_vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_vbo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLuint), indices,
+               GL_STATIC_DRAW);
+  glBindVertexArray(0);
+
+  return mesh->index_vbo != 0;
+}
+
+// Geometry parsed from an OBJ or mapped from a mesh cache, ready to upload.
+struct MeshData {
+  const r32* positions = nullptr;
+  const r32* normals = nullptr;
+  u32 vertex_count = 0;
+  const u32* indices = nullptr;
+  u32 index_count = 0;
+};
+
+// A mesh cache holds a mesh as it's uploaded. LoadOBJ writes one next to the
+// OBJ, as <file>.obj.mesh, the first time it parses it:
+//
+//   MeshFileHeader
+//   Material material[material_count]
+//   r32 positions[vertex_count * 3]
+//   r32 normals[vertex_count * 3]
+//   u32 indices[index_count]
+//
+// Later loads map the cache and pass the arrays straight to glBufferData. A
+// cache is stale, and the OBJ is parsed again, when the OBJ or its MTL changed
+// size or modified stamp, or the version or Material layout changed. A cache
+// whose OBJ is missing is used as is, so BuildMeshCache can convert meshes
+// offline and ship without them.
 
+constexpr u32 kMeshFileMagic = 0x4853454d;  // "MESH"
+constexpr u32 kMeshFileVersion = 1;
+
+struct MeshFileHeader {
+  u32 magic;
+  u32 version;
+  // Materials are written as is so a layout change invalidates them.
+  u32 material_size;
+  u32 material_count;
+  u32 vertex_count;
+  u32 index_count;
+  u64 obj_size;
+  u64 obj_modified;
+  u64 mtl_size;
+  u64 mtl_modified;
+  // Empty when the OBJ names no mtllib.
+  char mtl_file[128];
+};
+
+struct MeshLoadStats {
+  u32 cache_loads = 0;
+  u32 obj_loads = 0;
+  u64 load_usec = 0;
+};
+
+static MeshLoadStats kMeshLoadStats;
+
+std::string MeshCacheFilename(const char* obj_file) {
+  return std::string(obj_file) + ".mesh";
+}
+
+// Records what a cache of obj_file is built from. A missing MTL records as
+// zeroes so one appearing later makes the cache stale.
+b8 GetMeshSourceInfo(const char* obj_file, const char* mtl_file,
+                     MeshFileHeader* header) {
+  header->mtl_size = 0;
+  header->mtl_modified = 0;
+  if (mtl_file[0]) {
+    filesystem::GetFileInfo(mtl_file, &header->mtl_size,
+                            &header->mtl_modified);
+  }
+  return filesystem::GetFileInfo(obj_file, &header->obj_size,
+                                 &header->obj_modified);
+}
+
+// Maps the cache for obj_file if it's current. Arrays in data point into file
+// so keep it mapped until they're uploaded.
+b8 MapMeshCache(const char* obj_file, filesystem::MappedFile* file,
+                Mesh* mesh, MeshData* data) {
+  std::string cache = MeshCacheFilename(obj_file);
+  if (!filesystem::MapFile(cache.c_str(), file)) return false;
+  const MeshFileHeader* header = (const MeshFileHeader*)file->data;
+  b8 valid = file->size >= sizeof(MeshFileHeader) &&
+             header->magic == kMeshFileMagic &&
+             header->version == kMeshFileVersion &&
+             header->material_size == sizeof(Material) &&
+             header->material_count <= kMaxMaterial &&
+             !header->mtl_file[sizeof(header->mtl_file) - 1];
+  if (valid) {
+    u64 size = sizeof(MeshFileHeader) +
+               header->material_count * sizeof(Material) +
+               (u64)header->vertex_count * 6 * sizeof(r32) +
+               (u64)header->index_count * sizeof(u32);
+    valid = size == file->size;
+  }
+  MeshFileHeader source;
+  if (valid && GetMeshSourceInfo(obj_file, header->mtl_file, &source)) {
+    valid = source.obj_size == header->obj_size &&
+            source.obj_modified == header->obj_modified &&
+            source.mtl_size == header->mtl_size &&
+            source.mtl_modified == header->mtl_modified;
+  }
+  if (!valid) {
+    filesystem::UnmapFile(file);
+    return false;
+  }
+  const u8* cursor = file->data + sizeof(MeshFileHeader);
+  memcpy(mesh->material, cursor, header->material_count * sizeof(Material));
+  mesh->material_count = header->material_count;
+  cursor += header->material_count * sizeof(Material);
+  data->vertex_count = header->vertex_count;
+  data->positions = (const r32*)cursor;
+  cursor += header->vertex_count * 3 * sizeof(r32);
+  data->normals = (const r32*)cursor;
+  cursor += header->vertex_count * 3 * sizeof(r32);
+  data->index_count = header->index_count;
+  data->indices = (const u32*)cursor;
   return true;
 }
 
-bool LoadOBJ(const char* filename, Mesh* mesh) {
-  *mesh = {};
-  static v3f v[kMaxVertCount];
-  static u32 cv = 0;
-  static v3f vn[kMaxVertCount];
-  static u32 cvn = 0;
+b8 WriteMeshCache(const char* obj_file, const char* mtl_file,
+                  const Mesh& mesh, const MeshData& data) {
+  MeshFileHeader header = {};
+  header.magic = kMeshFileMagic;
+  header.version = kMeshFileVersion;
+  header.material_size = sizeof(Material);
+  header.material_count = mesh.material_count;
+  header.vertex_count = data.vertex_count;
+  header.index_count = data.index_count;
+  strncpy(header.mtl_file, mtl_file, sizeof(header.mtl_file) - 1);
+  if (!GetMeshSourceInfo(obj_file, mtl_file, &header)) return false;
+  std::string cache = MeshCacheFilename(obj_file);
+  // Written aside then renamed over the cache so a failed write never leaves
+  // a truncated cache behind.
+  std::string temp = cache + ".tmp";
+  FILE* f = fopen(temp.c_str(), "wb");
+  if (!f) return false;
+  auto write = [f](const void* bytes, u64 size) {
+    return !size || fwrite(bytes, size, 1, f) == 1;
+  };
+  b8 written = write(&header, sizeof(header)) &&
+               write(mesh.material, mesh.material_count * sizeof(Material)) &&
+               write(data.positions, data.vertex_count * 3 * sizeof(r32)) &&
+               write(data.normals, data.vertex_count * 3 * sizeof(r32)) &&
+               write(data.indices, data.index_count * sizeof(u32));
+  written = fclose(f) == 0 && written;
+  if (written) {
+    remove(cache.c_str());
+    written = rename(temp.c_str(), cache.c_str()) == 0;
+  }
+  if (!written) remove(temp.c_str());
+  return written;
+}
+
+inline b8 IsOBJSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline b8 IsOBJDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline b8 IsOBJKeyword(const char* s, const char* keyword, u32 len) {
+  return strncmp(s, keyword, len) == 0 && IsOBJSpace(s[len]);
+}
+
+void SkipOBJSpace(const char** s) {
+  while (IsOBJSpace(**s)) ++*s;
+}
 
-#define FREE_MEM()                             \
-  memory::PopType<r32>(2 * kMaxVertCount * 8); \
+void SkipOBJLine(const char** s) {
+  while (**s && **s != '\n') ++*s;
+  if (**s) ++*s;
+}
 
-  r32* verts = memory::PushType<r32>(kMaxVertCount * 8);
-  u32 verts_count = 0;
+// Copies the next whitespace delimited token into token, truncated to fit.
+void ParseOBJToken(const char** s, char* token, u32 size) {
+  SkipOBJSpace(s);
+  u32 len = 0;
+  while (**s && **s != '\n' && !IsOBJSpace(**s)) {
+    if (len + 1 < size) token[len++] = **s;
+    ++*s;
+  }
+  token[len] = '\0';
+}
 
-  r32* norms = memory::PushType<r32>(kMaxVertCount * 8);
-  u32 norms_count = 0;
+s32 ParseOBJInt(const char** s) {
+  b8 negative = **s == '-';
+  if (negative || **s == '+') ++*s;
+  s32 value = 0;
+  while (IsOBJDigit(**s)) value = value * 10 + (*(*s)++ - '0');
+  return negative ? -value : value;
+}
 
-  cv = 0;
-  cvn = 0;
+// Decimal or scientific notation. Digits past the 18th are dropped, far more
+// than a float holds, and the rest scale by an exact power of ten so results
+// match strtof for anything an exporter writes.
+r32 ParseOBJFloat(const char** s) {
+  static const r64 kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+  SkipOBJSpace(s);
+  b8 negative = **s == '-';
+  if (negative || **s == '+') ++*s;
+  u64 mantissa = 0;
+  s32 exponent = 0;
+  for (; IsOBJDigit(**s); ++*s) {
+    if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (**s - '0');
+    else ++exponent;
+  }
+  if (**s == '.') {
+    for (++*s; IsOBJDigit(**s); ++*s) {
+      if (mantissa >= 100000000000000000ull) continue;
+      mantissa = mantissa * 10 + (**s - '0');
+      --exponent;
+    }
+  }
+  if (**s == 'e' || **s == 'E') {
+    ++*s;
+    exponent += ParseOBJInt(s);
+  }
+  r64 value = (r64)mantissa;
+  if (exponent < -22 || exponent > 22) value *= pow(10.0, exponent);
+  else if (exponent < 0) value /= kPow10[-exponent];
+  else value *= kPow10[exponent];
+  return (r32)(negative ? -value : value);
+}
 
-#define ADD_VERTS(vec) \
-  memcpy(&verts[verts_count], &v[vec.x - 1].x, 3 * sizeof(r32));  \
-  memcpy(&norms[norms_count], &vn[vec.z - 1].x, 3 * sizeof(r32)); \
-  verts_count += 3;                                                  \
-  norms_count += 3;
+// One corner of a face as v, v/vt, v//vn or v/vt/vn. Texture coordinates
+// aren't used. Returns false at the end of the face.
+b8 ParseOBJCorner(const char** s, s32* v, s32* vn) {
+  SkipOBJSpace(s);
+  if (!IsOBJDigit(**s) && **s != '-') return false;
+  *v = ParseOBJInt(s);
+  *vn = 0;
+  if (**s != '/') return true;
+  ++*s;
+  if (**s != '/') ParseOBJInt(s);
+  if (**s != '/') return true;
+  ++*s;
+  *vn = ParseOBJInt(s);
+  return true;
+}
 
-#define ADD_VERT_AND_NORM(a, b, c) \
-  ADD_VERTS(a);                    \
-  ADD_VERTS(b);                    \
-  ADD_VERTS(c);
+// Positions and normals are numbered from 1. Negative numbers count back from
+// the last one read so far.
+inline u32 ResolveOBJIndex(s32 i, u32 count) {
+  return i < 0 ? count + i + 1 : (u32)i;
+}
 
+// Parses an OBJ read whole into memory in two passes. The first counts what
+// to make room for. The second fans faces into triangles and gives each
+// distinct position and normal pair one vertex. Arrays in data are pushed
+// onto the permanent arena so parse under a ScopedMarker. mtl_file gets the
+// path of the OBJ's mtllib, or is empty.
+b8 ParseOBJ(const char* filename, Mesh* mesh, MeshData* data, char* mtl_file,
+            u32 mtl_file_size) {
+  *mesh = {};
+  *data = {};
+  mtl_file[0] = '\0';
   FILE* f = fopen(filename, "rb");
   if (!f) {
-    FREE_MEM();
     printf("%s not found!\n", filename);
     return false;
   }
-  char line[1024];
+  fseek(f, 0, SEEK_END);
+  u64 size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char* text = (char*)memory::TryPushBytes(memory::kPermanent, size + 1);
+  b8 read = text && fread(text, 1, size, f) == size;
+  fclose(f);
+  if (!read) {
+    LOG(ERR, "Unable to read %s", filename);
+    return false;
+  }
+  text[size] = '\0';
+
+  u32 position_count = 0;
+  u32 normal_count = 0;
+  u32 corner_count = 0;
+  for (const char* s = text; *s; SkipOBJLine(&s)) {
+    SkipOBJSpace(&s);
+    if (IsOBJKeyword(s, "v", 1)) ++position_count;
+    else if (IsOBJKeyword(s, "vn", 2)) ++normal_count;
+    else if (IsOBJKeyword(s, "f", 1)) {
+      s += 1;
+      s32 v, vn;
+      while (ParseOBJCorner(&s, &v, &vn)) ++corner_count;
+    }
+  }
+
+  // Normals get a zero at index 0 for corners without one.
+  v3f* positions = memory::PushType<v3f>(position_count + 1);
+  v3f* normals = memory::PushType<v3f>(normal_count + 1);
+  normals[0] = v3f(0.f, 0.f, 0.f);
+  r32* out_positions = memory::PushType<r32>(corner_count * 3);
+  r32* out_normals = memory::PushType<r32>(corner_count * 3);
+  u32* indices = memory::PushType<u32>(corner_count * 3);
+  // Open addressed map from a position and normal pair to its vertex. Pairs
+  // are never zero since positions count from 1.
+  u32 table_size = 16;
+  while (table_size < corner_count * 2) table_size *= 2;
+  u64* keys = memory::PushType<u64>(table_size);
+  u32* values = memory::PushType<u32>(table_size);
+  memset(keys, 0, table_size * sizeof(u64));
+
+  u32 cv = 0;
+  u32 cvn = 0;
+  u32 vertex_count = 0;
+  u32 index_count = 0;
+  auto add_corner = [&](s32 v, s32 vn) -> u32 {
+    u32 pi = ResolveOBJIndex(v, cv);
+    u32 ni = ResolveOBJIndex(vn, cvn);
+    if (!pi || pi > cv || ni > cvn) return u32(-1);
+    u64 key = ((u64)pi << 32) | ni;
+    u32 slot = (u32)((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_size - 1);
+    while (keys[slot] && keys[slot] != key) slot = (slot + 1) & (table_size - 1);
+    if (!keys[slot]) {
+      keys[slot] = key;
+      values[slot] = vertex_count;
+      memcpy(&out_positions[vertex_count * 3], &positions[pi].x,
+             3 * sizeof(r32));
+      memcpy(&out_normals[vertex_count * 3], &normals[ni].x, 3 * sizeof(r32));
+      ++vertex_count;
+    }
+    return values[slot];
+  };
+
   Material* mtl = nullptr;
-  while (1) {
-    s32 res = fscanf(f, "%s", line);
-    if (res == EOF) break;
-    if (strcmp(line, "v") == 0) {
-      v3f* vert = &v[cv++];
-      fscanf(f, "%f %f %f\n", &vert->x, &vert->y, &vert->z);
-    } else if (strcmp(line, "vt") == 0) {
-      continue;  // I don't use these yet.
-    } else if (strcmp(line, "mtllib") == 0) {
-      if (mesh->material_count < kMaxMaterial) {
-        char mtlname[64] = {};
-        fscanf(f, "%s\n", mtlname);
-        if (filesystem::HasExtension(mtlname, "mtl")) {
-          char fullname[128] = {};
-          strcpy(fullname, filename);
-          filesystem::ReplaceFilename(mtlname, fullname);
-          if (!LoadMTL(fullname, mesh->material, &mesh->material_count)) {
-            printf("Unable to load material %s\n", mtlname);
-          }
+  for (const char* s = text; *s; SkipOBJLine(&s)) {
+    SkipOBJSpace(&s);
+    if (IsOBJKeyword(s, "v", 1)) {
+      s += 1;
+      v3f* vert = &positions[++cv];
+      vert->x = ParseOBJFloat(&s);
+      vert->y = ParseOBJFloat(&s);
+      vert->z = ParseOBJFloat(&s);
+    } else if (IsOBJKeyword(s, "vn", 2)) {
+      s += 2;
+      v3f* norm = &normals[++cvn];
+      norm->x = ParseOBJFloat(&s);
+      norm->y = ParseOBJFloat(&s);
+      norm->z = ParseOBJFloat(&s);
+    } else if (IsOBJKeyword(s, "f", 1)) {
+      s += 1;
+      u32 vert_pair_idx = mtl ? (u32)mtl->vert_pair_count - 1 : 0;
+      if (mtl && mtl->vert_pair[vert_pair_idx].first == u64(-1)) {
+        mtl->vert_pair[vert_pair_idx].first = index_count;
+      }
+      s32 v, vn;
+      u32 first = u32(-1), second = u32(-1);
+      while (ParseOBJCorner(&s, &v, &vn)) {
+        u32 third = add_corner(v, vn);
+        if (third == u32(-1)) {
+          LOG(ERR, "%s has a face with a bad index", filename);
+          return false;
         }
+        if (first == u32(-1)) {
+          first = third;
+        } else if (second == u32(-1)) {
+          second = third;
+        } else {
+          indices[index_count++] = first;
+          indices[index_count++] = second;
+          indices[index_count++] = third;
+          second = third;
+        }
+      }
+      if (mtl) {
+        mtl->vert_pair[vert_pair_idx].count =
+            index_count - mtl->vert_pair[vert_pair_idx].first;
       }
-    } else if (strcmp(line, "vn") == 0) {
-      v3f* norm = &vn[cvn++];
-      fscanf(f, "%f %f %f\n", &norm->x, &norm->y, &norm->z);
-    } else if (strcmp(line, "vt") == 0) {
-      continue;  // I don't use these yet.
-    } else if (strcmp(line, "usemtl") == 0) {
-      char mtlname[64] = {};
-      fscanf(f, "%s\n", mtlname);
+    } else if (IsOBJKeyword(s, "usemtl", 6)) {
+      s += 6;
+      char mtlname[64];
+      ParseOBJToken(&s, mtlname, sizeof(mtlname));
       for (u32 i = 0; i < mesh->material_count; ++i) {
         if (strcmp(mesh->material[i].name, mtlname) == 0) {
           mtl = &mesh->material[i];
@@ -224,41 +523,81 @@ bool LoadOBJ(const char* filename, Mesh* mesh) {
           break;
         }
       }
-    } else if (strcmp(line, "f") == 0) {
-      u32 vert_pair_idx = mtl ? (u32)mtl->vert_pair_count - 1 : 0;
-      if (mtl && mtl->vert_pair[vert_pair_idx].first == u64(-1)) {
-        mtl->vert_pair[vert_pair_idx].first = verts_count / 3;
-      }
-      s32 i = 0;
-      v3i first, second, third;
-      fscanf(f, " %i/%i/%i", &first.x, &first.y, &first.z);
-      fscanf(f, " %i/%i/%i", &second.x, &second.y, &second.z);
-      fscanf(f, " %i/%i/%i", &third.x, &third.y, &third.z);
-      ADD_VERT_AND_NORM(first, second, third);
-      second = third;
-      char c = fgetc(f);
-      while (c != '\n') {
-        fscanf(f, " %i/%i/%i", &third.x, &third.y, &third.z);
-        ADD_VERT_AND_NORM(first, second, third);
-        second = third;
-        c = fgetc(f);
-      }
-      if (mtl) {
-        mtl->vert_pair[vert_pair_idx].count =
-            (verts_count / 3) - mtl->vert_pair[vert_pair_idx].first;
+    } else if (IsOBJKeyword(s, "mtllib", 6)) {
+      s += 6;
+      char mtlname[64];
+      ParseOBJToken(&s, mtlname, sizeof(mtlname));
+      if (mesh->material_count < kMaxMaterial &&
+          filesystem::HasExtension(mtlname, "mtl")) {
+        // The MTL sits next to the OBJ.
+        const char* slash = strrchr(filename, '/');
+        s32 dir_len = slash ? (s32)(slash - filename) + 1 : 0;
+        snprintf(mtl_file, mtl_file_size, "%.*s%s", dir_len, filename,
+                 mtlname);
+        if (!LoadMTL(mtl_file, mesh->material, &mesh->material_count)) {
+          printf("Unable to load material %s\n", mtlname);
+        }
       }
     }
-  } 
-   
-  if (!SetupMesh(mesh, verts, verts_count, norms, norms_count)) {
-    fclose(f);
-    FREE_MEM();
+  }
+
+  data->positions = out_positions;
+  data->normals = out_normals;
+  data->vertex_count = vertex_count;
+  data->indices = indices;
+  data->index_count = index_count;
+  return true;
+}
+
+// Converts an OBJ to a mesh cache without uploading it, for converting assets
+// offline.
+b8 BuildMeshCache(const char* filename) {
+  memory::ScopedMarker marker;
+  Mesh mesh;
+  MeshData data;
+  char mtl_file[128];
+  if (!ParseOBJ(filename, &mesh, &data, mtl_file, sizeof(mtl_file))) {
+    return false;
+  }
+  return WriteMeshCache(filename, mtl_file, mesh, data);
+}
+
+// Loads from the mesh cache when it's current, otherwise parses the OBJ and
+// writes the cache for next time.
+bool LoadOBJ(const char* filename, Mesh* mesh) {
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  *mesh = {};
+  MeshData data;
+  filesystem::MappedFile file;
+  if (MapMeshCache(filename, &file, mesh, &data)) {
+    b8 setup = SetupMesh(mesh, data.positions, data.normals,
+                         data.vertex_count, data.indices, data.index_count);
+    filesystem::UnmapFile(&file);
+    ++kMeshLoadStats.cache_loads;
+    kMeshLoadStats.load_usec += platform::ClockEnd(&clock);
+    return setup;
+  }
+
+  // Scratch vertex storage is released when the load returns.
+  memory::ScopedMarker marker;
+  char mtl_file[128];
+  if (!ParseOBJ(filename, mesh, &data, mtl_file, sizeof(mtl_file))) {
     return false;
   }
-  
+  if (!SetupMesh(mesh, data.positions, data.normals, data.vertex_count,
+                 data.indices, data.index_count)) {
+    return false;
+  }
+  if (!WriteMeshCache(filename, mtl_file, *mesh, data)) {
+    LOG(WARN, "Unable to write the mesh cache for %s", filename);
+  }
+  ++kMeshLoadStats.obj_loads;
+  kMeshLoadStats.load_usec += platform::ClockEnd(&clock);
+
 #if DEBUGOBJ
-  printf("Loaded Mesh vert count %i verts vbo %i norms vbo %i vao %i \n",
-         mesh->vert_count, mesh->vert_vbo, mesh->norm_vbo, mesh->vao);
+  printf("Loaded Mesh vert count %i index count %i vao %i \n",
+         mesh->vert_count, mesh->index_count, mesh->vao);
 
   for (u32 i = 0; i < mesh->material_count; ++i) {
     const Material* mat = &mesh->material[i];
@@ -270,9 +609,6 @@ bool LoadOBJ(const char* filename, Mesh* mesh) {
   }
 #endif
 
-  fclose(f);
-
-  FREE_MEM();
   return true;
 }
 
@@ -0,0 +1,695 @@
+#pragma once
+
+#include <vector>
+
+// Retained alternative to the immediate rgg draw functions. Commands are
+// recorded into a RenderQueue without touching GL, then SubmitRenderQueue
+// sorts them and draws runs of commands that share a program, observer and
+// texture together:
+//
+//   rgg::RenderQueue queue;
+//   rgg::SetRenderObserver(&queue, *rgg::GetObserver());
+//   rgg::RenderRectangle(&queue, rect, color);
+//   ...
+//   rgg::SubmitRenderQueue(&queue);
+//
+// Rectangles, line rectangles, smooth rectangles and circles are instanced -
+// each is a ShapeInstance in one per-instance buffer and each run of them is
+// a single glDrawArraysInstanced. Triangles and lines are merged into a single
+// vertex upload and a draw per run. Textures share the sprite batch's buffers.
+// Meshes still draw one at a time but only bind their program once per run.
+// The view projection is computed once per observer rather than per draw.
+//
+// Commands are sorted on observer, then layer, then program, texture and
+// depth. Everything recorded after SetRenderObserver or a larger layer draws
+// after what came before. Within a layer commands may be reordered, so put
+// primitives that overlap and blend on separate layers. Commands with equal
+// keys keep the order they were recorded in.
+//
+// A queue only touches its own memory while recording, so it can be recorded
+// on a worker thread. Give each recording thread its own queue and submit them
+// in order from the thread that owns the GL context.
+
+// Defined with the immediate draw functions in opengl3_renderer.cc.
+void RenderMesh(const Mesh& mesh, const Mat4f& model, const v4f& color);
+
+// Also the order types draw in within a layer - fills before outlines.
+enum RenderCommandType : u8 {
+  kRenderCommandTriangles,
+  kRenderCommandRectangle,
+  kRenderCommandSmoothRectangle,
+  kRenderCommandLines,
+  kRenderCommandLineRectangle,
+  kRenderCommandCircle,
+  kRenderCommandTexture,
+  kRenderCommandMesh,
+};
+
+struct ColorVertex {
+  v3f position;
+  v4f color;
+};
+
+// Per-instance data for the instanced shapes. See the instance shaders in
+// opengl3_shaders.h for what rect and params hold for each.
+struct ShapeInstance {
+  v4f rect;
+  v4f color;
+  v4f params;
+};
+
+struct MeshCommand {
+  // Must outlive the submit.
+  const Mesh* mesh;
+  Mat4f model;
+  v4f color;
+};
+
+struct RenderCommand {
+  u64 key;
+  RenderCommandType type;
+  u16 observer;
+  GLuint texture;
+  // Range in the queue's array for the command type.
+  u32 first;
+  u32 count;
+};
+
+struct RenderQueue {
+  std::vector<RenderCommand> commands;
+  std::vector<Observer> observers;
+  std::vector<ColorVertex> colors;
+  std::vector<SpriteVertex> sprites;
+  std::vector<ShapeInstance> shapes;
+  std::vector<MeshCommand> meshes;
+  u8 layer = 0;
+};
+
+struct RenderSortEntry {
+  u64 key;
+  u32 command;
+};
+
+// Consecutive sorted commands drawn with the same state.
+struct RenderRun {
+  RenderCommandType type;
+  u16 observer;
+  GLuint texture;
+  // Range in the sorted commands.
+  u32 begin;
+  u32 end;
+  // Range in kRenderQueueState's colors, shapes or sprites.
+  u32 first;
+  u32 count;
+};
+
+struct RenderQueueStats {
+  u32 commands = 0;
+  u32 draw_calls = 0;
+};
+
+// Program and vertex array for an instanced shape. The vertex array's first
+// attribute is the shape's static geometry and the rest read ShapeInstances.
+struct ShapeProgram {
+  GLuint reference;
+  GLuint matrix_uniform;
+  GLuint vao;
+};
+
+struct RenderQueueState {
+  GLuint color_program;
+  GLuint color_matrix_uniform;
+  GLuint color_vao;
+  GLuint color_vbo;
+  u32 color_capacity = 0;
+  ShapeProgram rectangle;
+  ShapeProgram smooth_rectangle;
+  ShapeProgram circle;
+  GLuint shape_vbo;
+  u32 shape_capacity = 0;
+  // Scratch reused across submits.
+  std::vector<RenderSortEntry> sorted;
+  std::vector<RenderSortEntry> sort_scratch;
+  std::vector<RenderRun> runs;
+  std::vector<ColorVertex> colors;
+  std::vector<ShapeInstance> shapes;
+  std::vector<SpriteVertex> sprites;
+  std::vector<Mat4f> view_projection;
+  RenderQueueStats stats;
+  RenderQueueStats last_frame;
+};
+
+static RenderQueueState kRenderQueueState;
+
+b8 SetupShapeProgram(const GLchar* const* vertex_shader,
+                     const GLchar* const* fragment_shader,
+                     const char* matrix_name, GLuint geometry_vbo,
+                     s32 geometry_size, ShapeProgram* program) {
+  GLuint vert_shader, frag_shader;
+  if (!GLCompileShader(GL_VERTEX_SHADER, vertex_shader, &vert_shader)) {
+    return false;
+  }
+  if (!GLCompileShader(GL_FRAGMENT_SHADER, fragment_shader, &frag_shader)) {
+    return false;
+  }
+  if (!GLLinkShaders(&program->reference, 2, vert_shader, frag_shader)) {
+    return false;
+  }
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  program->matrix_uniform =
+      glGetUniformLocation(program->reference, matrix_name);
+  assert(program->matrix_uniform != u32(-1));
+
+  glGenVertexArrays(1, &program->vao);
+  glBindVertexArray(program->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry_vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, geometry_size, GL_FLOAT, GL_FALSE, 0, nullptr);
+  // Pointed at the run's first instance before each draw.
+  for (GLuint i = 1; i <= 3; ++i) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+  return true;
+}
+
+// Vertex array reading ColorVertex from vbo, for color_program.
+GLuint CreateColorVertexArray(GLuint vbo) {
+  GLuint vao;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ColorVertex),
+                        (void*)offsetof(ColorVertex, position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ColorVertex),
+                        (void*)offsetof(ColorVertex, color));
+  return vao;
+}
+
+b8 SetupRenderQueue() {
+  RenderQueueState* state = &kRenderQueueState;
+  // Rectangle corners as triangles then as a line loop, in the vertex order
+  // the immediate RenderRectangle and RenderLineRectangle use.
+  // clang-format off
+  GLfloat corners[20] = {
+    0.f, 0.f, 0.f, 1.f, 1.f, 1.f,
+    0.f, 0.f, 1.f, 1.f, 1.f, 0.f,
+    0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f,
+  };
+  // Same unit quad as kTextureState.
+  GLfloat quad[18] = {
+    -0.5f, -0.5f, 0.f, -0.5f, 0.5f, 0.f, 0.5f, 0.5f, 0.f,
+    0.5f, -0.5f, 0.f, -0.5f, -0.5f, 0.f, 0.5f, 0.5f, 0.f,
+  };
+  // clang-format on
+  GLuint corner_vbo, quad_vbo;
+  glGenBuffers(1, &corner_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, corner_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+  glGenBuffers(1, &quad_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+  glGenBuffers(1, &state->shape_vbo);
+  if (!SetupShapeProgram(&kRectangleInstanceVertexShader, &kFragmentShader,
+                         "matrix", corner_vbo, 2, &state->rectangle)) {
+    return false;
+  }
+  if (!SetupShapeProgram(&kSmoothRectangleInstanceVertexShader,
+                         &kSmoothRectangleFragmentShader, "view_projection",
+                         quad_vbo, 3, &state->smooth_rectangle)) {
+    return false;
+  }
+  if (!SetupShapeProgram(&kCircleInstanceVertexShader, &kCircleFragmentShader,
+                         "view_projection", quad_vbo, 3, &state->circle)) {
+    return false;
+  }
+
+  GLuint vert_shader, frag_shader;
+  if (!GLCompileShader(GL_VERTEX_SHADER, &kColorVertexShader, &vert_shader)) {
+    return false;
+  }
+  if (!GLCompileShader(GL_FRAGMENT_SHADER, &kFragmentShader, &frag_shader)) {
+    return false;
+  }
+  if (!GLLinkShaders(&state->color_program, 2, vert_shader, frag_shader)) {
+    return false;
+  }
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  state->color_matrix_uniform =
+      glGetUniformLocation(state->color_program, "matrix");
+  assert(state->color_matrix_uniform != u32(-1));
+
+  glGenBuffers(1, &state->color_vbo);
+  state->color_vao = CreateColorVertexArray(state->color_vbo);
+  return true;
+}
+
+// Maps z onto 16 bits that sort in the same order as the float.
+u16 RenderDepth(r32 z) {
+  u32 bits;
+  memcpy(&bits, &z, sizeof(bits));
+  bits = (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+  return bits >> 16;
+}
+
+void SetRenderObserver(RenderQueue* queue, const Observer& observer) {
+  assert(queue->observers.size() < 256);
+  queue->observers.push_back(observer);
+}
+
+// Commands on larger layers draw after commands on smaller ones.
+void SetRenderLayer(RenderQueue* queue, u8 layer) {
+  queue->layer = layer;
+}
+
+RenderCommand* PushRenderCommand(RenderQueue* queue, RenderCommandType type,
+                                 GLuint texture, r32 z) {
+  // Off the GL thread the queue can't read kObserver, so it has to be told.
+  assert(!queue->observers.empty());
+  RenderCommand* command = &queue->commands.emplace_back();
+  command->observer = queue->observers.size() - 1;
+  command->type = type;
+  command->texture = texture;
+  command->key = (u64)command->observer << 48 | (u64)queue->layer << 40 |
+                 (u64)type << 32 | (u64)(texture & 0xFFFF) << 16 |
+                 RenderDepth(z);
+  return command;
+}
+
+ColorVertex* PushColorVertices(RenderQueue* queue, RenderCommandType type,
+                               r32 z, u32 count) {
+  RenderCommand* command = PushRenderCommand(queue, type, 0, z);
+  command->first = queue->colors.size();
+  command->count = count;
+  queue->colors.resize(command->first + count);
+  return &queue->colors[command->first];
+}
+
+ShapeInstance* PushShape(RenderQueue* queue, RenderCommandType type, r32 z) {
+  RenderCommand* command = PushRenderCommand(queue, type, 0, z);
+  command->first = queue->shapes.size();
+  command->count = 1;
+  return &queue->shapes.emplace_back();
+}
+
+// Rotation is in degrees about the rect's center like Rectf::Rotate.
+ShapeInstance* PushRectangleShape(RenderQueue* queue, RenderCommandType type,
+                                  const Rectf& rect, r32 z, r32 rotation,
+                                  const v4f& color) {
+  ShapeInstance* shape = PushShape(queue, type, z);
+  shape->rect = v4f(rect.x, rect.y, rect.width, rect.height);
+  shape->color = color;
+  shape->params = v4f(z, 1.f, 0.f, 0.f);
+  if (rotation != 0.f) {
+    r32 angle = rotation * (r32)PI / 180.0f;
+    shape->params.y = cos(angle);
+    shape->params.z = sin(angle);
+  }
+  return shape;
+}
+
+void RenderRectangle(RenderQueue* queue, const Rectf& rect, r32 z,
+                     r32 rotation, const v4f& color) {
+  PushRectangleShape(queue, kRenderCommandRectangle, rect, z, rotation, color);
+}
+
+void RenderRectangle(RenderQueue* queue, const Rectf& rect,
+                     const v4f& color) {
+  RenderRectangle(queue, rect, 0.f, 0.f, color);
+}
+
+void RenderTriangle(RenderQueue* queue, const v2f& p, r32 half_height,
+                    const v4f& color) {
+  ColorVertex* v = PushColorVertices(queue, kRenderCommandTriangles, 0.f, 3);
+  v[0] = {v3f(p.x, p.y + half_height, 0.f), color};
+  v[1] = {v3f(p.x + half_height, p.y - half_height, 0.f), color};
+  v[2] = {v3f(p.x - half_height, p.y - half_height, 0.f), color};
+}
+
+void RenderLineRectangle(RenderQueue* queue, const Rectf& rect, r32 z,
+                         r32 rotate, const v4f& color) {
+  PushRectangleShape(queue, kRenderCommandLineRectangle, rect, z, rotate,
+                     color);
+}
+
+void RenderLineRectangle(RenderQueue* queue, const Rectf& rect,
+                         const v4f& color) {
+  RenderLineRectangle(queue, rect, 0.f, 0.f, color);
+}
+
+void RenderLine(RenderQueue* queue, const v3f& start, const v3f& end,
+                const v4f& color) {
+  ColorVertex* v = PushColorVertices(queue, kRenderCommandLines, start.z, 2);
+  v[0] = {start, color};
+  v[1] = {end, color};
+}
+
+void RenderSmoothRectangle(RenderQueue* queue, const Rectf& rect,
+                           r32 smoothing_radius, const v4f& color) {
+  ShapeInstance* shape =
+      PushShape(queue, kRenderCommandSmoothRectangle, 0.f);
+  shape->rect = v4f(rect.x + rect.width / 2.f, rect.y + rect.height / 2.f,
+                    rect.width, rect.height);
+  shape->color = color;
+  // Matches the immediate RenderSmoothRectangle.
+  shape->params = v4f(0.f, rect.width - smoothing_radius, 0.f, 0.f);
+}
+
+void RenderCircle(RenderQueue* queue, const v3f& position, r32 inner_radius,
+                  r32 outer_radius, const v4f& color) {
+  ShapeInstance* shape = PushShape(queue, kRenderCommandCircle, position.z);
+  r32 d = outer_radius * 2.f;
+  shape->rect = v4f(position.x, position.y, d, d);
+  shape->color = color;
+  shape->params = v4f(position.z, inner_radius, outer_radius, 0.f);
+}
+
+void RenderCircle(RenderQueue* queue, const v3f& position, r32 radius,
+                  const v4f& color) {
+  RenderCircle(queue, position, 0.f, radius, color);
+}
+
+void RenderProgressBar(RenderQueue* queue, const Rectf& rect, r32 z,
+                       r32 current_progress, r32 max_progress,
+                       const v4f& fill_color, const v4f& outline_color) {
+  if (current_progress > FLT_EPSILON) {
+    Rectf fill_rect(
+        rect.x, rect.y,
+        rect.width * fmodf(current_progress, max_progress) / max_progress,
+        rect.height);
+    if (current_progress == max_progress) fill_rect.width = rect.width;
+    RenderRectangle(queue, fill_rect, z, 0.f, fill_color);
+  }
+  RenderLineRectangle(queue, rect, z, 0.f, outline_color);
+}
+
+void RenderTexture(RenderQueue* queue, const Texture& texture,
+                   const Rectf& src, const Rectf& dest, const v4f& tint,
+                   bool mirror = false, bool flip = false) {
+  RenderCommand* command =
+      PushRenderCommand(queue, kRenderCommandTexture, texture.reference, 0.f);
+  command->first = queue->sprites.size();
+  command->count = 4;
+  queue->sprites.resize(command->first + 4);
+  SpriteQuad(texture, src, dest, tint, mirror, flip,
+             &queue->sprites[command->first]);
+}
+
+void RenderTexture(RenderQueue* queue, const Texture& texture,
+                   const Rectf& src, const Rectf& dest, bool mirror = false,
+                   bool flip = false) {
+  RenderTexture(queue, texture, src, dest, v4f(1.f, 1.f, 1.f, 1.f), mirror,
+                flip);
+}
+
+void RenderMesh(RenderQueue* queue, const Mesh& mesh, const Mat4f& model,
+                const v4f& color = v4f(1.f, 1.f, 1.f, 1.f)) {
+  if (!mesh.IsValid()) return;
+  RenderCommand* command =
+      PushRenderCommand(queue, kRenderCommandMesh, mesh.vao, 0.f);
+  command->first = queue->meshes.size();
+  command->count = 1;
+  queue->meshes.push_back({&mesh, model, color});
+}
+
+void RenderMesh(RenderQueue* queue, const Mesh& mesh, const v3f& pos,
+                const v3f& scale, const Quatf& quat,
+                const v4f& color = v4f(1.f, 1.f, 1.f, 1.f)) {
+  RenderMesh(queue, mesh, math::Model(pos, scale, quat), color);
+}
+
+void ClearRenderQueue(RenderQueue* queue) {
+  queue->commands.clear();
+  queue->observers.clear();
+  queue->colors.clear();
+  queue->sprites.clear();
+  queue->shapes.clear();
+  queue->meshes.clear();
+  queue->layer = 0;
+}
+
+// LSD radix sort a byte at a time. Bytes every key shares are skipped, which
+// is most of them - a queue rarely spans more than a few observers, layers
+// and textures.
+void SortRenderCommands(std::vector<RenderSortEntry>* entries,
+                        std::vector<RenderSortEntry>* scratch) {
+  u32 n = entries->size();
+  b8 sorted = true;
+  for (u32 i = 1; i < n && sorted; ++i) {
+    sorted = (*entries)[i - 1].key <= (*entries)[i].key;
+  }
+  if (sorted) return;
+  scratch->resize(n);
+  RenderSortEntry* src = entries->data();
+  RenderSortEntry* dst = scratch->data();
+  for (u32 shift = 0; shift < 64; shift += 8) {
+    u32 offset[256] = {};
+    for (u32 i = 0; i < n; ++i) ++offset[(src[i].key >> shift) & 0xFF];
+    if (offset[(src[0].key >> shift) & 0xFF] == n) continue;
+    u32 total = 0;
+    for (u32 b = 0; b < 256; ++b) {
+      u32 count = offset[b];
+      offset[b] = total;
+      total += count;
+    }
+    for (u32 i = 0; i < n; ++i) {
+      dst[offset[(src[i].key >> shift) & 0xFF]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != entries->data()) {
+    memcpy(entries->data(), src, n * sizeof(RenderSortEntry));
+  }
+}
+
+b8 RenderCommandIsShape(RenderCommandType type) {
+  return type == kRenderCommandRectangle ||
+         type == kRenderCommandLineRectangle ||
+         type == kRenderCommandSmoothRectangle ||
+         type == kRenderCommandCircle;
+}
+
+// Sorts the queue into runs and gathers merged geometry in draw order.
+void BuildRenderRuns(const RenderQueue& queue) {
+  RenderQueueState* state = &kRenderQueueState;
+  u32 n = queue.commands.size();
+  state->sorted.resize(n);
+  for (u32 i = 0; i < n; ++i) state->sorted[i] = {queue.commands[i].key, i};
+  SortRenderCommands(&state->sorted, &state->sort_scratch);
+
+  state->runs.clear();
+  state->colors.clear();
+  state->shapes.clear();
+  state->sprites.clear();
+  for (u32 i = 0; i < n; ++i) {
+    const RenderCommand& command = queue.commands[state->sorted[i].command];
+    RenderRun* run = state->runs.empty() ? nullptr : &state->runs.back();
+    if (!run || run->type != command.type ||
+        run->observer != command.observer ||
+        run->texture != command.texture ||
+        command.type == kRenderCommandMesh) {
+      run = &state->runs.emplace_back();
+      run->type = command.type;
+      run->observer = command.observer;
+      run->texture = command.texture;
+      run->begin = i;
+      run->first = state->colors.size();
+      if (RenderCommandIsShape(command.type)) {
+        run->first = state->shapes.size();
+      } else if (command.type == kRenderCommandTexture) {
+        run->first = state->sprites.size();
+      }
+      run->count = 0;
+    }
+    run->end = i + 1;
+    switch (command.type) {
+      case kRenderCommandTriangles:
+      case kRenderCommandLines: {
+        state->colors.insert(
+            state->colors.end(), queue.colors.begin() + command.first,
+            queue.colors.begin() + command.first + command.count);
+        run->count += command.count;
+      } break;
+      case kRenderCommandRectangle:
+      case kRenderCommandLineRectangle:
+      case kRenderCommandSmoothRectangle:
+      case kRenderCommandCircle: {
+        state->shapes.push_back(queue.shapes[command.first]);
+        ++run->count;
+      } break;
+      case kRenderCommandTexture: {
+        state->sprites.insert(
+            state->sprites.end(), queue.sprites.begin() + command.first,
+            queue.sprites.begin() + command.first + command.count);
+        run->count += command.count;
+      } break;
+      default: break;
+    }
+  }
+}
+
+// Orphans the buffer like the sprite batch does so the driver doesn't wait on
+// the last submit's draws, growing it to fit.
+template <typename T>
+void UploadRenderBuffer(GLuint vbo, const std::vector<T>& data,
+                        u32* capacity) {
+  if (data.empty()) return;
+  if (!*capacity) *capacity = 1024;
+  while (*capacity < data.size()) *capacity *= 2;
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, *capacity * sizeof(T), nullptr,
+               GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, data.size() * sizeof(T), data.data());
+}
+
+void UploadRenderRuns() {
+  RenderQueueState* state = &kRenderQueueState;
+  UploadRenderBuffer(state->color_vbo, state->colors, &state->color_capacity);
+  UploadRenderBuffer(state->shape_vbo, state->shapes, &state->shape_capacity);
+  if (!state->sprites.empty()) {
+    u32 count = state->sprites.size() / 4;
+    if (count > kSpriteBatch.capacity) GrowSpriteBatch(count);
+    glBindBuffer(GL_ARRAY_BUFFER, kSpriteBatch.vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 kSpriteBatch.capacity * 4 * sizeof(SpriteVertex), nullptr,
+                 GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0,
+                    state->sprites.size() * sizeof(SpriteVertex),
+                    state->sprites.data());
+  }
+}
+
+// GL 4.1 has no base instance, so the instance attributes are pointed at the
+// run's first instance instead.
+void DrawShapeRun(const RenderRun& run, const ShapeProgram& program,
+                  b8 observer_changed) {
+  RenderQueueState* state = &kRenderQueueState;
+  glBindVertexArray(program.vao);
+  if (observer_changed) {
+    glUniformMatrix4fv(program.matrix_uniform, 1, GL_FALSE,
+                       &state->view_projection[run.observer].data_[0]);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, state->shape_vbo);
+  uintptr_t offset = run.first * sizeof(ShapeInstance);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance),
+                        (void*)(offset + offsetof(ShapeInstance, rect)));
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance),
+                        (void*)(offset + offsetof(ShapeInstance, color)));
+  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance),
+                        (void*)(offset + offsetof(ShapeInstance, params)));
+  if (run.type == kRenderCommandLineRectangle) {
+    glDrawArraysInstanced(GL_LINE_LOOP, 6, 4, run.count);
+  } else {
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, run.count);
+  }
+  ++state->stats.draw_calls;
+}
+
+void DrawMeshRun(const RenderQueue& queue, const RenderRun& run) {
+  RenderQueueState* state = &kRenderQueueState;
+  // The immediate RenderMesh reads the observer for its uniforms.
+  Observer observer = kObserver;
+  kObserver = queue.observers[run.observer];
+  for (u32 i = run.begin; i < run.end; ++i) {
+    const RenderCommand& command = queue.commands[state->sorted[i].command];
+    const MeshCommand& mesh = queue.meshes[command.first];
+    glBindVertexArray(mesh.mesh->vao);
+    RenderMesh(*mesh.mesh, mesh.model, mesh.color);
+    ++state->stats.draw_calls;
+  }
+  kObserver = observer;
+}
+
+// Draws the queue's commands and clears it. Call from the GL thread.
+void SubmitRenderQueue(RenderQueue* queue) {
+  RenderQueueState* state = &kRenderQueueState;
+  if (queue->commands.empty()) {
+    ClearRenderQueue(queue);
+    return;
+  }
+  FlushBatches();
+  state->stats.commands += queue->commands.size();
+  state->view_projection.resize(queue->observers.size());
+  for (u32 i = 0; i < queue->observers.size(); ++i) {
+    state->view_projection[i] =
+        queue->observers[i].projection * queue->observers[i].view;
+  }
+  BuildRenderRuns(*queue);
+  UploadRenderRuns();
+
+  GLuint program = 0;
+  s32 observer = -1;
+  for (const RenderRun& run : state->runs) {
+    GLuint run_program;
+    switch (run.type) {
+      case kRenderCommandTriangles:
+      case kRenderCommandLines: run_program = state->color_program; break;
+      case kRenderCommandRectangle:
+      case kRenderCommandLineRectangle:
+        run_program = state->rectangle.reference;
+        break;
+      case kRenderCommandSmoothRectangle:
+        run_program = state->smooth_rectangle.reference;
+        break;
+      case kRenderCommandCircle:
+        run_program = state->circle.reference;
+        break;
+      case kRenderCommandTexture: run_program = kSpriteBatch.program; break;
+      case kRenderCommandMesh:
+        run_program = kRGG.geometry_program_3d.reference;
+        break;
+    }
+    if (run_program != program) {
+      glUseProgram(run_program);
+      program = run_program;
+      // Uniforms are per program.
+      observer = -1;
+    }
+    b8 observer_changed = observer != run.observer;
+    observer = run.observer;
+    const Mat4f& matrix = state->view_projection[run.observer];
+    switch (run.type) {
+      case kRenderCommandTriangles:
+      case kRenderCommandLines: {
+        glBindVertexArray(state->color_vao);
+        if (observer_changed) {
+          glUniformMatrix4fv(state->color_matrix_uniform, 1, GL_FALSE,
+                             &matrix.data_[0]);
+        }
+        glDrawArrays(
+            run.type == kRenderCommandTriangles ? GL_TRIANGLES : GL_LINES,
+            run.first, run.count);
+        ++state->stats.draw_calls;
+      } break;
+      case kRenderCommandRectangle:
+      case kRenderCommandLineRectangle: {
+        DrawShapeRun(run, state->rectangle, observer_changed);
+      } break;
+      case kRenderCommandSmoothRectangle: {
+        DrawShapeRun(run, state->smooth_rectangle, observer_changed);
+      } break;
+      case kRenderCommandCircle: {
+        DrawShapeRun(run, state->circle, observer_changed);
+      } break;
+      case kRenderCommandTexture: {
+        glBindVertexArray(kSpriteBatch.vao);
+        if (observer_changed) {
+          glUniformMatrix4fv(kSpriteBatch.matrix_uniform, 1, GL_FALSE,
+                             &matrix.data_[0]);
+        }
+        glBindTexture(GL_TEXTURE_2D, run.texture);
+        glDrawElements(GL_TRIANGLES, run.count / 4 * 6, GL_UNSIGNED_INT,
+                       (void*)(uintptr_t)(run.first / 4 * 6 * sizeof(u32)));
+        ++state->stats.draw_calls;
+      } break;
+      case kRenderCommandMesh: {
+        DrawMeshRun(*queue, run);
+      } break;
+    }
+  }
+  ClearRenderQueue(queue);
+}
@@ -104,18 +104,31 @@ struct DebugRect {
 
 constexpr s32 kHexVertCount = 18;
 
-DECLARE_ARRAY(DebugSphere, 8);
-DECLARE_ARRAY(DebugCube, 128);
-DECLARE_ARRAY(DebugPoint, 128);
-DECLARE_ARRAY(DebugRect, 512);
+// Debug views can push thousands of these a frame - physics collision rects
+// for instance - so they grow rather than drop pushes past a fixed count.
+DECLARE_GROWABLE_ARRAY(DebugSphere, 8);
+DECLARE_GROWABLE_ARRAY(DebugCube, 128);
+DECLARE_GROWABLE_ARRAY(DebugPoint, 128);
+DECLARE_GROWABLE_ARRAY(DebugRect, 512);
 
 static Observer kObserver;
 static RGG kRGG;
 
 #include "opengl3_texture.cc"
+#include "opengl3_sprite_batch.cc"
 #include "texture_cache.cc"
+#include "texture_atlas.cc"
+#include "render_target.cc"
 #include "opengl3_ui.cc"
 #include "camera.cc"
+#include "opengl3_render_queue.cc"
+#include "opengl3_line_batch.cc"
+#include "opengl3_tilemap.cc"
+
+void FlushBatches() {
+  FlushSprites();
+  FlushText();
+}
 
 Mat4f DefaultPerspective(const v2f& dims, r32 fov = 64.f) {
   return math::Perspective(fov, dims.x / dims.y, 1.f, 1000.f);
@@ -130,6 +143,7 @@ class ModifyObserver
  public:
   ModifyObserver(const Mat4f& proj, const Mat4f& view)
   {
+    FlushBatches();
     projection_ = kObserver.projection;
     view_ = kObserver.view;
     kObserver.projection = proj;
@@ -138,6 +152,7 @@ class ModifyObserver
 
   ModifyObserver(const rgg::Camera& camera)
   {
+    FlushBatches();
     projection_ = kObserver.projection;
     view_ = kObserver.view;
     kObserver.projection =
@@ -148,6 +163,7 @@ class ModifyObserver
 
   ~ModifyObserver()
   {
+    FlushBatches();
     kObserver.projection = projection_;
     kObserver.view = view_;
   }
@@ -318,6 +334,24 @@ void DebugReset() {
   kUsedDebugRect = 0;
 }
 
+// Draws anything still batched and rolls this frame's render stats over.
+// Call once per frame before swapping buffers.
+void EndFrame() {
+  FlushBatches();
+  UploadDecodedTextures();
+  UpdateRenderTargets();
+  kSpriteBatch.last_frame = kSpriteBatch.stats;
+  kSpriteBatch.stats = {};
+  kUI.last_frame = kUI.stats;
+  kUI.stats = {};
+  kRenderQueueState.last_frame = kRenderQueueState.stats;
+  kRenderQueueState.stats = {};
+  kLineBatchState.last_frame = kLineBatchState.stats;
+  kLineBatchState.stats = {};
+  kTilemapState.last_frame = kTilemapState.stats;
+  kTilemapState.stats = {};
+}
+
 b8 Initialize() {
   const GLubyte* renderer = glGetString(GL_RENDERER);
   const GLubyte* version = glGetString(GL_VERSION);
@@ -410,6 +444,26 @@ b8 Initialize() {
     return false;
   }
 
+  if (!SetupSpriteBatch()) {
+    LOG(WARN, "Failed to setup SpriteBatch.");
+    return false;
+  }
+
+  if (!SetupRenderQueue()) {
+    LOG(WARN, "Failed to setup RenderQueue.");
+    return false;
+  }
+
+  if (!SetupLineBatch()) {
+    LOG(WARN, "Failed to setup LineBatch.");
+    return false;
+  }
+
+  if (!SetupTilemap()) {
+    LOG(WARN, "Failed to setup Tilemap.");
+    return false;
+  }
+
   if (!SetupUI()) {
     LOG(WARN, "Failed to setup UI.");
     return false;
@@ -434,6 +488,7 @@ RenderTag CreateRenderable(int vert_count, GLfloat* verts, GLenum mode) {
 
 void RenderTag(const RenderTag& tag, const v3f& position, const v3f& scale,
                const Quatf& orientation, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   glBindVertexArray(tag.vao_reference);
   // Translate and rotate the triangle appropriately.
@@ -448,6 +503,7 @@ void RenderTag(const RenderTag& tag, const v3f& position, const v3f& scale,
 
 void RenderTriangle(const v3f& position, const v3f& scale,
                     const Quatf& orientation, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   glBindVertexArray(kRGG.triangle_vao_reference);
   // Translate and rotate the triangle appropriately.
@@ -461,6 +517,7 @@ void RenderTriangle(const v3f& position, const v3f& scale,
 }
 
 void RenderTriangle(const v2f& p, r32 half_height, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   glBindVertexArray(kTextureState.vao_reference);
   Mat4f view_projection = kObserver.projection * kObserver.view;
@@ -482,6 +539,7 @@ void RenderTriangle(const v2f& p, r32 half_height, const v4f& color) {
 
 void RenderRectangle(const v3f& position, const v3f& scale,
                      const Quatf& orientation, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   glBindVertexArray(kRGG.rectangle_vao_reference);
   // Translate and rotate the rectangle appropriately.
@@ -495,6 +553,7 @@ void RenderRectangle(const v3f& position, const v3f& scale,
 }
 
 void RenderRectangle(const Rectf& rect, r32 z, r32 rotation, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   // Texture state has quad with length 1 geometry. This makes scaling simpler
   // as we can use the width / height directly in scale matrix.
@@ -525,6 +584,7 @@ void RenderRectangle(const Rectf& rect, const v4f& color) {
 void RenderLine(const v3f& start, const v3f& end, const v4f& color);
 
 void RenderLineRectangle(const Rectf& rect, r32 z, r32 rotate, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   // Texture state has quad with length 1 geometry. This makes scaling simpler
   // as we can use the width / height directly in scale matrix.
@@ -551,6 +611,7 @@ void RenderLineRectangle(const Rectf& rect, const v4f& color) {
 }
 
 void RenderSmoothRectangle(const Rectf& rect, r32 smoothing_radius, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.smooth_rectangle_program.reference);
   glBindVertexArray(kTextureState.vao_reference_static);
   v3f pos(rect.x + rect.width / 2.f, rect.y + rect.height / 2.f, 0.0f);
@@ -569,6 +630,7 @@ void RenderSmoothRectangle(const Rectf& rect, r32 smoothing_radius, const v4f& c
 }
 
 void RenderCircle(const v3f& position, r32 inner_radius, r32 outer_radius, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.circle_program.reference);
   glBindVertexArray(kTextureState.vao_reference_static);
   // Translate and rotate the circle appropriately.
@@ -591,6 +653,7 @@ void RenderCircle(const v3f& position, r32 radius, const v4f& color) {
 }
 
 void RenderLine(const v3f& start, const v3f& end, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program.reference);
   glBindVertexArray(kRGG.line_vao_reference);
   // Model matrix unneeded here due to verts being set directly.
@@ -605,66 +668,6 @@ void RenderLine(const v3f& start, const v3f& end, const v4f& color) {
   glDrawArrays(GL_LINES, 0, 2);
 }
 
-struct LineBatch {
-  LineBatch() {
-    data.reserve(48);
-  }
-  void AddLine(const v2f& start, const v2f& end) {
-    data.insert(data.end(), {start.x, start.y, 0.f, end.x, end.y, 0.f});
-  }
-  size_t Size() const {
-    return data.size() * sizeof(r32);
-  }
-  const r32* Data() const {
-    return data.data();
-  }
-  size_t Count() const {
-    return data.size() / 3;
-  }
-  std::vector<r32> data;
-};
-
-void RenderLineBatch(const LineBatch& batch, const v4f& color) {
-  glUseProgram(kRGG.geometry_program.reference);
-  glBindVertexArray(kRGG.line_vao_reference);
-  // Model matrix unneeded here due to verts being set directly.
-  Mat4f view_pojection = kObserver.projection * kObserver.view;
-  glUniform4f(kRGG.geometry_program.color_uniform, color.x, color.y, color.z,
-              color.w);
-  glUniformMatrix4fv(kRGG.geometry_program.matrix_uniform, 1, GL_FALSE,
-                     &view_pojection.data_[0]);
-  glBindBuffer(GL_ARRAY_BUFFER, kRGG.line_vbo_reference);
-  glBufferData(GL_ARRAY_BUFFER, batch.Size(), batch.Data(), GL_DYNAMIC_DRAW);
-  glDrawArrays(GL_LINES, 0, batch.Count());
-
-}
-
-void RenderGrid(const v2f& grid, const Rectf& bounds, uint64_t color_count, v4f* color) {
-  // Prepare Geometry and color
-  glUseProgram(kRGG.geometry_program.reference);
-  glBindVertexArray(kRGG.line_vao_reference);
-
-  // Draw horizontal lines.
-  const v2f top_right(bounds.x + bounds.width, bounds.y + bounds.height);
-  s32 i = 0;
-  for (r32 y = bounds.y; y <= top_right.y; y += grid.y) {
-    auto start = v3f(bounds.x, y, 0.f);
-    auto end = v3f(top_right.x, y, 0.f);
-    RenderLine(start, end, *color);
-    i += 1;
-    i = (i != color_count) * i;
-  }
-
-  // Draw vertical lines.
-  i = 0;
-  for (r32 x = bounds.x; x <= top_right.x; x += grid.x) {
-    auto start = v3f(x, bounds.y, 0.f);
-    auto end = v3f(x, top_right.y, 0.f);
-    RenderLine(start, end, *color);
-    i += 1;
-    i = (i != color_count) * i;
-  }
-}
 void SetDefaultSurfaceMaterial() {
   // Set some reasonable lighting defaults.
   glUniform3f(kRGG.geometry_program_3d.suface_specular_uniform,
@@ -676,6 +679,7 @@ void SetDefaultSurfaceMaterial() {
 }
 
 void Render3d(const v3f& pos, const v3f& scale, const v4f& color, GLuint vao, s32 verts) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program_3d.reference);
   glBindVertexArray(vao);
   Mat4f model = math::Model(pos, scale);
@@ -695,6 +699,7 @@ void Render3d(const v3f& pos, const v3f& scale, const v4f& color, GLuint vao, s3
 }
 
 void Render3d(const v3f& pos, const v3f& scale, const v4f& color, GLuint vao, s32 verts, const Mat4f& perspective) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program_3d.reference);
   glBindVertexArray(vao);
   Mat4f model = math::Model(pos, scale);
@@ -714,6 +719,7 @@ void Render3d(const v3f& pos, const v3f& scale, const v4f& color, GLuint vao, s3
 }
 
 void Render3dWithRotation(const v3f& pos, const v3f& scale, const Quatf& quat, const v4f& color, GLuint vao, s32 verts) {
+  FlushBatches();
   glUseProgram(kRGG.geometry_program_3d.reference);
   glBindVertexArray(vao);
   Mat4f model = math::Model(pos, scale, quat);
@@ -748,7 +754,7 @@ void RenderMesh(const Mesh& mesh, const Mat4f& model, const v4f& color = v4f(1.f
               kObserver.position.z);
   if (!mesh.material_count) {
     SetDefaultSurfaceMaterial();
-    glDrawArrays(GL_TRIANGLES, 0, mesh.vert_count);
+    glDrawElements(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, nullptr);
   } else {
     for (s32 i = 0; i < (s32)mesh.material_count; ++i) {
       const Material* mat = &mesh.material[i];
@@ -761,7 +767,9 @@ void RenderMesh(const Mesh& mesh, const Mat4f& model, const v4f& color = v4f(1.f
       for (s32 j = 0; j < mat->vert_pair_count; ++j) {
         // Set surface lighting properties.
         const MaterialVertPair* vp = &mat->vert_pair[j];
-        glDrawArrays(GL_TRIANGLES, (GLint)vp->first, (GLint)vp->count);
+        if (!vp->count) continue;
+        glDrawElements(GL_TRIANGLES, (GLsizei)vp->count, GL_UNSIGNED_INT,
+                       (void*)(vp->first * sizeof(GLuint)));
       }
     }
   }
@@ -769,6 +777,7 @@ void RenderMesh(const Mesh& mesh, const Mat4f& model, const v4f& color = v4f(1.f
 
 // Leaving color as default will only use lighting properties.
 void RenderMesh(const Mesh& mesh, const v3f& pos, const v3f& scale, const Quatf& quat, const v4f& color = v4f(1.f, 1.f, 1.f, 1.f)) {
+  FlushBatches();
   if (!mesh.IsValid()) return;
   glUseProgram(kRGG.geometry_program_3d.reference);
   glBindVertexArray(mesh.vao);
@@ -779,6 +788,7 @@ void RenderMesh(const Mesh& mesh, const v3f& pos, const v3f& scale, const Quatf&
 void RenderMesh(const Mesh& mesh, const v3f& pos, const v3f& scale,
            r32 x_rotation, r32 y_rotation, r32 z_rotation,
            const v4f& color = v4f(1.f, 1.f, 1.f, 1.f)) {
+  FlushBatches();
   if (!mesh.IsValid()) return;
   glUseProgram(kRGG.geometry_program_3d.reference);
   glBindVertexArray(mesh.vao);
@@ -816,58 +826,17 @@ void RenderSphere(v3f pos, v3f scale, const v4f& color) {
 }
 
 void RenderLineCube(const Cubef& cube, const v4f& color) {
-  glUseProgram(kRGG.geometry_program.reference);
-  Mat4f matrix = kObserver.view * kObserver.projection;
-  glUniform4f(kRGG.geometry_program_3d.color_uniform, color.x, color.y,
-              color.z, color.w);
-  glUniformMatrix4fv(kRGG.geometry_program.matrix_uniform, 1, GL_FALSE,
-                     &matrix.data_[0]);
-  v3f pos =
-      cube.pos - v3f(cube.width / 2.f, cube.height / 2.f, cube.depth / 2.f);
-  v3f back_top_left = pos + v3f(0.f, cube.height, 0.f);
-  v3f back_top_right = pos + v3f(cube.width, cube.height, 0.f);
-  v3f back_bottom_left = pos;
-  v3f back_bottom_right = pos + v3f(cube.width, 0.f, 0.f);
-
-
-  v3f front_top_left = pos + v3f(0.f, cube.height, cube.depth);
-  v3f front_top_right = pos + v3f(cube.width, cube.height, cube.depth);
-  v3f front_bottom_left = pos + v3f(0.f, 0.f, cube.depth);;
-  v3f front_bottom_right = pos + v3f(cube.width, 0.f, cube.depth);
-
-  // TODO(abrunasso): Probably a cheapear way to do this.
-
-  // Draw back face
-  RenderLine(back_bottom_left, back_top_left, color);
-  RenderLine(back_bottom_left, back_bottom_right, color);
-  RenderLine(back_bottom_right, back_top_right, color);
-  RenderLine(back_top_left, back_top_right, color);
-
-  // Connecting edges between back and front.
-  RenderLine(back_bottom_left, front_bottom_left, color);
-  RenderLine(back_bottom_right, front_bottom_right, color);
-  RenderLine(back_top_left, front_top_left, color);
-  RenderLine(back_top_right, front_top_right, color);
-
-  // Draw front face.
-  RenderLine(front_bottom_left, front_top_left, color);
-  RenderLine(front_bottom_left, front_bottom_right, color);
-  RenderLine(front_bottom_right, front_top_right, color);
-  RenderLine(front_top_left, front_top_right, color);
+  LineBatch* batch = &kLineBatchState.scratch;
+  batch->Clear();
+  batch->AddCube(cube, color);
+  RenderLineBatch(*batch);
 }
 
 void RenderLineHexagon(const v3f& center, r32 size, const v4f& color) {
-  v3f points[6];
-  for (s32 i = 1; i <= 6; ++i) {
-    points[i - 1] = v3f(math::HexCorner(center.xy(), 5.f, i));
-    points[i - 1].z = center.z;
-  }
-  RenderLine(points[5], points[0], color);
-  RenderLine(points[0], points[1], color);
-  RenderLine(points[1], points[2], color);
-  RenderLine(points[2], points[3], color);
-  RenderLine(points[3], points[4], color);
-  RenderLine(points[4], points[5], color);
+  LineBatch* batch = &kLineBatchState.scratch;
+  batch->Clear();
+  batch->AddHexagon(center, size, color);
+  RenderLineBatch(*batch);
 }
 
 void RenderProgressBar(const Rectf& rect, r32 z, r32 current_progress,
@@ -884,34 +853,44 @@ void RenderProgressBar(const Rectf& rect, r32 z, r32 current_progress,
   RenderLineRectangle(rect, z, 0.f, outline_color);
 }
 
+// Reused by the debug primitives so their commands don't allocate per frame.
+static RenderQueue kDebugRenderQueue;
+
 void DebugRenderWorldPrimitives() {
   // Perspetive / world debugging.
-  for (s32 i = 0; i < kUsedDebugSphere; ++i) {
+  for (u32 i = 0; i < kUsedDebugSphere; ++i) {
     r32 r = kDebugSphere[i].radius;
     rgg::RenderSphere(kDebugSphere[i].position, v3f(r, r, r),
                       kDebugSphere[i].color);
   }
 
-  for (s32 i = 0; i < kUsedDebugCube; ++i) {
+  LineBatch* lines = &kLineBatchState.scratch;
+  lines->Clear();
+  for (u32 i = 0; i < kUsedDebugCube; ++i) {
     if (kDebugCube[i].fill) {
       rgg::RenderCube(kDebugCube[i].cube, kDebugCube[i].color);
     } else {
-      rgg::RenderLineCube(kDebugCube[i].cube, kDebugCube[i].color);
+      lines->AddCube(kDebugCube[i].cube, kDebugCube[i].color);
     }
   }
+  RenderLineBatch(*lines);
 
-  for (s32 i = 0; i < kUsedDebugPoint; ++i) {
+  RenderQueue* queue = &kDebugRenderQueue;
+  SetRenderObserver(queue, kObserver);
+  for (u32 i = 0; i < kUsedDebugPoint; ++i) {
     if (kDebugPoint[i].type != kDebugWorld) continue;
     DebugPoint* point = &kDebugPoint[i];
-    rgg::RenderCircle(point->position, point->radius, point->color);
+    rgg::RenderCircle(queue, point->position, point->radius, point->color);
   }
 
-  for (s32 i = 0; i < kUsedDebugRect; ++i) {
+  // Rects draw over points.
+  SetRenderLayer(queue, 1);
+  for (u32 i = 0; i < kUsedDebugRect; ++i) {
     if (kDebugRect[i].type != kDebugWorld) continue;
     DebugRect* rect = &kDebugRect[i];
-    //printf("...\n");
-    rgg::RenderLineRectangle(rect->rect, rect->color);
+    rgg::RenderLineRectangle(queue, rect->rect, rect->color);
   }
+  SubmitRenderQueue(queue);
 }
 
 void DebugRenderUIPrimitives() {
@@ -922,17 +901,21 @@ void DebugRenderUIPrimitives() {
   rgg::ModifyObserver mod(math::Ortho2(dims.x, 0.0f, dims.y, 0.0f, 0.0f, 0.0f),
                           math::Identity());
 
-  for (s32 i = 0; i < kUsedDebugPoint; ++i) {
+  RenderQueue* queue = &kDebugRenderQueue;
+  SetRenderObserver(queue, kObserver);
+  for (u32 i = 0; i < kUsedDebugPoint; ++i) {
     if (kDebugPoint[i].type != kDebugUI) continue;
     DebugPoint* point = &kDebugPoint[i];
-    rgg::RenderCircle(point->position, point->radius, point->color);
+    rgg::RenderCircle(queue, point->position, point->radius, point->color);
   }
 
-  for (s32 i = 0; i < kUsedDebugRect; ++i) {
+  SetRenderLayer(queue, 1);
+  for (u32 i = 0; i < kUsedDebugRect; ++i) {
     if (kDebugRect[i].type != kDebugUI) continue;
     DebugRect* rect = &kDebugRect[i];
-    rgg::RenderLineRectangle(rect->rect, rect->color);
+    rgg::RenderLineRectangle(queue, rect->rect, rect->color);
   }
+  SubmitRenderQueue(queue);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glEnable(GL_DEPTH_TEST);
 }
@@ -175,8 +175,8 @@ inline constexpr const char* kCircleFragmentShader = R"(
 inline constexpr const char* kFontVertexShader = R"(
   #version 410
   layout (location = 0) in vec4 text_pos;
+  layout (location = 1) in vec4 color;
   uniform mat4 matrix;
-  uniform vec4 color;
   out vec4 color_out;
   out vec2 texture_coordinates;
   void main() {
@@ -198,28 +198,155 @@ inline constexpr const char* kFontFragmentShader = R"(
   }
 )";
 
-inline constexpr const char* kTextureVertexShader = R"(
+inline constexpr const char* kSpriteVertexShader = R"(
   #version 410
-  layout (location = 0) in vec3 vertex_position;
+  layout (location = 0) in vec2 vertex_position;
   layout (location = 1) in vec2 uv_position;
+  layout (location = 2) in vec4 vertex_color;
   uniform mat4 matrix;
   out vec2 texture_coordinates;
+  out vec4 tint;
   void main() {
-  	texture_coordinates = uv_position;
-  	gl_Position = matrix * vec4(vertex_position, 1.0);
+    texture_coordinates = uv_position;
+    tint = vertex_color;
+    gl_Position = matrix * vec4(vertex_position, 0.0, 1.0);
   }
 )";
 
-inline constexpr const char* kTextureFragmentShader = R"(
+inline constexpr const char* kSpriteFragmentShader = R"(
   #version 410
   in vec2 texture_coordinates;
+  in vec4 tint;
   uniform sampler2D basic_texture;
   layout(location = 0) out vec4 frag_color;
   void main() {
-  	frag_color = texture(basic_texture, texture_coordinates);
-  	//frag_color = vec4(1.0, 0.0, 0.0, 1.0);
+    frag_color = texture(basic_texture, texture_coordinates) * tint;
+  }
+)";
+
+
+inline constexpr const char* kColorVertexShader = R"(
+  #version 410
+  layout (location = 0) in vec3 vertex_position;
+  layout (location = 1) in vec4 vertex_color;
+  uniform mat4 matrix;
+  out vec4 color_out;
+  void main() {
+    color_out = vertex_color;
+    gl_Position = matrix * vec4(vertex_position, 1.0);
+  }
+)";
+
+// Instanced shapes for RenderQueue. Each instance carries its rect, color and
+// a params vector whose meaning depends on the shape.
+
+// params is z, cos and sin of the rotation. Corners are 0 or 1 so the
+// unrotated corners land exactly where Rectf::Polygon puts them.
+inline constexpr const char* kRectangleInstanceVertexShader = R"(
+  #version 410
+  layout (location = 0) in vec2 corner;
+  layout (location = 1) in vec4 rect;
+  layout (location = 2) in vec4 color;
+  layout (location = 3) in vec4 params;
+  uniform mat4 matrix;
+  out vec4 color_out;
+  void main() {
+    vec2 p = rect.xy + corner * rect.zw;
+    if (params.z != 0.0) {
+      vec2 center = rect.xy + 0.5 * rect.zw;
+      vec2 d = p - center;
+      p = center + vec2(d.x * params.y - d.y * params.z,
+                        d.x * params.z + d.y * params.y);
+    }
+    color_out = color;
+    gl_Position = matrix * vec4(p, params.x, 1.0);
   }
 )";
 
+// rect is the center and dimensions. params is z then the smoothing radius.
+inline constexpr const char* kSmoothRectangleInstanceVertexShader = R"(
+  #version 410
+  layout (location = 0) in vec3 vertex_position;
+  layout (location = 1) in vec4 rect;
+  layout (location = 2) in vec4 color;
+  layout (location = 3) in vec4 params;
+  uniform mat4 view_projection;
+  out vec4 color_out;
+  out float smoothing_radius_out;
+  out vec3 center_out;
+  out vec3 position_out;
+  void main() {
+    smoothing_radius_out = params.y;
+    color_out = color;
+    center_out = vec3(rect.xy, params.x);
+    position_out = vec3(rect.xy + vertex_position.xy * rect.zw, params.x);
+    gl_Position = view_projection * vec4(position_out, 1.0);
+  }
+)";
+
+// rect is the center and dimensions. params is z then the inner and outer
+// radius.
+inline constexpr const char* kCircleInstanceVertexShader = R"(
+  #version 410
+  layout (location = 0) in vec3 vertex_position;
+  layout (location = 1) in vec4 rect;
+  layout (location = 2) in vec4 color;
+  layout (location = 3) in vec4 params;
+  uniform mat4 view_projection;
+  out vec4 color_out;
+  out vec3 center_out;
+  out vec3 position_out;
+  out float out_inner_radius;
+  out float out_outer_radius;
+  void main() {
+    color_out = color;
+    center_out = vec3(rect.xy, params.x);
+    position_out = vec3(rect.xy + vertex_position.xy * rect.zw, params.x);
+    out_inner_radius = params.y;
+    out_outer_radius = params.z;
+    gl_Position = view_projection * vec4(position_out, 1.0);
+  }
+)";
+
+// Tilemaps draw one quad over the visible part of the map. The fragment
+// shader looks its cell's tile up in the cells texture then samples that
+// tile's rect in the tile set texture. Tile 0 is empty.
+inline constexpr const char* kTilemapVertexShader = R"(
+  #version 410
+  layout (location = 0) in vec2 corner;
+  uniform mat4 matrix;
+  uniform vec4 bounds;
+  out vec2 world_position;
+  void main() {
+    world_position = bounds.xy + corner * bounds.zw;
+    gl_Position = matrix * vec4(world_position, 0.0, 1.0);
+  }
+)";
+
+inline constexpr const char* kTilemapFragmentShader = R"(
+  #version 410
+  in vec2 world_position;
+  uniform vec2 origin;
+  uniform vec2 tile_size;
+  uniform vec2 texture_size;
+  uniform vec4 tiles[256];
+  uniform usampler2D cells;
+  uniform sampler2D tile_texture;
+  layout(location = 0) out vec4 frag_color;
+  void main() {
+    vec2 cell_position = (world_position - origin) / tile_size;
+    ivec2 cell = clamp(ivec2(floor(cell_position)), ivec2(0),
+                       textureSize(cells, 0) - 1);
+    uint tile = texelFetch(cells, cell, 0).r;
+    if (tile == 0u) discard;
+    vec4 src = tiles[tile];
+    vec2 uv = (src.xy + fract(cell_position) * src.zw) / texture_size;
+    // Gradients from the unwrapped position so mip selection doesn't jump at
+    // tile edges.
+    vec2 uv_unwrapped = cell_position * src.zw / texture_size;
+    frag_color = textureGrad(tile_texture, uv, dFdx(uv_unwrapped),
+                             dFdy(uv_unwrapped));
+  }
+)";
 
 }
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Collects textured quads so RenderTexture costs a draw call per run of
+// sprites sharing a texture instead of one per sprite.
+//
+// Sprites are held until something else needs the GPU - another rgg draw
+// function, an observer or render target change, an imui scissor change or
+// EndFrame. Code that changes GL state directly between RenderTexture calls
+// must call FlushBatches first.
+//
+// Outside a ScopedSpriteLayer sprites are drawn in the order they were
+// submitted and only neighbors with the same texture share a draw. Inside one
+// sprites are grouped by texture, so only use it for sprites that don't
+// overlap each other:
+//
+//   {
+//     rgg::ScopedSpriteLayer layer;
+//     for (const Cell& cell : grid) rgg::RenderTexture(...);
+//   }
+//
+// The vertex buffer is orphaned each flush rather than persistently mapped.
+// Persistent mapping needs GL 4.4 and the shaders target 4.1.
+
+// Text is batched separately in opengl3_ui.cc. Each batch flushes the other
+// before taking a quad so only one holds anything at a time.
+void FlushText();
+
+struct SpriteVertex {
+  v2f position;
+  UV uv;
+  // RGBA8.
+  u32 color;
+};
+
+struct Sprite {
+  // Layer in the high bits. Submission run outside a layer or texture inside
+  // one in the low bits.
+  u64 key;
+  GLuint texture;
+  // First of the sprite's four vertices.
+  u32 vertex;
+};
+
+struct SpriteStats {
+  // Sprites submitted. Before batching each of these was a draw call.
+  u32 sprites = 0;
+  u32 draw_calls = 0;
+};
+
+struct SpriteBatch {
+  GLuint program;
+  GLuint matrix_uniform;
+  GLuint texture_uniform;
+  GLuint vao;
+  GLuint vbo;
+  GLuint ibo;
+  // Sprites the vertex and index buffers have room for.
+  u32 capacity = 0;
+  std::vector<Sprite> sprites;
+  std::vector<SpriteVertex> vertices;
+  // Vertices in draw order when the sprites needed sorting.
+  std::vector<SpriteVertex> sorted;
+  u32 layer = 0;
+  // Bumped each time the texture changes outside a layer.
+  u32 run = 0;
+  GLuint last_texture = 0;
+  s32 layer_depth = 0;
+  b8 needs_sort = false;
+  // When false every sprite is flushed on its own, for comparison.
+  b8 enabled = true;
+  SpriteStats stats;
+  SpriteStats last_frame;
+};
+
+static SpriteBatch kSpriteBatch;
+
+b8 SetupSpriteBatch() {
+  SpriteBatch* batch = &kSpriteBatch;
+  GLuint vert_shader, frag_shader;
+  if (!GLCompileShader(GL_VERTEX_SHADER, &kSpriteVertexShader,
+                       &vert_shader)) {
+    return false;
+  }
+  if (!GLCompileShader(GL_FRAGMENT_SHADER, &kSpriteFragmentShader,
+                       &frag_shader)) {
+    return false;
+  }
+  if (!GLLinkShaders(&batch->program, 2, vert_shader, frag_shader)) {
+    return false;
+  }
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  batch->matrix_uniform = glGetUniformLocation(batch->program, "matrix");
+  assert(batch->matrix_uniform != u32(-1));
+  batch->texture_uniform =
+      glGetUniformLocation(batch->program, "basic_texture");
+
+  glGenVertexArrays(1, &batch->vao);
+  glBindVertexArray(batch->vao);
+  glGenBuffers(1, &batch->vbo);
+  glGenBuffers(1, &batch->ibo);
+  glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (void*)offsetof(SpriteVertex, position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                        (void*)offsetof(SpriteVertex, uv));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex),
+                        (void*)offsetof(SpriteVertex, color));
+  return true;
+}
+
+// Sizes the buffers for at least count sprites. Indices never change so they
+// are only written here.
+void GrowSpriteBatch(u32 count) {
+  SpriteBatch* batch = &kSpriteBatch;
+  u32 capacity = batch->capacity ? batch->capacity : 1024;
+  while (capacity < count) capacity *= 2;
+  std::vector<u32> indices(capacity * 6);
+  for (u32 i = 0; i < capacity; ++i) {
+    u32 v = i * 4;
+    u32* idx = &indices[i * 6];
+    idx[0] = v;
+    idx[1] = v + 1;
+    idx[2] = v + 2;
+    idx[3] = v;
+    idx[4] = v + 2;
+    idx[5] = v + 3;
+  }
+  // The element buffer binding is part of the vao.
+  glBindVertexArray(batch->vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u32),
+               indices.data(), GL_STATIC_DRAW);
+  batch->capacity = capacity;
+}
+
+void FlushSprites() {
+  SpriteBatch* batch = &kSpriteBatch;
+  u32 count = batch->sprites.size();
+  if (!count) return;
+  if (count > batch->capacity) GrowSpriteBatch(count);
+  const SpriteVertex* vertices = batch->vertices.data();
+  if (batch->needs_sort) {
+    std::stable_sort(batch->sprites.begin(), batch->sprites.end(),
+                     [](const Sprite& a, const Sprite& b) {
+      return a.key < b.key;
+    });
+    batch->sorted.resize(batch->vertices.size());
+    for (u32 i = 0; i < count; ++i) {
+      memcpy(&batch->sorted[i * 4], &batch->vertices[batch->sprites[i].vertex],
+             4 * sizeof(SpriteVertex));
+    }
+    vertices = batch->sorted.data();
+  }
+
+  glUseProgram(batch->program);
+  glBindVertexArray(batch->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+  // Orphan the old storage so the driver doesn't wait on draws still reading
+  // it.
+  glBufferData(GL_ARRAY_BUFFER, batch->capacity * 4 * sizeof(SpriteVertex),
+               nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(SpriteVertex),
+                  vertices);
+  Mat4f matrix = kObserver.projection * kObserver.view;
+  glUniformMatrix4fv(batch->matrix_uniform, 1, GL_FALSE, &matrix.data_[0]);
+
+  u32 first = 0;
+  for (u32 i = 1; i <= count; ++i) {
+    if (i < count && batch->sprites[i].texture == batch->sprites[first].texture)
+      continue;
+    glBindTexture(GL_TEXTURE_2D, batch->sprites[first].texture);
+    glDrawElements(GL_TRIANGLES, (i - first) * 6, GL_UNSIGNED_INT,
+                   (void*)(uintptr_t)(first * 6 * sizeof(u32)));
+    ++batch->stats.draw_calls;
+    first = i;
+  }
+
+  batch->sprites.clear();
+  batch->vertices.clear();
+  batch->layer = 0;
+  batch->run = 0;
+  batch->last_texture = 0;
+  batch->needs_sort = false;
+}
+
+// Sprites submitted in scope are drawn after everything before it and grouped
+// by texture.
+class ScopedSpriteLayer {
+ public:
+  ScopedSpriteLayer() {
+    ++kSpriteBatch.layer;
+    ++kSpriteBatch.layer_depth;
+  }
+
+  ~ScopedSpriteLayer() {
+    ++kSpriteBatch.layer;
+    kSpriteBatch.last_texture = 0;
+    --kSpriteBatch.layer_depth;
+  }
+};
+
+u32 PackColor(const v4f& color) {
+  return (u32)(CLAMPF(color.x, 0.f, 1.f) * 255.f + .5f) |
+         (u32)(CLAMPF(color.y, 0.f, 1.f) * 255.f + .5f) << 8 |
+         (u32)(CLAMPF(color.z, 0.f, 1.f) * 255.f + .5f) << 16 |
+         (u32)(CLAMPF(color.w, 0.f, 1.f) * 255.f + .5f) << 24;
+}
+
+// Writes the four vertices of a textured quad - bottom left, top left, top
+// right then bottom right.
+void SpriteQuad(const Texture& texture, const Rectf& src, const Rectf& dest,
+                const v4f& tint, bool mirror, bool flip, SpriteVertex* quad) {
+  // Match uv coordinates to quad coords. Mirror swaps left and right, flip
+  // swaps top and bottom.
+  r32 u0 = src.x / texture.width;
+  r32 v0 = src.y / texture.height;
+  r32 u1 = u0 + src.width / texture.width;
+  r32 v1 = v0 + src.height / texture.height;
+  if (mirror) std::swap(u0, u1);
+  if (flip) std::swap(v0, v1);
+  u32 color = PackColor(tint);
+  r32 x0 = dest.x;
+  r32 y0 = dest.y;
+  r32 x1 = dest.x + dest.width;
+  r32 y1 = dest.y + dest.height;
+  *quad++ = {v2f(x0, y0), {u0, v0}, color};  // BL
+  *quad++ = {v2f(x0, y1), {u0, v1}, color};  // TL
+  *quad++ = {v2f(x1, y1), {u1, v1}, color};  // TR
+  *quad++ = {v2f(x1, y0), {u1, v0}, color};  // BR
+}
+
+void RenderTexture(const Texture& texture, const Rectf& src, const Rectf& dest,
+                   const v4f& tint, bool mirror = false, bool flip = false) {
+  FlushText();
+  SpriteBatch* batch = &kSpriteBatch;
+  u64 sub;
+  if (batch->layer_depth) {
+    sub = texture.reference;
+  } else {
+    if (texture.reference != batch->last_texture) ++batch->run;
+    sub = batch->run;
+  }
+  batch->last_texture = texture.reference;
+  Sprite sprite;
+  sprite.key = (u64)batch->layer << 32 | sub;
+  sprite.texture = texture.reference;
+  sprite.vertex = batch->vertices.size();
+  if (!batch->sprites.empty() && sprite.key < batch->sprites.back().key) {
+    batch->needs_sort = true;
+  }
+  batch->sprites.push_back(sprite);
+
+  batch->vertices.resize(sprite.vertex + 4);
+  SpriteQuad(texture, src, dest, tint, mirror, flip,
+             &batch->vertices[sprite.vertex]);
+  ++batch->stats.sprites;
+  if (!batch->enabled) FlushSprites();
+}
+
+void RenderTexture(const Texture& texture, const Rectf& src, const Rectf& dest,
+                   bool mirror = false, bool flip = false) {
+  RenderTexture(texture, src, dest, v4f(1.f, 1.f, 1.f, 1.f), mirror, flip);
+}
@@ -50,10 +50,6 @@ struct TextureState {
   GLuint vao_reference;
   GLuint vbo_reference;
   GLuint vao_reference_static;
-  GLuint program;
-  GLuint texture_uniform;
-  GLuint matrix_uniform;
-  GLuint uv_vbo;
 };
 
 struct TextureInfo {
@@ -73,27 +69,11 @@ struct UV {
 
 static TextureState kTextureState;
 
-b8 SetupTexture() {
-  GLuint vert_shader, frag_shader;
-  if (!GLCompileShader(GL_VERTEX_SHADER, &kTextureVertexShader,
-                         &vert_shader)) {
-    return false;
-  }
-  if (!GLCompileShader(GL_FRAGMENT_SHADER, &kTextureFragmentShader,
-                         &frag_shader)) {
-    return false;
-  }
-  if (!GLLinkShaders(&kTextureState.program, 2, vert_shader, frag_shader)) {
-    return false;
-  }
-  kTextureState.texture_uniform =
-      glGetUniformLocation(kTextureState.program, "basic_texture");
-  kTextureState.matrix_uniform =
-      glGetUniformLocation(kTextureState.program, "matrix");
-
-  glDeleteShader(vert_shader);
-  glDeleteShader(frag_shader);
+// Draws sprites and text held by RenderTexture and RenderText. See
+// opengl3_sprite_batch.cc and opengl3_ui.cc.
+void FlushBatches();
 
+b8 SetupTexture() {
    GLfloat quad[18] = {
     -0.5f,  -0.5f, 0.0f, // BL
     -0.5f,  0.5f, 0.0f, // TL
@@ -107,10 +87,6 @@ b8 SetupTexture() {
       GLCreateGeometryVAO(18, quad, &kTextureState.vbo_reference);
   u32 vbo;
   kTextureState.vao_reference_static = GLCreateGeometryVAO(18, quad, &vbo);
-  glEnableVertexAttribArray(1);
-  glGenBuffers(1, &kTextureState.uv_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, kTextureState.uv_vbo);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 
   return true;
 }
@@ -172,6 +148,33 @@ Texture CreateEmptyTexture2D(GLenum format, uint64_t width, uint64_t height) {
   return texture;
 }
 
+// A new texture holding the pixels of src, filtered like CreateEmptyTexture2D.
+Texture CopyTexture2D(const Texture& src) {
+  Texture dst = CreateEmptyTexture2D(src.format, (u64)src.width,
+                                     (u64)src.height);
+  GLint read_binding;
+  GLint draw_binding;
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_binding);
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_binding);
+  GLuint frame_buffers[2];
+  glGenFramebuffers(2, frame_buffers);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_buffers[0]);
+  glFramebufferTexture(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                       src.reference, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_buffers[1]);
+  glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                       dst.reference, 0);
+  GLint width = (GLint)src.width;
+  GLint height = (GLint)src.height;
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read_binding);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_binding);
+  glDeleteFramebuffers(2, frame_buffers);
+  dst.file = src.file;
+  return dst;
+}
+
 Surface CreateSurface(GLenum format, uint64_t width, uint64_t height) {
   Surface surface;
   surface.texture = CreateEmptyTexture2D(format, width, height);
@@ -208,6 +211,7 @@ b8 LoadFromFile(const char* file, const TextureInfo& texture_info, Texture* text
 
 void BeginRenderTo(const Surface& surface) {
   assert(surface.IsValid());
+  FlushBatches();
   glBindFramebuffer(GL_FRAMEBUFFER, surface.frame_buffer);
   glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, surface.texture.reference, 0);
   GLenum draw_buffers[1] = {GL_COLOR_ATTACHMENT0};
@@ -216,6 +220,7 @@ void BeginRenderTo(const Surface& surface) {
 }
 
 void EndRenderTo() {
+  FlushBatches();
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
   v2f dims = window::GetWindowSize();
   glViewport(0, 0, (GLsizei)dims.x, (GLsizei)dims.y);
@@ -238,50 +243,3 @@ bool SaveSurface(const Surface& surface, const char* filename) {
   EndRenderTo();
   return res != 0;
 }
-
-void RenderTexture(const Texture& texture, const Rectf& src, const Rectf& dest, bool mirror = false, bool flip = false) {
-  glUseProgram(kTextureState.program);
-  glBindTexture(GL_TEXTURE_2D, texture.reference);
-  glBindVertexArray(kTextureState.vao_reference_static);
-  UV uv[6];
-  // Match uv coordinates to quad coords.
-  r32 start_x = src.x / texture.width;
-  r32 start_y = src.y / texture.height;
-  r32 width = src.width / texture.width;
-  r32 height = src.height / texture.height;
-
-  if (mirror) {
-    uv[0] = {start_x + width, start_y}; // BR
-    uv[1] = {start_x + width, start_y + height}; // TR 
-    uv[2] = {start_x, start_y + height}; // TL
-    uv[3] = {start_x, start_y}; // BL
-    uv[4] = {start_x + width, start_y}; // BR
-    uv[5] = {start_x, start_y + height}; // TL
-  } else {
-    uv[0] = {start_x, start_y}; // BL
-    uv[1] = {start_x, start_y + height}; // TL
-    uv[2] = {start_x + width, start_y + height}; // TR 
-    uv[3] = {start_x + width, start_y}; // BR
-    uv[4] = {start_x, start_y}; // BL
-    uv[5] = {start_x + width, start_y + height}; // TR 
-  }
-
-#if 0
-  LOG(INFO, "uv[0]=(%.3f, %3.f)", uv[0].u, uv[0].v);
-  LOG(INFO, "uv[1]=(%.3f, %3.f)", uv[1].u, uv[1].v);
-  LOG(INFO, "uv[2]=(%.3f, %3.f)", uv[2].u, uv[2].v);
-  LOG(INFO, "uv[3]=(%.3f, %3.f)", uv[3].u, uv[3].v);
-  LOG(INFO, "uv[4]=(%.3f, %3.f)", uv[4].u, uv[4].v);
-  LOG(INFO, "uv[5]=(%.3f, %3.f)", uv[5].u, uv[5].v);
-#endif
-
-  glBindBuffer(GL_ARRAY_BUFFER, kTextureState.uv_vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(uv), uv, GL_DYNAMIC_DRAW);
-  v3f pos(dest.x + dest.width / 2.f, dest.y + dest.height / 2.f, 0.0f);
-  v3f scale(dest.width, dest.height, 1.f);
-  if (flip) scale.y *= -1.f;
-  Mat4f model = math::Model(pos, scale);
-  Mat4f matrix = kObserver.projection * kObserver.view * model;
-  glUniformMatrix4fv(kTextureState.matrix_uniform, 1, GL_FALSE, &matrix.data_[0]);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <vector>
+
+// Grids of tiles drawn in one draw call however many cells they have. Each
+// cell holds an index into the tilemap's tiles, rects within a single texture.
+// The indices live in an integer texture that the fragment shader looks cells
+// up in, so drawing costs the pixels covered rather than the cell count:
+//
+//   rgg::Tilemap map = rgg::CreateTilemap(texture_id, 512, 512, v2f(16.f, 16.f));
+//   u16 dirt = rgg::AddTilemapTile(&map, Rectf(16.f, 137.f, 16.f, 16.f));
+//   for (...) rgg::SetTile(&map, x, y, dirt);
+//   rgg::RenderTilemap(&map, origin, view_bounds);
+//
+// SetTile only writes the cell on the CPU. The next RenderTilemap uploads the
+// rect of cells changed since the last one, so a single edited cell costs one
+// texel of upload. Tile 0 is empty and draws nothing.
+
+#define RGG_TILEMAP_TILE_MAX 256
+
+struct Tilemap {
+  TextureId texture = 0;
+  GLuint cells_reference = 0;
+  u32 width = 0;
+  u32 height = 0;
+  v2f tile_size;
+  // Cells row by row from the bottom left.
+  std::vector<u16> cells;
+  // Source rect of each tile in texture. tiles[0] is the empty tile.
+  std::vector<Rectf> tiles;
+  // Cells changed since the last upload, inclusive. Empty when min > max.
+  s32 dirty_min_x = 0;
+  s32 dirty_min_y = 0;
+  s32 dirty_max_x = -1;
+  s32 dirty_max_y = -1;
+
+  u16 Get(u32 x, u32 y) const {
+    assert(x < width && y < height);
+    return cells[y * width + x];
+  }
+};
+
+struct TilemapStats {
+  u32 draw_calls = 0;
+  u32 cells_uploaded = 0;
+};
+
+struct TilemapState {
+  GLuint program;
+  GLuint matrix_uniform;
+  GLuint bounds_uniform;
+  GLuint origin_uniform;
+  GLuint tile_size_uniform;
+  GLuint texture_size_uniform;
+  GLuint tiles_uniform;
+  GLuint vao;
+  GLuint vbo;
+  TilemapStats stats;
+  TilemapStats last_frame;
+};
+
+static TilemapState kTilemapState;
+
+b8 SetupTilemap() {
+  TilemapState* state = &kTilemapState;
+  GLuint vert_shader, frag_shader;
+  if (!GLCompileShader(GL_VERTEX_SHADER, &kTilemapVertexShader,
+                       &vert_shader)) {
+    return false;
+  }
+  if (!GLCompileShader(GL_FRAGMENT_SHADER, &kTilemapFragmentShader,
+                       &frag_shader)) {
+    return false;
+  }
+  if (!GLLinkShaders(&state->program, 2, vert_shader, frag_shader)) {
+    return false;
+  }
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  state->matrix_uniform = glGetUniformLocation(state->program, "matrix");
+  assert(state->matrix_uniform != u32(-1));
+  state->bounds_uniform = glGetUniformLocation(state->program, "bounds");
+  assert(state->bounds_uniform != u32(-1));
+  state->origin_uniform = glGetUniformLocation(state->program, "origin");
+  assert(state->origin_uniform != u32(-1));
+  state->tile_size_uniform = glGetUniformLocation(state->program, "tile_size");
+  assert(state->tile_size_uniform != u32(-1));
+  state->texture_size_uniform =
+      glGetUniformLocation(state->program, "texture_size");
+  assert(state->texture_size_uniform != u32(-1));
+  state->tiles_uniform = glGetUniformLocation(state->program, "tiles");
+  assert(state->tiles_uniform != u32(-1));
+  glUseProgram(state->program);
+  glUniform1i(glGetUniformLocation(state->program, "cells"), 0);
+  glUniform1i(glGetUniformLocation(state->program, "tile_texture"), 1);
+
+  // clang-format off
+  GLfloat corners[8] = {
+    0.f, 0.f, 0.f, 1.f, 1.f, 0.f, 1.f, 1.f,
+  };
+  // clang-format on
+  glGenVertexArrays(1, &state->vao);
+  glBindVertexArray(state->vao);
+  glGenBuffers(1, &state->vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, state->vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  return true;
+}
+
+// A width by height tilemap of empty cells, each tile_size in world units,
+// drawing its tiles from texture.
+Tilemap CreateTilemap(TextureId texture, u32 width, u32 height,
+                      const v2f& tile_size) {
+  assert(width && height);
+  Tilemap map;
+  map.texture = texture;
+  map.width = width;
+  map.height = height;
+  map.tile_size = tile_size;
+  map.cells.resize(width * height);
+  map.tiles.push_back(Rectf(0.f, 0.f, 0.f, 0.f));
+  glGenTextures(1, &map.cells_reference);
+  glBindTexture(GL_TEXTURE_2D, map.cells_reference);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, width, height, 0, GL_RED_INTEGER,
+               GL_UNSIGNED_SHORT, map.cells.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  return map;
+}
+
+void DestroyTilemap(Tilemap* map) {
+  if (map->cells_reference) glDeleteTextures(1, &map->cells_reference);
+  *map = {};
+}
+
+// Adds src, a rect in the tilemap's texture, as a tile. Returns its index for
+// SetTile.
+u16 AddTilemapTile(Tilemap* map, const Rectf& src) {
+  assert(map->tiles.size() < RGG_TILEMAP_TILE_MAX);
+  map->tiles.push_back(src);
+  return map->tiles.size() - 1;
+}
+
+void SetTile(Tilemap* map, u32 x, u32 y, u16 tile) {
+  assert(x < map->width && y < map->height);
+  assert(tile < map->tiles.size());
+  u16* cell = &map->cells[y * map->width + x];
+  if (*cell == tile) return;
+  *cell = tile;
+  if (map->dirty_min_x > map->dirty_max_x) {
+    map->dirty_min_x = map->dirty_max_x = x;
+    map->dirty_min_y = map->dirty_max_y = y;
+    return;
+  }
+  map->dirty_min_x = MIN(map->dirty_min_x, (s32)x);
+  map->dirty_min_y = MIN(map->dirty_min_y, (s32)y);
+  map->dirty_max_x = MAX(map->dirty_max_x, (s32)x);
+  map->dirty_max_y = MAX(map->dirty_max_y, (s32)y);
+}
+
+// Uploads the rect of cells changed since the last upload.
+void UploadTilemapCells(Tilemap* map) {
+  if (map->dirty_min_x > map->dirty_max_x) return;
+  s32 w = map->dirty_max_x - map->dirty_min_x + 1;
+  s32 h = map->dirty_max_y - map->dirty_min_y + 1;
+  glBindTexture(GL_TEXTURE_2D, map->cells_reference);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, map->width);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, map->dirty_min_x, map->dirty_min_y, w, h,
+                  GL_RED_INTEGER, GL_UNSIGNED_SHORT,
+                  &map->cells[map->dirty_min_y * map->width +
+                              map->dirty_min_x]);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  kTilemapState.stats.cells_uploaded += w * h;
+  map->dirty_min_x = map->dirty_min_y = 0;
+  map->dirty_max_x = map->dirty_max_y = -1;
+}
+
+// Draws the part of map inside view, with its bottom left cell at origin.
+void RenderTilemap(Tilemap* map, const v2f& origin, const Rectf& view) {
+  const Texture* texture = GetTexture(map->texture);
+  if (!texture || !texture->IsValid()) return;
+  Rectf bounds = Rectf(origin, v2f(map->width * map->tile_size.x,
+                                   map->height * map->tile_size.y));
+  v2f bl(fmaxf(bounds.x, view.x), fmaxf(bounds.y, view.y));
+  v2f tr(fminf(bounds.x + bounds.width, view.x + view.width),
+         fminf(bounds.y + bounds.height, view.y + view.height));
+  if (bl.x >= tr.x || bl.y >= tr.y) return;
+  FlushBatches();
+  UploadTilemapCells(map);
+  TilemapState* state = &kTilemapState;
+  glUseProgram(state->program);
+  Mat4f matrix = kObserver.projection * kObserver.view;
+  glUniformMatrix4fv(state->matrix_uniform, 1, GL_FALSE, &matrix.data_[0]);
+  glUniform4f(state->bounds_uniform, bl.x, bl.y, tr.x - bl.x, tr.y - bl.y);
+  glUniform2f(state->origin_uniform, origin.x, origin.y);
+  glUniform2f(state->tile_size_uniform, map->tile_size.x, map->tile_size.y);
+  glUniform2f(state->texture_size_uniform, texture->width, texture->height);
+  glUniform4fv(state->tiles_uniform, map->tiles.size(),
+               (const GLfloat*)map->tiles.data());
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, map->cells_reference);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, texture->reference);
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(state->vao);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  ++state->stats.draw_calls;
+}
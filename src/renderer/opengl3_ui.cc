@@ -4,18 +4,66 @@
 // HI! THIS IS IN THE rgg NAMESPACE.
 // DONT INCLUDE IT ANYWHERE OUTSIDE OF renderer.cc
 
+// Text is drawn like sprites - RenderText appends glyph quads to one vertex
+// stream that is drawn with a single call when something else needs the GPU.
+// Strings are laid out once and kept in a direct mapped cache keyed by the
+// hash of the string and scale, so text that doesn't change between frames
+// only costs a copy.
+
 struct Font {
   Texture texture;
   GLuint program;
   GLuint texture_uniform;
   GLuint matrix_uniform;
-  GLuint color_uniform;
   GLuint vbo;
   GLuint vao;
 };
 
+struct TextVertex {
+  r32 x;
+  r32 y;
+  r32 u;
+  r32 v;
+  // RGBA8.
+  u32 color;
+};
+
+// A glyph's quad relative to the pen at scale 1.
+struct Glyph {
+  r32 x0, y0;
+  r32 x1, y1;
+  r32 u0, v0;
+  r32 u1, v1;
+  r32 yoffset;
+  r32 xadvance;
+};
+
+// Vertices for a string relative to where it is drawn. Color is filled in
+// when the layout is copied into the batch.
+struct TextLayout {
+  u32 hash = 0;
+  r32 scale = 0.f;
+  std::string msg;
+  std::vector<TextVertex> vertices;
+};
+
+struct TextStats {
+  u32 glyphs = 0;
+  u32 draw_calls = 0;
+};
+
+constexpr u32 kTextLayoutCount = 512;
+
 struct UI {
   Font font;
+  Glyph glyph[256];
+  // Kerning between each pair of characters, first * 256 + second.
+  s8 kerning[256 * 256];
+  TextLayout layout[kTextLayoutCount];
+  // Glyphs waiting to be drawn.
+  std::vector<TextVertex> vertices;
+  TextStats stats;
+  TextStats last_frame;
 };
 
 static UI kUI;
@@ -38,7 +86,6 @@ b8 SetupUI() {
   }
   font.texture_uniform = glGetUniformLocation(font.program, "basic_texture");
   font.matrix_uniform = glGetUniformLocation(font.program, "matrix");
-  font.color_uniform = glGetUniformLocation(font.program, "color");
 
   glDeleteShader(vert_shader);
   glDeleteShader(frag_shader);
@@ -48,37 +95,52 @@ b8 SetupUI() {
 
   glGenVertexArrays(1, &font.vao);
   glBindVertexArray(font.vao);
-  glEnableVertexAttribArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, font.vbo);
-  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), NULL);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex),
+                        (void*)offsetof(TextVertex, color));
+
+  // Scale metadata into quads and uvs once rather than per character drawn.
+  for (s32 i = 0; i < 256; ++i) {
+    const FontMetadataRow* row = &kFontMetadataRow[i];
+    Glyph* glyph = &kUI.glyph[i];
+    glyph->x0 = (r32)row->xoffset;
+    glyph->y0 = (r32)kFontLineHeight - (r32)row->yoffset;
+    glyph->x1 = glyph->x0 + (r32)row->width;
+    glyph->y1 = glyph->y0 - (r32)row->height;
+    glyph->u0 = (r32)row->x / kFontWidth;
+    glyph->v0 = (r32)row->y / kFontHeight;
+    glyph->u1 = glyph->u0 + (r32)row->width / kFontWidth;
+    glyph->v1 = glyph->v0 + (r32)row->height / kFontHeight;
+    glyph->yoffset = (r32)row->yoffset;
+    glyph->xadvance = (r32)row->xadvance;
+    for (s32 k = 0; k < row->kcount; ++k) {
+      const FontKerning& kerning = row->kerning[k];
+      assert(kerning.second >= 0 && kerning.second < 256);
+      kUI.kerning[i * 256 + kerning.second] = (s8)kerning.amount;
+    }
+  }
 
   return true;
 }
 
-s32 GetNextKerning(const char* msg, s32 msg_len, s32 first, s32 second) {
-  if (first == msg_len - 1) return 0;
-  const FontMetadataRow* row = &kFontMetadataRow[msg[first]];
-  for (s32 i = 0; i < row->kcount; ++i) {
-    if (row->kerning[i].second == msg[second]) {
-      return row->kerning[i].amount;
-    }
-  }
-  return 0;
+s32 GetKerning(char first, char second) {
+  return kUI.kerning[(u8)first * 256 + (u8)second];
 }
 
 void GetTextInfo(const char* msg, s32 msg_len, r32* width, r32* height,
                  r32* min_y_offset) {
-  auto& font = kUI.font;
   *height = (r32)kFontLineHeight;
   *width = 0.0f;
   *min_y_offset = 1000.0f;
   s32 kerning_offset = 0;
   for (s32 i = 0; i < msg_len; ++i) {
-    const FontMetadataRow* row = &kFontMetadataRow[msg[i]];
-    *width += (r32)row->xadvance + kerning_offset;
-    r32 y_offset = (r32)row->yoffset;
-    if (y_offset < *min_y_offset) *min_y_offset = y_offset;
-    kerning_offset = GetNextKerning(msg, msg_len, i, i + 1);
+    const Glyph* glyph = &kUI.glyph[(u8)msg[i]];
+    *width += glyph->xadvance + kerning_offset;
+    if (glyph->yoffset < *min_y_offset) *min_y_offset = glyph->yoffset;
+    kerning_offset = i + 1 < msg_len ? GetKerning(msg[i], msg[i + 1]) : 0;
   }
 }
 
@@ -93,90 +155,76 @@ Rectf GetTextRect(const char* msg, s32 msg_len, v2f pos) {
   return GetTextRect(msg, msg_len, pos, 1.0f);
 }
 
-void RenderText(const char* msg, v2f pos, r32 scale, const v4f& color) {
-  auto& font = kUI.font;
-
-  struct TextPoint {
-    GLfloat x;
-    GLfloat y;
-    GLfloat u;
-    GLfloat v;
-    void Pr() { printf("%.1f,%.1f,%.1f,%.1f\n", x, y, u, v); }
-  };
+void LayoutText(const char* msg, s32 msg_len, r32 scale, u32 hash,
+                TextLayout* layout) {
+  layout->hash = hash;
+  layout->scale = scale;
+  layout->msg.assign(msg, msg_len);
+  layout->vertices.clear();
+  // The kerning for a pair shifts the second glyph and is added to the
+  // advance after it.
+  r32 pen = 0.f;
+  s32 kerning_offset = 0;
+  for (s32 i = 0; i < msg_len; ++i) {
+    // The font sheet has no entry for the character. This could occur if you
+    // are attempting to render a '\n'.
+    assert(kFontMetadataRow[(u8)msg[i]].id != 0);
+    const Glyph* glyph = &kUI.glyph[(u8)msg[i]];
+    r32 x0 = pen + (glyph->x0 + kerning_offset) * scale;
+    r32 x1 = pen + (glyph->x1 + kerning_offset) * scale;
+    r32 y0 = glyph->y0 * scale;
+    r32 y1 = glyph->y1 * scale;
+    TextVertex quad[6] = {
+      {x0, y0, glyph->u0, glyph->v0, 0},
+      {x1, y0, glyph->u1, glyph->v0, 0},
+      {x1, y1, glyph->u1, glyph->v1, 0},
+      {x1, y1, glyph->u1, glyph->v1, 0},
+      {x0, y1, glyph->u0, glyph->v1, 0},
+      {x0, y0, glyph->u0, glyph->v0, 0},
+    };
+    layout->vertices.insert(layout->vertices.end(), quad, quad + 6);
+    pen += (glyph->xadvance + kerning_offset) * scale;
+    kerning_offset = i + 1 < msg_len ? GetKerning(msg[i], msg[i + 1]) : 0;
+  }
+}
 
+void FlushText() {
+  u32 count = kUI.vertices.size();
+  if (!count) return;
+  Font& font = kUI.font;
   glUseProgram(font.program);
   glBindVertexArray(font.vao);
   glBindTexture(GL_TEXTURE_2D, font.texture.reference);
-
   Mat4f matrix = kObserver.projection * kObserver.view;
   glUniformMatrix4fv(font.matrix_uniform, 1, GL_FALSE, &matrix.data_[0]);
-  glUniform4f(font.color_uniform, color.x, color.y, color.z, color.w);
-
-#if 0
-  math::Print4x4Matrix(kUI.projection);
-  printf("\n");
-#endif
+  glBindBuffer(GL_ARRAY_BUFFER, font.vbo);
+  // Orphans the last frame's storage.
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(TextVertex),
+               kUI.vertices.data(), GL_STREAM_DRAW);
+  glDrawArrays(GL_TRIANGLES, 0, count);
+  ++kUI.stats.draw_calls;
+  kUI.vertices.clear();
+}
 
+void RenderText(const char* msg, v2f pos, r32 scale, const v4f& color) {
+  FlushSprites();
   s32 msg_len = (s32)strlen(msg);
-  s32 kerning_offset = 0;
-  for (s32 i = 0; i < msg_len; ++i) {
-    const FontMetadataRow* row = &kFontMetadataRow[msg[i]];
-    //printf("%i\n", msg[i]);
-    // The character trying to render is invalid. This means the font sheet
-    // has no corresponding entry for the ascii id msg[i].
-    // This could occur if you are attempting to render a '\n'
-    assert(row->id != 0);
-
-    // Scale to get uv coordinatoes.
-    r32 tex_x = (r32)row->x / kFontWidth;
-    r32 tex_y = (r32)row->y / kFontHeight;
-    r32 tex_w = (r32)row->width / kFontWidth;
-    r32 tex_h = (r32)row->height / kFontHeight;
-
-    // Verts are subject to projection given by an orhthographic matrix
-    // using the screen width and height.
-    r32 v_w = (r32)row->width * scale;
-    r32 v_h = (r32)row->height * scale;
-    
-    r32 offset_start_x =
-      pos.x + (r32)row->xoffset * scale + (r32)kerning_offset * scale;
-    r32 offset_start_y =
-      pos.y - (r32)row->yoffset * scale + (r32)kFontLineHeight * scale;
-
-#if 0
-    printf("id=%i char=%c width=%i height=%i xoffset=%i yoffset=%i"
-           " start_x=%.3f start_y=%.3f tex_w=%.3f tex_h=%.3f\n",
-           msg[i], msg[i], row->width, row->height, row->xoffset,
-           row->yoffset, offset_start_x, offset_start_y, tex_w, tex_h);
-#endif
-
-    TextPoint text_point[6] = {
-      {offset_start_x, offset_start_y, tex_x, tex_y},
-      {offset_start_x + v_w, offset_start_y, tex_x + tex_w, tex_y},
-      {offset_start_x + v_w, offset_start_y - v_h, tex_x + tex_w, tex_y + tex_h},
-      {offset_start_x + v_w, offset_start_y - v_h, tex_x + tex_w, tex_y + tex_h},
-      {offset_start_x, offset_start_y - v_h, tex_x, tex_y + tex_h},
-      {offset_start_x, offset_start_y, tex_x, tex_y}
-    };
-
-#if 0
-    text_point[0].Pr();
-    text_point[1].Pr();
-    text_point[2].Pr();
-    text_point[3].Pr();
-    text_point[4].Pr();
-    text_point[5].Pr();
-#endif
-    glBindBuffer(GL_ARRAY_BUFFER, font.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(text_point), text_point, GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, 6);  // Draw the character 
-    pos.x += (r32)row->xadvance * scale + (r32)kerning_offset * scale;
-    kerning_offset = GetNextKerning(msg, msg_len, i, i + 1);
-#if 0
-    printf("%c(%i) to %c(%i) offset:%i\n",
-            msg[i], msg[i], msg[i + 1], msg[i + 1], kerning_offset);
-#endif
+  u32 hash = GetHash(msg, msg_len);
+  hash = GetHash((const char*)&scale, sizeof(scale), hash);
+  TextLayout* layout = &kUI.layout[hash % kTextLayoutCount];
+  if (layout->hash != hash || layout->scale != scale ||
+      layout->msg.size() != (u32)msg_len ||
+      memcmp(layout->msg.data(), msg, msg_len) != 0) {
+    LayoutText(msg, msg_len, scale, hash, layout);
+  }
+  u32 packed = PackColor(color);
+  u32 first = kUI.vertices.size();
+  kUI.vertices.resize(first + layout->vertices.size());
+  TextVertex* dst = &kUI.vertices[first];
+  for (const TextVertex& v : layout->vertices) {
+    *dst++ = {pos.x + v.x, pos.y + v.y, v.u, v.v, packed};
   }
+  kUI.stats.glyphs += msg_len;
 }
 
 void RenderText(const char* msg, v2f pos, const v4f& color) {
@@ -184,6 +232,7 @@ void RenderText(const char* msg, v2f pos, const v4f& color) {
 }
 
 void RenderButton(const char* text, const Rectf& rect, const v4f& color) {
+  FlushBatches();
   glUseProgram(kRGG.smooth_rectangle_program.reference);
   glBindVertexArray(kTextureState.vao_reference);
   v3f pos(rect.x + rect.width / 2.f, rect.y + rect.height / 2.f, 0.0f);
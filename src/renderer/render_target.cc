@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// Surfaces that keep what was drawn into them until something marks them
+// dirty. Owners ask before drawing and skip the pass when nothing changed:
+//
+//   if (rgg::RenderTargetNeedsRender(target, key)) {
+//     rgg::BeginRenderTarget(target);
+//     ...
+//     rgg::EndRenderTarget(target);
+//   }
+//   rgg::RenderTexture(rgg::GetRenderTarget(target)->surface.texture, ...);
+//
+// A target needs rendering when it's new, when MarkRenderTargetDirty was
+// called on it or when key differs from the last call. Build key with
+// HashRenderKey from whatever the pass draws from. Render counts and times
+// are kept per target for diagnostics.
+//
+// Render targets draw their surfaces from a pool keyed on format and size.
+// Destroying a target returns its surface to the pool, so targets that are
+// recreated at the same size, like editor views toggling zoom, reuse
+// framebuffers instead of allocating new ones. Pooled surfaces unused for
+// pool_idle_frames are deleted in EndFrame.
+
+typedef u32 RenderTargetId;
+
+struct RenderTarget {
+  RenderTargetId id = 0;
+  char name[32];
+  Surface surface;
+  b8 dirty = true;
+  u32 key = 0;
+  // Passes drawn and passes skipped because nothing changed.
+  u32 renders = 0;
+  u32 skips = 0;
+  u64 last_render_usec = 0;
+  u64 render_usec = 0;
+  platform::Clock clock;
+};
+
+#define RGG_RENDER_TARGET_MAX 64
+
+DECLARE_GROWABLE_HASH_ARRAY(RenderTarget, RGG_RENDER_TARGET_MAX);
+
+struct PooledSurface {
+  Surface surface;
+  GLenum format;
+  b8 in_use;
+  // Frames since it was released.
+  u32 idle_frames;
+};
+
+struct RenderTargetStats {
+  u32 renders = 0;
+  u32 skips = 0;
+  u64 render_usec = 0;
+  u32 surfaces_created = 0;
+  u32 surfaces_reused = 0;
+};
+
+struct RenderTargets {
+  std::vector<PooledSurface> pool;
+  u32 pool_idle_frames = 120;
+  RenderTargetStats stats;
+  RenderTargetStats last_frame;
+};
+
+static RenderTargets kRenderTargets;
+
+// FNV-1a over value's bytes, continuing from key. Only hash types without
+// padding.
+template <typename T>
+u32 HashRenderKey(const T& value, u32 key = kHashSeed) {
+  return GetHash((const char*)&value, sizeof(T), key);
+}
+
+// A surface of format and size from the pool, created if none is free. What
+// it holds is undefined until drawn over.
+Surface AcquireSurface(GLenum format, u64 width, u64 height) {
+  RenderTargets* targets = &kRenderTargets;
+  for (PooledSurface& pooled : targets->pool) {
+    if (pooled.in_use || pooled.format != format ||
+        (u64)pooled.surface.width() != width ||
+        (u64)pooled.surface.height() != height) {
+      continue;
+    }
+    pooled.in_use = true;
+    ++targets->stats.surfaces_reused;
+    return pooled.surface;
+  }
+  PooledSurface pooled = {};
+  pooled.surface = CreateSurface(format, width, height);
+  pooled.format = format;
+  pooled.in_use = true;
+  targets->pool.push_back(pooled);
+  ++targets->stats.surfaces_created;
+  return pooled.surface;
+}
+
+// Returns surface to the pool. Surfaces that didn't come from the pool are
+// destroyed.
+void ReleaseSurface(Surface* surface) {
+  for (PooledSurface& pooled : kRenderTargets.pool) {
+    if (pooled.surface.frame_buffer != surface->frame_buffer) continue;
+    pooled.in_use = false;
+    pooled.idle_frames = 0;
+    *surface = {};
+    return;
+  }
+  DestroySurface(surface);
+}
+
+RenderTarget* GetRenderTarget(RenderTargetId id) {
+  return FindRenderTarget(id);
+}
+
+RenderTarget* UseNamedRenderTarget(const char* name) {
+  RenderTarget* target = UseRenderTarget();
+  assert(target);
+  strncpy(target->name, name, sizeof(target->name) - 1);
+  target->name[sizeof(target->name) - 1] = '\0';
+  return target;
+}
+
+RenderTargetId CreateRenderTarget(const char* name, u64 width, u64 height,
+                                  GLenum format = GL_RGBA) {
+  RenderTarget* target = UseNamedRenderTarget(name);
+  target->surface = AcquireSurface(format, width, height);
+  return target->id;
+}
+
+// A target drawing over texture, which it takes ownership of. It starts
+// clean since texture already holds what it shows.
+RenderTargetId CreateRenderTarget(const char* name, const Texture& texture) {
+  RenderTarget* target = UseNamedRenderTarget(name);
+  target->surface = CreateSurfaceFromTexture(texture);
+  target->dirty = false;
+  return target->id;
+}
+
+void DestroyRenderTarget(RenderTargetId id) {
+  RenderTarget* target = FindRenderTarget(id);
+  if (!target) return;
+  ReleaseSurface(&target->surface);
+  SwapAndClearRenderTarget(id);
+}
+
+void MarkRenderTargetDirty(RenderTargetId id) {
+  RenderTarget* target = FindRenderTarget(id);
+  if (target) target->dirty = true;
+}
+
+// True if the target is dirty or key changed since the last call. Counts a
+// skip otherwise.
+b8 RenderTargetNeedsRender(RenderTargetId id, u32 key = 0) {
+  RenderTarget* target = FindRenderTarget(id);
+  if (!target) return false;
+  if (target->key != key) {
+    target->key = key;
+    target->dirty = true;
+  }
+  if (!target->dirty) {
+    ++target->skips;
+    ++kRenderTargets.stats.skips;
+  }
+  return target->dirty;
+}
+
+void BeginRenderTarget(RenderTargetId id) {
+  RenderTarget* target = FindRenderTarget(id);
+  assert(target);
+  BeginRenderTo(target->surface);
+  platform::ClockStart(&target->clock);
+}
+
+// Times the pass from BeginRenderTarget on the CPU. Drawing is only submitted
+// by then, so GPU time isn't included.
+void EndRenderTarget(RenderTargetId id) {
+  RenderTarget* target = FindRenderTarget(id);
+  assert(target);
+  EndRenderTo();
+  target->last_render_usec = platform::ClockEnd(&target->clock);
+  target->render_usec += target->last_render_usec;
+  target->dirty = false;
+  ++target->renders;
+  ++kRenderTargets.stats.renders;
+  kRenderTargets.stats.render_usec += target->last_render_usec;
+}
+
+void IterateRenderTargets(
+    const std::function<void(const RenderTarget*)> func) {
+  for (u32 i = 0; i < kUsedRenderTarget; ++i) {
+    func(&kRenderTarget[i]);
+  }
+}
+
+// Ages the pool, deleting surfaces that have sat unused too long, and rolls
+// the frame's stats.
+void UpdateRenderTargets() {
+  RenderTargets* targets = &kRenderTargets;
+  for (u32 i = 0; i < targets->pool.size();) {
+    PooledSurface* pooled = &targets->pool[i];
+    if (pooled->in_use || ++pooled->idle_frames < targets->pool_idle_frames) {
+      ++i;
+      continue;
+    }
+    DestroySurface(&pooled->surface);
+    targets->pool[i] = targets->pool.back();
+    targets->pool.pop_back();
+  }
+  targets->last_frame = targets->stats;
+  targets->stats = {};
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+// Packs images into a few large atlas pages so sprites cut from different
+// files share a texture and batch together. Each page is a single entry in the
+// texture cache however many images it holds.
+//
+// Pages are packed with a skyline bottom-left heuristic. Images keep a
+// transparent texel of padding so nearest sampling never bleeds into a
+// neighbor. Pages are nearest filtered without mipmaps, which is how the 2d
+// art is drawn anyway.
+//
+//   rgg::BuildTextureAtlas(files);
+//   rgg::TextureId page;
+//   Rectf rect;
+//   if (rgg::FindAtlasRegion(file, src, &page, &rect))
+//     rgg::RenderTexture(page, rect, dest);
+//
+// Images larger than a page are skipped and load as their own textures.
+
+#define RGG_ATLAS_REGION_MAX 1024
+
+// Where an image landed in the atlas.
+struct AtlasRegion {
+  TextureId page = 0;
+  Rectf rect;
+};
+
+DECLARE_HASH_MAP_STR(AtlasRegion, RGG_ATLAS_REGION_MAX);
+
+struct SkylineNode {
+  s32 x;
+  s32 y;
+  s32 width;
+};
+
+struct AtlasSource {
+  std::string file;
+  Rectf rect;
+};
+
+struct AtlasPage {
+  TextureId id = 0;
+  std::vector<SkylineNode> skyline;
+  // Images on the page, for mapping atlas rects back to their files.
+  std::vector<AtlasSource> sources;
+};
+
+struct TextureAtlas {
+  s32 page_size = 2048;
+  s32 padding = 1;
+  std::vector<AtlasPage> pages;
+};
+
+static TextureAtlas kTextureAtlas;
+
+// The y a w by h rect would sit at with its left edge on node i, or -1 if it
+// doesn't fit there.
+s32 SkylineFit(const AtlasPage& page, u32 i, s32 w, s32 h, s32 size) {
+  if (page.skyline[i].x + w > size) return -1;
+  s32 y = 0;
+  s32 remaining = w;
+  while (remaining > 0) {
+    assert(i < page.skyline.size());
+    y = MAX(y, page.skyline[i].y);
+    if (y + h > size) return -1;
+    remaining -= page.skyline[i].width;
+    ++i;
+  }
+  return y;
+}
+
+// Finds the lowest spot for a w by h rect, breaking ties on the narrowest
+// node, and raises the skyline over it.
+b8 SkylinePack(AtlasPage* page, s32 w, s32 h, s32 size, s32* x, s32* y) {
+  std::vector<SkylineNode>& skyline = page->skyline;
+  s32 best_i = -1;
+  s32 best_top = INT_MAX;
+  s32 best_width = INT_MAX;
+  for (u32 i = 0; i < skyline.size(); ++i) {
+    s32 fit = SkylineFit(*page, i, w, h, size);
+    if (fit < 0) continue;
+    if (fit + h < best_top ||
+        (fit + h == best_top && skyline[i].width < best_width)) {
+      best_i = i;
+      best_top = fit + h;
+      best_width = skyline[i].width;
+      *y = fit;
+    }
+  }
+  if (best_i < 0) return false;
+  *x = skyline[best_i].x;
+  skyline.insert(skyline.begin() + best_i, {*x, best_top, w});
+  // Trim the nodes the new one covers.
+  for (u32 i = best_i + 1; i < skyline.size();) {
+    const SkylineNode& prev = skyline[i - 1];
+    s32 overlap = prev.x + prev.width - skyline[i].x;
+    if (overlap <= 0) break;
+    skyline[i].x += overlap;
+    skyline[i].width -= overlap;
+    if (skyline[i].width > 0) break;
+    skyline.erase(skyline.begin() + i);
+  }
+  // Merge neighbors at the same height.
+  for (u32 i = 1; i < skyline.size();) {
+    if (skyline[i - 1].y != skyline[i].y) {
+      ++i;
+      continue;
+    }
+    skyline[i - 1].width += skyline[i].width;
+    skyline.erase(skyline.begin() + i);
+  }
+  return true;
+}
+
+AtlasPage* CreateAtlasPage() {
+  TextureAtlas* atlas = &kTextureAtlas;
+  assert(kUsedTextureHandle < RGG_TEXTURE_MAX);
+  TextureHandle* handle = UseTextureHandle();
+  TextureInfo info;
+  info.min_filter = GL_NEAREST;
+  info.mag_filter = GL_NEAREST;
+  // Zeroed so padding between images is transparent.
+  std::vector<u8> clear(atlas->page_size * atlas->page_size * 4);
+  handle->texture = CreateTexture2D(GL_RGBA, atlas->page_size,
+                                    atlas->page_size, info, clear.data());
+  handle->texture.file = "atlas_page_" + std::to_string(atlas->pages.size());
+  atlas->pages.emplace_back();
+  AtlasPage* page = &atlas->pages.back();
+  page->id = handle->id;
+  page->skyline.push_back({0, 0, atlas->page_size});
+  return page;
+}
+
+// Packs a decoded RGBA image into the first page with room, starting a new
+// page if none has. Returns false if the image is bigger than a page.
+b8 AddToTextureAtlas(const char* file, s32 width, s32 height,
+                     const u8* pixels) {
+  TextureAtlas* atlas = &kTextureAtlas;
+  u32 len = (u32)strlen(file);
+  if (FindAtlasRegion(file, len)) return true;
+  s32 w = width + atlas->padding * 2;
+  s32 h = height + atlas->padding * 2;
+  if (w > atlas->page_size || h > atlas->page_size) return false;
+  AtlasPage* page = nullptr;
+  s32 x, y;
+  for (AtlasPage& p : atlas->pages) {
+    if (SkylinePack(&p, w, h, atlas->page_size, &x, &y)) {
+      page = &p;
+      break;
+    }
+  }
+  if (!page) {
+    page = CreateAtlasPage();
+    SkylinePack(page, w, h, atlas->page_size, &x, &y);
+  }
+  Rectf rect(x + atlas->padding, y + atlas->padding, width, height);
+  glBindTexture(GL_TEXTURE_2D, GetTexture(page->id)->reference);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint)rect.x, (GLint)rect.y, width,
+                  height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  AtlasRegion* region = UseAtlasRegion(file, len);
+  assert(region);
+  region->page = page->id;
+  region->rect = rect;
+  page->sources.push_back({std::string(file), rect});
+  return true;
+}
+
+// Decodes files on the worker pool then packs them tallest first, which
+// leaves the skyline flatter than packing in file order. Files already in the
+// atlas are skipped.
+void BuildTextureAtlas(const std::vector<std::string>& files) {
+  struct Image {
+    std::string file;
+    u8* pixels = nullptr;
+    s32 width = 0;
+    s32 height = 0;
+  };
+  std::vector<Image> images;
+  for (const std::string& file : files) {
+    if (FindAtlasRegion(file.c_str(), (u32)file.size())) continue;
+    b8 duplicate = false;
+    for (const Image& image : images) duplicate |= image.file == file;
+    if (!duplicate) images.push_back({file});
+  }
+  // Same flip as LoadFromFile, set from this thread before any decode.
+  stbi_set_flip_vertically_on_load(1);
+  util::WorkerPoolInitialize();
+  util::WorkGroup group;
+  for (Image& image : images) {
+    Image* img = &image;
+    util::WorkerPoolPush([img]() {
+      s32 n;
+      img->pixels =
+          stbi_load(img->file.c_str(), &img->width, &img->height, &n, 4);
+    }, &group);
+  }
+  util::WorkerPoolWait(&group);
+  std::sort(images.begin(), images.end(), [](const Image& a, const Image& b) {
+    return a.height != b.height ? a.height > b.height : a.width > b.width;
+  });
+  for (const Image& image : images) {
+    if (!image.pixels) {
+      LOG(ERR, "Cannot decode %s for the texture atlas", image.file.c_str());
+      continue;
+    }
+    if (!AddToTextureAtlas(image.file.c_str(), image.width, image.height,
+                           image.pixels)) {
+      LOG(WARN, "%s is too large for an atlas page", image.file.c_str());
+    }
+    free(image.pixels);
+  }
+}
+
+// Maps src, in texels of file, to its page and rect in the atlas. Returns
+// false if file isn't in the atlas.
+b8 FindAtlasRegion(const char* file, const Rectf& src, TextureId* page,
+                   Rectf* rect) {
+  const AtlasRegion* region = FindAtlasRegion(file, (u32)strlen(file));
+  if (!region) return false;
+  *page = region->page;
+  *rect = Rectf(region->rect.x + src.x, region->rect.y + src.y, src.width,
+                src.height);
+  return true;
+}
+
+// The reverse of FindAtlasRegion, for writing atlas references back out in
+// terms of their original files. Returns false if page isn't an atlas page.
+b8 FindAtlasSource(TextureId page, const Rectf& rect, std::string* file,
+                   Rectf* src) {
+  for (const AtlasPage& p : kTextureAtlas.pages) {
+    if (p.id != page) continue;
+    for (const AtlasSource& source : p.sources) {
+      if (!math::PointInRect(rect.Min(), source.rect)) continue;
+      *file = source.file;
+      *src = Rectf(rect.x - source.rect.x, rect.y - source.rect.y, rect.width,
+                   rect.height);
+      return true;
+    }
+  }
+  return false;
+}
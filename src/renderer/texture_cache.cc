@@ -1,10 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 typedef u32 TextureId;
 
+enum TextureLoadState {
+  kTextureReady,
+  kTextureLoading,
+  kTextureFailed,
+};
+
 struct TextureHandle {
   TextureId id = 0;
   Texture texture;
+  TextureLoadState state = kTextureReady;
 };
 
 struct TextureFileToId {
@@ -30,6 +40,164 @@ TextureId LoadTexture(const char* texture_file, const TextureInfo& texture_info)
   return t->id; 
 }
 
+// Textures loaded with LoadTextureAsync decode as background work on
+// util::WorkerPool threads, so systems waiting on the pool never decode.
+// Decoded pixels queue for the main thread, which uploads them in EndFrame
+// until upload_budget_usec is spent and leaves the rest for the next frame.
+// Until its upload GetTexture returns a 1x1 placeholder for the id, so
+// existing draws work unchanged and show a grey box of the right size.
+//
+// stb_image's vertical flip flag is global. Every load sets it the same way,
+// and only ever from the main thread, so decodes don't race on it.
+
+struct DecodedTexture {
+  TextureId id;
+  TextureInfo info;
+  // From stbi_load, null if decoding failed.
+  u8* pixels;
+  const char* failure_reason;
+  s32 width;
+  s32 height;
+};
+
+struct TextureLoadStats {
+  // Loads waiting on a decode or an upload.
+  u32 pending = 0;
+  u32 loaded = 0;
+  u32 failed = 0;
+  // Totals across every load. Decode time is summed across workers.
+  u64 decode_usec = 0;
+  u64 upload_usec = 0;
+  // Spent uploading in the last EndFrame.
+  u64 last_upload_usec = 0;
+};
+
+struct TextureLoads {
+  Mutex mutex;
+  // Filled by workers, guarded by mutex.
+  std::vector<DecodedTexture> decoded;
+  // Main thread's copy of decoded still waiting on the upload budget.
+  std::vector<DecodedTexture> uploads;
+  Texture placeholder;
+  u64 upload_budget_usec = 2000;
+  std::atomic<u64> decode_usec{0};
+  TextureLoadStats stats;
+  b8 initialized = false;
+};
+
+static TextureLoads kTextureLoads;
+
+TextureId LoadTextureAsync(const char* texture_file,
+                           const TextureInfo& texture_info) {
+  u32 len = (u32)strlen(texture_file);
+  TextureFileToId* loaded_file_to_id = FindTextureFileToId(texture_file, len);
+  if (loaded_file_to_id) return loaded_file_to_id->id;
+  TextureLoads* loads = &kTextureLoads;
+  if (!loads->initialized) {
+    platform::MutexCreate(&loads->mutex);
+    util::WorkerPoolInitialize();
+    u8 grey[4] = {128, 128, 128, 160};
+    TextureInfo info;
+    info.min_filter = GL_NEAREST;
+    info.mag_filter = GL_NEAREST;
+    loads->placeholder = CreateTexture2D(GL_RGBA, 1, 1, info, grey);
+    loads->initialized = true;
+  }
+  assert(kUsedTextureHandle < RGG_TEXTURE_MAX);
+  TextureHandle* t = UseTextureHandle();
+  t->texture = loads->placeholder;
+  t->texture.file = std::string(texture_file);
+  t->state = kTextureLoading;
+  TextureFileToId* file_to_id = UseTextureFileToId(texture_file, len);
+  file_to_id->id = t->id;
+  ++loads->stats.pending;
+
+  stbi_set_flip_vertically_on_load(1);
+  TextureId id = t->id;
+  std::string file(texture_file);
+  util::WorkerPoolPush([id, file, texture_info]() {
+    platform::Clock clock;
+    platform::ClockStart(&clock);
+    DecodedTexture decoded;
+    decoded.id = id;
+    decoded.info = texture_info;
+    s32 n;
+    decoded.pixels =
+        stbi_load(file.c_str(), &decoded.width, &decoded.height, &n, 4);
+    decoded.failure_reason = decoded.pixels ? nullptr : stbi_failure_reason();
+    kTextureLoads.decode_usec += platform::ClockEnd(&clock);
+    LockGuard lock(&kTextureLoads.mutex);
+    kTextureLoads.decoded.push_back(decoded);
+  }, nullptr, util::kWorkBackground);
+  return id;
+}
+
+void UploadDecodedTexture(const DecodedTexture& decoded) {
+  TextureLoads* loads = &kTextureLoads;
+  --loads->stats.pending;
+  TextureHandle* t = FindTextureHandle(decoded.id);
+  assert(t);
+  if (!decoded.pixels) {
+    LOG(ERR, "Cannot decode texture %s: %s", t->texture.file.c_str(),
+        decoded.failure_reason);
+    t->state = kTextureFailed;
+    ++loads->stats.failed;
+    return;
+  }
+  std::string file = std::move(t->texture.file);
+  t->texture = CreateTexture2D(GL_RGBA, decoded.width, decoded.height,
+                               decoded.info, decoded.pixels);
+  t->texture.file = std::move(file);
+  t->state = kTextureReady;
+  ++loads->stats.loaded;
+  free(decoded.pixels);
+}
+
+// Uploads decoded textures until the frame's budget is spent. At least one
+// texture is uploaded each call so large images still make progress.
+void UploadDecodedTextures() {
+  TextureLoads* loads = &kTextureLoads;
+  loads->stats.last_upload_usec = 0;
+  if (!loads->stats.pending) return;
+  // Nothing else runs queued work when the pool has no threads.
+  if (!util::kWorkerPool.thread_count) {
+    util::WorkerPoolRunOne(util::kWorkBackground);
+  }
+  {
+    LockGuard lock(&loads->mutex);
+    loads->uploads.insert(loads->uploads.end(), loads->decoded.begin(),
+                          loads->decoded.end());
+    loads->decoded.clear();
+  }
+  platform::Clock clock;
+  platform::ClockStart(&clock);
+  u32 i = 0;
+  while (i < loads->uploads.size()) {
+    UploadDecodedTexture(loads->uploads[i++]);
+    loads->stats.last_upload_usec = platform::ClockEnd(&clock);
+    if (loads->stats.last_upload_usec >= loads->upload_budget_usec) break;
+  }
+  loads->uploads.erase(loads->uploads.begin(), loads->uploads.begin() + i);
+  loads->stats.upload_usec += loads->stats.last_upload_usec;
+  loads->stats.decode_usec = loads->decode_usec;
+}
+
+b8 IsTextureReady(TextureId id) {
+  TextureHandle* handle = FindTextureHandle(id);
+  return handle && handle->state == kTextureReady;
+}
+
+// Copies a loaded texture for a caller that will draw into or destroy it.
+// The cache keeps its own, so other users of id are unaffected. Returns false
+// while it's still loading, and an invalid texture if loading failed.
+b8 CopyTexture(TextureId id, Texture* texture) {
+  TextureHandle* handle = FindTextureHandle(id);
+  if (!handle || handle->state == kTextureLoading) return false;
+  if (handle->state == kTextureReady) *texture = CopyTexture2D(handle->texture);
+  else *texture = {};
+  return true;
+}
+
 const Texture* GetTexture(TextureId id) {
   TextureHandle* handle = FindTextureHandle(id);
   if (!handle) return nullptr;
@@ -16,7 +16,16 @@ typedef PathmapNode* GetPathmapNode(const v2i&);
 PathmapNode*
 GetPathmapNodeDefault(const v2i& v)
 {
-  return &kSearch.path_map[v.x][v.y];
+  if (v.x < 0 || v.y < 0 || v.x >= kSearch.map_size.x ||
+      v.y >= kSearch.map_size.y) {
+    return nullptr;
+  }
+  PathmapNode* node = &kSearch.path_map[v.y * kSearch.map_size.x + v.x];
+  if (node->generation != kSearch.generation) {
+    *node = {};
+    node->generation = kSearch.generation;
+  }
+  return node;
 }
 
 struct BfsIterator {
@@ -40,7 +49,7 @@ struct BfsIterator {
 INLINE b8
 IsInMap(const v2i& pos, const v2i& map_size)
 {
-  return true;
+  return pos.x >= 0 && pos.y >= 0 && pos.x < map_size.x && pos.y < map_size.y;
 }
 
 INLINE b8
@@ -61,8 +70,21 @@ BfsStart(BfsIterator* itr)
   assert(itr->neighbor_callback);
   assert(itr->map_size.x > 0 && itr->map_size.y > 0);
   assert(itr->max_neighbor);
+  itr->depth = 0;
   if (!IsValidPos(itr)) return false;
-  kSearch = {};
+  // Bumping the generation stands in for clearing every node.
+  u32 count = itr->map_size.x * itr->map_size.y;
+  if (kSearch.path_map.size() < count) kSearch.path_map.resize(count);
+  if (kSearch.queue.size() < count) kSearch.queue.resize(count);
+  kSearch.map_size = itr->map_size;
+  if (++kSearch.generation == 0) {
+    for (PathmapNode& node : kSearch.path_map) node.generation = 0;
+    kSearch.generation = 1;
+  }
+  PathmapNode* node = itr->get_pathmap_node(itr->current);
+  if (!node) return false;
+  node->from = itr->current;
+  node->checked = true;
   kSearch.queue_size = 0;
   itr->neighbor_index = 0;
   itr->queue_index = 0;
@@ -70,77 +92,70 @@ BfsStart(BfsIterator* itr)
   return true;
 }
 
+// Moves the iterator to the next neighbor of from. True if that neighbor is
+// in the map, within max_depth and not yet visited.
 INLINE b8
 BfsStep(const v2i& from, BfsIterator* itr)
 {
-  const s32 neighbor_index = itr->neighbor_index;
-  printf("%s from [%i %i] idx %i\n", __func__, from.x, from.y, neighbor_index);
-  v2i neighbor = itr->neighbor_callback(from, neighbor_index);
-
-  itr->queue_index = (neighbor_index + 1) / itr->max_neighbor;
-  itr->neighbor_index += 1;
-  if (itr->neighbor_index >= itr->max_neighbor) itr->neighbor_index = 0;
-  itr->current = neighbor;
-  auto* pnode = itr->get_pathmap_node(from);
-  printf("%s From [%i %i] is [%s]\n",
-         __func__, from.x, from.y,
-         pnode == nullptr ? "NULL" : "SET");
+  itr->current = itr->neighbor_callback(from, itr->neighbor_index);
+  if (++itr->neighbor_index >= itr->max_neighbor) {
+    // Done with from - move on to the next node in the queue.
+    itr->neighbor_index = 0;
+    ++itr->queue_index;
+  }
+  PathmapNode* pnode = itr->get_pathmap_node(from);
   if (!pnode) return false;
   itr->depth = pnode->depth + 1;
-
-  return IsValidPos(itr) && !pnode->checked;
+  if (!IsValidPos(itr)) return false;
+  PathmapNode* node = itr->get_pathmap_node(itr->current);
+  return node && !node->checked;
 }
 
+// Visits the next reachable node, leaving it in itr->current. Returns false
+// once every reachable node has been visited.
 INLINE b8
 BfsNext(BfsIterator* itr)
 {
-  printf("%s 1\n", __func__);
   auto& queue = kSearch.queue;
-  auto& path_map = kSearch.path_map;
   s32& qsz = kSearch.queue_size;
   while (itr->queue_index < qsz) {
-    printf("%s 2\n", __func__);
     v2i from = queue[itr->queue_index];
-    if (BfsStep(from, itr)) {
-      if (itr->blocked_callback(itr->current)) continue;
-      if (FLAGGED(itr->flags, kAvoidBlockedDiagnol)) {
-        b8 right_tile_blocked = IsInMap(from + v2i(1, 0), itr->map_size) &&
-                                itr->blocked_callback(from + v2i(1, 0));
-        b8 left_tile_blocked = IsInMap(from + v2i(-1, 0), itr->map_size) &&
-                               itr->blocked_callback(from + v2i(-1, 0));
-        b8 bottom_tile_blocked = IsInMap(from + v2i(0, -1), itr->map_size) &&
-                                 itr->blocked_callback(from + v2i(0, -1));
-        b8 top_tile_blocked = IsInMap(from + v2i(0, 1), itr->map_size) &&
-                                      itr->blocked_callback(from + v2i(0, 1));
-        if (itr->current.x == from.x + 1 && itr->current.y == from.y + 1 &&
-            (right_tile_blocked || top_tile_blocked)) {
-          continue;
-        }
-        if (itr->current.x == from.x + 1 && itr->current.y == from.y - 1 &&
-            (right_tile_blocked || bottom_tile_blocked)) {
-          continue;
-        }
-        if (itr->current.x == from.x - 1 && itr->current.y == from.y + 1 &&
-            (left_tile_blocked || top_tile_blocked)) {
-          continue;
-        }
-        if (itr->current.x == from.x - 1 && itr->current.y == from.y - 1 &&
-            (left_tile_blocked || bottom_tile_blocked)) {
-          continue;
-        }
+    if (!BfsStep(from, itr)) continue;
+    if (itr->blocked_callback(itr->current)) continue;
+    if (FLAGGED(itr->flags, kAvoidBlockedDiagnol)) {
+      b8 right_tile_blocked = IsInMap(from + v2i(1, 0), itr->map_size) &&
+                              itr->blocked_callback(from + v2i(1, 0));
+      b8 left_tile_blocked = IsInMap(from + v2i(-1, 0), itr->map_size) &&
+                             itr->blocked_callback(from + v2i(-1, 0));
+      b8 bottom_tile_blocked = IsInMap(from + v2i(0, -1), itr->map_size) &&
+                               itr->blocked_callback(from + v2i(0, -1));
+      b8 top_tile_blocked = IsInMap(from + v2i(0, 1), itr->map_size) &&
+                                    itr->blocked_callback(from + v2i(0, 1));
+      if (itr->current.x == from.x + 1 && itr->current.y == from.y + 1 &&
+          (right_tile_blocked || top_tile_blocked)) {
+        continue;
+      }
+      if (itr->current.x == from.x + 1 && itr->current.y == from.y - 1 &&
+          (right_tile_blocked || bottom_tile_blocked)) {
+        continue;
+      }
+      if (itr->current.x == from.x - 1 && itr->current.y == from.y + 1 &&
+          (left_tile_blocked || top_tile_blocked)) {
+        continue;
+      }
+      if (itr->current.x == from.x - 1 && itr->current.y == from.y - 1 &&
+          (left_tile_blocked || bottom_tile_blocked)) {
+        continue;
       }
-      PathmapNode* node = itr->get_pathmap_node(itr->current);
-      printf("Node is %i %i is [%s]\n", itr->current.x, itr->current.y,
-             node == nullptr ? "NULL" : "SET");
-      if (!node) return false;
-      node->from = from;
-      node->depth = itr->get_pathmap_node(from)->depth + 1;
-      node->checked = true;
-      queue[qsz++] = itr->current;
-      break;
     }
+    PathmapNode* node = itr->get_pathmap_node(itr->current);
+    node->from = from;
+    node->depth = itr->depth;
+    node->checked = true;
+    queue[qsz++] = itr->current;
+    return true;
   }
-  return itr->queue_index < qsz;
+  return false;
 }
 
 INLINE Path*
@@ -149,28 +164,22 @@ BfsPathTo(BfsIterator* itr, const v2i& end)
   v2i start = itr->current;
   if (itr->current == end) return nullptr;
 
-  auto& path_map = kSearch.path_map;
-  BfsStart(itr);
-  s32 i = 0;
-  printf("%s\n", __func__);
+  if (!BfsStart(itr)) return nullptr;
   while (BfsNext(itr)) {
-    // A depth value greater than 0 means the end node was expanded.
-    if (itr->get_pathmap_node(end)->depth) {
-      break;
-    }
+    if (itr->current == end) break;
   }
 
   auto* node = itr->get_pathmap_node(end);
-  if (!node || !node->depth) return nullptr;
+  if (!node || !node->checked) return nullptr;
 
-  kPath = {};
   auto& path = kPath.queue;
   auto& psz = kPath.size;
-  path[psz++] = end;
-  while (path[psz - 1] != start) {
-    auto& prev = path[psz - 1];
-    path[psz++] = itr->get_pathmap_node(prev)->from;
+  path.clear();
+  path.push_back(end);
+  while (path.back() != start) {
+    path.push_back(itr->get_pathmap_node(path.back())->from);
   }
+  psz = path.size();
   // Reverse it
   for (s32 i = 0, last = psz - 1; i < last; ++i, --last) {
     auto t = path[last];
@@ -0,0 +1,174 @@
+#pragma once
+
+// Don't include this file directly - include search.cc instead.
+// This is contained in the search namespace
+//
+// Flow fields hold the next step toward the nearest of a set of goal cells for
+// every cell of a grid. Building one costs a Dijkstra over the grid, after
+// which any number of units find their way with a lookup per step:
+//
+//   search::FlowField field;
+//   search::FlowFieldBuild(grid, goals, goal_count, &field);
+//   v2i next;
+//   if (search::FlowFieldStep(field, cell, &next)) ...
+//
+// Steps follow the same rules and costs as FindPath. When a cell is blocked
+// FlowFieldBlock repairs only the cells whose way to a goal went through it.
+
+constexpr u32 kFlowUnreachable = UINT32_MAX;
+constexpr u8 kFlowNoStep = 0xff;
+
+struct FlowField {
+  s32 width = 0;
+  s32 height = 0;
+  // Cost from each cell to its nearest goal, in kPathStraightCost units.
+  // kFlowUnreachable where no goal can be reached.
+  std::vector<u32> integration;
+  // Index into kPathNeighbors of each cell's step toward its goal.
+  // kFlowNoStep at goals and unreachable cells.
+  std::vector<u8> direction;
+};
+
+// kPathNeighbors index of the step back the other way.
+static const u8 kFlowOpposite[kPathNeighborCount] = {1, 0, 3, 2, 7, 6, 5, 4};
+
+// Settles cells off open outward from whatever was pushed, pointing each cell
+// at the neighbor it was reached from. Returns the cells settled.
+u32
+FlowFieldRun(const PathGrid& grid, std::vector<PathOpen>* open,
+             FlowField* field)
+{
+  u32 settled = 0;
+  while (!open->empty()) {
+    std::pop_heap(open->begin(), open->end(), PathOpenCompare);
+    PathOpen top = open->back();
+    open->pop_back();
+    if (top.g > field->integration[top.node]) continue;
+    ++settled;
+    s32 x = top.node % grid.width;
+    s32 y = top.node / grid.width;
+    for (u8 i = 0; i < kPathNeighborCount; ++i) {
+      const v2i& dir = kPathNeighbors[i];
+      // Steps are symmetric, so a step out from x, y can be walked back.
+      if (!PathCanStep(grid, x, y, dir.x, dir.y)) continue;
+      u32 index = (y + dir.y) * grid.width + x + dir.x;
+      u32 g = top.g + (dir.x && dir.y ? kPathDiagonalCost : kPathStraightCost);
+      if (g >= field->integration[index]) continue;
+      field->integration[index] = g;
+      field->direction[index] = kFlowOpposite[i];
+      open->push_back({g, g, index});
+      std::push_heap(open->begin(), open->end(), PathOpenCompare);
+    }
+  }
+  return settled;
+}
+
+// Builds field toward goals over grid. Blocked goals are ignored. Returns the
+// cells settled.
+u32
+FlowFieldBuild(const PathGrid& grid, const v2i* goals, u32 goal_count,
+               FlowField* field)
+{
+  u32 count = grid.width * grid.height;
+  field->width = grid.width;
+  field->height = grid.height;
+  field->integration.assign(count, kFlowUnreachable);
+  field->direction.assign(count, kFlowNoStep);
+  std::vector<PathOpen>* open = &kPathScratch.open;
+  open->clear();
+  for (u32 i = 0; i < goal_count; ++i) {
+    if (!grid.IsOpen(goals[i].x, goals[i].y)) continue;
+    u32 index = goals[i].y * grid.width + goals[i].x;
+    field->integration[index] = 0;
+    open->push_back({0, 0, index});
+  }
+  std::make_heap(open->begin(), open->end(), PathOpenCompare);
+  return FlowFieldRun(grid, open, field);
+}
+
+// Repairs field after cell was blocked in grid. Cells whose step led through
+// cell, or now cuts its corner, lose their cost along with every cell that
+// stepped through them. Those are settled again from the cells around them,
+// the rest of the field is untouched. Returns the cells settled.
+u32
+FlowFieldBlock(const PathGrid& grid, v2i cell, FlowField* field)
+{
+  assert(grid.width == field->width && grid.height == field->height);
+  if (cell.x < 0 || cell.y < 0 || cell.x >= grid.width ||
+      cell.y >= grid.height) {
+    return 0;
+  }
+  std::vector<u32>* removed = &kPathScratch.cells;
+  removed->clear();
+  auto remove = [&](u32 index) {
+    field->integration[index] = kFlowUnreachable;
+    field->direction[index] = kFlowNoStep;
+    removed->push_back(index);
+  };
+  u32 cell_index = cell.y * grid.width + cell.x;
+  if (field->integration[cell_index] != kFlowUnreachable) remove(cell_index);
+  for (const v2i& dir : kPathNeighbors) {
+    v2i n = cell + dir;
+    if (n.x < 0 || n.y < 0 || n.x >= grid.width || n.y >= grid.height) {
+      continue;
+    }
+    u32 index = n.y * grid.width + n.x;
+    u8 step = field->direction[index];
+    if (step == kFlowNoStep) continue;
+    const v2i& to = kPathNeighbors[step];
+    if (!PathCanStep(grid, n.x, n.y, to.x, to.y)) remove(index);
+  }
+  // Everything stepping into a removed cell goes with it.
+  for (u32 i = 0; i < removed->size(); ++i) {
+    u32 index = (*removed)[i];
+    s32 x = index % grid.width;
+    s32 y = index / grid.width;
+    for (u8 j = 0; j < kPathNeighborCount; ++j) {
+      s32 nx = x + kPathNeighbors[j].x;
+      s32 ny = y + kPathNeighbors[j].y;
+      if (nx < 0 || ny < 0 || nx >= grid.width || ny >= grid.height) continue;
+      u32 n = ny * grid.width + nx;
+      if (field->direction[n] == kFlowOpposite[j]) remove(n);
+    }
+  }
+  // Reseed removed cells from the best neighbor that kept its cost.
+  std::vector<PathOpen>* open = &kPathScratch.open;
+  open->clear();
+  for (u32 index : *removed) {
+    s32 x = index % grid.width;
+    s32 y = index / grid.width;
+    if (!grid.IsOpen(x, y)) continue;
+    for (u8 j = 0; j < kPathNeighborCount; ++j) {
+      const v2i& dir = kPathNeighbors[j];
+      if (!PathCanStep(grid, x, y, dir.x, dir.y)) continue;
+      u32 n = (y + dir.y) * grid.width + x + dir.x;
+      if (field->integration[n] == kFlowUnreachable) continue;
+      u32 g = field->integration[n] +
+              (dir.x && dir.y ? kPathDiagonalCost : kPathStraightCost);
+      if (g >= field->integration[index]) continue;
+      field->integration[index] = g;
+      field->direction[index] = j;
+    }
+    if (field->integration[index] != kFlowUnreachable) {
+      open->push_back({field->integration[index],
+                       field->integration[index], index});
+    }
+  }
+  std::make_heap(open->begin(), open->end(), PathOpenCompare);
+  return FlowFieldRun(grid, open, field);
+}
+
+// The cell to step to from cell. False at goals and where no goal can be
+// reached.
+INLINE b8
+FlowFieldStep(const FlowField& field, v2i cell, v2i* next)
+{
+  if (cell.x < 0 || cell.y < 0 || cell.x >= field.width ||
+      cell.y >= field.height) {
+    return false;
+  }
+  u8 step = field.direction[cell.y * field.width + cell.x];
+  if (step == kFlowNoStep) return false;
+  *next = cell + kPathNeighbors[step];
+  return true;
+}
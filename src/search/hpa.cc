@@ -0,0 +1,427 @@
+#pragma once
+
+// Don't include this file directly - include search.cc instead.
+// This is contained in the search namespace
+//
+// Hierarchical paths (HPA*) for grids too big to A* across per query. The
+// grid is split into square clusters. Where open ground crosses the border
+// between two clusters there's an entrance on either side, and the cost
+// between every pair of entrances within a cluster is kept. Queries search
+// that graph of entrances, a handful per cluster, then fill in the cells a
+// cluster at a time:
+//
+//   search::HpaGraph graph;
+//   search::HpaBuild(grid, 16, &graph);
+//   search::HpaFindPath(grid, graph, start, goal, &path);
+//
+// Changing a cell only rebuilds the entrances on borders it lies on and the
+// costs of the clusters beside it:
+//
+//   blocked[cell.y * width + cell.x] = 1;
+//   search::HpaUpdateCell(grid, cell, &graph);
+//
+// Paths cross clusters at entrances, so they can run a few steps longer than
+// FindPath's.
+
+struct HpaEntrance {
+  v2i cell;
+  // The cell in the neighboring cluster it steps across to.
+  v2i across;
+};
+
+struct HpaCluster {
+  v2i min;
+  v2i dims;
+  std::vector<HpaEntrance> entrances;
+  // Cost from each entrance to each other within the cluster, row per
+  // entrance. kFlowUnreachable where they aren't connected.
+  std::vector<u32> costs;
+};
+
+struct HpaGraph {
+  s32 width = 0;
+  s32 height = 0;
+  s32 cluster_size = 0;
+  s32 clusters_x = 0;
+  s32 clusters_y = 0;
+  std::vector<HpaCluster> clusters;
+
+  u32
+  ClusterIndex(v2i cell) const
+  {
+    return (cell.y / cluster_size) * clusters_x + cell.x / cluster_size;
+  }
+
+  // Entrances a cluster can hold - one per cell of its four borders.
+  u32
+  MaxEntrances() const
+  {
+    return 4 * cluster_size;
+  }
+};
+
+struct HpaStats {
+  // Entrances taken off the open list.
+  u32 expanded = 0;
+  // In cells, with straight steps costing 1.
+  r32 cost = 0.f;
+};
+
+// Runs shorter than this get an entrance in the middle, longer ones one at
+// each end.
+constexpr s32 kHpaEntranceRun = 6;
+
+// Costs within a cluster and entrance nodes are searched with their own
+// scratch so FindPath can run while they're in use.
+thread_local FlowField kHpaField;
+thread_local PathScratch kHpaScratch;
+thread_local std::vector<v2i> kHpaLocalPath;
+
+// Dijkstra from cell over view into kHpaField. cell may be blocked.
+void
+HpaLocalCosts(const PathGrid& view, v2i cell)
+{
+  FlowField* field = &kHpaField;
+  u32 count = view.width * view.height;
+  field->width = view.width;
+  field->height = view.height;
+  field->integration.assign(count, kFlowUnreachable);
+  field->direction.assign(count, kFlowNoStep);
+  u32 index = cell.y * view.width + cell.x;
+  field->integration[index] = 0;
+  std::vector<PathOpen>* open = &kHpaScratch.open;
+  open->clear();
+  open->push_back({0, 0, index});
+  FlowFieldRun(view, open, field);
+}
+
+INLINE u32
+HpaLocalCost(const HpaCluster& cluster, v2i cell)
+{
+  v2i local = cell - cluster.min;
+  return kHpaField.integration[local.y * cluster.dims.x + local.x];
+}
+
+void
+HpaBuildCosts(const PathGrid& grid, HpaCluster* cluster)
+{
+  PathGrid view = PathGridView(grid, cluster->min, cluster->dims);
+  u32 n = cluster->entrances.size();
+  cluster->costs.resize(n * n);
+  for (u32 i = 0; i < n; ++i) {
+    HpaLocalCosts(view, cluster->entrances[i].cell - cluster->min);
+    for (u32 j = 0; j < n; ++j) {
+      cluster->costs[i * n + j] =
+          HpaLocalCost(*cluster, cluster->entrances[j].cell);
+    }
+  }
+}
+
+INLINE void
+HpaAddEntrances(HpaCluster* a, HpaCluster* b, v2i cell_a, v2i cell_b)
+{
+  a->entrances.push_back({cell_a, cell_b});
+  b->entrances.push_back({cell_b, cell_a});
+}
+
+// Rebuilds the entrances between cluster a and the cluster b to its right, or
+// above it if vertical is set.
+void
+HpaBuildBorder(const PathGrid& grid, HpaGraph* graph, u32 a_index,
+               u32 b_index, b8 vertical)
+{
+  HpaCluster* a = &graph->clusters[a_index];
+  HpaCluster* b = &graph->clusters[b_index];
+  auto remove_across = [graph](HpaCluster* cluster, u32 other) {
+    std::vector<HpaEntrance>* entrances = &cluster->entrances;
+    entrances->erase(
+        std::remove_if(entrances->begin(), entrances->end(),
+                       [graph, other](const HpaEntrance& e) {
+                         return graph->ClusterIndex(e.across) == other;
+                       }),
+        entrances->end());
+  };
+  remove_across(a, b_index);
+  remove_across(b, a_index);
+  // The border runs along step from the first pair of cells either side of
+  // it.
+  v2i step = vertical ? v2i(1, 0) : v2i(0, 1);
+  v2i first_a = vertical ? v2i(a->min.x, a->min.y + a->dims.y - 1)
+                         : v2i(a->min.x + a->dims.x - 1, a->min.y);
+  v2i first_b = b->min;
+  s32 length = vertical ? a->dims.x : a->dims.y;
+  s32 run = 0;
+  for (s32 i = 0; i <= length; ++i) {
+    v2i cell_a = first_a + step * i;
+    v2i cell_b = first_b + step * i;
+    if (i < length && grid.IsOpen(cell_a.x, cell_a.y) &&
+        grid.IsOpen(cell_b.x, cell_b.y)) {
+      ++run;
+      continue;
+    }
+    if (!run) continue;
+    s32 start = i - run;
+    if (run < kHpaEntranceRun) {
+      s32 middle = start + run / 2;
+      HpaAddEntrances(a, b, first_a + step * middle, first_b + step * middle);
+    } else {
+      HpaAddEntrances(a, b, first_a + step * start, first_b + step * start);
+      HpaAddEntrances(a, b, first_a + step * (i - 1),
+                      first_b + step * (i - 1));
+    }
+    run = 0;
+  }
+}
+
+// Splits grid into clusters of cluster_size square and finds the entrances
+// and costs of every one.
+void
+HpaBuild(const PathGrid& grid, s32 cluster_size, HpaGraph* graph)
+{
+  assert(cluster_size > 0);
+  graph->width = grid.width;
+  graph->height = grid.height;
+  graph->cluster_size = cluster_size;
+  graph->clusters_x = (grid.width + cluster_size - 1) / cluster_size;
+  graph->clusters_y = (grid.height + cluster_size - 1) / cluster_size;
+  graph->clusters.clear();
+  graph->clusters.resize(graph->clusters_x * graph->clusters_y);
+  for (s32 cy = 0; cy < graph->clusters_y; ++cy) {
+    for (s32 cx = 0; cx < graph->clusters_x; ++cx) {
+      HpaCluster* cluster = &graph->clusters[cy * graph->clusters_x + cx];
+      cluster->min = v2i(cx * cluster_size, cy * cluster_size);
+      cluster->dims = v2i(MIN(cluster_size, grid.width - cluster->min.x),
+                          MIN(cluster_size, grid.height - cluster->min.y));
+    }
+  }
+  for (s32 cy = 0; cy < graph->clusters_y; ++cy) {
+    for (s32 cx = 0; cx < graph->clusters_x; ++cx) {
+      u32 index = cy * graph->clusters_x + cx;
+      if (cx + 1 < graph->clusters_x) {
+        HpaBuildBorder(grid, graph, index, index + 1, false);
+      }
+      if (cy + 1 < graph->clusters_y) {
+        HpaBuildBorder(grid, graph, index, index + graph->clusters_x, true);
+      }
+    }
+  }
+  for (HpaCluster& cluster : graph->clusters) {
+    assert(cluster.entrances.size() <= graph->MaxEntrances());
+    HpaBuildCosts(grid, &cluster);
+  }
+}
+
+// Updates graph after cell was blocked or unblocked in grid. Returns the
+// clusters whose costs were rebuilt.
+u32
+HpaUpdateCell(const PathGrid& grid, v2i cell, HpaGraph* graph)
+{
+  if (cell.x < 0 || cell.y < 0 || cell.x >= graph->width ||
+      cell.y >= graph->height) {
+    return 0;
+  }
+  s32 cx = cell.x / graph->cluster_size;
+  s32 cy = cell.y / graph->cluster_size;
+  u32 index = graph->ClusterIndex(cell);
+  const HpaCluster& cluster = graph->clusters[index];
+  u32 changed[5];
+  u32 changed_count = 0;
+  changed[changed_count++] = index;
+  if (cell.x == cluster.min.x && cx > 0) {
+    HpaBuildBorder(grid, graph, index - 1, index, false);
+    changed[changed_count++] = index - 1;
+  }
+  if (cell.x == cluster.min.x + cluster.dims.x - 1 &&
+      cx + 1 < graph->clusters_x) {
+    HpaBuildBorder(grid, graph, index, index + 1, false);
+    changed[changed_count++] = index + 1;
+  }
+  if (cell.y == cluster.min.y && cy > 0) {
+    HpaBuildBorder(grid, graph, index - graph->clusters_x, index, true);
+    changed[changed_count++] = index - graph->clusters_x;
+  }
+  if (cell.y == cluster.min.y + cluster.dims.y - 1 &&
+      cy + 1 < graph->clusters_y) {
+    HpaBuildBorder(grid, graph, index, index + graph->clusters_x, true);
+    changed[changed_count++] = index + graph->clusters_x;
+  }
+  for (u32 i = 0; i < changed_count; ++i) {
+    HpaBuildCosts(grid, &graph->clusters[changed[i]]);
+  }
+  return changed_count;
+}
+
+// Appends the cells from the last cell of path to to, walking within cluster.
+b8
+HpaRefine(const PathGrid& grid, const HpaCluster& cluster, v2i to,
+          std::vector<v2i>* path)
+{
+  v2i from = path->back();
+  if (from == to) return true;
+  PathGrid view = PathGridView(grid, cluster.min, cluster.dims);
+  if (!FindPath(view, from - cluster.min, to - cluster.min, &kHpaLocalPath,
+                kPathAStar)) {
+    return false;
+  }
+  for (u32 i = 1; i < kHpaLocalPath.size(); ++i) {
+    path->push_back(kHpaLocalPath[i] + cluster.min);
+  }
+  return true;
+}
+
+// Fills path with cells from start to goal like FindPath, searching graph's
+// entrances first and then the cells of the clusters on the way. graph must be
+// up to date with grid.
+b8
+HpaFindPath(const PathGrid& grid, const HpaGraph& graph, v2i start,
+            v2i goal, std::vector<v2i>* path, HpaStats* stats = nullptr)
+{
+  HpaStats local_stats;
+  if (!stats) stats = &local_stats;
+  *stats = {};
+  path->clear();
+  assert(grid.width == graph.width && grid.height == graph.height);
+  if (start.x < 0 || start.y < 0 || start.x >= grid.width ||
+      start.y >= grid.height || !grid.IsOpen(goal.x, goal.y)) {
+    return false;
+  }
+  // A blocked start's way out can cross into the next cluster anywhere,
+  // not just at an entrance. It's rare - units stood where a wall went up.
+  if (!grid.IsOpen(start.x, start.y)) {
+    PathStats path_stats;
+    b8 found = FindPath(grid, start, goal, path, kPathAStar, &path_stats);
+    stats->cost = path_stats.cost;
+    return found;
+  }
+  u32 start_cluster = graph.ClusterIndex(start);
+  u32 goal_cluster = graph.ClusterIndex(goal);
+  // Stay within the cluster when both ends are in it and connected there.
+  if (start_cluster == goal_cluster) {
+    path->push_back(start);
+    if (HpaRefine(grid, graph.clusters[start_cluster], goal, path)) {
+      stats->cost = PathCost(*path);
+      return true;
+    }
+    path->clear();
+  }
+
+  // Nodes are entrances, numbered per cluster, then start and goal.
+  const u32 stride = graph.MaxEntrances();
+  const u32 start_node = graph.clusters.size() * stride;
+  const u32 goal_node = start_node + 1;
+  auto node_cell = [&](u32 node) -> v2i {
+    if (node == start_node) return start;
+    if (node == goal_node) return goal;
+    return graph.clusters[node / stride].entrances[node % stride].cell;
+  };
+  const HpaCluster& sc = graph.clusters[start_cluster];
+  const HpaCluster& gc = graph.clusters[goal_cluster];
+  std::vector<u32> start_costs(sc.entrances.size());
+  std::vector<u32> goal_costs(gc.entrances.size());
+  HpaLocalCosts(PathGridView(grid, sc.min, sc.dims), start - sc.min);
+  for (u32 i = 0; i < sc.entrances.size(); ++i) {
+    start_costs[i] = HpaLocalCost(sc, sc.entrances[i].cell);
+  }
+  HpaLocalCosts(PathGridView(grid, gc.min, gc.dims), goal - gc.min);
+  for (u32 i = 0; i < gc.entrances.size(); ++i) {
+    goal_costs[i] = HpaLocalCost(gc, gc.entrances[i].cell);
+  }
+
+  PathScratch* scratch = &kHpaScratch;
+  if (scratch->nodes.size() < goal_node + 1) {
+    scratch->nodes.resize(goal_node + 1);
+  }
+  if (++scratch->generation == 0) {
+    for (PathNode& node : scratch->nodes) node.generation = 0;
+    scratch->generation = 1;
+  }
+  scratch->open.clear();
+  auto push = [&](u32 node, u32 parent, u32 g) {
+    PathNode* n = PathVisit(scratch, node);
+    if (n->closed || g >= n->g) return;
+    n->g = g;
+    n->parent = parent;
+    v2i cell = node_cell(node);
+    u32 f = g + OctileDistance(goal.x - cell.x, goal.y - cell.y);
+    scratch->open.push_back({f, g, node});
+    std::push_heap(scratch->open.begin(), scratch->open.end(),
+                   PathOpenCompare);
+  };
+  push(start_node, start_node, 0);
+  b8 found = false;
+  while (!scratch->open.empty()) {
+    std::pop_heap(scratch->open.begin(), scratch->open.end(),
+                  PathOpenCompare);
+    PathOpen open = scratch->open.back();
+    scratch->open.pop_back();
+    PathNode* node = &scratch->nodes[open.node];
+    if (node->closed || open.g > node->g) continue;
+    node->closed = true;
+    ++stats->expanded;
+    if (open.node == goal_node) {
+      found = true;
+      break;
+    }
+    if (open.node == start_node) {
+      for (u32 i = 0; i < sc.entrances.size(); ++i) {
+        if (start_costs[i] == kFlowUnreachable) continue;
+        push(start_cluster * stride + i, open.node, start_costs[i]);
+      }
+      continue;
+    }
+    u32 cluster_index = open.node / stride;
+    u32 i = open.node % stride;
+    const HpaCluster& cluster = graph.clusters[cluster_index];
+    u32 n = cluster.entrances.size();
+    if (cluster_index == goal_cluster && goal_costs[i] != kFlowUnreachable) {
+      push(goal_node, open.node, open.g + goal_costs[i]);
+    }
+    for (u32 j = 0; j < n; ++j) {
+      u32 cost = cluster.costs[i * n + j];
+      if (j == i || cost == kFlowUnreachable) continue;
+      push(cluster_index * stride + j, open.node, open.g + cost);
+    }
+    const HpaEntrance& entrance = cluster.entrances[i];
+    u32 across_index = graph.ClusterIndex(entrance.across);
+    const HpaCluster& across = graph.clusters[across_index];
+    for (u32 j = 0; j < across.entrances.size(); ++j) {
+      if (across.entrances[j].cell != entrance.across ||
+          across.entrances[j].across != entrance.cell) {
+        continue;
+      }
+      push(across_index * stride + j, open.node,
+           open.g + kPathStraightCost);
+      break;
+    }
+  }
+  if (!found) return false;
+  stats->cost = (r32)scratch->nodes[goal_node].g / kPathStraightCost;
+
+  // Walk back to start, then fill in cells between consecutive nodes. Nodes
+  // in the same cluster are joined within it, nodes in neighboring clusters
+  // are a step apart.
+  std::vector<u32>* nodes = &scratch->cells;
+  nodes->clear();
+  for (u32 node = goal_node; node != start_node;
+       node = scratch->nodes[node].parent) {
+    nodes->push_back(node);
+  }
+  path->push_back(start);
+  u32 cluster_index = start_cluster;
+  for (s32 i = (s32)nodes->size() - 1; i >= 0; --i) {
+    u32 node = (*nodes)[i];
+    u32 next_cluster = node == goal_node ? goal_cluster : node / stride;
+    v2i cell = node_cell(node);
+    if (next_cluster != cluster_index) {
+      path->push_back(cell);
+      cluster_index = next_cluster;
+      continue;
+    }
+    if (!HpaRefine(grid, graph.clusters[cluster_index], cell, path)) {
+      assert(!"HpaFindPath costs out of date with grid.");
+      path->clear();
+      return false;
+    }
+  }
+  return true;
+}
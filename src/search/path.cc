@@ -0,0 +1,358 @@
+#pragma once
+
+// Don't include this file directly - include search.cc instead.
+// This is contained in the search namespace
+//
+// Shortest paths over 8 connected grids of any size. Straight steps cost 1 and
+// diagonal steps sqrt(2). Diagonals never cut the corner of a blocked cell -
+// the same rule as kAvoidBlockedDiagnol.
+//
+// Costs are summed in fixed point. Float sums of diagonal steps drift from
+// the heuristic's product, which splits paths that should tie and has A*
+// expanding far more than it needs to on open ground.
+//
+//   search::PathGrid grid = {width, height, blocked};
+//   std::vector<v2i> path;
+//   if (search::FindPath(grid, start, goal, &path)) {
+//     // path runs from start to goal a cell at a time.
+//   }
+//
+// kPathAStar is A* with an octile heuristic. kPathJumpPoint is jump point
+// search, which only holds for grids where every open cell costs the same -
+// it skips over runs of cells A* would push one by one and returns a path of
+// the same length.
+//
+// Each thread searches with its own node scratch, sized to the largest grid
+// it has seen. Nodes are stamped with the query that last touched them rather
+// than cleared, so a query only costs the nodes it visits.
+
+struct PathGrid {
+  s32 width = 0;
+  s32 height = 0;
+  // width * height cells row by row from the bottom left. Nonzero is blocked.
+  const u8* blocked = nullptr;
+  // Cells from one row of blocked to the next, for grids viewing part of a
+  // larger one. 0 is width.
+  s32 stride = 0;
+
+  b8
+  IsOpen(s32 x, s32 y) const
+  {
+    return x >= 0 && y >= 0 && x < width && y < height &&
+           !blocked[y * (stride ? stride : width) + x];
+  }
+};
+
+// The dims cells of grid from min. Cells outside it are blocked to searches of
+// the view.
+INLINE PathGrid
+PathGridView(const PathGrid& grid, v2i min, v2i dims)
+{
+  PathGrid view;
+  view.width = dims.x;
+  view.height = dims.y;
+  view.stride = grid.stride ? grid.stride : grid.width;
+  view.blocked = grid.blocked + min.y * view.stride + min.x;
+  return view;
+}
+
+enum PathAlgorithm {
+  kPathAStar,
+  kPathJumpPoint,
+};
+
+struct PathStats {
+  // Nodes taken off the open list.
+  u32 expanded = 0;
+  u32 pushed = 0;
+  // In cells, with straight steps costing 1.
+  r32 cost = 0.f;
+};
+
+constexpr u32 kPathStraightCost = 4096;
+// sqrt(2) * kPathStraightCost.
+constexpr u32 kPathDiagonalCost = 5793;
+
+struct PathNode {
+  // Query that last touched the node. Anything else it holds is stale when
+  // this isn't the current generation.
+  u32 generation = 0;
+  u32 parent;
+  u32 g;
+  b8 closed;
+};
+
+struct PathOpen {
+  u32 f;
+  u32 g;
+  u32 node;
+};
+
+struct PathScratch {
+  std::vector<PathNode> nodes;
+  // Binary heap, cheapest f on top. Nodes are pushed again when a cheaper way
+  // to them is found and the stale entries skipped when popped.
+  std::vector<PathOpen> open;
+  std::vector<v2i> points;
+  std::vector<u32> cells;
+  u32 generation = 0;
+};
+
+thread_local PathScratch kPathScratch;
+
+INLINE u32
+OctileDistance(s32 dx, s32 dy)
+{
+  dx = abs(dx);
+  dy = abs(dy);
+  s32 diagonal = dx < dy ? dx : dy;
+  return (dx + dy - 2 * diagonal) * kPathStraightCost +
+         diagonal * kPathDiagonalCost;
+}
+
+// Ties on f go to the deeper node, which heads toward the goal instead of
+// widening the search.
+INLINE bool
+PathOpenCompare(const PathOpen& a, const PathOpen& b)
+{
+  if (a.f != b.f) return a.f > b.f;
+  return a.g < b.g;
+}
+
+PathScratch*
+PathBegin(const PathGrid& grid)
+{
+  PathScratch* scratch = &kPathScratch;
+  u64 count = (u64)grid.width * grid.height;
+  if (scratch->nodes.size() < count) scratch->nodes.resize(count);
+  if (++scratch->generation == 0) {
+    for (PathNode& node : scratch->nodes) node.generation = 0;
+    scratch->generation = 1;
+  }
+  scratch->open.clear();
+  return scratch;
+}
+
+INLINE PathNode*
+PathVisit(PathScratch* scratch, u32 index)
+{
+  PathNode* node = &scratch->nodes[index];
+  if (node->generation != scratch->generation) {
+    node->generation = scratch->generation;
+    node->parent = index;
+    node->g = UINT32_MAX;
+    node->closed = false;
+  }
+  return node;
+}
+
+INLINE void
+PathPush(PathScratch* scratch, const PathGrid& grid, v2i pos, u32 parent,
+         u32 g, v2i goal, PathStats* stats)
+{
+  u32 index = pos.y * grid.width + pos.x;
+  PathNode* node = PathVisit(scratch, index);
+  if (node->closed || g >= node->g) return;
+  node->g = g;
+  node->parent = parent;
+  u32 f = g + OctileDistance(goal.x - pos.x, goal.y - pos.y);
+  scratch->open.push_back({f, g, index});
+  std::push_heap(scratch->open.begin(), scratch->open.end(), PathOpenCompare);
+  ++stats->pushed;
+}
+
+// Whether a step from x, y by dx, dy is allowed.
+INLINE b8
+PathCanStep(const PathGrid& grid, s32 x, s32 y, s32 dx, s32 dy)
+{
+  if (!grid.IsOpen(x + dx, y + dy)) return false;
+  if (dx && dy) return grid.IsOpen(x + dx, y) && grid.IsOpen(x, y + dy);
+  return true;
+}
+
+// Walks from x, y by dx, dy until reaching the goal or a cell with a neighbor
+// that can only be reached well through it. Returns false if the walk hits a
+// wall first.
+b8
+PathJump(const PathGrid& grid, s32 x, s32 y, s32 dx, s32 dy, v2i goal,
+         v2i* jump_point)
+{
+  for (;;) {
+    if (!PathCanStep(grid, x, y, dx, dy)) return false;
+    x += dx;
+    y += dy;
+    if (x == goal.x && y == goal.y) break;
+    if (dx && dy) {
+      if (PathJump(grid, x, y, dx, 0, goal, jump_point) ||
+          PathJump(grid, x, y, 0, dy, goal, jump_point)) {
+        break;
+      }
+    } else if (dx) {
+      if ((grid.IsOpen(x, y - 1) && !grid.IsOpen(x - dx, y - 1)) ||
+          (grid.IsOpen(x, y + 1) && !grid.IsOpen(x - dx, y + 1))) {
+        break;
+      }
+    } else {
+      if ((grid.IsOpen(x - 1, y) && !grid.IsOpen(x - 1, y - dy)) ||
+          (grid.IsOpen(x + 1, y) && !grid.IsOpen(x + 1, y - dy))) {
+        break;
+      }
+    }
+  }
+  *jump_point = v2i(x, y);
+  return true;
+}
+
+// Directions worth searching from pos given the direction it was reached in.
+// Everything else is reached at least as cheaply through another path.
+u32
+PathPrunedDirections(const PathGrid& grid, v2i pos, s32 dx, s32 dy,
+                     v2i* dirs)
+{
+  u32 count = 0;
+  s32 x = pos.x;
+  s32 y = pos.y;
+  if (dx && dy) {
+    dirs[count++] = v2i(0, dy);
+    dirs[count++] = v2i(dx, 0);
+    dirs[count++] = v2i(dx, dy);
+  } else if (dx) {
+    dirs[count++] = v2i(dx, 0);
+    if (grid.IsOpen(x, y + 1)) {
+      dirs[count++] = v2i(0, 1);
+      dirs[count++] = v2i(dx, 1);
+    }
+    if (grid.IsOpen(x, y - 1)) {
+      dirs[count++] = v2i(0, -1);
+      dirs[count++] = v2i(dx, -1);
+    }
+  } else {
+    dirs[count++] = v2i(0, dy);
+    if (grid.IsOpen(x + 1, y)) {
+      dirs[count++] = v2i(1, 0);
+      dirs[count++] = v2i(1, dy);
+    }
+    if (grid.IsOpen(x - 1, y)) {
+      dirs[count++] = v2i(-1, 0);
+      dirs[count++] = v2i(-1, dy);
+    }
+  }
+  return count;
+}
+
+constexpr s32 kPathNeighborCount = 8;
+static const v2i kPathNeighbors[kPathNeighborCount] = {
+  v2i(1, 0), v2i(-1, 0), v2i(0, 1), v2i(0, -1),
+  v2i(1, 1), v2i(1, -1), v2i(-1, 1), v2i(-1, -1),
+};
+
+INLINE s32
+PathSign(s32 v)
+{
+  return (v > 0) - (v < 0);
+}
+
+// Writes the path ending at goal, one cell per step. Jump point paths are
+// straight or diagonal between points so the cells between fill in exactly.
+void
+PathBuild(PathScratch* scratch, const PathGrid& grid, u32 goal,
+          std::vector<v2i>* path)
+{
+  std::vector<v2i>* points = &scratch->points;
+  points->clear();
+  u32 index = goal;
+  for (;;) {
+    points->push_back(v2i(index % grid.width, index / grid.width));
+    u32 parent = scratch->nodes[index].parent;
+    if (parent == index) break;
+    index = parent;
+  }
+  path->clear();
+  path->push_back(points->back());
+  for (s32 i = (s32)points->size() - 2; i >= 0; --i) {
+    v2i pos = path->back();
+    v2i to = (*points)[i];
+    while (pos != to) {
+      pos += v2i(PathSign(to.x - pos.x), PathSign(to.y - pos.y));
+      path->push_back(pos);
+    }
+  }
+}
+
+// Cost of walking path, in cells with straight steps costing 1.
+r32
+PathCost(const std::vector<v2i>& path)
+{
+  u32 cost = 0;
+  for (u32 i = 1; i < path.size(); ++i) {
+    v2i d = path[i] - path[i - 1];
+    cost += d.x && d.y ? kPathDiagonalCost : kPathStraightCost;
+  }
+  return (r32)cost / kPathStraightCost;
+}
+
+// Fills path with the cells from start to goal, both included. Returns false
+// if goal is blocked or can't be reached. start may be blocked, for units
+// standing where something was just built.
+b8
+FindPath(const PathGrid& grid, v2i start, v2i goal, std::vector<v2i>* path,
+         PathAlgorithm algorithm = kPathJumpPoint, PathStats* stats = nullptr)
+{
+  PathStats local_stats;
+  if (!stats) stats = &local_stats;
+  *stats = {};
+  path->clear();
+  if (start.x < 0 || start.y < 0 || start.x >= grid.width ||
+      start.y >= grid.height || !grid.IsOpen(goal.x, goal.y)) {
+    return false;
+  }
+  PathScratch* scratch = PathBegin(grid);
+  PathPush(scratch, grid, start, start.y * grid.width + start.x, 0, goal,
+           stats);
+  u32 goal_index = goal.y * grid.width + goal.x;
+  v2i dirs[kPathNeighborCount];
+  while (!scratch->open.empty()) {
+    std::pop_heap(scratch->open.begin(), scratch->open.end(), PathOpenCompare);
+    PathOpen open = scratch->open.back();
+    scratch->open.pop_back();
+    PathNode* node = &scratch->nodes[open.node];
+    if (node->closed || open.g > node->g) continue;
+    node->closed = true;
+    ++stats->expanded;
+    if (open.node == goal_index) {
+      stats->cost = (r32)node->g / kPathStraightCost;
+      PathBuild(scratch, grid, goal_index, path);
+      return true;
+    }
+    v2i pos(open.node % grid.width, open.node / grid.width);
+    if (algorithm == kPathAStar) {
+      for (const v2i& dir : kPathNeighbors) {
+        if (!PathCanStep(grid, pos.x, pos.y, dir.x, dir.y)) continue;
+        u32 step = dir.x && dir.y ? kPathDiagonalCost : kPathStraightCost;
+        PathPush(scratch, grid, pos + dir, open.node, node->g + step, goal,
+                 stats);
+      }
+      continue;
+    }
+    u32 dir_count;
+    if (node->parent == open.node) {
+      for (s32 i = 0; i < kPathNeighborCount; ++i) dirs[i] = kPathNeighbors[i];
+      dir_count = kPathNeighborCount;
+    } else {
+      v2i parent(node->parent % grid.width, node->parent / grid.width);
+      dir_count = PathPrunedDirections(grid, pos, PathSign(pos.x - parent.x),
+                                       PathSign(pos.y - parent.y), dirs);
+    }
+    for (u32 i = 0; i < dir_count; ++i) {
+      v2i jump_point;
+      if (!PathJump(grid, pos.x, pos.y, dirs[i].x, dirs[i].y, goal,
+                    &jump_point)) {
+        continue;
+      }
+      u32 g = node->g + OctileDistance(jump_point.x - pos.x,
+                                       jump_point.y - pos.y);
+      PathPush(scratch, grid, jump_point, open.node, g, goal, stats);
+    }
+  }
+  return false;
+}
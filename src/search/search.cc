@@ -1,14 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
 #include "math/vec.h"
 
 namespace search {
 
-constexpr u32 kMapMaxWidth = 64;
-constexpr u32 kMapMaxHeight = 64;
-
 struct Path {
-  v2i queue[kMapMaxWidth * kMapMaxHeight];
+  std::vector<v2i> queue;
   s32 size;
 };
 
@@ -16,13 +18,18 @@ struct PathmapNode {
   v2i from;
   u32 depth = 0;
   b8 checked = false;
+  // Search that last touched the node. The node is fresh for any other.
+  u32 generation = 0;
 };
 
 struct Search {
-  // Visited Nodes
-  PathmapNode path_map[kMapMaxWidth][kMapMaxHeight];
+  // Visited Nodes, map_size.x * map_size.y of them row by row. Grown to the
+  // largest map searched and never cleared - see generation.
+  std::vector<PathmapNode> path_map;
+  v2i map_size;
+  u32 generation = 0;
   // BFS queue.
-  v2i queue[kMapMaxWidth * kMapMaxHeight];
+  std::vector<v2i> queue;
   s32 queue_size;
 };
 
@@ -30,5 +37,8 @@ static Search kSearch;
 static Path kPath;
 
 #include "bfs.cc"
+#include "path.cc"
+#include "flow_field.cc"
+#include "hpa.cc"
 
 }
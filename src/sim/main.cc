@@ -7,6 +7,8 @@ public:
   void OnRender() override;
   void OnImGui() override;
   void OnFileSelected(const std::string& filename) override;
+  u32 RenderKey() override;
+  bool IsAnimating() override { return !map_.IsLoaded(); }
   void LoadMap(const std::string& filename);
   void ChangeScale(r32 delta);
   void Main();
@@ -62,6 +64,10 @@ void Game::OnRender() {
   map_.Render(scale_);
 }
 
+u32 Game::RenderKey() {
+  return rgg::HashRenderKey(map_.version(), EditorRenderTarget::RenderKey());
+}
+
 void Game::OnImGui() {
   ImGuiImage();
 }
@@ -49,6 +49,10 @@ s32 main(s32 argc, char** argv) {
 
   kGameState.framerate_usec = 1000 * 1000 / kGameState.framerate;
 
+  if (!memory::Initialize(MiB(64))) {
+    return 1;
+  }
+
   if (!SetupWorkingDirectory()) {
     LOG(ERR, "Unable to setup working directory.");
     return 1;
@@ -70,6 +74,7 @@ s32 main(s32 argc, char** argv) {
 
   while (1) {
     platform::ClockStart(&game_clock);
+    memory::ResetArena(memory::kFrame);
 
     if (window::ShouldClose()) break;
     ImGuiImplNewFrame();
@@ -97,6 +102,7 @@ s32 main(s32 argc, char** argv) {
     ImGuiImplRenderDrawData();
     ImGui::EndFrame();
 
+    rgg::EndFrame();
     window::SwapBuffers();
 
     const u64 elapsed_usec = platform::ClockEnd(&game_clock);
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include "platform/platform.cc"
+
+namespace util {
+
+// Persistent pool of worker threads pulling from a single work queue. Threads
+// sleep on a semaphore while there is no work so an idle pool costs nothing.
+//
+// Work is tracked through an optional WorkGroup so callers can wait for just
+// the work they pushed. Waiting threads run queued work rather than block.
+//
+// Background work, like decoding an image that's needed in a few frames, has
+// its own queue. Only worker threads run it, after any normal work, so a
+// frame waiting on its own work never picks up a long background job.
+
+typedef std::function<void()> WorkFunc;
+
+constexpr u32 kMaxWorkers = 16;
+constexpr u32 kMaxWork = 1024;
+
+enum WorkPriority : u32 {
+  kWorkNormal = 0,
+  kWorkBackground = 1,
+  kWorkPriorityCount = 2,
+};
+
+struct WorkGroup {
+  // Work pushed to this group that has not finished running.
+  std::atomic<u32> outstanding{0};
+};
+
+struct Work {
+  WorkFunc func;
+  WorkGroup* group = nullptr;
+};
+
+// Ring buffer of queued work guarded by WorkerPool::mutex.
+struct WorkQueue {
+  Work work[kMaxWork];
+  u32 read = 0;
+  u32 write = 0;
+};
+
+struct WorkerPool {
+  Thread threads[kMaxWorkers];
+  u32 thread_count = 0;
+  WorkQueue queues[kWorkPriorityCount];
+  Mutex mutex;
+  // Posted once per pushed work item of either priority.
+  Semaphore semaphore;
+  std::atomic<b8> shutdown{false};
+  b8 initialized = false;
+};
+
+static WorkerPool kWorkerPool;
+
+// Pops one work item of priority and runs it on the calling thread. Returns
+// false if that queue was empty.
+b8
+WorkerPoolRunOne(WorkPriority priority = kWorkNormal)
+{
+  Work work;
+  {
+    LockGuard lock(&kWorkerPool.mutex);
+    WorkQueue* queue = &kWorkerPool.queues[priority];
+    if (queue->read == queue->write) return false;
+    Work* w = &queue->work[queue->read % kMaxWork];
+    work.func = std::move(w->func);
+    work.group = w->group;
+    *w = {};
+    ++queue->read;
+  }
+  work.func();
+  if (work.group) --work.group->outstanding;
+  return true;
+}
+
+u64
+WorkerPoolThreadMain(void* arg)
+{
+  while (1) {
+    platform::SemaphoreWait(&kWorkerPool.semaphore);
+    if (kWorkerPool.shutdown) break;
+    if (!WorkerPoolRunOne(kWorkNormal)) WorkerPoolRunOne(kWorkBackground);
+  }
+  return 0;
+}
+
+b8
+WorkerPoolInitialize(u32 thread_count)
+{
+  if (kWorkerPool.initialized) return true;
+  if (!platform::MutexCreate(&kWorkerPool.mutex)) return false;
+  if (!platform::SemaphoreCreate(&kWorkerPool.semaphore)) return false;
+  kWorkerPool.shutdown = false;
+  kWorkerPool.thread_count = MIN(thread_count, kMaxWorkers);
+  for (u32 i = 0; i < kWorkerPool.thread_count; ++i) {
+    Thread* thread = &kWorkerPool.threads[i];
+    thread->func = WorkerPoolThreadMain;
+    thread->arg = nullptr;
+    if (!platform::ThreadCreate(thread)) return false;
+  }
+  kWorkerPool.initialized = true;
+  return true;
+}
+
+// Sizes the pool to leave one core for the calling thread.
+b8
+WorkerPoolInitialize()
+{
+  u32 cores = platform::thread_affinity_count();
+  if (cores == UINT_MAX || cores <= 1) return WorkerPoolInitialize(0);
+  return WorkerPoolInitialize(cores - 1);
+}
+
+void
+WorkerPoolPush(const WorkFunc& func, WorkGroup* group = nullptr,
+               WorkPriority priority = kWorkNormal)
+{
+  assert(kWorkerPool.initialized);
+  if (group) ++group->outstanding;
+  while (1) {
+    {
+      LockGuard lock(&kWorkerPool.mutex);
+      WorkQueue* queue = &kWorkerPool.queues[priority];
+      if (queue->write - queue->read < kMaxWork) {
+        Work* w = &queue->work[queue->write % kMaxWork];
+        w->func = func;
+        w->group = group;
+        ++queue->write;
+        break;
+      }
+    }
+    // Queue is full - make room by doing some of the work here.
+    WorkerPoolRunOne(priority);
+  }
+  platform::SemaphorePost(&kWorkerPool.semaphore);
+}
+
+// Blocks until all work in group has run. The calling thread runs queued
+// normal work while it waits so this makes progress even with zero workers.
+// Background work is never run here - don't wait on a background group.
+void
+WorkerPoolWait(WorkGroup* group)
+{
+  while (group->outstanding) {
+    if (!WorkerPoolRunOne()) platform::ThreadYield();
+  }
+}
+
+void
+WorkerPoolShutdown()
+{
+  if (!kWorkerPool.initialized) return;
+  kWorkerPool.shutdown = true;
+  platform::SemaphorePost(&kWorkerPool.semaphore, kWorkerPool.thread_count);
+  for (u32 i = 0; i < kWorkerPool.thread_count; ++i) {
+    platform::ThreadJoin(&kWorkerPool.threads[i]);
+    kWorkerPool.threads[i] = {};
+  }
+  platform::SemaphoreFree(&kWorkerPool.semaphore);
+  platform::MutexFree(&kWorkerPool.mutex);
+  kWorkerPool.thread_count = 0;
+  for (WorkQueue& queue : kWorkerPool.queues) {
+    queue.read = 0;
+    queue.write = 0;
+  }
+  kWorkerPool.initialized = false;
+}
+
+}  // namespace util